@@ -1,7 +1,7 @@
 /** @file
 This file contains the internal functions required to generate a Firmware Volume.
 
-Copyright (c) 2004 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2004 - 2021, Intel Corporation. All rights reserved.<BR>
 Portions Copyright (c) 2011 - 2013, ARM Ltd. All rights reserved.<BR>
 Portions Copyright (c) 2016 HP Development Company, L.P.<BR>
 Portions Copyright (c) 2020, Hewlett Packard Enterprise Development LP. All rights reserved.<BR>
@@ -31,6 +31,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "WinNtInclude.h"
 #include "GenFvInternalLib.h"
+#include <Guid/FvFileIndex.h>
 #include "FvLib.h"
 #include "PeCoffLib.h"
 
@@ -47,6 +48,7 @@ EFI_GUID  mFileGuidArray [MAX_NUMBER_OF_FILES_IN_FV];
 EFI_GUID  mZeroGuid                           = {0x0, 0x0, 0x0, {0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0}};
 EFI_GUID  mDefaultCapsuleGuid                 = {0x3B6686BD, 0x0D76, 0x4030, { 0xB7, 0x0E, 0xB5, 0x51, 0x9E, 0x2F, 0xC5, 0xA0 }};
 EFI_GUID  mEfiFfsSectionAlignmentPaddingGuid  = EFI_FFS_SECTION_ALIGNMENT_PADDING_GUID;
+EFI_GUID  mEfiFvFileIndexGuid                 = EDKII_FV_FILE_INDEX_GUID;
 
 CHAR8      *mFvbAttributeName[] = {
   EFI_FVB2_READ_DISABLED_CAP_STRING,
@@ -2497,6 +2499,111 @@ Returns:
   return EFI_SUCCESS;
 }
 
+EFI_STATUS
+UpdateFvFileIndex (
+  IN MEMORY_FILE          *FvImage
+  )
+/*++
+
+Routine Description:
+
+  This function fills in the file index entry of the FV extension header, if
+  the extension header has one, with the name, type and offset of each file
+  of the FV except the pad files.
+
+Arguments:
+
+  FvImage         The memory image of the FV, with all of its files placed.
+
+Returns:
+
+  EFI_SUCCESS              The function completed successfully.
+  EFI_ABORTED              The file index entry has no room for all the files.
+
+--*/
+{
+  EFI_FIRMWARE_VOLUME_HEADER      *FvHeader;
+  EFI_FIRMWARE_VOLUME_EXT_HEADER  *ExtHeader;
+  EFI_FIRMWARE_VOLUME_EXT_ENTRY   *ExtEntry;
+  EDKII_FV_FILE_INDEX             *FileIndex;
+  EDKII_FV_FILE_INDEX_ENTRY       *Entries;
+  EFI_FFS_FILE_HEADER             *FileHeader;
+  EFI_FFS_FILE_STATE              FileState;
+  UINT32                          Capacity;
+  UINT32                          FileCount;
+  UINT32                          FileOffset;
+  UINT32                          FileLength;
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) FvImage->FileImage;
+  if (FvHeader->ExtHeaderOffset == 0) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Find the file index entry that the FV extension header file reserves.
+  //
+  FileIndex = NULL;
+  ExtHeader = (EFI_FIRMWARE_VOLUME_EXT_HEADER *) ((UINT8 *) FvHeader + FvHeader->ExtHeaderOffset);
+  for (ExtEntry = (EFI_FIRMWARE_VOLUME_EXT_ENTRY *) (ExtHeader + 1);
+       (UINTN) (ExtEntry + 1) <= (UINTN) ExtHeader + ExtHeader->ExtHeaderSize && ExtEntry->ExtEntrySize != 0;
+       ExtEntry = (EFI_FIRMWARE_VOLUME_EXT_ENTRY *) ((UINT8 *) ExtEntry + ExtEntry->ExtEntrySize)) {
+    if (ExtEntry->ExtEntryType == EFI_FV_EXT_TYPE_GUID_TYPE &&
+        ExtEntry->ExtEntrySize >= sizeof (EDKII_FV_FILE_INDEX) &&
+        CompareGuid (&((EDKII_FV_FILE_INDEX *) ExtEntry)->FormatType, &mEfiFvFileIndexGuid) == 0) {
+      FileIndex = (EDKII_FV_FILE_INDEX *) ExtEntry;
+      break;
+    }
+  }
+  if (FileIndex == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Capacity  = (FileIndex->Hdr.ExtEntrySize - sizeof (EDKII_FV_FILE_INDEX)) / sizeof (EDKII_FV_FILE_INDEX_ENTRY);
+  Entries   = (EDKII_FV_FILE_INDEX_ENTRY *) (FileIndex + 1);
+  FileCount = 0;
+
+  //
+  // Walk the files up to the free space, as the PEI Core does.
+  //
+  FileOffset = (FvHeader->HeaderLength + 7) & ~7;
+  while (FileOffset + sizeof (EFI_FFS_FILE_HEADER) <= FvHeader->FvLength) {
+    FileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) FvHeader + FileOffset);
+    FileState  = FileHeader->State;
+    if ((FvHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0) {
+      FileState = (EFI_FFS_FILE_STATE) ~FileState;
+    }
+    if ((FileState & EFI_FILE_HEADER_VALID) == 0) {
+      break;
+    }
+
+    if (FileHeader->Type != EFI_FV_FILETYPE_FFS_PAD) {
+      if (FileCount == Capacity) {
+        Warning (NULL, 0, 0, "FV file index", "The FV extension header has room for %u files only, so the file index is not generated.", (unsigned) Capacity);
+        FileIndex->FileCount = 0;
+        FileIndex->EndOffset = 0;
+        return EFI_ABORTED;
+      }
+      memcpy (&Entries[FileCount].Name, &FileHeader->Name, sizeof (EFI_GUID));
+      Entries[FileCount].Offset = FileOffset;
+      Entries[FileCount].Type   = FileHeader->Type;
+      memset (Entries[FileCount].Reserved, 0, sizeof (Entries[FileCount].Reserved));
+      FileCount++;
+    }
+
+    FileLength = GetFfsFileLength (FileHeader);
+    if (FileLength < sizeof (EFI_FFS_FILE_HEADER)) {
+      break;
+    }
+    FileOffset += (FileLength + 7) & ~7;
+  }
+
+  FileIndex->FileCount = FileCount;
+  FileIndex->EndOffset = (UINT32) MIN (FileOffset, FvHeader->FvLength);
+  DebugMsg (NULL, 0, 9, "FV file index", "%u files, end of files at 0x%x", (unsigned) FileCount, (unsigned) FileIndex->EndOffset);
+
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 GenerateFvImage (
   IN CHAR8                *InfFileImage,
@@ -2954,6 +3061,11 @@ Returns:
     }
   }
 
+  //
+  // Fill in the file index now that the files are placed.
+  //
+  UpdateFvFileIndex (&FvImageMemoryFile);
+
   if (mArm) {
     Status = UpdateArmResetVectorIfNeeded (&FvImageMemoryFile, &mFvDataInfo);
     if (EFI_ERROR (Status)) {
@@ -0,0 +1,56 @@
+/** @file
+  GUID and layout of the FV file index, that GenFv fills in when the FV
+  extension header has an entry for it.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __FV_FILE_INDEX_GUID_H__
+#define __FV_FILE_INDEX_GUID_H__
+
+#define EDKII_FV_FILE_INDEX_GUID \
+  { \
+    0x7e1c3a96, 0x4b2d, 0x4f58, {0xa1, 0x6e, 0x93, 0xd4, 0x0b, 0x5c, 0x27, 0xe8 } \
+  }
+
+///
+/// Locates a file of the FV.
+///
+typedef struct {
+  ///
+  /// The name of the file.
+  ///
+  EFI_GUID                        Name;
+  ///
+  /// The offset of the FFS file header from the FV header.
+  ///
+  UINT32                          Offset;
+  ///
+  /// The EFI_FV_FILETYPE of the file.
+  ///
+  UINT8                           Type;
+  UINT8                           Reserved[3];
+} EDKII_FV_FILE_INDEX_ENTRY;
+
+///
+/// The FV extension entry of the file index. Hdr.ExtEntryType is
+/// EFI_FV_EXT_TYPE_GUID_TYPE and FormatType is EDKII_FV_FILE_INDEX_GUID.
+/// FileCount entries follow, and room is reserved for as many as fit in
+/// Hdr.ExtEntrySize.
+///
+typedef struct {
+  EFI_FIRMWARE_VOLUME_EXT_ENTRY   Hdr;
+  EFI_GUID                        FormatType;
+  ///
+  /// The offset of the end of the last file from the FV header, or 0 if the
+  /// index has not been generated.
+  ///
+  UINT32                          EndOffset;
+  UINT32                          FileCount;
+//EDKII_FV_FILE_INDEX_ENTRY       Entries[];
+} EDKII_FV_FILE_INDEX;
+
+#endif
@@ -22,6 +22,7 @@ from Common.LongFilePathSupport import OpenLongFilePath as open
 from Common.DataType import *
 
 FV_UI_EXT_ENTY_GUID = 'A67DF1FA-8DE8-4E98-AF09-4BDF2EFFBC7C'
+FV_FILE_INDEX_EXT_ENTRY_GUID = '7E1C3A96-4B2D-4F58-A16E-93D40B5C27E8'
 
 ## generate FV
 #
@@ -55,6 +56,7 @@ class FV (object):
         self.FvForceRebase = None
         self.FvRegionInFD = None
         self.UsedSizeEnable = False
+        self.FileIndexEnable = False
         self.FvExtEntryTypeValue = []
         self.FvExtEntryType = []
         self.FvExtEntryData = []
@@ -328,6 +330,10 @@ class FV (object):
                     if self.FvAttributeDict[FvAttribute].upper() in ('TRUE', '1'):
                         self.UsedSizeEnable = True
                     continue
+                if FvAttribute == "FvFileIndexEnable":
+                    if self.FvAttributeDict[FvAttribute].upper() in ('TRUE', '1'):
+                        self.FileIndexEnable = True
+                    continue
                 self.FvInfFile.append("EFI_"            + \
                                           FvAttribute       + \
                                           ' = '             + \
@@ -343,7 +349,7 @@ class FV (object):
         # Generate FV extension header file
         #
         if not self.FvNameGuid:
-            if len(self.FvExtEntryType) > 0 or self.UsedSizeEnable:
+            if len(self.FvExtEntryType) > 0 or self.UsedSizeEnable or self.FileIndexEnable:
                 GenFdsGlobalVariable.ErrorLogger("FV Extension Header Entries declared for %s with no FvNameGuid declaration." % (self.UiFvName))
         else:
             TotalSize = 16 + 4
@@ -358,6 +364,29 @@ class FV (object):
                 # } EFI_FIRMWARE_VOLUME_EXT_ENTRY_USED_SIZE_TYPE;
                 Buffer += pack('HHL', 8, 3, 0)
 
+            if self.FileIndexEnable:
+                #
+                # Reserve the EXT entry of the FV file index, which GenFv fills
+                # in with an entry for each file once the files are placed.
+                # This GUID is used: 7E1C3A96-4B2D-4F58-A16E-93D40B5C27E8
+                #
+                # Layout:
+                #   EFI_FIRMWARE_VOLUME_EXT_ENTRY: size 4
+                #   GUID: size 16
+                #   EndOffset and FileCount: size 4 each
+                #   EDKII_FV_FILE_INDEX_ENTRY: size 24 for each file
+                #
+                FileCount = len(self.AprioriSectionList) + len(self.FfsList)
+                Size = 4 + 16 + 4 + 4 + FileCount * 24
+                if Size >= 0x10000:
+                    GenFdsGlobalVariable.ErrorLogger("The FV file index of %s for %d files exceeds 0x10000." % (self.UiFvName, FileCount))
+                TotalSize += Size
+                Guid = FV_FILE_INDEX_EXT_ENTRY_GUID.split('-')
+                Buffer += (pack('HH', Size, 0x0002)
+                           + PackGUID(Guid)
+                           + pack('=LL', 0, 0)
+                           + bytes(FileCount * 24))
+
             if self.FvNameString == 'TRUE':
                 #
                 # Create EXT entry for FV UI name
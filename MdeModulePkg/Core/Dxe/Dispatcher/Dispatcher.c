@@ -19,6 +19,12 @@
             all Befores. It then addes the item that was passed in and then
             processess the After dependecies by recursively calling the routine.
 
+  Depex evaluation is incremental. The PUSH opcodes of every Dependent driver
+  are registered in a reverse index keyed by protocol GUID, and installing a
+  protocol only queues for evaluation the drivers that reference it. Each
+  dispatch pass evaluates the queued drivers in discovery order, which is the
+  order a full scan of mDiscoveredList would schedule them in.
+
   Dispatcher Rules:
   The rules for the dispatcher are in chapter 10 of the DXE CIS. Figure 10-3
   is the state diagram for the DXE dispatcher
@@ -51,10 +57,52 @@ LIST_ENTRY  mScheduledQueue = INITIALIZE_LIST_HEAD_VARIABLE (mScheduledQueue);
 LIST_ENTRY  mFvHandleList = INITIALIZE_LIST_HEAD_VARIABLE (mFvHandleList);           // list of KNOWN_HANDLE
 
 //
-// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning.
+// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning, and the
+// depex evaluation queues and reverse index below.
 //
 EFI_LOCK  mDispatcherLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 
+//
+// Reverse index of the dependency expressions. A DEPEX_WAITER is registered
+// in mDepexWaiterHashTable for every protocol GUID pushed by the depex of a
+// Dependent driver.
+//
+#define DEPEX_WAITER_HASH_BUCKET_COUNT  64
+
+#define DEPEX_WAITER_SIGNATURE  SIGNATURE_32('d','p','x','w')
+typedef struct {
+  UINTN                   Signature;
+  LIST_ENTRY              Link;             // mDepexWaiterHashTable or mDepexRetiredList
+  EFI_GUID                Protocol;
+  EFI_CORE_DRIVER_ENTRY   *DriverEntry;
+} DEPEX_WAITER;
+
+LIST_ENTRY  mDepexWaiterHashTable[DEPEX_WAITER_HASH_BUCKET_COUNT];
+UINTN       mDepexWaiterCount = 0;
+
+//
+// Waiters of drivers that left the Dependent state. They are unlinked from
+// the index while mDispatcherLock is held, and freed by the dispatcher.
+//
+LIST_ENTRY  mDepexRetiredList = INITIALIZE_LIST_HEAD_VARIABLE (mDepexRetiredList);
+
+//
+// Drivers whose depex must be evaluated on the next dispatch pass, sorted by
+// DiscoveryOrder. List of EFI_CORE_DRIVER_ENTRY.
+//
+LIST_ENTRY  mDepexDirtyList = INITIALIZE_LIST_HEAD_VARIABLE (mDepexDirtyList);
+
+//
+// Drivers without a depex, waiting for all the Architectural Protocols to be
+// installed. List of EFI_CORE_DRIVER_ENTRY.
+//
+LIST_ENTRY  mDepexArchWaitList = INITIALIZE_LIST_HEAD_VARIABLE (mDepexArchWaitList);
+
+//
+// Order in which the next driver added to mDiscoveredList is discovered.
+//
+UINTN       mDriverDiscoveryOrder = 0;
+
 
 //
 // Flag for the DXE Dispacher.  TRUE if dispatcher is execuing.
@@ -222,6 +270,218 @@ CoreReleaseDispatcherLock (
 }
 
 
+/**
+  Returns the mDepexWaiterHashTable bucket of a protocol GUID.
+
+  @param  Protocol              The protocol GUID.
+
+  @return The bucket of the protocol GUID.
+
+**/
+STATIC
+LIST_ENTRY *
+CoreGetDepexWaiterHashBucket (
+  IN  EFI_GUID  *Protocol
+  )
+{
+  return &mDepexWaiterHashTable[CalculateGuidHash (Protocol) & (DEPEX_WAITER_HASH_BUCKET_COUNT - 1)];
+}
+
+
+/**
+  Queue a driver for the evaluation of its depex on the next dispatch pass.
+  The queue is kept in discovery order. Nothing is done if the driver is
+  already queued. The caller must hold mDispatcherLock.
+
+  @param  DriverEntry           The driver to queue.
+
+**/
+STATIC
+VOID
+CoreQueueDepexEvaluation (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  LIST_ENTRY            *Link;
+  EFI_CORE_DRIVER_ENTRY *Entry;
+
+  if (DriverEntry->DepexQueued) {
+    return;
+  }
+
+  //
+  // Drivers are mostly queued in discovery order, so search from the tail
+  //
+  for (Link = mDepexDirtyList.BackLink; Link != &mDepexDirtyList; Link = Link->BackLink) {
+    Entry = CR (Link, EFI_CORE_DRIVER_ENTRY, DepexLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    if (Entry->DiscoveryOrder < DriverEntry->DiscoveryOrder) {
+      break;
+    }
+  }
+
+  InsertHeadList (Link, &DriverEntry->DepexLink);
+  DriverEntry->DepexQueued = TRUE;
+}
+
+
+/**
+  Register a Dependent driver in the reverse index of the dependency
+  expressions under every protocol GUID that its depex pushes. Drivers with a
+  Before or After depex are not registered, as they are scheduled with the
+  driver they refer to, and drivers without a depex wait in
+  mDepexArchWaitList instead.
+
+  @param  DriverEntry           The driver to register.
+
+  @retval TRUE                  The driver is registered.
+  @retval FALSE                 There was not enough memory to register the
+                                driver. Its depex must be evaluated on every
+                                dispatch pass.
+
+**/
+STATIC
+BOOLEAN
+CoreIndexDepex (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  UINT8         *Iterator;
+  UINT8         *End;
+  DEPEX_WAITER  *Waiter;
+  LIST_ENTRY    NewWaiters;
+
+  if (DriverEntry->Depex == NULL || DriverEntry->Before || DriverEntry->After) {
+    return TRUE;
+  }
+
+  //
+  // Allocate the waiters before taking mDispatcherLock
+  //
+  InitializeListHead (&NewWaiters);
+  Iterator = DriverEntry->Depex;
+  End      = Iterator + DriverEntry->DepexSize;
+  while (Iterator < End && *Iterator != EFI_DEP_END) {
+    if (*Iterator != EFI_DEP_PUSH && *Iterator != EFI_DEP_BEFORE &&
+        *Iterator != EFI_DEP_AFTER && *Iterator != EFI_DEP_REPLACE_TRUE) {
+      Iterator++;
+      continue;
+    }
+
+    //
+    // These opcodes are followed by a GUID
+    //
+    if ((UINTN)(End - Iterator) <= sizeof (EFI_GUID)) {
+      break;
+    }
+
+    if (*Iterator == EFI_DEP_PUSH) {
+      Waiter = AllocatePool (sizeof (DEPEX_WAITER));
+      if (Waiter == NULL) {
+        while (!IsListEmpty (&NewWaiters)) {
+          Waiter = CR (NewWaiters.ForwardLink, DEPEX_WAITER, Link, DEPEX_WAITER_SIGNATURE);
+          RemoveEntryList (&Waiter->Link);
+          CoreFreePool (Waiter);
+        }
+        return FALSE;
+      }
+
+      Waiter->Signature   = DEPEX_WAITER_SIGNATURE;
+      Waiter->DriverEntry = DriverEntry;
+      CopyMem (&Waiter->Protocol, Iterator + 1, sizeof (EFI_GUID));
+      InsertTailList (&NewWaiters, &Waiter->Link);
+    }
+
+    Iterator += sizeof (EFI_GUID) + 1;
+  }
+
+  CoreAcquireDispatcherLock ();
+  while (!IsListEmpty (&NewWaiters)) {
+    Waiter = CR (NewWaiters.ForwardLink, DEPEX_WAITER, Link, DEPEX_WAITER_SIGNATURE);
+    RemoveEntryList (&Waiter->Link);
+    InsertTailList (CoreGetDepexWaiterHashBucket (&Waiter->Protocol), &Waiter->Link);
+    mDepexWaiterCount++;
+  }
+  CoreReleaseDispatcherLock ();
+
+  return TRUE;
+}
+
+
+/**
+  Tells the dispatcher that a protocol has been installed, so that the drivers
+  whose dependency expression references it are evaluated again on the next
+  dispatch pass.
+
+  @param  Protocol              The GUID of the protocol that was installed.
+
+**/
+VOID
+CoreNotifyDispatcherOfProtocol (
+  IN  EFI_GUID                *Protocol
+  )
+{
+  LIST_ENTRY    *Bucket;
+  LIST_ENTRY    *Link;
+  DEPEX_WAITER  *Waiter;
+
+  if (mDepexWaiterCount == 0) {
+    return;
+  }
+
+  CoreAcquireDispatcherLock ();
+
+  Bucket = CoreGetDepexWaiterHashBucket (Protocol);
+  for (Link = Bucket->ForwardLink; Link != Bucket; ) {
+    Waiter = CR (Link, DEPEX_WAITER, Link, DEPEX_WAITER_SIGNATURE);
+    Link   = Link->ForwardLink;
+    if (!CompareGuid (&Waiter->Protocol, Protocol)) {
+      continue;
+    }
+
+    if (Waiter->DriverEntry->Dependent) {
+      CoreQueueDepexEvaluation (Waiter->DriverEntry);
+    } else {
+      //
+      // The driver has been scheduled and never waits on a protocol again
+      //
+      RemoveEntryList (&Waiter->Link);
+      InsertTailList (&mDepexRetiredList, &Waiter->Link);
+      mDepexWaiterCount--;
+    }
+  }
+
+  CoreReleaseDispatcherLock ();
+}
+
+
+/**
+  Free the waiters retired from the reverse index of the dependency
+  expressions.
+
+**/
+STATIC
+VOID
+CoreFreeRetiredDepexWaiters (
+  VOID
+  )
+{
+  DEPEX_WAITER  *Waiter;
+
+  while (TRUE) {
+    CoreAcquireDispatcherLock ();
+    if (IsListEmpty (&mDepexRetiredList)) {
+      CoreReleaseDispatcherLock ();
+      break;
+    }
+    Waiter = CR (mDepexRetiredList.ForwardLink, DEPEX_WAITER, Link, DEPEX_WAITER_SIGNATURE);
+    RemoveEntryList (&Waiter->Link);
+    CoreReleaseDispatcherLock ();
+
+    CoreFreePool (Waiter);
+  }
+}
+
+
 /**
   Read Depex and pre-process the Depex for Before and After. If Section Extraction
   protocol returns an error via ReadSection defer the reading of the Depex.
@@ -325,6 +585,7 @@ CoreSchedule (
       CoreAcquireDispatcherLock ();
       DriverEntry->Unrequested  = FALSE;
       DriverEntry->Dependent    = TRUE;
+      CoreQueueDepexEvaluation (DriverEntry);
       CoreReleaseDispatcherLock ();
 
       DEBUG ((DEBUG_DISPATCH, "Schedule FFS(%g) - EFI_SUCCESS\n", DriverName));
@@ -407,10 +668,11 @@ CoreDispatcher (
 {
   EFI_STATUS                      Status;
   EFI_STATUS                      ReturnStatus;
-  LIST_ENTRY                      *Link;
   EFI_CORE_DRIVER_ENTRY           *DriverEntry;
   BOOLEAN                         ReadyToRun;
   EFI_EVENT                       DxeDispatchEvent;
+  LIST_ENTRY                      RetryList;
+  LIST_ENTRY                      *WaitList;
 
   PERF_FUNCTION_BEGIN ();
 
@@ -542,12 +804,38 @@ CoreDispatcher (
       CoreSignalEvent (DxeDispatchEvent);
     }
 
+    CoreFreeRetiredDepexWaiters ();
+
+    //
+    // Queue the drivers without a depex once all the Architectural Protocols
+    // are installed
+    //
+    CoreAcquireDispatcherLock ();
+    if (!IsListEmpty (&mDepexArchWaitList) && !EFI_ERROR (CoreAllEfiServicesAvailable ())) {
+      while (!IsListEmpty (&mDepexArchWaitList)) {
+        DriverEntry = CR (mDepexArchWaitList.ForwardLink, EFI_CORE_DRIVER_ENTRY, DepexLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+        RemoveEntryList (&DriverEntry->DepexLink);
+        DriverEntry->DepexQueued = FALSE;
+        CoreQueueDepexEvaluation (DriverEntry);
+      }
+    }
+    CoreReleaseDispatcherLock ();
+
     //
-    // Search DriverList for items to place on Scheduled Queue
+    // Evaluate the queued drivers for items to place on Scheduled Queue
     //
     ReadyToRun = FALSE;
-    for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
-      DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    InitializeListHead (&RetryList);
+    while (TRUE) {
+      CoreAcquireDispatcherLock ();
+      if (IsListEmpty (&mDepexDirtyList)) {
+        CoreReleaseDispatcherLock ();
+        break;
+      }
+      DriverEntry = CR (mDepexDirtyList.ForwardLink, EFI_CORE_DRIVER_ENTRY, DepexLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+      RemoveEntryList (&DriverEntry->DepexLink);
+      DriverEntry->DepexQueued = FALSE;
+      CoreReleaseDispatcherLock ();
 
       if (DriverEntry->DepexProtocolError){
         //
@@ -556,19 +844,57 @@ CoreDispatcher (
         Status = CoreGetDepexSectionAndPreProccess (DriverEntry);
       }
 
+      WaitList = NULL;
       if (DriverEntry->Dependent) {
+        //
+        // Register the driver in the reverse index before evaluating its
+        // depex, so that no protocol installation is missed
+        //
+        if (!DriverEntry->DepexIndexed) {
+          DriverEntry->DepexIndexed = CoreIndexDepex (DriverEntry);
+        }
+
         if (CoreIsSchedulable (DriverEntry)) {
           CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (DriverEntry);
           ReadyToRun = TRUE;
+        } else if (!DriverEntry->DepexIndexed) {
+          WaitList = &RetryList;
+        } else if (DriverEntry->Depex == NULL) {
+          WaitList = &mDepexArchWaitList;
         }
       } else {
+        if (DriverEntry->DepexProtocolError) {
+          WaitList = &RetryList;
+        }
         if (DriverEntry->Unrequested) {
           DEBUG ((DEBUG_DISPATCH, "Evaluate DXE DEPEX for FFS(%g)\n", &DriverEntry->FileName));
           DEBUG ((DEBUG_DISPATCH, "  SOR                                             = Not Requested\n"));
           DEBUG ((DEBUG_DISPATCH, "  RESULT = FALSE\n"));
         }
       }
+
+      if (WaitList != NULL) {
+        CoreAcquireDispatcherLock ();
+        if (!DriverEntry->DepexQueued) {
+          InsertTailList (WaitList, &DriverEntry->DepexLink);
+          DriverEntry->DepexQueued = TRUE;
+        }
+        CoreReleaseDispatcherLock ();
+      }
     }
+
+    //
+    // Evaluate again on the next pass the drivers whose depex could not be
+    // read or registered
+    //
+    CoreAcquireDispatcherLock ();
+    while (!IsListEmpty (&RetryList)) {
+      DriverEntry = CR (RetryList.ForwardLink, EFI_CORE_DRIVER_ENTRY, DepexLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+      RemoveEntryList (&DriverEntry->DepexLink);
+      DriverEntry->DepexQueued = FALSE;
+      CoreQueueDepexEvaluation (DriverEntry);
+    }
+    CoreReleaseDispatcherLock ();
   } while (ReadyToRun);
 
   //
@@ -891,6 +1217,8 @@ CoreAddToDriverList (
   CoreAcquireDispatcherLock ();
 
   InsertTailList (&mDiscoveredList, &DriverEntry->Link);
+  DriverEntry->DiscoveryOrder = mDriverDiscoveryOrder++;
+  CoreQueueDepexEvaluation (DriverEntry);
 
   CoreReleaseDispatcherLock ();
 
@@ -1449,8 +1777,14 @@ CoreInitializeDispatcher (
   VOID
   )
 {
+  UINTN  Index;
+
   PERF_FUNCTION_BEGIN ();
 
+  for (Index = 0; Index < DEPEX_WAITER_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&mDepexWaiterHashTable[Index]);
+  }
+
   mFwVolEvent = EfiCreateProtocolNotifyEvent (
                   &gEfiFirmwareVolume2ProtocolGuid,
                   TPL_CALLBACK,
@@ -51,6 +51,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
 #include <Guid/HobList.h>
+#include <Guid/HobIndex.h>
 #include <Guid/DebugImageInfoTable.h>
 #include <Guid/FileInfo.h>
 #include <Guid/Apriori.h>
@@ -70,6 +71,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiLib.h>
 #include <Library/BaseLib.h>
 #include <Library/HobLib.h>
+#include <Library/HobIndexLib.h>
 #include <Library/PerformanceLib.h>
 #include <Library/UefiDecompressLib.h>
 #include <Library/ExtractGuidedSectionLib.h>
@@ -124,6 +126,32 @@ typedef struct {
   BOOLEAN                     Present;
 } EFI_CORE_PROTOCOL_NOTIFY_ENTRY;
 
+///
+/// ADDRESS_INDEX_NODE - node of an address ordered index, embedded in each
+/// descriptor of an indexed memory map.
+///
+typedef struct _ADDRESS_INDEX_NODE  ADDRESS_INDEX_NODE;
+struct _ADDRESS_INDEX_NODE {
+  ADDRESS_INDEX_NODE  *Left;
+  ADDRESS_INDEX_NODE  *Right;
+  /// Base address of the descriptor
+  UINT64              Key;
+  /// Caller defined weight of the descriptor, used to prune searches
+  UINT64              Weight;
+  /// Largest Weight in the subtree rooted at this node
+  UINT64              MaxWeight;
+  /// Height of the subtree rooted at this node, 0 if not in an index
+  UINT32              Height;
+};
+
+///
+/// ADDRESS_INDEX - address ordered index over the descriptors of a memory map
+///
+typedef struct {
+  ADDRESS_INDEX_NODE  *Root;
+  UINTN               Count;
+} ADDRESS_INDEX;
+
 //
 // DXE Dispatcher Data structures
 //
@@ -166,6 +194,11 @@ typedef struct {
   EFI_HANDLE                      ImageHandle;
   BOOLEAN                         IsFvImage;
 
+  LIST_ENTRY                      DepexLink;        // mDepexDirtyList or mDepexArchWaitList
+  BOOLEAN                         DepexQueued;
+  BOOLEAN                         DepexIndexed;
+  UINTN                           DiscoveryOrder;
+
 } EFI_CORE_DRIVER_ENTRY;
 
 //
@@ -183,6 +216,7 @@ typedef struct {
   EFI_GCD_IO_TYPE       GcdIoType;
   EFI_HANDLE            ImageHandle;
   EFI_HANDLE            DeviceHandle;
+  ADDRESS_INDEX_NODE    IndexNode;
 } EFI_GCD_MAP_ENTRY;
 
 
@@ -305,6 +339,52 @@ CoreInitializePool (
   );
 
 
+/**
+  Allocates a zeroed small fixed size object of EfiBootServicesData.
+
+  The object comes from a slab page of its size class when the slab fast path
+  is enabled, and from the regular pool otherwise. The object must be freed
+  with CoreFreeSlabPool() and the same Size.
+
+  @param  Size                   The size of the object to allocate
+
+  @return The allocated object, or NULL
+
+**/
+VOID *
+CoreAllocateSlabPool (
+  IN UINTN  Size
+  );
+
+
+/**
+  Frees an object allocated with CoreAllocateSlabPool().
+
+  @param  Buffer                 The object to free
+  @param  Size                   The size passed to CoreAllocateSlabPool()
+
+  @retval EFI_INVALID_PARAMETER  Buffer is not a valid slab object of Size bytes.
+  @retval EFI_SUCCESS            The object was successfully freed.
+
+**/
+EFI_STATUS
+CoreFreeSlabPool (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  );
+
+
+/**
+  Reports how many allocations the slab fast path absorbed and how much pool
+  memory it saved.
+
+**/
+VOID
+CoreDumpSlabPoolStatistics (
+  VOID
+  );
+
+
 /**
   Called to initialize the memory map and add descriptors to
   the current descriptor list.
@@ -520,6 +600,20 @@ CorePreProcessDepex (
   );
 
 
+/**
+  Tells the dispatcher that a protocol has been installed, so that the drivers
+  whose dependency expression references it are evaluated again on the next
+  dispatch pass.
+
+  @param  Protocol              The GUID of the protocol that was installed.
+
+**/
+VOID
+CoreNotifyDispatcherOfProtocol (
+  IN  EFI_GUID                *Protocol
+  );
+
+
 
 /**
   Terminates all boot services.
@@ -591,6 +685,19 @@ CoreInstallConfigurationTable (
   IN VOID     *Table
   );
 
+/**
+  Builds the index of a HOB list.
+
+  @param  HobList                The HOB list.
+
+  @return The HOB index, or NULL if it could not be allocated.
+
+**/
+EDKII_HOB_INDEX *
+CoreBuildHobIndex (
+  IN VOID  *HobList
+  );
+
 
 
 /**
@@ -2101,6 +2208,47 @@ FwVolDriverInit (
   );
 
 
+/**
+  Locates a section in a given FFS File of a firmware volume produced by the
+  DXE Core, and returns a pointer to its contents in the section stream
+  database of the file instead of a copy.  Compressed and GUIDed
+  encapsulations of the file are extracted only once, the first time one of
+  their sections is read, and stay cached with the file.
+
+  The returned buffer stays valid as long as the firmware volume, and must
+  not be modified or freed by the caller.
+
+  @param  FwVol                      The firmware volume protocol instance.
+  @param  NameGuid                   Pointer to an EFI_GUID, which is the
+                                     filename.
+  @param  SectionType                Indicates the section type to return.
+  @param  SectionInstance            Indicates which instance of sections with a
+                                     type of SectionType to return.
+  @param  Buffer                     On output, points to the section contents.
+  @param  BufferSize                 On output, the size of the section
+                                     contents.
+  @param  AuthenticationStatus       On output, the authentication status of
+                                     the section, as returned by ReadSection().
+
+  @retval EFI_SUCCESS                The section was found.
+  @retval EFI_UNSUPPORTED            FwVol is not produced by the DXE Core.
+  @retval EFI_NOT_FOUND              Section not found.
+  @retval EFI_INVALID_PARAMETER      Invalid parameter.
+  @retval Others                     The section could not be extracted.
+
+**/
+EFI_STATUS
+FvLocateFileSection (
+  IN  EFI_FIRMWARE_VOLUME2_PROTOCOL  *FwVol,
+  IN  CONST EFI_GUID                 *NameGuid,
+  IN  EFI_SECTION_TYPE               SectionType,
+  IN  UINTN                          SectionInstance,
+  OUT VOID                           **Buffer,
+  OUT UINTN                          *BufferSize,
+  OUT UINT32                         *AuthenticationStatus
+  );
+
+
 /**
   Entry point of the section extraction code. Initializes an instance of the
   section extraction interface and installs it on a new handle.
@@ -2461,6 +2609,53 @@ GetSection (
   );
 
 
+/**
+  Retrieves requested section from section stream without copying it.  The
+  section contents stay in the section stream database, so repeated reads of
+  an encapsulated section never extract it again, and the returned buffer
+  remains valid until the section stream is closed.  It must not be modified
+  or freed by the caller.
+
+  @param  SectionStreamHandle   The section stream from which to retrieve the
+                                requested section.
+  @param  SectionType           A pointer to the type of section to search for,
+                                or NULL for the whole section stream.
+  @param  SectionDefinitionGuid If the section type is EFI_SECTION_GUID_DEFINED,
+                                then SectionDefinitionGuid indicates which of
+                                these types of sections to search for.
+  @param  SectionInstance       Indicates which instance of the requested
+                                section to return.
+  @param  Buffer                On output, points to the section contents.
+  @param  BufferSize            On output, the size of the section contents.
+  @param  AuthenticationStatus  On output, the authentication status of the
+                                section, as returned by GetSection().
+  @param  IsFfs3Fv              Indicates the FV format.
+
+  @retval EFI_SUCCESS           Section was retrieved successfully
+  @retval EFI_PROTOCOL_ERROR    A GUID defined section was encountered in the
+                                section stream with its
+                                EFI_GUIDED_SECTION_PROCESSING_REQUIRED bit set,
+                                but there was no corresponding GUIDed Section
+                                Extraction Protocol in the handle database.
+  @retval EFI_NOT_FOUND         The requested section does not exist.
+  @retval EFI_OUT_OF_RESOURCES  The system has insufficient resources to process
+                                the request.
+  @retval EFI_INVALID_PARAMETER The SectionStreamHandle does not exist.
+
+**/
+EFI_STATUS
+GetSectionInPlace (
+  IN  UINTN                                             SectionStreamHandle,
+  IN  EFI_SECTION_TYPE                                  *SectionType,
+  IN  EFI_GUID                                          *SectionDefinitionGuid,
+  IN  UINTN                                             SectionInstance,
+  OUT VOID                                              **Buffer,
+  OUT UINTN                                             *BufferSize,
+  OUT UINT32                                            *AuthenticationStatus,
+  IN  BOOLEAN                                           IsFfs3Fv
+  );
+
+
 /**
   SEP member function.  Deletes an existing section stream
 
@@ -2650,6 +2845,82 @@ CoreReleaseLock (
   IN EFI_LOCK  *Lock
   );
 
+
+/**
+  Inserts a node in an address index.
+
+  @param  Index                  The address index.
+  @param  Node                   The node to insert. It must not be in an index.
+  @param  Key                    The key of the node, usually the base address
+                                 of the descriptor that embeds it.
+  @param  Weight                 The weight of the node.
+
+**/
+VOID
+CoreAddressIndexInsert (
+  IN OUT ADDRESS_INDEX       *Index,
+  IN OUT ADDRESS_INDEX_NODE  *Node,
+  IN     UINT64              Key,
+  IN     UINT64              Weight
+  );
+
+
+/**
+  Removes a node from an address index. Nothing is done if the node is not
+  in an index.
+
+  The key and the weight of a node must not change while it is in an index,
+  so a node is removed before its descriptor is updated, and inserted again
+  afterwards.
+
+  @param  Index                  The address index.
+  @param  Node                   The node to remove.
+
+**/
+VOID
+CoreAddressIndexRemove (
+  IN OUT ADDRESS_INDEX       *Index,
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  );
+
+
+/**
+  Finds the node with the highest key that is not above MaxKey and whose
+  weight is at least MinWeight.
+
+  @param  Index                  The address index.
+  @param  MaxKey                 The highest key to return.
+  @param  MinWeight              The lowest weight to return. 0 matches any node.
+
+  @return The node found, or NULL.
+
+**/
+ADDRESS_INDEX_NODE *
+CoreAddressIndexFindPrevious (
+  IN ADDRESS_INDEX  *Index,
+  IN UINT64         MaxKey,
+  IN UINT64         MinWeight
+  );
+
+
+/**
+  Finds the node with the lowest key that is not below MinKey and whose
+  weight is at least MinWeight.
+
+  @param  Index                  The address index.
+  @param  MinKey                 The lowest key to return.
+  @param  MinWeight              The lowest weight to return. 0 matches any node.
+
+  @return The node found, or NULL.
+
+**/
+ADDRESS_INDEX_NODE *
+CoreAddressIndexFindNext (
+  IN ADDRESS_INDEX  *Index,
+  IN UINT64         MinKey,
+  IN UINT64         MinWeight
+  );
+
 /**
   Read data from Firmware Block by FVB protocol Read.
   The data may cross the multi block ranges.
@@ -1,7 +1,7 @@
 /** @file
   DXE Core Main Entry Point
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -243,6 +243,7 @@ DxeMain (
   EFI_VECTOR_HANDOFF_INFO       *VectorInfoList;
   EFI_VECTOR_HANDOFF_INFO       *VectorInfo;
   VOID                          *EntryPoint;
+  EDKII_HOB_INDEX               *HobIndex;
 
   //
   // Setup the default exception handlers
@@ -333,6 +334,17 @@ DxeMain (
   Status = CoreInstallConfigurationTable (&gEfiHobListGuid, HobStart);
   ASSERT_EFI_ERROR (Status);
 
+  //
+  // Install the HOB index into the EFI System Tables's Configuration Table, so
+  // that the HOB libraries of the DXE drivers find HOBs without walking the
+  // HOB list
+  //
+  HobIndex = CoreBuildHobIndex (HobStart);
+  if (HobIndex != NULL) {
+    Status = CoreInstallConfigurationTable (&gEdkiiHobIndexGuid, HobIndex);
+    ASSERT_EFI_ERROR (Status);
+  }
+
   //
   // Install Memory Type Information Table into the EFI System Tables's Configuration Table
   //
@@ -767,6 +779,10 @@ CoreExitBootServices (
 
   gMemoryMapTerminated = TRUE;
 
+  DEBUG_CODE_BEGIN ();
+  CoreDumpSlabPoolStatistics ();
+  DEBUG_CODE_END ();
+
   //
   // Notify other drivers that we are exiting boot services.
   //
@@ -32,9 +32,11 @@ LIST_ENTRY      gEventQueue[TPL_HIGH_LEVEL + 1];
 UINTN           gEventPending = 0;
 
 ///
-/// gEventSignalQueue - A list of events to signal based on EventGroup type
+/// gEventGroupHashTable - The events to signal indexed by EventGroup. Events
+/// created without an EventGroup are members of the all zero GUID group.
 ///
-LIST_ENTRY      gEventSignalQueue = INITIALIZE_LIST_HEAD_VARIABLE (gEventSignalQueue);
+LIST_ENTRY      gEventGroupHashTable[EVENT_GROUP_HASH_BUCKET_COUNT];
+BOOLEAN         mEventGroupHashTableReady = FALSE;
 
 ///
 /// Enumerate the valid types
@@ -114,6 +116,68 @@ CoreReleaseEventLock (
 }
 
 
+/**
+  Returns the gEventGroupHashTable bucket of an event group. The event group
+  index is initialized on first use, as event groups can be signalled before
+  the event services are initialized.
+
+  @param  EventGroup             The GUID of the event group.
+
+  @return The bucket of the event group.
+
+**/
+STATIC
+LIST_ENTRY *
+CoreGetEventGroupHashBucket (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  UINTN   Index;
+
+  if (!mEventGroupHashTableReady) {
+    for (Index = 0; Index < EVENT_GROUP_HASH_BUCKET_COUNT; Index++) {
+      InitializeListHead (&gEventGroupHashTable[Index]);
+    }
+    mEventGroupHashTableReady = TRUE;
+  }
+
+  return &gEventGroupHashTable[CalculateGuidHash (EventGroup) & (EVENT_GROUP_HASH_BUCKET_COUNT - 1)];
+}
+
+
+/**
+  Finds an event group in the event group index. The event database must be
+  locked.
+
+  @param  EventGroup             The GUID of the event group.
+
+  @return The event group, or NULL if it has no member yet.
+
+**/
+STATIC
+EVENT_GROUP *
+CoreFindEventGroup (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  LIST_ENTRY   *Link;
+  LIST_ENTRY   *Head;
+  EVENT_GROUP  *Group;
+
+  ASSERT_LOCKED (&gEventQueueLock);
+
+  Head = CoreGetEventGroupHashBucket (EventGroup);
+  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+    Group = CR (Link, EVENT_GROUP, Link, EVENT_GROUP_SIGNATURE);
+    if (CompareGuid (&Group->EventGroup, EventGroup)) {
+      return Group;
+    }
+  }
+
+  return NULL;
+}
+
+
 
 /**
   Initializes "event" support.
@@ -199,7 +263,7 @@ CoreDispatchEventNotifies (
     CoreAcquireEventLock ();
   }
 
-  gEventPending &= ~(UINTN)(1 << Priority);
+  gEventPending &= ~((UINTN)1 << Priority);
   CoreReleaseEventLock ();
 }
 
@@ -236,7 +300,7 @@ CoreNotifyEvent (
   //
 
   InsertTailList (&gEventQueue[Event->NotifyTpl], &Event->NotifyLink);
-  gEventPending |= (UINTN)(1 << Event->NotifyTpl);
+  gEventPending |= (UINTN)1 << Event->NotifyTpl;
 }
 
 
@@ -254,15 +318,15 @@ CoreNotifySignalList (
   )
 {
   LIST_ENTRY              *Link;
-  LIST_ENTRY              *Head;
+  EVENT_GROUP             *Group;
   IEVENT                  *Event;
 
   CoreAcquireEventLock ();
 
-  Head = &gEventSignalQueue;
-  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
-    Event = CR (Link, IEVENT, SignalLink, EVENT_SIGNATURE);
-    if (CompareGuid (&Event->EventGroup, EventGroup)) {
+  Group = CoreFindEventGroup (EventGroup);
+  if (Group != NULL) {
+    for (Link = Group->Members.ForwardLink; Link != &Group->Members; Link = Link->ForwardLink) {
+      Event = CR (Link, IEVENT, SignalLink, EVENT_SIGNATURE);
       CoreNotifyEvent (Event);
     }
   }
@@ -382,6 +446,9 @@ CoreCreateEventInternal (
 {
   EFI_STATUS      Status;
   IEVENT          *IEvent;
+  EVENT_GROUP     *Group;
+  EVENT_GROUP     *NewGroup;
+  EFI_GUID        GroupGuid;
   INTN            Index;
 
 
@@ -452,15 +519,40 @@ CoreCreateEventInternal (
     NotifyContext = NULL;
   }
 
+  //
+  // If the event is the first member of its group, allocate the group now, as
+  // it cannot be allocated while the event database is locked.
+  //
+  NewGroup = NULL;
+  if ((Type & EVT_NOTIFY_SIGNAL) != 0x00000000) {
+    ZeroMem (&GroupGuid, sizeof (EFI_GUID));
+    if (EventGroup != NULL) {
+      CopyGuid (&GroupGuid, EventGroup);
+    }
+
+    CoreAcquireEventLock ();
+    Group = CoreFindEventGroup (&GroupGuid);
+    CoreReleaseEventLock ();
+    if (Group == NULL) {
+      NewGroup = AllocatePool (sizeof (EVENT_GROUP));
+      if (NewGroup == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+  }
+
   //
   // Allocate and initialize a new event structure.
   //
   if ((Type & EVT_RUNTIME) != 0) {
     IEvent = AllocateRuntimeZeroPool (sizeof (IEVENT));
   } else {
-    IEvent = AllocateZeroPool (sizeof (IEVENT));
+    IEvent = CoreAllocateSlabPool (sizeof (IEVENT));
   }
   if (IEvent == NULL) {
+    if (NewGroup != NULL) {
+      CoreFreePool (NewGroup);
+    }
     return EFI_OUT_OF_RESOURCES;
   }
 
@@ -503,11 +595,26 @@ CoreCreateEventInternal (
     //
     // The Event's NotifyFunction must be queued whenever the event is signaled
     //
-    InsertHeadList (&gEventSignalQueue, &IEvent->SignalLink);
+    Group = CoreFindEventGroup (&IEvent->EventGroup);
+    if (Group == NULL) {
+      ASSERT (NewGroup != NULL);
+      NewGroup->Signature = EVENT_GROUP_SIGNATURE;
+      CopyGuid (&NewGroup->EventGroup, &IEvent->EventGroup);
+      InitializeListHead (&NewGroup->Members);
+      InsertTailList (CoreGetEventGroupHashBucket (&NewGroup->EventGroup), &NewGroup->Link);
+      Group    = NewGroup;
+      NewGroup = NULL;
+    }
+
+    InsertHeadList (&Group->Members, &IEvent->SignalLink);
   }
 
   CoreReleaseEventLock ();
 
+  if (NewGroup != NULL) {
+    CoreFreePool (NewGroup);
+  }
+
   //
   // Done
   //
@@ -776,7 +883,11 @@ CoreCloseEvent (
   // clear the Signature of Event before free pool.
   //
   Event->Signature = 0;
-  Status = CoreFreePool (Event);
+  if ((Event->Type & EVT_RUNTIME) != 0) {
+    Status = CoreFreePool (Event);
+  } else {
+    Status = CoreFreeSlabPool (Event, sizeof (IEVENT));
+  }
   ASSERT_EFI_ERROR (Status);
 
   return Status;
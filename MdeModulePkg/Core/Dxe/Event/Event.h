@@ -23,6 +23,28 @@ extern  UINTN                   gEventPending;
 ///
 #define EVT_EXFLAG_EVENT_PROTOCOL_NOTIFICATION    0x02
 
+///
+/// Number of buckets of the event group index. Must be a power of 2.
+///
+#define EVENT_GROUP_HASH_BUCKET_COUNT             32
+
+///
+/// Event group of the event group index. Event groups are never freed.
+///
+#define EVENT_GROUP_SIGNATURE   SIGNATURE_32('e','v','g','p')
+typedef struct {
+  UINTN                   Signature;
+  ///
+  /// Entry in its bucket of the event group index
+  ///
+  LIST_ENTRY              Link;
+  EFI_GUID                EventGroup;
+  ///
+  /// List of the events of the group, linked by SignalLink
+  ///
+  LIST_ENTRY              Members;
+} EVENT_GROUP;
+
 //
 // EFI_EVENT
 //
@@ -42,7 +64,8 @@ typedef struct {
   UINT32                  Type;
   UINT32                  SignalCount;
   ///
-  /// Entry if the event is registered to be signalled
+  /// Entry in the members of its event group if the event is registered to
+  /// be signalled
   ///
   LIST_ENTRY              SignalLink;
   ///
@@ -10,11 +10,43 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "DxeMain.h"
 #include "Event.h"
 
+//
+// The timer database is a hierarchical timing wheel. The system time is cut
+// into ticks of 2^TIMER_WHEEL_TICK_SHIFT 100ns units, and each level of the
+// wheel has TIMER_WHEEL_SLOT_COUNT slots, each one covering
+// TIMER_WHEEL_SLOT_COUNT times the ticks of a slot of the level below.
+//
+// A timer is queued in the lowest level whose slots still cover its trigger
+// tick from mEfiTimerWheelTick, so insertion and cancellation are O(1). When
+// mEfiTimerWheelTick enters the range of a slot of an upper level, the timers
+// of that slot are cascaded to the levels below. The timers of a level 0
+// slot are not sorted, and are checked one by one when the slot is due.
+//
+#define TIMER_WHEEL_TICK_SHIFT    16
+#define TIMER_WHEEL_LEVEL_SHIFT   6
+#define TIMER_WHEEL_SLOT_COUNT    (1 << TIMER_WHEEL_LEVEL_SHIFT)
+#define TIMER_WHEEL_LEVEL_COUNT   ((64 - TIMER_WHEEL_TICK_SHIFT + TIMER_WHEEL_LEVEL_SHIFT - 1) / TIMER_WHEEL_LEVEL_SHIFT)
+
 //
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+LIST_ENTRY       mEfiTimerWheel[TIMER_WHEEL_LEVEL_COUNT][TIMER_WHEEL_SLOT_COUNT];
+//
+// Bitmaps of the slots that may hold timers, one bit per slot. A bit is
+// cleared lazily when its slot is found empty.
+//
+UINT64           mEfiTimerWheelBitmap[TIMER_WHEEL_LEVEL_COUNT];
+//
+// The tick that is being processed. All the slots of the ticks before it have
+// been processed.
+//
+UINT64           mEfiTimerWheelTick = 0;
+//
+// A lower bound of the trigger time of the queued timers, checked by
+// CoreTimerTick () on every tick.
+//
+UINT64           mEfiTimerNextTriggerTime = MAX_UINT64;
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
@@ -36,29 +68,256 @@ CoreInsertEventTimer (
   IN IEVENT   *Event
   )
 {
-  UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  UINT64          TriggerTick;
+  UINTN           Level;
+  UINTN           Slot;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
   //
-  // Get the timer's trigger time
+  // A timer that is already due is queued in the slot being processed
   //
-  TriggerTime = Event->Timer.TriggerTime;
+  TriggerTick = RShiftU64 (Event->Timer.TriggerTime, TIMER_WHEEL_TICK_SHIFT);
+  if (TriggerTick < mEfiTimerWheelTick) {
+    TriggerTick = mEfiTimerWheelTick;
+  }
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Find the lowest level whose slots cover the trigger tick
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  for (Level = 0; Level < TIMER_WHEEL_LEVEL_COUNT - 1; Level++) {
+    if (RShiftU64 (TriggerTick ^ mEfiTimerWheelTick, TIMER_WHEEL_LEVEL_SHIFT * (Level + 1)) == 0) {
+      break;
+    }
+  }
+
+  Slot = (UINTN) RShiftU64 (TriggerTick, TIMER_WHEEL_LEVEL_SHIFT * Level) & (TIMER_WHEEL_SLOT_COUNT - 1);
+  InsertTailList (&mEfiTimerWheel[Level][Slot], &Event->Timer.Link);
+  mEfiTimerWheelBitmap[Level] |= LShiftU64 (1, Slot);
+
+  if (Event->Timer.TriggerTime < mEfiTimerNextTriggerTime) {
+    mEfiTimerNextTriggerTime = Event->Timer.TriggerTime;
+  }
+}
+
+/**
+  Returns the first tick after mEfiTimerWheelTick at which a slot of an upper
+  level of the timer wheel must be cascaded.
+
+  @return The tick, or MAX_UINT64 if the upper levels are empty.
+
+**/
+STATIC
+UINT64
+CoreNextTimerWheelCascade (
+  VOID
+  )
+{
+  UINTN           Level;
+  UINTN           Slot;
+  UINT64          Bitmap;
+  UINT64          Tick;
+  UINT64          NextTick;
+
+  NextTick = MAX_UINT64;
+  for (Level = 1; Level < TIMER_WHEEL_LEVEL_COUNT; Level++) {
+    //
+    // The slots of the level after the one holding mEfiTimerWheelTick
+    //
+    Slot   = (UINTN) RShiftU64 (mEfiTimerWheelTick, TIMER_WHEEL_LEVEL_SHIFT * Level) & (TIMER_WHEEL_SLOT_COUNT - 1);
+    Bitmap = mEfiTimerWheelBitmap[Level] & LShiftU64 (LShiftU64 (MAX_UINT64, Slot), 1);
+    if (Bitmap == 0) {
+      continue;
+    }
+
+    Tick = RShiftU64 (mEfiTimerWheelTick, TIMER_WHEEL_LEVEL_SHIFT * (Level + 1));
+    Tick = LShiftU64 (LShiftU64 (Tick, TIMER_WHEEL_LEVEL_SHIFT) + LowBitSet64 (Bitmap), TIMER_WHEEL_LEVEL_SHIFT * Level);
+    if (Tick < NextTick) {
+      NextTick = Tick;
+    }
+  }
+
+  return NextTick;
+}
+
+/**
+  Cascades to the lower levels of the timer wheel the slots of the upper
+  levels that mEfiTimerWheelTick has just entered.
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
+**/
+STATIC
+VOID
+CoreCascadeTimerWheel (
+  VOID
+  )
+{
+  UINTN           Level;
+  UINTN           Slot;
+  LIST_ENTRY      *Head;
+  IEVENT          *Event;
+
+  for (Level = 1; Level < TIMER_WHEEL_LEVEL_COUNT; Level++) {
+    //
+    // The slots of a level are only entered at the start of their range
+    //
+    if ((mEfiTimerWheelTick & (LShiftU64 (1, TIMER_WHEEL_LEVEL_SHIFT * Level) - 1)) != 0) {
       break;
     }
+
+    Slot = (UINTN) RShiftU64 (mEfiTimerWheelTick, TIMER_WHEEL_LEVEL_SHIFT * Level) & (TIMER_WHEEL_SLOT_COUNT - 1);
+    Head = &mEfiTimerWheel[Level][Slot];
+    mEfiTimerWheelBitmap[Level] &= ~LShiftU64 (1, Slot);
+    while (!IsListEmpty (Head)) {
+      Event = CR (Head->ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+      RemoveEntryList (&Event->Timer.Link);
+      CoreInsertEventTimer (Event);
+    }
   }
+}
+
+/**
+  Moves the expired timers of a level 0 slot of the timer wheel to a list
+  sorted by trigger time. The timers of the slot that are not expired stay in
+  the slot.
+
+  @param  Slot                   The level 0 slot.
+  @param  SystemTime             The current system time.
+  @param  ExpiredList            The list of expired timers.
 
-  InsertTailList (Link, &Event->Timer.Link);
+**/
+STATIC
+VOID
+CoreExpireTimerWheelSlot (
+  IN     UINTN       Slot,
+  IN     UINT64      SystemTime,
+  IN OUT LIST_ENTRY  *ExpiredList
+  )
+{
+  LIST_ENTRY      *Head;
+  LIST_ENTRY      *Link;
+  LIST_ENTRY      *NextLink;
+  LIST_ENTRY      *Position;
+  IEVENT          *Event;
+  IEVENT          *Event2;
+
+  Head = &mEfiTimerWheel[0][Slot];
+  for (Link = Head->ForwardLink; Link != Head; Link = NextLink) {
+    NextLink = Link->ForwardLink;
+    Event    = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    if (Event->Timer.TriggerTime > SystemTime) {
+      continue;
+    }
+
+    //
+    // Keep the expired timers in assending trigger time order
+    //
+    RemoveEntryList (&Event->Timer.Link);
+    for (Position = ExpiredList->BackLink; Position != ExpiredList; Position = Position->BackLink) {
+      Event2 = CR (Position, IEVENT, Timer.Link, EVENT_SIGNATURE);
+      if (Event2->Timer.TriggerTime <= Event->Timer.TriggerTime) {
+        break;
+      }
+    }
+    InsertHeadList (Position, &Event->Timer.Link);
+  }
+
+  if (IsListEmpty (Head)) {
+    mEfiTimerWheelBitmap[0] &= ~LShiftU64 (1, Slot);
+  }
+}
+
+/**
+  Advances the timer wheel up to the current system time, and collects the
+  expired timers.
+
+  @param  SystemTime             The current system time.
+  @param  ExpiredList            The list of expired timers, sorted by trigger
+                                 time.
+
+**/
+STATIC
+VOID
+CoreAdvanceTimerWheel (
+  IN     UINT64      SystemTime,
+  IN OUT LIST_ENTRY  *ExpiredList
+  )
+{
+  UINT64          SystemTick;
+  UINT64          Tick;
+  UINT64          Bitmap;
+  UINTN           Slot;
+  LIST_ENTRY      *Head;
+  LIST_ENTRY      *Link;
+  IEVENT          *Event;
+  UINT64          NextTriggerTime;
+
+  SystemTick = RShiftU64 (SystemTime, TIMER_WHEEL_TICK_SHIFT);
+  if (SystemTick < mEfiTimerWheelTick) {
+    SystemTick = mEfiTimerWheelTick;
+  }
+
+  while (TRUE) {
+    //
+    // Expire the due level 0 slots of the ticks covered by level 0
+    //
+    Slot   = (UINTN) mEfiTimerWheelTick & (TIMER_WHEEL_SLOT_COUNT - 1);
+    Bitmap = mEfiTimerWheelBitmap[0] & LShiftU64 (MAX_UINT64, Slot);
+    if (Bitmap != 0) {
+      Slot = (UINTN) LowBitSet64 (Bitmap);
+      Tick = (mEfiTimerWheelTick & ~(UINT64) (TIMER_WHEEL_SLOT_COUNT - 1)) + Slot;
+      if (Tick <= SystemTick) {
+        mEfiTimerWheelTick = Tick;
+        CoreExpireTimerWheelSlot (Slot, SystemTime, ExpiredList);
+        if (Tick == SystemTick) {
+          break;
+        }
+        continue;
+      }
+    }
+
+    //
+    // Level 0 holds nothing else that is due. Skip the ticks up to the next
+    // slot of an upper level that holds timers.
+    //
+    Tick = CoreNextTimerWheelCascade ();
+    if (Tick > SystemTick) {
+      mEfiTimerWheelTick = SystemTick;
+      break;
+    }
+
+    mEfiTimerWheelTick = Tick;
+    CoreCascadeTimerWheel ();
+  }
+
+  //
+  // Compute a lower bound of the next trigger time. It is exact for the
+  // timers left in the slot being processed, and the start time of the next
+  // slot holding timers otherwise.
+  //
+  NextTriggerTime = MAX_UINT64;
+  Slot = (UINTN) mEfiTimerWheelTick & (TIMER_WHEEL_SLOT_COUNT - 1);
+  Head = &mEfiTimerWheel[0][Slot];
+  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+    Event = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    if (Event->Timer.TriggerTime < NextTriggerTime) {
+      NextTriggerTime = Event->Timer.TriggerTime;
+    }
+  }
+
+  if (NextTriggerTime == MAX_UINT64) {
+    Bitmap = mEfiTimerWheelBitmap[0] & LShiftU64 (LShiftU64 (MAX_UINT64, Slot), 1);
+    if (Bitmap != 0) {
+      Tick = (mEfiTimerWheelTick & ~(UINT64) (TIMER_WHEEL_SLOT_COUNT - 1)) + LowBitSet64 (Bitmap);
+    } else {
+      Tick = CoreNextTimerWheelCascade ();
+    }
+
+    if (Tick != MAX_UINT64) {
+      NextTriggerTime = LShiftU64 (Tick, TIMER_WHEEL_TICK_SHIFT);
+    }
+  }
+
+  mEfiTimerNextTriggerTime = NextTriggerTime;
 }
 
 /**
@@ -82,7 +341,7 @@ CoreCurrentSystemTime (
 }
 
 /**
-  Checks the sorted timer list against the current system time.
+  Checks the timer wheel against the current system time.
   Signals any expired event timer.
 
   @param  CheckEvent             Not used
@@ -98,6 +357,7 @@ CoreCheckTimers (
 {
   UINT64                  SystemTime;
   IEVENT                  *Event;
+  LIST_ENTRY              ExpiredList;
 
   //
   // Check the timer database for expired timers
@@ -105,18 +365,14 @@ CoreCheckTimers (
   CoreAcquireLock (&mEfiTimerLock);
   SystemTime = CoreCurrentSystemTime ();
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  InitializeListHead (&ExpiredList);
+  CoreAdvanceTimerWheel (SystemTime, &ExpiredList);
 
-    //
-    // If this timer is not expired, then we're done
-    //
-    if (Event->Timer.TriggerTime > SystemTime) {
-      break;
-    }
+  while (!IsListEmpty (&ExpiredList)) {
+    Event = CR (ExpiredList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
     //
-    // Remove this timer from the timer queue
+    // Remove this timer from the expired timers
     //
 
     RemoveEntryList (&Event->Timer.Link);
@@ -165,6 +421,14 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Level;
+  UINTN       Slot;
+
+  for (Level = 0; Level < TIMER_WHEEL_LEVEL_COUNT; Level++) {
+    for (Slot = 0; Slot < TIMER_WHEEL_SLOT_COUNT; Slot++) {
+      InitializeListHead (&mEfiTimerWheel[Level][Slot]);
+    }
+  }
 
   Status = CoreCreateEventInternal (
              EVT_NOTIFY_SIGNAL,
@@ -191,8 +455,6 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
-
   //
   // Check runtiem flag in case there are ticks while exiting boot services
   //
@@ -204,15 +466,10 @@ CoreTimerTick (
   mEfiSystemTime += Duration;
 
   //
-  // If the head of the list is expired, fire the timer event
-  // to process it
+  // If a timer may be expired, fire the timer event to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
-
-    if (Event->Timer.TriggerTime <= mEfiSystemTime) {
-      CoreSignalEvent (mEfiCheckTimerEvent);
-    }
+  if (mEfiTimerNextTriggerTime <= mEfiSystemTime) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
   }
 
   CoreReleaseLock (&mEfiSystemTimeLock);
@@ -241,6 +241,25 @@ GetFwVolHeader (
 }
 
 
+/**
+  Returns the bucket of the file name index of a firmware volume in which
+  the files with a given name are kept.
+
+  @param  FvDevice       The firmware volume.
+  @param  NameGuid       The file name.
+
+  @return The head of the bucket.
+
+**/
+LIST_ENTRY *
+GetFfsFileHashBucket (
+  IN FV_DEVICE       *FvDevice,
+  IN CONST EFI_GUID  *NameGuid
+  )
+{
+  return &FvDevice->FfsFileHashTable[CalculateGuidHash (NameGuid) & (FFS_FILE_HASH_BUCKET_COUNT - 1)];
+}
+
 
 /**
   Free FvDevice resource when error happens
@@ -381,10 +400,13 @@ FvCheck (
     LbaIndex = 0;
     while ((BlockMap->NumBlocks != 0) || (BlockMap->Length != 0)) {
       //
-      // read the FV data
+      // Read the FV data of the whole block range at once. FVB drivers that
+      // stop at the first block boundary return EFI_BAD_BUFFER_SIZE with the
+      // size actually read, so the read is resumed from there.
       //
-      Size = BlockMap->Length;
-      for (Index = 0; Index < BlockMap->NumBlocks; Index++) {
+      Index = 0;
+      while (Index < BlockMap->NumBlocks) {
+        Size = (BlockMap->NumBlocks - Index) * BlockMap->Length;
         Status = Fvb->Read (
                         Fvb,
                         LbaIndex,
@@ -392,16 +414,25 @@ FvCheck (
                         &Size,
                         CacheLocation
                         );
+        if (Status == EFI_BAD_BUFFER_SIZE) {
+          Status = EFI_SUCCESS;
+        }
+
+        if (EFI_ERROR (Status)) {
+          goto Done;
+        }
 
         //
-        // Not check EFI_BAD_BUFFER_SIZE, for Size = BlockMap->Length
+        // Partial reads must end on a block boundary.
         //
-        if (EFI_ERROR (Status)) {
+        if ((Size < BlockMap->Length) || ((Size % BlockMap->Length) != 0)) {
+          Status = EFI_DEVICE_ERROR;
           goto Done;
         }
 
-        LbaIndex++;
-        CacheLocation += BlockMap->Length;
+        Index         += Size / BlockMap->Length;
+        LbaIndex      += Size / BlockMap->Length;
+        CacheLocation += Size;
       }
 
       BlockMap++;
@@ -424,6 +455,9 @@ FvCheck (
   //
   Status = EFI_SUCCESS;
   InitializeListHead (&FvDevice->FfsFileListHeader);
+  for (Index = 0; Index < FFS_FILE_HASH_BUCKET_COUNT; Index++) {
+    InitializeListHead (&FvDevice->FfsFileHashTable[Index]);
+  }
 
   //
   // Build FFS list
@@ -537,6 +571,17 @@ FvCheck (
       FfsFileEntry->FileCached = FileCached;
       FileCached = FALSE;
       InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+
+      //
+      // Index the file by name. Files with the same name stay in FV order,
+      // so lookups find the same file as a scan of the file list.
+      //
+      if (CacheFfsHeader->Type != EFI_FV_FILETYPE_FFS_PAD) {
+        InsertTailList (
+          GetFfsFileHashBucket (FvDevice, &CacheFfsHeader->Name),
+          &FfsFileEntry->HashLink
+          );
+      }
     }
 
     if (IS_FFS_FILE2 (CacheFfsHeader)) {
@@ -13,6 +13,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define FV2_DEVICE_SIGNATURE SIGNATURE_32 ('_', 'F', 'V', '2')
 
+//
+// Number of buckets of the file name index of a firmware volume.
+// It must be a power of 2.
+//
+#define FFS_FILE_HASH_BUCKET_COUNT  64
+
 //
 // Used to track all non-deleted files
 //
@@ -21,6 +27,10 @@ typedef struct {
   EFI_FFS_FILE_HEADER             *FfsHeader;
   UINTN                           StreamHandle;
   BOOLEAN                         FileCached;
+  //
+  // Link in the file name index, unused for pad files
+  //
+  LIST_ENTRY                      HashLink;
 } FFS_FILE_LIST_ENTRY;
 
 typedef struct {
@@ -41,6 +51,11 @@ typedef struct {
   UINT8                                   ErasePolarity;
   BOOLEAN                                 IsFfs3Fv;
   BOOLEAN                                 IsMemoryMapped;
+
+  //
+  // Index of the non-pad files of FfsFileListHeader by file name
+  //
+  LIST_ENTRY                              FfsFileHashTable[FFS_FILE_HASH_BUCKET_COUNT];
 } FV_DEVICE;
 
 #define FV_DEVICE_FROM_THIS(a) CR(a, FV_DEVICE, Fv, FV2_DEVICE_SIGNATURE)
@@ -399,4 +414,21 @@ IsValidFfsFile (
   IN EFI_FFS_FILE_HEADER  *FfsHeader
   );
 
+
+/**
+  Returns the bucket of the file name index of a firmware volume in which
+  the files with a given name are kept.
+
+  @param  FvDevice       The firmware volume.
+  @param  NameGuid       The file name.
+
+  @return The head of the bucket.
+
+**/
+LIST_ENTRY *
+GetFfsFileHashBucket (
+  IN FV_DEVICE       *FvDevice,
+  IN CONST EFI_GUID  *NameGuid
+  );
+
 #endif
@@ -280,9 +280,10 @@ FvReadFile (
 {
   EFI_STATUS                        Status;
   FV_DEVICE                         *FvDevice;
-  EFI_GUID                          SearchNameGuid;
-  EFI_FV_FILETYPE                   LocalFoundType;
-  EFI_FV_FILE_ATTRIBUTES            LocalAttributes;
+  EFI_FV_ATTRIBUTES                 FvAttributes;
+  LIST_ENTRY                        *Bucket;
+  LIST_ENTRY                        *Link;
+  FFS_FILE_LIST_ENTRY               *FfsFileEntry;
   UINTN                             FileSize;
   UINT8                             *SrcPtr;
   EFI_FFS_FILE_HEADER               *FfsHeader;
@@ -295,31 +296,41 @@ FvReadFile (
 
   FvDevice = FV_DEVICE_FROM_THIS (This);
 
+  //
+  // Check if read operation is enabled
+  //
+  Status = FvGetVolumeAttributes (This, &FvAttributes);
+  if (EFI_ERROR (Status) || ((FvAttributes & EFI_FV2_READ_STATUS) == 0)) {
+    return EFI_NOT_FOUND;
+  }
 
   //
-  // Keep looking until we find the matching NameGuid.
-  // The Key is really a FfsFileEntry
+  // Look the file up in the file name index of the FV. The last key is
+  // set to the FfsFileEntry of the file, as FvReadFileSection expects.
   //
-  FvDevice->LastKey = 0;
-  do {
-    LocalFoundType = 0;
-    Status = FvGetNextFile (
-              This,
-              &FvDevice->LastKey,
-              &LocalFoundType,
-              &SearchNameGuid,
-              &LocalAttributes,
-              &FileSize
-              );
-    if (EFI_ERROR (Status)) {
-      return EFI_NOT_FOUND;
+  Bucket = GetFfsFileHashBucket (FvDevice, NameGuid);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    FfsFileEntry = BASE_CR (Link, FFS_FILE_LIST_ENTRY, HashLink);
+    if (CompareGuid (&FfsFileEntry->FfsHeader->Name, NameGuid)) {
+      break;
     }
-  } while (!CompareGuid (&SearchNameGuid, NameGuid));
+  }
+
+  if (Link == Bucket) {
+    return EFI_NOT_FOUND;
+  }
+
+  FvDevice->LastKey = FfsFileEntry;
 
   //
   // Get a pointer to the header
   //
   FfsHeader = FvDevice->LastKey->FfsHeader;
+  if (IS_FFS_FILE2 (FfsHeader)) {
+    FileSize = FFS_FILE2_SIZE (FfsHeader) - sizeof (EFI_FFS_FILE_HEADER2);
+  } else {
+    FileSize = FFS_FILE_SIZE (FfsHeader) - sizeof (EFI_FFS_FILE_HEADER);
+  }
   if (FvDevice->IsMemoryMapped) {
     //
     // Memory mapped FV has not been cached, so here is to cache by file.
@@ -404,43 +415,29 @@ FvReadFile (
 
 
 /**
-  Locates a section in a given FFS File and
-  copies it to the supplied buffer (not including section header).
+  Locates a file in the firmware volume and opens the section stream of its
+  contents.  The section stream is kept in the FfsFileEntry of the file, so it
+  is opened only once, and sections extracted from it stay available to the
+  following reads of the file.
 
   @param  This                       Indicates the calling context.
   @param  NameGuid                   Pointer to an EFI_GUID, which is the
                                      filename.
-  @param  SectionType                Indicates the section type to return.
-  @param  SectionInstance            Indicates which instance of sections with a
-                                     type of SectionType to return.
-  @param  Buffer                     Buffer is a pointer to pointer to a buffer
-                                     in which the file or section contents or are
-                                     returned.
-  @param  BufferSize                 BufferSize is a pointer to caller allocated
-                                     UINTN.
-  @param  AuthenticationStatus       AuthenticationStatus is a pointer to a
-                                     caller allocated UINT32 in which the
-                                     authentication status is returned.
+  @param  FfsEntry                   On output, the FfsFileEntry of the file.
 
-  @retval EFI_SUCCESS                Successfully read the file section into
-                                     buffer.
-  @retval EFI_WARN_BUFFER_TOO_SMALL  Buffer too small.
-  @retval EFI_NOT_FOUND              Section not found.
-  @retval EFI_DEVICE_ERROR           Device error.
-  @retval EFI_ACCESS_DENIED          Could not read.
-  @retval EFI_INVALID_PARAMETER      Invalid parameter.
+  @retval EFI_SUCCESS                The section stream of the file is open.
+  @retval EFI_NOT_FOUND              File not found, or the file has no
+                                     sections.
+  @retval EFI_OUT_OF_RESOURCES       Not enough buffer to be allocated.
+  @retval Others                     The section stream could not be opened.
 
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-FvReadFileSection (
+FvOpenFileSectionStream (
   IN CONST  EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
   IN CONST  EFI_GUID                       *NameGuid,
-  IN        EFI_SECTION_TYPE               SectionType,
-  IN        UINTN                          SectionInstance,
-  IN OUT    VOID                           **Buffer,
-  IN OUT    UINTN                          *BufferSize,
-  OUT       UINT32                         *AuthenticationStatus
+  OUT       FFS_FILE_LIST_ENTRY            **FfsEntry
   )
 {
   EFI_STATUS                        Status;
@@ -448,12 +445,8 @@ FvReadFileSection (
   EFI_FV_FILETYPE                   FileType;
   EFI_FV_FILE_ATTRIBUTES            FileAttributes;
   UINTN                             FileSize;
+  UINT32                            AuthenticationStatus;
   UINT8                             *FileBuffer;
-  FFS_FILE_LIST_ENTRY               *FfsEntry;
-
-  if (NameGuid == NULL || Buffer == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
 
   FvDevice = FV_DEVICE_FROM_THIS (This);
 
@@ -467,41 +460,100 @@ FvReadFileSection (
             &FileSize,
             &FileType,
             &FileAttributes,
-            AuthenticationStatus
+            &AuthenticationStatus
             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   //
   // Get the last key used by our call to FvReadFile as it is the FfsEntry for this file.
   //
-  FfsEntry = (FFS_FILE_LIST_ENTRY *) FvDevice->LastKey;
+  *FfsEntry = (FFS_FILE_LIST_ENTRY *) FvDevice->LastKey;
 
-  if (EFI_ERROR (Status)) {
-    return Status;
-  }
-  if (IS_FFS_FILE2 (FfsEntry->FfsHeader)) {
-    FileBuffer = ((UINT8 *) FfsEntry->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER2);
+  if (IS_FFS_FILE2 ((*FfsEntry)->FfsHeader)) {
+    FileBuffer = ((UINT8 *) (*FfsEntry)->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER2);
   } else {
-    FileBuffer = ((UINT8 *) FfsEntry->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER);
+    FileBuffer = ((UINT8 *) (*FfsEntry)->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER);
   }
   //
   // Check to see that the file actually HAS sections before we go any further.
   //
   if (FileType == EFI_FV_FILETYPE_RAW) {
-    Status = EFI_NOT_FOUND;
-    goto Done;
+    return EFI_NOT_FOUND;
   }
 
   //
   // Use FfsEntry to cache Section Extraction Protocol Information
   //
-  if (FfsEntry->StreamHandle == 0) {
+  if ((*FfsEntry)->StreamHandle == 0) {
     Status = OpenSectionStream (
                FileSize,
                FileBuffer,
-               &FfsEntry->StreamHandle
+               &(*FfsEntry)->StreamHandle
                );
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
+  }
+
+  //
+  // Close of stream defered to close of FfsHeader list to allow SEP to cache data
+  //
+  return Status;
+}
+
+
+/**
+  Locates a section in a given FFS File and
+  copies it to the supplied buffer (not including section header).
+
+  @param  This                       Indicates the calling context.
+  @param  NameGuid                   Pointer to an EFI_GUID, which is the
+                                     filename.
+  @param  SectionType                Indicates the section type to return.
+  @param  SectionInstance            Indicates which instance of sections with a
+                                     type of SectionType to return.
+  @param  Buffer                     Buffer is a pointer to pointer to a buffer
+                                     in which the file or section contents or are
+                                     returned.
+  @param  BufferSize                 BufferSize is a pointer to caller allocated
+                                     UINTN.
+  @param  AuthenticationStatus       AuthenticationStatus is a pointer to a
+                                     caller allocated UINT32 in which the
+                                     authentication status is returned.
+
+  @retval EFI_SUCCESS                Successfully read the file section into
+                                     buffer.
+  @retval EFI_WARN_BUFFER_TOO_SMALL  Buffer too small.
+  @retval EFI_NOT_FOUND              Section not found.
+  @retval EFI_DEVICE_ERROR           Device error.
+  @retval EFI_ACCESS_DENIED          Could not read.
+  @retval EFI_INVALID_PARAMETER      Invalid parameter.
+
+**/
+EFI_STATUS
+EFIAPI
+FvReadFileSection (
+  IN CONST  EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
+  IN CONST  EFI_GUID                       *NameGuid,
+  IN        EFI_SECTION_TYPE               SectionType,
+  IN        UINTN                          SectionInstance,
+  IN OUT    VOID                           **Buffer,
+  IN OUT    UINTN                          *BufferSize,
+  OUT       UINT32                         *AuthenticationStatus
+  )
+{
+  EFI_STATUS                        Status;
+  FV_DEVICE                         *FvDevice;
+  FFS_FILE_LIST_ENTRY               *FfsEntry;
+
+  if (NameGuid == NULL || Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FvDevice = FV_DEVICE_FROM_THIS (This);
+
+  Status = FvOpenFileSectionStream (This, NameGuid, &FfsEntry);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   //
@@ -525,12 +577,92 @@ FvReadFileSection (
     *AuthenticationStatus |= FvDevice->AuthenticationStatus;
   }
 
+  return Status;
+}
+
+
+/**
+  Locates a section in a given FFS File of a firmware volume produced by the
+  DXE Core, and returns a pointer to its contents in the section stream
+  database of the file instead of a copy.  Compressed and GUIDed
+  encapsulations of the file are extracted only once, the first time one of
+  their sections is read, and stay cached with the file.
+
+  The returned buffer stays valid as long as the firmware volume, and must
+  not be modified or freed by the caller.
+
+  @param  FwVol                      The firmware volume protocol instance.
+  @param  NameGuid                   Pointer to an EFI_GUID, which is the
+                                     filename.
+  @param  SectionType                Indicates the section type to return.
+  @param  SectionInstance            Indicates which instance of sections with a
+                                     type of SectionType to return.
+  @param  Buffer                     On output, points to the section contents.
+  @param  BufferSize                 On output, the size of the section
+                                     contents.
+  @param  AuthenticationStatus       On output, the authentication status of
+                                     the section, as returned by ReadSection().
+
+  @retval EFI_SUCCESS                The section was found.
+  @retval EFI_UNSUPPORTED            FwVol is not produced by the DXE Core.
+  @retval EFI_NOT_FOUND              Section not found.
+  @retval EFI_INVALID_PARAMETER      Invalid parameter.
+  @retval Others                     The section could not be extracted.
+
+**/
+EFI_STATUS
+FvLocateFileSection (
+  IN  EFI_FIRMWARE_VOLUME2_PROTOCOL  *FwVol,
+  IN  CONST EFI_GUID                 *NameGuid,
+  IN  EFI_SECTION_TYPE               SectionType,
+  IN  UINTN                          SectionInstance,
+  OUT VOID                           **Buffer,
+  OUT UINTN                          *BufferSize,
+  OUT UINT32                         *AuthenticationStatus
+  )
+{
+  EFI_STATUS                        Status;
+  FV_DEVICE                         *FvDevice;
+  FFS_FILE_LIST_ENTRY               *FfsEntry;
+
+  if (FwVol == NULL || NameGuid == NULL || Buffer == NULL || SectionType == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
   //
-  // Close of stream defered to close of FfsHeader list to allow SEP to cache data
+  // Only our own device structure holds the section streams. Recognize it by
+  // its ReadSection() service, without reading the memory around a protocol
+  // instance produced by another driver.
   //
+  if (FwVol->ReadSection != FvReadFileSection) {
+    return EFI_UNSUPPORTED;
+  }
 
-Done:
-  return Status;
-}
+  FvDevice = BASE_CR (FwVol, FV_DEVICE, Fv);
+  ASSERT (FvDevice->Signature == FV2_DEVICE_SIGNATURE);
 
+  Status = FvOpenFileSectionStream (FwVol, NameGuid, &FfsEntry);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
 
+  Status = GetSectionInPlace (
+             FfsEntry->StreamHandle,
+             &SectionType,
+             NULL,
+             SectionInstance,
+             Buffer,
+             BufferSize,
+             AuthenticationStatus,
+             FvDevice->IsFfs3Fv
+             );
+
+  if (!EFI_ERROR (Status)) {
+    //
+    // Inherit the authentication status.
+    //
+    *AuthenticationStatus |= FvDevice->AuthenticationStatus;
+  }
+
+  return Status;
+}
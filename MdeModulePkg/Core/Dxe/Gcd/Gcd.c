@@ -43,6 +43,14 @@ EFI_LOCK           mGcdIoSpaceLock     = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIF
 LIST_ENTRY         mGcdMemorySpaceMap  = INITIALIZE_LIST_HEAD_VARIABLE (mGcdMemorySpaceMap);
 LIST_ENTRY         mGcdIoSpaceMap      = INITIALIZE_LIST_HEAD_VARIABLE (mGcdIoSpaceMap);
 
+//
+// Address indexes over the GCD maps. Every entry of a map is in the index of
+// the map, keyed by its base address. Only the unallocated entries have a
+// weight, so that the allocation searches skip the allocated ones.
+//
+ADDRESS_INDEX      mGcdMemorySpaceMapIndex;
+ADDRESS_INDEX      mGcdIoSpaceMapIndex;
+
 EFI_GCD_MAP_ENTRY mGcdMemorySpaceMapEntryTemplate = {
   EFI_GCD_MAP_SIGNATURE,
   {
@@ -147,6 +155,10 @@ CoreDumpGcdMemorySpaceMap (
     EFI_GCD_MEMORY_SPACE_DESCRIPTOR  *MemorySpaceMap;
     UINTN                            Index;
 
+    if (!DebugPrintLevelEnabled (DEBUG_GCD)) {
+      return;
+    }
+
     Status = CoreGetMemorySpaceMap (&NumberOfDescriptors, &MemorySpaceMap);
     ASSERT (Status == EFI_SUCCESS && MemorySpaceMap != NULL);
 
@@ -189,6 +201,10 @@ CoreDumpGcdIoSpaceMap (
     EFI_GCD_IO_SPACE_DESCRIPTOR  *IoSpaceMap;
     UINTN                        Index;
 
+    if (!DebugPrintLevelEnabled (DEBUG_GCD)) {
+      return;
+    }
+
     Status = CoreGetIoSpaceMap (&NumberOfDescriptors, &IoSpaceMap);
     ASSERT (Status == EFI_SUCCESS && IoSpaceMap != NULL);
 
@@ -361,6 +377,55 @@ PageAlignLength (
 // GCD Memory Space Worker Functions
 //
 
+/**
+  Returns the address index of a GCD map.
+
+  @param  Map                    The GCD memory space map or the GCD I/O space map.
+
+  @return The address index of Map.
+
+**/
+STATIC
+ADDRESS_INDEX *
+CoreGetGcdMapIndex (
+  IN LIST_ENTRY  *Map
+  )
+{
+  if (Map == &mGcdMemorySpaceMap) {
+    return &mGcdMemorySpaceMapIndex;
+  }
+
+  ASSERT (Map == &mGcdIoSpaceMap);
+  return &mGcdIoSpaceMapIndex;
+}
+
+/**
+  Inserts an entry of a GCD map in the address index of the map, or updates
+  the index after the base address or the owner of the entry changed.
+
+  @param  Map                    The GCD map that contains Entry.
+  @param  Entry                  The entry to index.
+
+**/
+STATIC
+VOID
+CoreIndexGcdMapEntry (
+  IN LIST_ENTRY         *Map,
+  IN EFI_GCD_MAP_ENTRY  *Entry
+  )
+{
+  ADDRESS_INDEX  *Index;
+
+  Index = CoreGetGcdMapIndex (Map);
+  CoreAddressIndexRemove (Index, &Entry->IndexNode);
+  CoreAddressIndexInsert (
+    Index,
+    &Entry->IndexNode,
+    Entry->BaseAddress,
+    (Entry->ImageHandle == NULL) ? 1 : 0
+    );
+}
+
 /**
   Allocate pool for two entries.
 
@@ -411,6 +476,7 @@ CoreAllocateGcdMapEntry (
   @param  Length                 The length of the new range in bytes
   @param  TopEntry               Top pad entry to insert if needed.
   @param  BottomEntry            Bottom pad entry to insert if needed.
+  @param  Map                    The GCD map that contains Entry.
 
   @retval EFI_SUCCESS            The new range was inserted into the linked list
 
@@ -422,7 +488,8 @@ CoreInsertGcdMapEntry (
   IN EFI_PHYSICAL_ADDRESS  BaseAddress,
   IN UINT64                Length,
   IN EFI_GCD_MAP_ENTRY     *TopEntry,
-  IN EFI_GCD_MAP_ENTRY     *BottomEntry
+  IN EFI_GCD_MAP_ENTRY     *BottomEntry,
+  IN LIST_ENTRY            *Map
   )
 {
   ASSERT (Length != 0);
@@ -431,18 +498,23 @@ CoreInsertGcdMapEntry (
     ASSERT (BottomEntry->Signature == 0);
 
     CopyMem (BottomEntry, Entry, sizeof (EFI_GCD_MAP_ENTRY));
+    ZeroMem (&BottomEntry->IndexNode, sizeof (BottomEntry->IndexNode));
     Entry->BaseAddress      = BaseAddress;
     BottomEntry->EndAddress = BaseAddress - 1;
     InsertTailList (Link, &BottomEntry->Link);
+    CoreIndexGcdMapEntry (Map, BottomEntry);
+    CoreIndexGcdMapEntry (Map, Entry);
   }
 
   if ((BaseAddress + Length - 1) < Entry->EndAddress) {
     ASSERT (TopEntry->Signature == 0);
 
     CopyMem (TopEntry, Entry, sizeof (EFI_GCD_MAP_ENTRY));
+    ZeroMem (&TopEntry->IndexNode, sizeof (TopEntry->IndexNode));
     TopEntry->BaseAddress = BaseAddress + Length;
     Entry->EndAddress     = BaseAddress + Length - 1;
     InsertHeadList (Link, &TopEntry->Link);
+    CoreIndexGcdMapEntry (Map, TopEntry);
   }
 
   return EFI_SUCCESS;
@@ -510,10 +582,12 @@ CoreMergeGcdMapEntry (
     return EFI_UNSUPPORTED;
   }
 
+  CoreAddressIndexRemove (CoreGetGcdMapIndex (Map), &AdjacentEntry->IndexNode);
   if (Forward) {
     Entry->EndAddress  = AdjacentEntry->EndAddress;
   } else {
     Entry->BaseAddress = AdjacentEntry->BaseAddress;
+    CoreIndexGcdMapEntry (Map, Entry);
   }
   RemoveEntryList (AdjacentLink);
   CoreFreePool (AdjacentEntry);
@@ -566,6 +640,9 @@ CoreCleanupGcdMapEntry (
 /**
   Search a segment of memory space in GCD map. The result is a range of GCD entry list.
 
+  The first and the last entries of the range are looked up in the address
+  index of the map, so the cost does not depend on the size of the map.
+
   @param  BaseAddress            The start address of the segment.
   @param  Length                 The length of the segment.
   @param  StartLink              The first GCD entry involves this segment of
@@ -587,38 +664,54 @@ CoreSearchGcdMapEntry (
   IN  LIST_ENTRY            *Map
   )
 {
-  LIST_ENTRY         *Link;
-  EFI_GCD_MAP_ENTRY  *Entry;
+  ADDRESS_INDEX       *Index;
+  ADDRESS_INDEX_NODE  *Node;
+  EFI_GCD_MAP_ENTRY   *StartEntry;
+  EFI_GCD_MAP_ENTRY   *EndEntry;
 
   ASSERT (Length != 0);
 
   *StartLink = NULL;
   *EndLink   = NULL;
 
-  Link = Map->ForwardLink;
-  while (Link != Map) {
-    Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    if (BaseAddress >= Entry->BaseAddress && BaseAddress <= Entry->EndAddress) {
-      *StartLink = Link;
-    }
-    if (*StartLink != NULL) {
-      if ((BaseAddress + Length - 1) >= Entry->BaseAddress &&
-          (BaseAddress + Length - 1) <= Entry->EndAddress     ) {
-        *EndLink = Link;
-        return EFI_SUCCESS;
-      }
-    }
-    Link = Link->ForwardLink;
+  Index = CoreGetGcdMapIndex (Map);
+
+  //
+  // Find the entry that contains BaseAddress
+  //
+  Node = CoreAddressIndexFindPrevious (Index, BaseAddress, 0);
+  if (Node == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  StartEntry = BASE_CR (Node, EFI_GCD_MAP_ENTRY, IndexNode);
+  ASSERT (StartEntry->Signature == EFI_GCD_MAP_SIGNATURE);
+  if (BaseAddress > StartEntry->EndAddress) {
+    return EFI_NOT_FOUND;
   }
 
-  return EFI_NOT_FOUND;
+  //
+  // Find the entry that contains the last byte of the segment. It must not be
+  // ordered before the first entry, which happens if the segment wraps around.
+  //
+  Node = CoreAddressIndexFindPrevious (Index, BaseAddress + Length - 1, 0);
+  ASSERT (Node != NULL);
+  EndEntry = BASE_CR (Node, EFI_GCD_MAP_ENTRY, IndexNode);
+  ASSERT (EndEntry->Signature == EFI_GCD_MAP_SIGNATURE);
+  if (EndEntry->BaseAddress < StartEntry->BaseAddress ||
+      (BaseAddress + Length - 1) > EndEntry->EndAddress) {
+    return EFI_NOT_FOUND;
+  }
+
+  *StartLink = &StartEntry->Link;
+  *EndLink   = &EndEntry->Link;
+  return EFI_SUCCESS;
 }
 
 
 /**
   Count the amount of GCD map entries.
 
-  @param  Map                    Points to the start entry to do the count loop.
+  @param  Map                    The GCD map whose entries are counted.
 
   @return The count.
 
@@ -628,17 +721,7 @@ CoreCountGcdMapEntry (
   IN LIST_ENTRY  *Map
   )
 {
-  UINTN           Count;
-  LIST_ENTRY      *Link;
-
-  Count = 0;
-  Link = Map->ForwardLink;
-  while (Link != Map) {
-    Count++;
-    Link = Link->ForwardLink;
-  }
-
-  return Count;
+  return CoreGetGcdMapIndex (Map)->Count;
 }
 
 
@@ -901,7 +984,7 @@ CoreConvertSpace (
   Link = StartLink;
   while (Link != EndLink->ForwardLink) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    CoreInsertGcdMapEntry (Link, Entry, BaseAddress, Length, TopEntry, BottomEntry);
+    CoreInsertGcdMapEntry (Link, Entry, BaseAddress, Length, TopEntry, BottomEntry, Map);
     switch (Operation) {
     //
     // Add operations
@@ -924,6 +1007,7 @@ CoreConvertSpace (
     case GCD_FREE_IO_OPERATION:
       Entry->ImageHandle  = NULL;
       Entry->DeviceHandle = NULL;
+      CoreIndexGcdMapEntry (Map, Entry);
       break;
     //
     // Remove operations
@@ -1066,6 +1150,9 @@ CoreAllocateSpace (
   LIST_ENTRY            *StartLink;
   LIST_ENTRY            *EndLink;
   BOOLEAN               Found;
+  BOOLEAN               TopDown;
+  ADDRESS_INDEX         *Index;
+  ADDRESS_INDEX_NODE    *Node;
 
   //
   // Make sure parameters are valid
@@ -1166,21 +1253,27 @@ CoreAllocateSpace (
 
     //
     // Verify that the list of descriptors are unallocated memory matching GcdMemoryType.
-    //
-    if (GcdAllocateType == EfiGcdAllocateMaxAddressSearchTopDown ||
-        GcdAllocateType == EfiGcdAllocateAnySearchTopDown ) {
-      Link = Map->BackLink;
+    // Only the unallocated entries have a weight in the index, so the
+    // allocated entries, which cannot be used, are skipped by the search.
+    //
+    TopDown = (BOOLEAN) (GcdAllocateType == EfiGcdAllocateMaxAddressSearchTopDown ||
+                         GcdAllocateType == EfiGcdAllocateAnySearchTopDown);
+    Index   = CoreGetGcdMapIndex (Map);
+    if (TopDown) {
+      Node = CoreAddressIndexFindPrevious (Index, MAX_UINT64, 1);
     } else {
-      Link = Map->ForwardLink;
+      Node = CoreAddressIndexFindNext (Index, 0, 1);
     }
-    while (Link != Map) {
-      Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
+    while (Node != NULL) {
+      Entry = BASE_CR (Node, EFI_GCD_MAP_ENTRY, IndexNode);
+      ASSERT (Entry->Signature == EFI_GCD_MAP_SIGNATURE);
 
-      if (GcdAllocateType == EfiGcdAllocateMaxAddressSearchTopDown ||
-          GcdAllocateType == EfiGcdAllocateAnySearchTopDown           ) {
-        Link = Link->BackLink;
+      if (TopDown) {
+        Node = (Entry->BaseAddress == 0) ? NULL :
+               CoreAddressIndexFindPrevious (Index, Entry->BaseAddress - 1, 1);
       } else {
-        Link = Link->ForwardLink;
+        Node = (Entry->EndAddress == MAX_UINT64) ? NULL :
+               CoreAddressIndexFindNext (Index, Entry->EndAddress + 1, 1);
       }
 
       Status = CoreAllocateSpaceCheckEntry (Operation, Entry, GcdMemoryType, GcdIoType);
@@ -1188,8 +1281,7 @@ CoreAllocateSpace (
         continue;
       }
 
-      if (GcdAllocateType == EfiGcdAllocateMaxAddressSearchTopDown ||
-          GcdAllocateType == EfiGcdAllocateAnySearchTopDown) {
+      if (TopDown) {
         if ((Entry->BaseAddress + Length) > MaxAddress) {
           continue;
         }
@@ -1221,7 +1313,6 @@ CoreAllocateSpace (
       }
       ASSERT (StartLink != NULL && EndLink != NULL);
 
-      Link = StartLink;
       //
       // Verify that the list of descriptors are unallocated memory matching GcdMemoryType.
       //
@@ -1231,7 +1322,10 @@ CoreAllocateSpace (
         Entry = CR (SubLink, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
         Status = CoreAllocateSpaceCheckEntry (Operation, Entry, GcdMemoryType, GcdIoType);
         if (EFI_ERROR (Status)) {
-          Link = SubLink;
+          //
+          // Resume the search from the entry that cannot be used
+          //
+          Node = &Entry->IndexNode;
           Found = FALSE;
           break;
         }
@@ -1263,9 +1357,10 @@ CoreAllocateSpace (
   Link = StartLink;
   while (Link != EndLink->ForwardLink) {
     Entry = CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE);
-    CoreInsertGcdMapEntry (Link, Entry, *BaseAddress, Length, TopEntry, BottomEntry);
+    CoreInsertGcdMapEntry (Link, Entry, *BaseAddress, Length, TopEntry, BottomEntry, Map);
     Entry->ImageHandle  = ImageHandle;
     Entry->DeviceHandle = DeviceHandle;
+    CoreIndexGcdMapEntry (Map, Entry);
     Link = Link->ForwardLink;
   }
 
@@ -2483,6 +2578,7 @@ CoreInitializeGcdServices (
   Entry->EndAddress = LShiftU64 (1, SizeOfMemorySpace) - 1;
 
   InsertHeadList (&mGcdMemorySpaceMap, &Entry->Link);
+  CoreIndexGcdMapEntry (&mGcdMemorySpaceMap, Entry);
 
   CoreDumpGcdMemorySpaceMap (TRUE);
 
@@ -2495,6 +2591,7 @@ CoreInitializeGcdServices (
   Entry->EndAddress = LShiftU64 (1, SizeOfIoSpace) - 1;
 
   InsertHeadList (&mGcdIoSpaceMap, &Entry->Link);
+  CoreIndexGcdMapEntry (&mGcdIoSpaceMap, Entry);
 
   CoreDumpGcdIoSpaceMap (TRUE);
 
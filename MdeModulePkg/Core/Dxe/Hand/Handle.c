@@ -15,8 +15,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // gHandleList           - A list of all the handles in the system
 // gProtocolDatabaseLock - Lock to protect the mProtocolDatabase
 // gHandleDatabaseKey    -  The Key to show that the handle has been created/modified
+// mProtocolHashTable    - GUID hash index over mProtocolDatabase, used when
+//                         PcdEnableProtocolDatabaseHashIndex is TRUE. A bucket is
+//                         initialized the first time it is touched.
+// mHandleHashTable      - Registry of all the handles in gHandleList hashed by
+//                         address, used to validate handles in constant time.
+//                         A bucket is initialized the first time it is touched.
 //
 LIST_ENTRY      mProtocolDatabase     = INITIALIZE_LIST_HEAD_VARIABLE (mProtocolDatabase);
+LIST_ENTRY      mProtocolHashTable[PROTOCOL_HASH_BUCKET_COUNT];
+LIST_ENTRY      mHandleHashTable[HANDLE_HASH_BUCKET_COUNT];
 LIST_ENTRY      gHandleList           = INITIALIZE_LIST_HEAD_VARIABLE (gHandleList);
 EFI_LOCK        gProtocolDatabaseLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 UINT64          gHandleDatabaseKey    = 0;
@@ -51,6 +59,40 @@ CoreReleaseProtocolLock (
 
 
 
+/**
+  Returns the mHandleHashTable bucket that a handle is registered in.
+  The handle itself is never dereferenced, so UserHandle may be any value.
+
+  @param  UserHandle             The handle to hash
+
+  @return The head of the hash bucket list.
+
+**/
+STATIC
+LIST_ENTRY *
+CoreGetHandleHashBucket (
+  IN  EFI_HANDLE                UserHandle
+  )
+{
+  UINTN               Hash;
+  LIST_ENTRY          *Bucket;
+
+  //
+  // Handles are pool allocations, so the low 3 bits carry no information.
+  //
+  Hash = (UINTN) UserHandle >> 3;
+  Hash ^= Hash >> 9;
+
+  Bucket = &mHandleHashTable[Hash & (HANDLE_HASH_BUCKET_COUNT - 1)];
+  if (Bucket->ForwardLink == NULL) {
+    InitializeListHead (Bucket);
+  }
+
+  return Bucket;
+}
+
+
+
 /**
   Check whether a handle is a valid EFI_HANDLE
 
@@ -67,13 +109,18 @@ CoreValidateHandle (
 {
   IHANDLE             *Handle;
   LIST_ENTRY          *Link;
+  LIST_ENTRY          *Bucket;
 
   if (UserHandle == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  for (Link = gHandleList.BackLink; Link != &gHandleList; Link = Link->BackLink) {
-    Handle = CR (Link, IHANDLE, AllHandles, EFI_HANDLE_SIGNATURE);
+  //
+  // Only the handles registered in the same bucket need to be checked
+  //
+  Bucket = CoreGetHandleHashBucket (UserHandle);
+  for (Link = Bucket->BackLink; Link != Bucket; Link = Link->BackLink) {
+    Handle = CR (Link, IHANDLE, HashLink, EFI_HANDLE_SIGNATURE);
     if (Handle == (IHANDLE *) UserHandle) {
       return EFI_SUCCESS;
     }
@@ -84,6 +131,37 @@ CoreValidateHandle (
 
 
 
+/**
+  Returns the mProtocolHashTable bucket that holds the protocol entry of a
+  protocol GUID.
+
+  @param  Protocol               The ID of the protocol
+
+  @return The head of the hash bucket list.
+
+**/
+STATIC
+LIST_ENTRY *
+CoreGetProtocolHashBucket (
+  IN EFI_GUID   *Protocol
+  )
+{
+  LIST_ENTRY          *Bucket;
+
+  //
+  // Protocol GUIDs are effectively random, so the low bits of the GUID
+  // hash give a good enough distribution.
+  //
+  Bucket = &mProtocolHashTable[CalculateGuidHash (Protocol) & (PROTOCOL_HASH_BUCKET_COUNT - 1)];
+  if (Bucket->ForwardLink == NULL) {
+    InitializeListHead (Bucket);
+  }
+
+  return Bucket;
+}
+
+
+
 /**
   Finds the protocol entry for the requested protocol.
   The gProtocolDatabaseLock must be owned
@@ -101,6 +179,7 @@ CoreFindProtocolEntry (
   )
 {
   LIST_ENTRY          *Link;
+  LIST_ENTRY          *Bucket;
   PROTOCOL_ENTRY      *Item;
   PROTOCOL_ENTRY      *ProtEntry;
 
@@ -111,19 +190,37 @@ CoreFindProtocolEntry (
   //
 
   ProtEntry = NULL;
-  for (Link = mProtocolDatabase.ForwardLink;
-       Link != &mProtocolDatabase;
-       Link = Link->ForwardLink) {
+  Bucket    = NULL;
+  if (FeaturePcdGet (PcdEnableProtocolDatabaseHashIndex)) {
+    //
+    // Only the entries that hash to the same bucket need to be compared
+    //
+    Bucket = CoreGetProtocolHashBucket (Protocol);
+    for (Link = Bucket->ForwardLink;
+         Link != Bucket;
+         Link = Link->ForwardLink) {
+
+      Item = CR(Link, PROTOCOL_ENTRY, HashLink, PROTOCOL_ENTRY_SIGNATURE);
+      if (CompareGuid (&Item->ProtocolID, Protocol)) {
+        ProtEntry = Item;
+        break;
+      }
+    }
+  } else {
+    for (Link = mProtocolDatabase.ForwardLink;
+         Link != &mProtocolDatabase;
+         Link = Link->ForwardLink) {
 
-    Item = CR(Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
-    if (CompareGuid (&Item->ProtocolID, Protocol)) {
+      Item = CR(Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
+      if (CompareGuid (&Item->ProtocolID, Protocol)) {
 
-      //
-      // This is the protocol entry
-      //
+        //
+        // This is the protocol entry
+        //
 
-      ProtEntry = Item;
-      break;
+        ProtEntry = Item;
+        break;
+      }
     }
   }
 
@@ -142,11 +239,16 @@ CoreFindProtocolEntry (
       CopyGuid ((VOID *)&ProtEntry->ProtocolID, Protocol);
       InitializeListHead (&ProtEntry->Protocols);
       InitializeListHead (&ProtEntry->Notify);
+      InitializeListHead (&ProtEntry->HashLink);
 
       //
-      // Add it to protocol database
+      // Add it to protocol database, and to the hash index when enabled.
+      // The protocol database list keeps the creation order for enumeration.
       //
       InsertTailList (&mProtocolDatabase, &ProtEntry->AllEntries);
+      if (Bucket != NULL) {
+        InsertTailList (Bucket, &ProtEntry->HashLink);
+      }
     }
   }
 
@@ -393,7 +495,7 @@ CoreInstallProtocolInterfaceNotify (
   //
   // Allocate a new protocol interface structure
   //
-  Prot = AllocateZeroPool (sizeof(PROTOCOL_INTERFACE));
+  Prot = CoreAllocateSlabPool (sizeof(PROTOCOL_INTERFACE));
   if (Prot == NULL) {
     Status = EFI_OUT_OF_RESOURCES;
     goto Done;
@@ -404,7 +506,7 @@ CoreInstallProtocolInterfaceNotify (
   //
   Handle = (IHANDLE *)*UserHandle;
   if (Handle == NULL) {
-    Handle = AllocateZeroPool (sizeof(IHANDLE));
+    Handle = CoreAllocateSlabPool (sizeof(IHANDLE));
     if (Handle == NULL) {
       Status = EFI_OUT_OF_RESOURCES;
       goto Done;
@@ -427,6 +529,7 @@ CoreInstallProtocolInterfaceNotify (
     // in the system
     //
     InsertTailList (&gHandleList, &Handle->AllHandles);
+    InsertTailList (CoreGetHandleHashBucket (Handle), &Handle->HashLink);
   } else {
     Status = CoreValidateHandle (Handle);
     if (EFI_ERROR (Status)) {
@@ -466,6 +569,11 @@ CoreInstallProtocolInterfaceNotify (
   //
   InsertTailList (&ProtEntry->Protocols, &Prot->ByProtocol);
 
+  //
+  // Let the dispatcher evaluate again the drivers waiting on this protocol
+  //
+  CoreNotifyDispatcherOfProtocol (Protocol);
+
   //
   // Notify the notification list for this protocol
   //
@@ -489,7 +597,7 @@ Done:
     // There was an error, clean up
     //
     if (Prot != NULL) {
-      CoreFreePool (Prot);
+      CoreFreeSlabPool (Prot, sizeof (PROTOCOL_INTERFACE));
     }
     DEBUG((DEBUG_ERROR, "InstallProtocolInterface: %g %p failed with %r\n", Protocol, Interface, Status));
   }
@@ -666,7 +774,7 @@ CoreDisconnectControllersUsingProtocolInterface (
           (EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL | EFI_OPEN_PROTOCOL_GET_PROTOCOL | EFI_OPEN_PROTOCOL_TEST_PROTOCOL)) != 0) {
         Link = RemoveEntryList (&OpenData->Link);
         Prot->OpenListCount--;
-        CoreFreePool (OpenData);
+        CoreFreeSlabPool (OpenData, sizeof (OPEN_PROTOCOL_DATA));
       } else {
         Link = Link->ForwardLink;
       }
@@ -779,7 +887,7 @@ CoreUninstallProtocolInterface (
     // Free the memory
     //
     Prot->Signature = 0;
-    CoreFreePool (Prot);
+    CoreFreeSlabPool (Prot, sizeof (PROTOCOL_INTERFACE));
     Status = EFI_SUCCESS;
   }
 
@@ -789,7 +897,8 @@ CoreUninstallProtocolInterface (
   if (IsListEmpty (&Handle->Protocols)) {
     Handle->Signature = 0;
     RemoveEntryList (&Handle->AllHandles);
-    CoreFreePool (Handle);
+    RemoveEntryList (&Handle->HashLink);
+    CoreFreeSlabPool (Handle, sizeof (IHANDLE));
   }
 
 Done:
@@ -1154,7 +1263,7 @@ CoreOpenProtocol (
   //
   // Create new entry
   //
-  OpenData = AllocatePool (sizeof(OPEN_PROTOCOL_DATA));
+  OpenData = CoreAllocateSlabPool (sizeof(OPEN_PROTOCOL_DATA));
   if (OpenData == NULL) {
     Status = EFI_OUT_OF_RESOURCES;
   } else {
@@ -1291,7 +1400,7 @@ CoreCloseProtocol (
     if ((OpenData->AgentHandle == AgentHandle) && (OpenData->ControllerHandle == ControllerHandle)) {
         RemoveEntryList (&OpenData->Link);
         ProtocolInterface->OpenListCount--;
-        CoreFreePool (OpenData);
+        CoreFreeSlabPool (OpenData, sizeof (OPEN_PROTOCOL_DATA));
         Status = EFI_SUCCESS;
     }
   }
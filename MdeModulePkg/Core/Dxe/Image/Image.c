@@ -1,7 +1,7 @@
 /** @file
   Core image handling services to load and unload PeImage.
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -565,6 +565,7 @@ CoreLoadPeImage (
   EFI_STATUS                Status;
   BOOLEAN                   DstBufAlocated;
   UINTN                     Size;
+  VOID                      *RelocationData;
 
   ZeroMem (&Image->ImageContext, sizeof (Image->ImageContext));
 
@@ -726,7 +727,7 @@ CoreLoadPeImage (
   //
   if ((Attribute & EFI_LOAD_PE_IMAGE_ATTRIBUTE_RUNTIME_REGISTRATION) != 0) {
     if (Image->ImageContext.ImageType == EFI_IMAGE_SUBSYSTEM_EFI_RUNTIME_DRIVER) {
-      Image->ImageContext.FixupData = AllocateRuntimePool ((UINTN)(Image->ImageContext.FixupDataSize));
+      Image->ImageContext.FixupData = AllocatePool ((UINTN)(Image->ImageContext.FixupDataSize));
       if (Image->ImageContext.FixupData == NULL) {
         Status = EFI_OUT_OF_RESOURCES;
         goto Done;
@@ -742,6 +743,33 @@ CoreLoadPeImage (
     goto Done;
   }
 
+  //
+  // The Runtime AP gets the runtime relocation table of the image, which is
+  // smaller than the FixupData and faster to apply, or the FixupData if the
+  // image has relocations that the table cannot describe. Either is kept in
+  // runtime memory.
+  //
+  if (Image->ImageContext.FixupData != NULL) {
+    Size   = 0;
+    Status = PeCoffLoaderBuildRuntimeRelocationTable (&Image->ImageContext, NULL, &Size);
+    if (Status == RETURN_BUFFER_TOO_SMALL) {
+      RelocationData = AllocateRuntimePool (Size);
+      if (RelocationData != NULL) {
+        Status = PeCoffLoaderBuildRuntimeRelocationTable (&Image->ImageContext, RelocationData, &Size);
+        ASSERT_EFI_ERROR (Status);
+      }
+    } else {
+      RelocationData = AllocateRuntimeCopyPool ((UINTN)(Image->ImageContext.FixupDataSize), Image->ImageContext.FixupData);
+    }
+
+    CoreFreePool (Image->ImageContext.FixupData);
+    Image->ImageContext.FixupData = RelocationData;
+    if (RelocationData == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Done;
+    }
+  }
+
   //
   // Flush the Instruction Cache
   //
@@ -1133,6 +1161,8 @@ CoreLoadImageCommon (
   UINTN                      FilePathSize;
   BOOLEAN                    ImageIsFromFv;
   BOOLEAN                    ImageIsFromLoadFile;
+  EFI_FIRMWARE_VOLUME2_PROTOCOL *FwVol;
+  EFI_GUID                   *FvNameGuid;
 
   SecurityStatus = EFI_SUCCESS;
 
@@ -1210,18 +1240,51 @@ CoreLoadImageCommon (
     }
 
     //
-    // Get the source file buffer by its device path.
+    // Images in the firmware volumes produced by the DXE Core are loaded
+    // straight from the section stream of their file, where compressed
+    // files are already extracted, without copying the PE32 section.
     //
-    FHand.Source = GetFileBufferByFilePath (
-                      BootPolicy,
-                      FilePath,
-                      &FHand.SourceSize,
-                      &AuthenticationStatus
-                      );
+    if (ImageIsFromFv) {
+      FvNameGuid = EfiGetNameGuidFromFwVolDevicePathNode ((CONST MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *) HandleFilePath);
+      if (FvNameGuid != NULL) {
+        Status = CoreHandleProtocol (DeviceHandle, &gEfiFirmwareVolume2ProtocolGuid, (VOID **)&FwVol);
+        if (!EFI_ERROR (Status)) {
+          Status = FvLocateFileSection (
+                     FwVol,
+                     FvNameGuid,
+                     EFI_SECTION_PE32,
+                     0,
+                     &FHand.Source,
+                     &FHand.SourceSize,
+                     &AuthenticationStatus
+                     );
+        }
+        if (EFI_ERROR (Status)) {
+          FHand.Source         = NULL;
+          AuthenticationStatus = 0;
+        }
+      }
+      Status = EFI_SUCCESS;
+    }
+
     if (FHand.Source == NULL) {
-      Status = EFI_NOT_FOUND;
-    } else {
-      FHand.FreeBuffer = TRUE;
+      //
+      // Get the source file buffer by its device path.
+      //
+      FHand.Source = GetFileBufferByFilePath (
+                        BootPolicy,
+                        FilePath,
+                        &FHand.SourceSize,
+                        &AuthenticationStatus
+                        );
+      if (FHand.Source == NULL) {
+        Status = EFI_NOT_FOUND;
+      } else {
+        FHand.FreeBuffer = TRUE;
+      }
+    }
+
+    if (FHand.Source != NULL) {
       if (ImageIsFromLoadFile) {
         //
         // LoadFile () may cause the device path of the Handle be updated.
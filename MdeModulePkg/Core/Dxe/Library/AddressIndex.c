@@ -0,0 +1,474 @@
+/** @file
+  Address ordered index used by the DXE Core to look up the descriptors of
+  its memory maps in logarithmic time.
+
+  The index is an AVL tree whose nodes are embedded in the indexed
+  descriptors, so that maintaining it never needs to allocate memory. This
+  matters because the memory map index is updated while the memory lock is
+  held.
+
+  Each node carries a caller defined weight, and each subtree caches the
+  largest weight it contains. Searches take a minimum weight and skip the
+  subtrees that cannot hold a match, which lets the memory services find a
+  large enough free descriptor without visiting the allocated ones.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+/**
+  Returns the height of a subtree.
+
+  @param  Node                   The root of the subtree, or NULL.
+
+  @return The height of the subtree, 0 for an empty subtree.
+
+**/
+STATIC
+UINT32
+AddressIndexHeight (
+  IN ADDRESS_INDEX_NODE  *Node
+  )
+{
+  return (Node == NULL) ? 0 : Node->Height;
+}
+
+/**
+  Returns the largest weight in a subtree.
+
+  @param  Node                   The root of the subtree, or NULL.
+
+  @return The largest weight in the subtree, 0 for an empty subtree.
+
+**/
+STATIC
+UINT64
+AddressIndexMaxWeight (
+  IN ADDRESS_INDEX_NODE  *Node
+  )
+{
+  return (Node == NULL) ? 0 : Node->MaxWeight;
+}
+
+/**
+  Compares two nodes. Nodes are ordered by key, and nodes with the same key
+  by address, so that a node can always be located in the tree.
+
+  @param  Node1                  The first node to compare.
+  @param  Node2                  The second node to compare.
+
+  @retval <0                     Node1 is ordered before Node2.
+  @retval 0                      Node1 and Node2 are the same node.
+  @retval >0                     Node1 is ordered after Node2.
+
+**/
+STATIC
+INTN
+AddressIndexCompare (
+  IN ADDRESS_INDEX_NODE  *Node1,
+  IN ADDRESS_INDEX_NODE  *Node2
+  )
+{
+  if (Node1->Key != Node2->Key) {
+    return (Node1->Key < Node2->Key) ? -1 : 1;
+  }
+
+  if (Node1 == Node2) {
+    return 0;
+  }
+
+  return ((UINTN) Node1 < (UINTN) Node2) ? -1 : 1;
+}
+
+/**
+  Recomputes the height and the largest weight of a node from its children.
+
+  @param  Node                   The node to update.
+
+**/
+STATIC
+VOID
+AddressIndexUpdate (
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  Node->Height    = 1 + MAX (AddressIndexHeight (Node->Left), AddressIndexHeight (Node->Right));
+  Node->MaxWeight = MAX (Node->Weight, MAX (AddressIndexMaxWeight (Node->Left), AddressIndexMaxWeight (Node->Right)));
+}
+
+/**
+  Rotates a subtree to the right.
+
+  @param  Node                   The root of the subtree.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexRotateRight (
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  ADDRESS_INDEX_NODE  *Left;
+
+  Left        = Node->Left;
+  Node->Left  = Left->Right;
+  Left->Right = Node;
+  AddressIndexUpdate (Node);
+  AddressIndexUpdate (Left);
+  return Left;
+}
+
+/**
+  Rotates a subtree to the left.
+
+  @param  Node                   The root of the subtree.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexRotateLeft (
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  ADDRESS_INDEX_NODE  *Right;
+
+  Right       = Node->Right;
+  Node->Right = Right->Left;
+  Right->Left = Node;
+  AddressIndexUpdate (Node);
+  AddressIndexUpdate (Right);
+  return Right;
+}
+
+/**
+  Restores the AVL balance of a subtree whose children are balanced.
+
+  @param  Node                   The root of the subtree.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexBalance (
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  UINT32  LeftHeight;
+  UINT32  RightHeight;
+
+  AddressIndexUpdate (Node);
+  LeftHeight  = AddressIndexHeight (Node->Left);
+  RightHeight = AddressIndexHeight (Node->Right);
+
+  if (LeftHeight > RightHeight + 1) {
+    if (AddressIndexHeight (Node->Left->Left) < AddressIndexHeight (Node->Left->Right)) {
+      Node->Left = AddressIndexRotateLeft (Node->Left);
+    }
+    return AddressIndexRotateRight (Node);
+  }
+
+  if (RightHeight > LeftHeight + 1) {
+    if (AddressIndexHeight (Node->Right->Right) < AddressIndexHeight (Node->Right->Left)) {
+      Node->Right = AddressIndexRotateRight (Node->Right);
+    }
+    return AddressIndexRotateLeft (Node);
+  }
+
+  return Node;
+}
+
+/**
+  Inserts a node in a subtree.
+
+  @param  Root                   The root of the subtree, or NULL.
+  @param  Node                   The node to insert.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexInsertNode (
+  IN OUT ADDRESS_INDEX_NODE  *Root,
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  if (Root == NULL) {
+    return Node;
+  }
+
+  if (AddressIndexCompare (Node, Root) < 0) {
+    Root->Left = AddressIndexInsertNode (Root->Left, Node);
+  } else {
+    Root->Right = AddressIndexInsertNode (Root->Right, Node);
+  }
+
+  return AddressIndexBalance (Root);
+}
+
+/**
+  Detaches the node with the lowest key from a subtree.
+
+  @param  Root                   The root of the subtree.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexRemoveFirstNode (
+  IN OUT ADDRESS_INDEX_NODE  *Root
+  )
+{
+  if (Root->Left == NULL) {
+    return Root->Right;
+  }
+
+  Root->Left = AddressIndexRemoveFirstNode (Root->Left);
+  return AddressIndexBalance (Root);
+}
+
+/**
+  Removes a node from a subtree.
+
+  @param  Root                   The root of the subtree, or NULL.
+  @param  Node                   The node to remove.
+
+  @return The new root of the subtree.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexRemoveNode (
+  IN OUT ADDRESS_INDEX_NODE  *Root,
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  ADDRESS_INDEX_NODE  *First;
+  INTN                Result;
+
+  if (Root == NULL) {
+    ASSERT (Root != NULL);
+    return NULL;
+  }
+
+  Result = AddressIndexCompare (Node, Root);
+  if (Result < 0) {
+    Root->Left = AddressIndexRemoveNode (Root->Left, Node);
+  } else if (Result > 0) {
+    Root->Right = AddressIndexRemoveNode (Root->Right, Node);
+  } else {
+    if (Root->Left == NULL) {
+      return Root->Right;
+    }
+    if (Root->Right == NULL) {
+      return Root->Left;
+    }
+
+    //
+    // Replace the node with the first node of its right subtree
+    //
+    First = Root->Right;
+    while (First->Left != NULL) {
+      First = First->Left;
+    }
+    First->Right = AddressIndexRemoveFirstNode (Root->Right);
+    First->Left  = Root->Left;
+    Root         = First;
+  }
+
+  return AddressIndexBalance (Root);
+}
+
+/**
+  Finds, in a subtree, the node with the highest key that is not above
+  MaxKey and whose weight is at least MinWeight.
+
+  @param  Root                   The root of the subtree, or NULL.
+  @param  MaxKey                 The highest key to return.
+  @param  MinWeight              The lowest weight to return.
+
+  @return The node found, or NULL.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexFindPreviousNode (
+  IN ADDRESS_INDEX_NODE  *Root,
+  IN UINT64              MaxKey,
+  IN UINT64              MinWeight
+  )
+{
+  ADDRESS_INDEX_NODE  *Node;
+
+  while (Root != NULL && Root->MaxWeight >= MinWeight) {
+    if (Root->Key > MaxKey) {
+      Root = Root->Left;
+      continue;
+    }
+
+    Node = AddressIndexFindPreviousNode (Root->Right, MaxKey, MinWeight);
+    if (Node != NULL) {
+      return Node;
+    }
+
+    if (Root->Weight >= MinWeight) {
+      return Root;
+    }
+
+    Root = Root->Left;
+  }
+
+  return NULL;
+}
+
+/**
+  Finds, in a subtree, the node with the lowest key that is not below
+  MinKey and whose weight is at least MinWeight.
+
+  @param  Root                   The root of the subtree, or NULL.
+  @param  MinKey                 The lowest key to return.
+  @param  MinWeight              The lowest weight to return.
+
+  @return The node found, or NULL.
+
+**/
+STATIC
+ADDRESS_INDEX_NODE *
+AddressIndexFindNextNode (
+  IN ADDRESS_INDEX_NODE  *Root,
+  IN UINT64              MinKey,
+  IN UINT64              MinWeight
+  )
+{
+  ADDRESS_INDEX_NODE  *Node;
+
+  while (Root != NULL && Root->MaxWeight >= MinWeight) {
+    if (Root->Key < MinKey) {
+      Root = Root->Right;
+      continue;
+    }
+
+    Node = AddressIndexFindNextNode (Root->Left, MinKey, MinWeight);
+    if (Node != NULL) {
+      return Node;
+    }
+
+    if (Root->Weight >= MinWeight) {
+      return Root;
+    }
+
+    Root = Root->Right;
+  }
+
+  return NULL;
+}
+
+/**
+  Inserts a node in an address index.
+
+  @param  Index                  The address index.
+  @param  Node                   The node to insert. It must not be in an index.
+  @param  Key                    The key of the node, usually the base address
+                                 of the descriptor that embeds it.
+  @param  Weight                 The weight of the node.
+
+**/
+VOID
+CoreAddressIndexInsert (
+  IN OUT ADDRESS_INDEX       *Index,
+  IN OUT ADDRESS_INDEX_NODE  *Node,
+  IN     UINT64              Key,
+  IN     UINT64              Weight
+  )
+{
+  Node->Left      = NULL;
+  Node->Right     = NULL;
+  Node->Key       = Key;
+  Node->Weight    = Weight;
+  Node->MaxWeight = Weight;
+  Node->Height    = 1;
+
+  Index->Root = AddressIndexInsertNode (Index->Root, Node);
+  Index->Count++;
+}
+
+/**
+  Removes a node from an address index. Nothing is done if the node is not
+  in an index.
+
+  The key and the weight of a node must not change while it is in an index,
+  so a node is removed before its descriptor is updated, and inserted again
+  afterwards.
+
+  @param  Index                  The address index.
+  @param  Node                   The node to remove.
+
+**/
+VOID
+CoreAddressIndexRemove (
+  IN OUT ADDRESS_INDEX       *Index,
+  IN OUT ADDRESS_INDEX_NODE  *Node
+  )
+{
+  if (Node->Height == 0) {
+    return;
+  }
+
+  Index->Root = AddressIndexRemoveNode (Index->Root, Node);
+  Index->Count--;
+
+  Node->Left   = NULL;
+  Node->Right  = NULL;
+  Node->Height = 0;
+}
+
+/**
+  Finds the node with the highest key that is not above MaxKey and whose
+  weight is at least MinWeight.
+
+  @param  Index                  The address index.
+  @param  MaxKey                 The highest key to return.
+  @param  MinWeight              The lowest weight to return. 0 matches any node.
+
+  @return The node found, or NULL.
+
+**/
+ADDRESS_INDEX_NODE *
+CoreAddressIndexFindPrevious (
+  IN ADDRESS_INDEX  *Index,
+  IN UINT64         MaxKey,
+  IN UINT64         MinWeight
+  )
+{
+  return AddressIndexFindPreviousNode (Index->Root, MaxKey, MinWeight);
+}
+
+/**
+  Finds the node with the lowest key that is not below MinKey and whose
+  weight is at least MinWeight.
+
+  @param  Index                  The address index.
+  @param  MinKey                 The lowest key to return.
+  @param  MinWeight              The lowest weight to return. 0 matches any node.
+
+  @return The node found, or NULL.
+
+**/
+ADDRESS_INDEX_NODE *
+CoreAddressIndexFindNext (
+  IN ADDRESS_INDEX  *Index,
+  IN UINT64         MinKey,
+  IN UINT64         MinWeight
+  )
+{
+  return AddressIndexFindNextNode (Index->Root, MinKey, MinWeight);
+}
@@ -41,6 +41,12 @@ typedef struct {
 
   UINT64          VirtualStart;
   UINT64          Attribute;
+
+  ///
+  /// Node in mMemoryMapIndex. Its weight is the size of the range for
+  /// EfiConventionalMemory, and 0 for any other type.
+  ///
+  ADDRESS_INDEX_NODE  IndexNode;
 } MEMORY_MAP;
 
 //
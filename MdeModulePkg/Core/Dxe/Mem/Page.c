@@ -44,6 +44,11 @@ UINTN         mFreeMapStack = 0;
 ///
 LIST_ENTRY   mFreeMemoryMapEntryList = INITIALIZE_LIST_HEAD_VARIABLE (mFreeMemoryMapEntryList);
 BOOLEAN      mMemoryTypeInformationInitialized = FALSE;
+///
+/// mMemoryMapIndex - address ordered index over all the entries of gMemoryMap.
+/// gMemoryMap remains the list that CoreGetMemoryMap() reports.
+///
+ADDRESS_INDEX mMemoryMapIndex = { NULL, 0 };
 
 EFI_MEMORY_TYPE_STATISTICS mMemoryTypeStatistics[EfiMaxMemoryType + 1] = {
   { 0, MAX_ALLOC_ADDRESS, 0, 0, EfiMaxMemoryType, TRUE,  FALSE },  // EfiReservedMemoryType
@@ -121,6 +126,57 @@ CoreReleaseMemoryLock (
 
 
 
+/**
+  Internal function.  Adds a descriptor entry of gMemoryMap to mMemoryMapIndex.
+
+  @param  Entry                  The entry to index
+
+**/
+STATIC
+VOID
+IndexMemoryMapEntry (
+  IN OUT MEMORY_MAP      *Entry
+  )
+{
+  CoreAddressIndexInsert (
+    &mMemoryMapIndex,
+    &Entry->IndexNode,
+    Entry->Start,
+    (Entry->Type == EfiConventionalMemory) ? Entry->End - Entry->Start + 1 : 0
+    );
+}
+
+/**
+  Internal function.  Finds the descriptor entry that covers an address.
+
+  @param  Address                The address to look up
+
+  @return The entry that covers Address, or NULL if there is none.
+
+**/
+STATIC
+MEMORY_MAP *
+FindMemoryMapEntry (
+  IN UINT64              Address
+  )
+{
+  ADDRESS_INDEX_NODE    *Node;
+  MEMORY_MAP            *Entry;
+
+  Node = CoreAddressIndexFindPrevious (&mMemoryMapIndex, Address, 0);
+  if (Node == NULL) {
+    return NULL;
+  }
+
+  Entry = BASE_CR (Node, MEMORY_MAP, IndexNode);
+  ASSERT (Entry->Signature == MEMORY_MAP_SIGNATURE);
+  if (Entry->End <= Address) {
+    return NULL;
+  }
+
+  return Entry;
+}
+
 /**
   Internal function.  Removes a descriptor entry.
 
@@ -132,6 +188,7 @@ RemoveMemoryMapEntry (
   IN OUT MEMORY_MAP      *Entry
   )
 {
+  CoreAddressIndexRemove (&mMemoryMapIndex, &Entry->IndexNode);
   RemoveEntryList (&Entry->Link);
   Entry->Link.ForwardLink = NULL;
 
@@ -163,8 +220,8 @@ CoreAddRange (
   IN UINT64                   Attribute
   )
 {
-  LIST_ENTRY        *Link;
-  MEMORY_MAP        *Entry;
+  ADDRESS_INDEX_NODE  *Node;
+  MEMORY_MAP          *Entry;
 
   ASSERT ((Start & EFI_PAGE_MASK) == 0);
   ASSERT (End > Start) ;
@@ -209,31 +266,29 @@ CoreAddRange (
   //
 
   // Two memory descriptors can only be merged if they have the same Type
-  // and the same Attribute
+  // and the same Attribute. The range does not overlap any descriptor, so
+  // only the descriptors right below and right above it may adjoin it.
   //
 
-  Link = gMemoryMap.ForwardLink;
-  while (Link != &gMemoryMap) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    Link  = Link->ForwardLink;
-
-    if (Entry->Type != Type) {
-      continue;
-    }
-
-    if (Entry->Attribute != Attribute) {
-      continue;
+  if (Start != 0) {
+    Node = CoreAddressIndexFindPrevious (&mMemoryMapIndex, Start - 1, 0);
+    if (Node != NULL) {
+      Entry = BASE_CR (Node, MEMORY_MAP, IndexNode);
+      if (Entry->Type == Type && Entry->Attribute == Attribute && Entry->End + 1 == Start) {
+        Start = Entry->Start;
+        RemoveMemoryMapEntry (Entry);
+      }
     }
+  }
 
-    if (Entry->End + 1 == Start) {
-
-      Start = Entry->Start;
-      RemoveMemoryMapEntry (Entry);
-
-    } else if (Entry->Start == End + 1) {
-
-      End = Entry->End;
-      RemoveMemoryMapEntry (Entry);
+  if (End != MAX_UINT64) {
+    Node = CoreAddressIndexFindNext (&mMemoryMapIndex, End + 1, 0);
+    if (Node != NULL) {
+      Entry = BASE_CR (Node, MEMORY_MAP, IndexNode);
+      if (Entry->Type == Type && Entry->Attribute == Attribute && Entry->Start == End + 1) {
+        End = Entry->End;
+        RemoveMemoryMapEntry (Entry);
+      }
     }
   }
 
@@ -249,6 +304,7 @@ CoreAddRange (
   mMapStack[mMapDepth].VirtualStart  = 0;
   mMapStack[mMapDepth].Attribute     = Attribute;
   InsertTailList (&gMemoryMap, &mMapStack[mMapDepth].Link);
+  IndexMemoryMapEntry (&mMapStack[mMapDepth]);
 
   mMapDepth += 1;
   ASSERT (mMapDepth < MAX_MAP_DEPTH);
@@ -320,9 +376,10 @@ CoreFreeMemoryMapStack (
   VOID
   )
 {
-  MEMORY_MAP      *Entry;
-  MEMORY_MAP      *Entry2;
-  LIST_ENTRY      *Link2;
+  MEMORY_MAP          *Entry;
+  MEMORY_MAP          *Entry2;
+  LIST_ENTRY          *Link2;
+  ADDRESS_INDEX_NODE  *Node;
 
   ASSERT_LOCKED (&gMemoryLock);
 
@@ -356,6 +413,7 @@ CoreFreeMemoryMapStack (
       //
       // Move this entry to general memory
       //
+      CoreAddressIndexRemove (&mMemoryMapIndex, &mMapStack[mMapDepth].IndexNode);
       RemoveEntryList (&mMapStack[mMapDepth].Link);
       mMapStack[mMapDepth].Link.ForwardLink = NULL;
 
@@ -363,16 +421,22 @@ CoreFreeMemoryMapStack (
       Entry->FromPages = TRUE;
 
       //
-      // Find insertion location
+      // Find insertion location: in front of the next entry from pages by
+      // address. Only the few entries still on the stack may be in between.
       //
-      for (Link2 = gMemoryMap.ForwardLink; Link2 != &gMemoryMap; Link2 = Link2->ForwardLink) {
-        Entry2 = CR (Link2, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+      Link2 = &gMemoryMap;
+      for (Node = CoreAddressIndexFindNext (&mMemoryMapIndex, Entry->Start, 0);
+           Node != NULL;
+           Node = CoreAddressIndexFindNext (&mMemoryMapIndex, Node->Key + 1, 0)) {
+        Entry2 = BASE_CR (Node, MEMORY_MAP, IndexNode);
         if (Entry2->FromPages && Entry2->Start > Entry->Start) {
+          Link2 = &Entry2->Link;
           break;
         }
       }
 
       InsertTailList (Link2, &Entry->Link);
+      IndexMemoryMapEntry (Entry);
 
     } else {
       //
@@ -736,7 +800,6 @@ CoreConvertPagesEx (
   UINT64          RangeEnd;
   UINT64          Attribute;
   EFI_MEMORY_TYPE MemType;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
 
   Entry = NULL;
@@ -762,15 +825,8 @@ CoreConvertPagesEx (
     //
     // Find the entry that the covers the range
     //
-    for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-      Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-      if (Entry->Start <= Start && Entry->End > Start) {
-        break;
-      }
-    }
-
-    if (Link == &gMemoryMap) {
+    Entry = FindMemoryMapEntry (Start);
+    if (Entry == NULL) {
       DEBUG ((DEBUG_ERROR | DEBUG_PAGE, "ConvertPages: failed to find range %lx - %lx\n", Start, End));
       return EFI_NOT_FOUND;
     }
@@ -844,8 +900,10 @@ CoreConvertPagesEx (
     }
 
     //
-    // Pull range out of descriptor
+    // Pull range out of descriptor. The descriptor leaves the index while
+    // its range changes, and is indexed again below if it is not empty.
     //
+    CoreAddressIndexRemove (&mMemoryMapIndex, &Entry->IndexNode);
     if (Entry->Start == Start) {
 
       //
@@ -882,6 +940,7 @@ CoreConvertPagesEx (
 
       Entry->End = Start - 1;
       ASSERT (Entry->Start < Entry->End);
+      IndexMemoryMapEntry (Entry);
 
       Entry = &mMapStack[mMapDepth];
       InsertTailList (&gMemoryMap, &Entry->Link);
@@ -908,6 +967,8 @@ CoreConvertPagesEx (
     if (Entry->Start == Entry->End + 1) {
       RemoveMemoryMapEntry (Entry);
       Entry = NULL;
+    } else {
+      IndexMemoryMapEntry (Entry);
     }
 
     //
@@ -1037,9 +1098,9 @@ CoreFindFreePagesI (
   UINT64          Target;
   UINT64          DescStart;
   UINT64          DescEnd;
-  UINT64          DescNumberOfBytes;
-  LIST_ENTRY      *Link;
-  MEMORY_MAP      *Entry;
+  UINT64              DescNumberOfBytes;
+  ADDRESS_INDEX_NODE  *Node;
+  MEMORY_MAP          *Entry;
 
   if ((MaxAddress < EFI_PAGE_MASK) ||(NumberOfPages == 0)) {
     return 0;
@@ -1070,24 +1131,25 @@ CoreFindFreePagesI (
   NumberOfBytes = LShiftU64 (NumberOfPages, EFI_PAGE_SHIFT);
   Target = 0;
 
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-    //
-    // If it's not a free entry, don't bother with it
-    //
-    if (Entry->Type != EfiConventionalMemory) {
-      continue;
-    }
+  //
+  // Walk the free entries that are large enough for the request from the
+  // highest address down. Entries do not overlap, so the first one that
+  // satisfies the request is the one with the highest usable end address.
+  //
+  for (Node = CoreAddressIndexFindPrevious (&mMemoryMapIndex, MaxAddress - 1, NumberOfBytes);
+       Node != NULL;
+       Node = (Node->Key == 0) ? NULL : CoreAddressIndexFindPrevious (&mMemoryMapIndex, Node->Key - 1, NumberOfBytes)) {
+    Entry = BASE_CR (Node, MEMORY_MAP, IndexNode);
+    ASSERT (Entry->Type == EfiConventionalMemory);
 
     DescStart = Entry->Start;
     DescEnd = Entry->End;
 
     //
-    // If desc is past max allowed address or below min allowed address, skip it
+    // If desc is below min allowed address, so are all the remaining ones
     //
-    if ((DescStart >= MaxAddress) || (DescEnd < MinAddress)) {
-      continue;
+    if (DescEnd < MinAddress) {
+      break;
     }
 
     //
@@ -1118,23 +1180,19 @@ CoreFindFreePagesI (
         continue;
       }
 
-      //
-      // If this is the best match so far remember it
-      //
-      if (DescEnd > Target) {
-        if (NeedGuard) {
-          DescEnd = AdjustMemoryS (
-                      DescEnd + 1 - DescNumberOfBytes,
-                      DescNumberOfBytes,
-                      NumberOfBytes
-                      );
-          if (DescEnd == 0) {
-            continue;
-          }
+      if (NeedGuard) {
+        DescEnd = AdjustMemoryS (
+                    DescEnd + 1 - DescNumberOfBytes,
+                    DescNumberOfBytes,
+                    NumberOfBytes
+                    );
+        if (DescEnd == 0) {
+          continue;
         }
-
-        Target = DescEnd;
       }
+
+      Target = DescEnd;
+      break;
     }
   }
 
@@ -1477,7 +1535,6 @@ CoreInternalFreePages (
   )
 {
   EFI_STATUS      Status;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
   UINTN           Alignment;
   BOOLEAN         IsGuarded;
@@ -1491,14 +1548,8 @@ CoreInternalFreePages (
   // Find the entry that the covers the range
   //
   IsGuarded = FALSE;
-  Entry = NULL;
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR(Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    if (Entry->Start <= Memory && Entry->End > Memory) {
-        break;
-    }
-  }
-  if (Link == &gMemoryMap) {
+  Entry = FindMemoryMapEntry (Memory);
+  if (Entry == NULL) {
     Status = EFI_NOT_FOUND;
     goto Done;
   }
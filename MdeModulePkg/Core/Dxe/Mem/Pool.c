@@ -83,6 +83,58 @@ POOL            mPoolHead[EfiMaxMemoryType];
 //
 LIST_ENTRY      mPoolHeadList = INITIALIZE_LIST_HEAD_VARIABLE (mPoolHeadList);
 
+//
+// Slab fast path for the small fixed size objects the DXE Core allocates for
+// its own bookkeeping (IHANDLE, PROTOCOL_INTERFACE, OPEN_PROTOCOL_DATA, IEVENT).
+// Each slab page holds objects of a single size class and starts with a
+// SLAB_PAGE_HEAD, so the objects carry neither a POOL_HEAD nor a POOL_TAIL.
+// Slab pages are never given back; they are bounded by the peak number of
+// live objects.
+//
+#define SLAB_PAGE_SIGNATURE   SIGNATURE_32('s','l','b','p')
+typedef struct {
+  UINT32          Signature;
+  UINT32          Class;
+  UINT64          Reserved;
+} SLAB_PAGE_HEAD;
+
+#define SLAB_FREE_SIGNATURE   SIGNATURE_32('s','l','b','f')
+typedef struct _SLAB_FREE SLAB_FREE;
+struct _SLAB_FREE {
+  UINT32          Signature;
+  SLAB_FREE       *Next;
+};
+
+#define SLAB_GRANULARITY      16
+#define SLAB_MAX_OBJECT_SIZE  256
+#define SLAB_CLASS_COUNT      (SLAB_MAX_OBJECT_SIZE / SLAB_GRANULARITY)
+
+#define SIZE_TO_SLAB_CLASS(a) (((a) + SLAB_GRANULARITY - 1) / SLAB_GRANULARITY - 1)
+#define SLAB_CLASS_TO_SIZE(a) (((a) + 1) * SLAB_GRANULARITY)
+
+typedef struct {
+  SLAB_FREE       *FreeList;
+  UINT64          Allocations;
+  UINT64          Frees;
+  UINTN           Pages;
+} SLAB_CLASS;
+
+SLAB_CLASS      mSlabClass[SLAB_CLASS_COUNT];
+
+//
+// TRUE if the slab fast path may be used. It is decided once, when the pool
+// is initialized, because an object must be freed the way it was allocated.
+//
+BOOLEAN         mSlabEnabled = FALSE;
+
+//
+// Pool memory (headers, tails and bin rounding) the slab fast path avoided
+// for all the allocations it absorbed, and for the live objects at peak.
+//
+UINT64          mSlabBytesSaved;
+INT64           mSlabLiveBytesSaved;
+INT64           mSlabPeakBytesSaved;
+
 /**
   Get pool size table index from the specified size.
 
@@ -127,6 +179,14 @@ CoreInitializePool (
       InitializeListHead (&mPoolHead[Type].FreeList[Index]);
     }
   }
+
+  //
+  // Slab objects are invisible to the heap guard and to the memory profile,
+  // so only use them when neither of those is watching the pool.
+  //
+  mSlabEnabled = !IsPoolTypeToGuard (EfiBootServicesData) &&
+                 !IsHeapGuardEnabled (GUARD_HEAP_TYPE_FREED) &&
+                 ((PcdGet8 (PcdMemoryProfilePropertyMask) & BIT0) == 0);
 }
 
 
@@ -855,3 +915,212 @@ CoreFreePoolI (
   return EFI_SUCCESS;
 }
 
+/**
+  Returns the number of bytes a pool allocation of Size bytes consumes from
+  the pool bins, including the pool header and tail.
+
+  @param  Size                   The size of the pool allocation
+
+  @return The size of the pool block that would back the allocation.
+
+**/
+STATIC
+UINTN
+GetPoolBlockSize (
+  IN UINTN  Size
+  )
+{
+  Size = ALIGN_VARIABLE (Size) + POOL_OVERHEAD;
+  return LIST_TO_SIZE (SIZE_TO_LIST (Size));
+}
+
+/**
+  Allocates a zeroed small fixed size object of EfiBootServicesData.
+
+  The object comes from a slab page of its size class when the slab fast path
+  is enabled, and from the regular pool otherwise. The object must be freed
+  with CoreFreeSlabPool() and the same Size.
+
+  @param  Size                   The size of the object to allocate
+
+  @return The allocated object, or NULL
+
+**/
+VOID *
+CoreAllocateSlabPool (
+  IN UINTN  Size
+  )
+{
+  SLAB_CLASS      *SlabClass;
+  SLAB_PAGE_HEAD  *Page;
+  SLAB_FREE       *Free;
+  UINTN           Class;
+  UINTN           ClassSize;
+  UINTN           Offset;
+  INT64           Saved;
+  VOID            *Buffer;
+  EFI_STATUS      Status;
+
+  if (!mSlabEnabled || Size == 0 || Size > SLAB_MAX_OBJECT_SIZE) {
+    Status = CoreAllocatePool (EfiBootServicesData, Size, &Buffer);
+    if (EFI_ERROR (Status)) {
+      return NULL;
+    }
+    ZeroMem (Buffer, Size);
+    return Buffer;
+  }
+
+  Class     = SIZE_TO_SLAB_CLASS (Size);
+  ClassSize = SLAB_CLASS_TO_SIZE (Class);
+  SlabClass = &mSlabClass[Class];
+
+  Status = CoreAcquireLockOrFail (&mPoolMemoryLock);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  if (SlabClass->FreeList == NULL) {
+    //
+    // Carve a new slab page into free objects of this size class
+    //
+    Page = CoreAllocatePoolPagesI (
+             EfiBootServicesData,
+             EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION_GRANULARITY),
+             DEFAULT_PAGE_ALLOCATION_GRANULARITY,
+             FALSE
+             );
+    if (Page == NULL) {
+      CoreReleaseLock (&mPoolMemoryLock);
+      return NULL;
+    }
+
+    Page->Signature = SLAB_PAGE_SIGNATURE;
+    Page->Class     = (UINT32)Class;
+    SlabClass->Pages++;
+
+    for (Offset = sizeof (SLAB_PAGE_HEAD);
+         Offset + ClassSize <= DEFAULT_PAGE_ALLOCATION_GRANULARITY;
+         Offset += ClassSize) {
+      Free = (SLAB_FREE *) ((UINT8 *) Page + Offset);
+      Free->Signature     = SLAB_FREE_SIGNATURE;
+      Free->Next          = SlabClass->FreeList;
+      SlabClass->FreeList = Free;
+    }
+  }
+
+  Free = SlabClass->FreeList;
+  ASSERT (Free->Signature == SLAB_FREE_SIGNATURE);
+  SlabClass->FreeList = Free->Next;
+  SlabClass->Allocations++;
+
+  Saved = (INT64) (GetPoolBlockSize (Size) - ClassSize);
+  mSlabBytesSaved     += (UINT64) Saved;
+  mSlabLiveBytesSaved += Saved;
+  if (mSlabLiveBytesSaved > mSlabPeakBytesSaved) {
+    mSlabPeakBytesSaved = mSlabLiveBytesSaved;
+  }
+
+  CoreReleaseLock (&mPoolMemoryLock);
+
+  ZeroMem (Free, ClassSize);
+  return Free;
+}
+
+/**
+  Frees an object allocated with CoreAllocateSlabPool().
+
+  @param  Buffer                 The object to free
+  @param  Size                   The size passed to CoreAllocateSlabPool()
+
+  @retval EFI_INVALID_PARAMETER  Buffer is not a valid slab object of Size bytes.
+  @retval EFI_SUCCESS            The object was successfully freed.
+
+**/
+EFI_STATUS
+CoreFreeSlabPool (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  )
+{
+  SLAB_CLASS      *SlabClass;
+  SLAB_PAGE_HEAD  *Page;
+  SLAB_FREE       *Free;
+  UINTN           Class;
+
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!mSlabEnabled || Size == 0 || Size > SLAB_MAX_OBJECT_SIZE) {
+    return CoreFreePool (Buffer);
+  }
+
+  Class = SIZE_TO_SLAB_CLASS (Size);
+  Page  = (SLAB_PAGE_HEAD *) ((UINTN) Buffer & ~(UINTN)(DEFAULT_PAGE_ALLOCATION_GRANULARITY - 1));
+  if (Page->Signature != SLAB_PAGE_SIGNATURE || Page->Class != Class) {
+    ASSERT (Page->Signature == SLAB_PAGE_SIGNATURE && Page->Class == Class);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SlabClass = &mSlabClass[Class];
+  DEBUG_CLEAR_MEMORY (Buffer, SLAB_CLASS_TO_SIZE (Class));
+
+  CoreAcquireLock (&mPoolMemoryLock);
+
+  Free = (SLAB_FREE *) Buffer;
+  Free->Signature     = SLAB_FREE_SIGNATURE;
+  Free->Next          = SlabClass->FreeList;
+  SlabClass->FreeList = Free;
+  SlabClass->Frees++;
+  mSlabLiveBytesSaved -= (INT64) (GetPoolBlockSize (Size) - SLAB_CLASS_TO_SIZE (Class));
+
+  CoreReleaseLock (&mPoolMemoryLock);
+  return EFI_SUCCESS;
+}
+
+/**
+  Reports how many allocations the slab fast path absorbed and how much pool
+  memory it saved.
+
+**/
+VOID
+CoreDumpSlabPoolStatistics (
+  VOID
+  )
+{
+  UINTN   Class;
+  UINT64  Allocations;
+  UINTN   Pages;
+
+  if (!mSlabEnabled) {
+    DEBUG ((DEBUG_INFO, "SlabPool: disabled\n"));
+    return;
+  }
+
+  Allocations = 0;
+  Pages       = 0;
+  for (Class = 0; Class < SLAB_CLASS_COUNT; Class++) {
+    if (mSlabClass[Class].Allocations == 0) {
+      continue;
+    }
+    DEBUG ((
+      DEBUG_INFO,
+      "SlabPool: %3d bytes - %,ld allocations, %,ld live, %ld pages\n",
+      (UINT32) SLAB_CLASS_TO_SIZE (Class),
+      mSlabClass[Class].Allocations,
+      mSlabClass[Class].Allocations - mSlabClass[Class].Frees,
+      (UINT64) mSlabClass[Class].Pages
+      ));
+    Allocations += mSlabClass[Class].Allocations;
+    Pages       += mSlabClass[Class].Pages;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "SlabPool: %,ld allocations absorbed in %ld pages, %,ld bytes of pool overhead saved (%,ld bytes at peak)\n",
+    Allocations,
+    (UINT64) Pages,
+    mSlabBytesSaved,
+    mSlabPeakBytesSaved
+    ));
+}
@@ -0,0 +1,69 @@
+/** @file
+  Index of the HOB list, which the DXE Core builds once its memory services
+  are initialized and installs in the EFI System Table's Configuration Table.
+  The HOB libraries of the DXE drivers use it to find HOBs without walking
+  the HOB list.
+
+  The HOB list does not grow in DXE, so every HOB type that fits in the index
+  is indexed, and the index is never updated.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+/**
+  Builds the index of a HOB list.
+
+  @param  HobList                The HOB list.
+
+  @return The HOB index, or NULL if it could not be allocated.
+
+**/
+EDKII_HOB_INDEX *
+CoreBuildHobIndex (
+  IN VOID  *HobList
+  )
+{
+  EDKII_HOB_INDEX       *Index;
+  EFI_PEI_HOB_POINTERS  Hob;
+  UINT32                EntryCount;
+  UINT32                GuidCount;
+  UINT32                GuidSlotCount;
+
+  EntryCount = 0;
+  GuidCount  = 0;
+  for (Hob.Raw = HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType < EDKII_HOB_INDEX_TYPE_COUNT) {
+      EntryCount++;
+      if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+        GuidCount++;
+      }
+    }
+  }
+
+  //
+  // Keep at least half of the GUID slots empty, so that probes are short.
+  //
+  GuidSlotCount = MAX (GetPowerOfTwo32 (GuidCount) * 4, 16);
+
+  Index = AllocatePool (GetHobIndexSize (EntryCount, GuidSlotCount));
+  if (Index == NULL) {
+    return NULL;
+  }
+
+  InitializeHobIndex (Index, HobList, BIT16 - 1, EntryCount, GuidSlotCount);
+
+  for (Hob.Raw = HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType < EDKII_HOB_INDEX_TYPE_COUNT) {
+      AppendHobToIndex (Index, Hob.Raw);
+    }
+  }
+
+  Index->IndexedEnd = Hob.Raw;
+
+  DEBUG ((DEBUG_INFO, "HOB index: %d HOBs, %d GUID HOBs\n", EntryCount, GuidCount));
+  return Index;
+}
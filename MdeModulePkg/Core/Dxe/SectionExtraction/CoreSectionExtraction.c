@@ -82,8 +82,17 @@ typedef struct {
   // Authentication status is from GUIDed encapsulations.
   //
   UINT32                      AuthenticationStatus;
+  //
+  // Link in the mStreamHashTable bucket of StreamHandle.
+  //
+  LIST_ENTRY                  HashLink;
 } CORE_SECTION_STREAM_NODE;
 
+//
+// Number of buckets of mStreamHashTable. It must be a power of 2.
+//
+#define STREAM_HASH_BUCKET_COUNT  64
+
 #define NULL_STREAM_HANDLE    0
 
 typedef struct {
@@ -191,6 +200,13 @@ CustomGuidedSectionExtract (
 //
 LIST_ENTRY mStreamRoot = INITIALIZE_LIST_HEAD_VARIABLE (mStreamRoot);
 
+//
+// Streams of mStreamRoot hashed by stream handle, so that every section read
+// does not have to walk all the streams. A bucket is initialized the first
+// time it is touched.
+//
+LIST_ENTRY mStreamHashTable[STREAM_HASH_BUCKET_COUNT];
+
 EFI_HANDLE mSectionExtractionHandle = NULL;
 
 EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL mCustomGuidedSectionExtractionProtocol = {
@@ -243,6 +259,39 @@ InitializeSectionExtraction (
 }
 
 
+/**
+  Returns the mStreamHashTable bucket of a stream handle. The handle itself is
+  never dereferenced, so StreamHandle may be any value.
+
+  @param  StreamHandle           The stream handle to hash.
+
+  @return The head of the hash bucket list.
+
+**/
+STATIC
+LIST_ENTRY *
+GetStreamHashBucket (
+  IN UINTN                      StreamHandle
+  )
+{
+  UINTN       Hash;
+  LIST_ENTRY  *Bucket;
+
+  //
+  // Stream handles are pool addresses, so the low 3 bits carry no information.
+  //
+  Hash = StreamHandle >> 3;
+  Hash ^= Hash >> 9;
+
+  Bucket = &mStreamHashTable[Hash & (STREAM_HASH_BUCKET_COUNT - 1)];
+  if (Bucket->ForwardLink == NULL) {
+    InitializeListHead (Bucket);
+  }
+
+  return Bucket;
+}
+
+
 /**
   Check if a stream is valid.
 
@@ -393,6 +442,7 @@ OpenSectionStreamEx (
   //
   OldTpl = CoreRaiseTpl (TPL_NOTIFY);
   InsertTailList (&mStreamRoot, &NewStream->Link);
+  InsertTailList (GetStreamHashBucket (NewStream->StreamHandle), &NewStream->HashLink);
   CoreRestoreTpl (OldTpl);
 
   *SectionStreamHandle = NewStream->StreamHandle;
@@ -1157,18 +1207,18 @@ FindStreamNode (
   )
 {
   CORE_SECTION_STREAM_NODE                      *StreamNode;
+  LIST_ENTRY                                    *Bucket;
+  LIST_ENTRY                                    *Link;
 
-  if (!IsListEmpty (&mStreamRoot)) {
-    StreamNode = STREAM_NODE_FROM_LINK (GetFirstNode (&mStreamRoot));
-    for (;;) {
-      if (StreamNode->StreamHandle == SearchHandle) {
-        *FoundStream = StreamNode;
-        return EFI_SUCCESS;
-      } else if (IsNodeAtEnd (&mStreamRoot, &StreamNode->Link)) {
-        break;
-      } else {
-        StreamNode = STREAM_NODE_FROM_LINK (GetNextNode (&mStreamRoot, &StreamNode->Link));
-      }
+  //
+  // Only the streams in the bucket of the handle need to be checked
+  //
+  Bucket = GetStreamHashBucket (SearchHandle);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    StreamNode = CR (Link, CORE_SECTION_STREAM_NODE, HashLink, CORE_SECTION_STREAM_SIGNATURE);
+    if (StreamNode->StreamHandle == SearchHandle) {
+      *FoundStream = StreamNode;
+      return EFI_SUCCESS;
     }
   }
 
@@ -1176,6 +1226,127 @@ FindStreamNode (
 }
 
 
+/**
+  Worker function.  Locates the requested section in a section stream.  The
+  caller must be at TPL_NOTIFY.
+
+  @param  SectionStreamHandle   The section stream in which to locate the
+                                requested section.
+  @param  SectionType           A pointer to the type of section to search for,
+                                or NULL for the whole section stream.
+  @param  SectionDefinitionGuid If the section type is EFI_SECTION_GUID_DEFINED,
+                                then SectionDefinitionGuid indicates which of
+                                these types of sections to search for.
+  @param  SectionInstance       Indicates which instance of the requested
+                                section to locate.
+  @param  SectionData           On output, points to the contents of the
+                                section in the section stream database.
+  @param  SectionSize           On output, the size of the contents of the
+                                section.
+  @param  AuthenticationStatus  On output, the authentication status of the
+                                section.
+  @param  IsFfs3Fv              Indicates the FV format.
+
+  @retval EFI_SUCCESS           Section was located successfully.
+  @retval EFI_PROTOCOL_ERROR    A GUID defined section requiring a missing
+                                GUIDed Section Extraction Protocol was
+                                encountered.
+  @retval EFI_NOT_FOUND         The requested section does not exist.
+  @retval EFI_OUT_OF_RESOURCES  The system has insufficient resources to process
+                                the request.
+  @retval EFI_INVALID_PARAMETER The SectionStreamHandle does not exist.
+
+**/
+STATIC
+EFI_STATUS
+LocateSection (
+  IN  UINTN                                             SectionStreamHandle,
+  IN  EFI_SECTION_TYPE                                  *SectionType,
+  IN  EFI_GUID                                          *SectionDefinitionGuid,
+  IN  UINTN                                             SectionInstance,
+  OUT UINT8                                             **SectionData,
+  OUT UINTN                                             *SectionSize,
+  OUT UINT32                                            *AuthenticationStatus,
+  IN  BOOLEAN                                           IsFfs3Fv
+  )
+{
+  CORE_SECTION_STREAM_NODE                              *StreamNode;
+  EFI_STATUS                                            Status;
+  CORE_SECTION_CHILD_NODE                               *ChildNode;
+  CORE_SECTION_STREAM_NODE                              *ChildStreamNode;
+  UINT32                                                ExtractedAuthenticationStatus;
+  UINTN                                                 Instance;
+  EFI_COMMON_SECTION_HEADER                             *Section;
+
+  ChildStreamNode = NULL;
+  Instance = SectionInstance + 1;
+
+  //
+  // Locate target stream
+  //
+  Status = FindStreamNode (SectionStreamHandle, &StreamNode);
+  if (EFI_ERROR (Status)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Found the stream, now locate and return the appropriate section
+  //
+  if (SectionType == NULL) {
+    //
+    // SectionType == NULL means return the WHOLE section stream...
+    //
+    *SectionSize = StreamNode->StreamLength;
+    *SectionData = StreamNode->StreamBuffer;
+    *AuthenticationStatus = StreamNode->AuthenticationStatus;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // There's a requested section type, so go find it and return it...
+  //
+  Status = FindChildNode (
+             StreamNode,
+             *SectionType,
+             &Instance,
+             SectionDefinitionGuid,
+             0,                             // encapsulation depth
+             &ChildNode,
+             &ChildStreamNode,
+             &ExtractedAuthenticationStatus
+             );
+  if (EFI_ERROR (Status)) {
+    if (Status == EFI_ABORTED) {
+      DEBUG ((DEBUG_ERROR, "%a: recursion aborted due to nesting depth\n",
+        __FUNCTION__));
+      //
+      // Map "aborted" to "not found".
+      //
+      Status = EFI_NOT_FOUND;
+    }
+    return Status;
+  }
+
+  Section = (EFI_COMMON_SECTION_HEADER *) (ChildStreamNode->StreamBuffer + ChildNode->OffsetInStream);
+
+  if (IS_SECTION2 (Section)) {
+    ASSERT (SECTION2_SIZE (Section) > 0x00FFFFFF);
+    if (!IsFfs3Fv) {
+      DEBUG ((DEBUG_ERROR, "It is a FFS3 formatted section in a non-FFS3 formatted FV.\n"));
+      return EFI_NOT_FOUND;
+    }
+    *SectionSize = SECTION2_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER2);
+    *SectionData = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER2);
+  } else {
+    *SectionSize = SECTION_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER);
+    *SectionData = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER);
+  }
+  *AuthenticationStatus = ExtractedAuthenticationStatus;
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   SEP member function.  Retrieves requested section from section stream.
 
@@ -1247,86 +1418,28 @@ GetSection (
   IN BOOLEAN                                            IsFfs3Fv
   )
 {
-  CORE_SECTION_STREAM_NODE                              *StreamNode;
   EFI_TPL                                               OldTpl;
   EFI_STATUS                                            Status;
-  CORE_SECTION_CHILD_NODE                               *ChildNode;
-  CORE_SECTION_STREAM_NODE                              *ChildStreamNode;
   UINTN                                                 CopySize;
-  UINT32                                                ExtractedAuthenticationStatus;
-  UINTN                                                 Instance;
   UINT8                                                 *CopyBuffer;
   UINTN                                                 SectionSize;
-  EFI_COMMON_SECTION_HEADER                             *Section;
-
 
-  ChildStreamNode = NULL;
   OldTpl = CoreRaiseTpl (TPL_NOTIFY);
-  Instance = SectionInstance + 1;
 
-  //
-  // Locate target stream
-  //
-  Status = FindStreamNode (SectionStreamHandle, &StreamNode);
+  Status = LocateSection (
+             SectionStreamHandle,
+             SectionType,
+             SectionDefinitionGuid,
+             SectionInstance,
+             &CopyBuffer,
+             &CopySize,
+             AuthenticationStatus,
+             IsFfs3Fv
+             );
   if (EFI_ERROR (Status)) {
-    Status = EFI_INVALID_PARAMETER;
     goto GetSection_Done;
   }
 
-  //
-  // Found the stream, now locate and return the appropriate section
-  //
-  if (SectionType == NULL) {
-    //
-    // SectionType == NULL means return the WHOLE section stream...
-    //
-    CopySize = StreamNode->StreamLength;
-    CopyBuffer = StreamNode->StreamBuffer;
-    *AuthenticationStatus = StreamNode->AuthenticationStatus;
-  } else {
-    //
-    // There's a requested section type, so go find it and return it...
-    //
-    Status = FindChildNode (
-               StreamNode,
-               *SectionType,
-               &Instance,
-               SectionDefinitionGuid,
-               0,                             // encapsulation depth
-               &ChildNode,
-               &ChildStreamNode,
-               &ExtractedAuthenticationStatus
-               );
-    if (EFI_ERROR (Status)) {
-      if (Status == EFI_ABORTED) {
-        DEBUG ((DEBUG_ERROR, "%a: recursion aborted due to nesting depth\n",
-          __FUNCTION__));
-        //
-        // Map "aborted" to "not found".
-        //
-        Status = EFI_NOT_FOUND;
-      }
-      goto GetSection_Done;
-    }
-
-    Section = (EFI_COMMON_SECTION_HEADER *) (ChildStreamNode->StreamBuffer + ChildNode->OffsetInStream);
-
-    if (IS_SECTION2 (Section)) {
-      ASSERT (SECTION2_SIZE (Section) > 0x00FFFFFF);
-      if (!IsFfs3Fv) {
-        DEBUG ((DEBUG_ERROR, "It is a FFS3 formatted section in a non-FFS3 formatted FV.\n"));
-        Status = EFI_NOT_FOUND;
-        goto GetSection_Done;
-      }
-      CopySize = SECTION2_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER2);
-      CopyBuffer = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER2);
-    } else {
-      CopySize = SECTION_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER);
-      CopyBuffer = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER);
-    }
-    *AuthenticationStatus = ExtractedAuthenticationStatus;
-  }
-
   SectionSize = CopySize;
   if (*Buffer != NULL) {
     //
@@ -1356,6 +1469,72 @@ GetSection_Done:
 }
 
 
+/**
+  Retrieves requested section from section stream without copying it.  The
+  section contents stay in the section stream database, so repeated reads of
+  an encapsulated section never extract it again, and the returned buffer
+  remains valid until the section stream is closed.  It must not be modified
+  or freed by the caller.
+
+  @param  SectionStreamHandle   The section stream from which to retrieve the
+                                requested section.
+  @param  SectionType           A pointer to the type of section to search for,
+                                or NULL for the whole section stream.
+  @param  SectionDefinitionGuid If the section type is EFI_SECTION_GUID_DEFINED,
+                                then SectionDefinitionGuid indicates which of
+                                these types of sections to search for.
+  @param  SectionInstance       Indicates which instance of the requested
+                                section to return.
+  @param  Buffer                On output, points to the section contents.
+  @param  BufferSize            On output, the size of the section contents.
+  @param  AuthenticationStatus  On output, the authentication status of the
+                                section, as returned by GetSection().
+  @param  IsFfs3Fv              Indicates the FV format.
+
+  @retval EFI_SUCCESS           Section was retrieved successfully
+  @retval EFI_PROTOCOL_ERROR    A GUID defined section was encountered in the
+                                section stream with its
+                                EFI_GUIDED_SECTION_PROCESSING_REQUIRED bit set,
+                                but there was no corresponding GUIDed Section
+                                Extraction Protocol in the handle database.
+  @retval EFI_NOT_FOUND         The requested section does not exist.
+  @retval EFI_OUT_OF_RESOURCES  The system has insufficient resources to process
+                                the request.
+  @retval EFI_INVALID_PARAMETER The SectionStreamHandle does not exist.
+
+**/
+EFI_STATUS
+GetSectionInPlace (
+  IN  UINTN                                             SectionStreamHandle,
+  IN  EFI_SECTION_TYPE                                  *SectionType,
+  IN  EFI_GUID                                          *SectionDefinitionGuid,
+  IN  UINTN                                             SectionInstance,
+  OUT VOID                                              **Buffer,
+  OUT UINTN                                             *BufferSize,
+  OUT UINT32                                            *AuthenticationStatus,
+  IN  BOOLEAN                                           IsFfs3Fv
+  )
+{
+  EFI_TPL                                               OldTpl;
+  EFI_STATUS                                            Status;
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  Status = LocateSection (
+             SectionStreamHandle,
+             SectionType,
+             SectionDefinitionGuid,
+             SectionInstance,
+             (UINT8 **) Buffer,
+             BufferSize,
+             AuthenticationStatus,
+             IsFfs3Fv
+             );
+  CoreRestoreTpl (OldTpl);
+
+  return Status;
+}
+
+
 /**
   Worker function.  Destructor for child nodes.
 
@@ -1429,6 +1608,7 @@ CloseSectionStream (
     // Found the stream, so close it
     //
     RemoveEntryList (&StreamNode->Link);
+    RemoveEntryList (&StreamNode->HashLink);
     while (!IsListEmpty (&StreamNode->Children)) {
       Link = GetFirstNode (&StreamNode->Children);
       ChildNode = CHILD_SECTION_NODE_FROM_LINK (Link);
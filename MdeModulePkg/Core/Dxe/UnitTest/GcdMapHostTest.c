@@ -0,0 +1,628 @@
+/** @file
+  Host based unit test and benchmark of the GCD memory space map of the DXE
+  Core.
+
+  The test replays an attribute change trace against the GCD memory services,
+  in the way the PCI bus driver, the image loader with memory protection and
+  the heap guard drive them during boot. The resulting map is checked against
+  a page granular shadow copy of the attributes, and the time spent in the GCD
+  services is reported.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include "DxeMain.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "DXE Core GCD Map Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Layout of the address space built by the trace
+//
+#define TRACE_MEMORY_SPACE_SIZE   48
+#define TRACE_MEMORY_BASE         SIZE_1MB
+#define TRACE_MEMORY_SIZE         SIZE_1GB
+#define TRACE_MEMORY_PAGES        EFI_SIZE_TO_PAGES (TRACE_MEMORY_SIZE)
+#define TRACE_MMIO_BASE           0xC0000000
+#define TRACE_MMIO_SIZE           SIZE_256MB
+#define TRACE_BAR_COUNT           1024
+#define TRACE_BAR_STRIDE          SIZE_64KB
+#define TRACE_BAR_SIZE            SIZE_16KB
+#define TRACE_IMAGE_COUNT         2048
+#define TRACE_IMAGE_SLOT_SIZE     (TRACE_MEMORY_SIZE / TRACE_IMAGE_COUNT)
+#define TRACE_GUARD_PAGE_COUNT    4096
+
+#define TRACE_MEMORY_CAPABILITIES  (EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB | \
+                                    EFI_MEMORY_RP | EFI_MEMORY_XP | EFI_MEMORY_RO)
+
+typedef enum {
+  GcdTraceAddMemorySpace,
+  GcdTraceAllocateMemorySpace,
+  GcdTraceFreeMemorySpace,
+  GcdTraceSetMemorySpaceAttributes
+} GCD_TRACE_OPERATION;
+
+///
+/// One GCD service call of the trace.
+///
+typedef struct {
+  GCD_TRACE_OPERATION   Operation;
+  EFI_GCD_MEMORY_TYPE   GcdMemoryType;
+  EFI_PHYSICAL_ADDRESS  BaseAddress;
+  UINT64                Length;
+  ///
+  /// Capabilities for GcdTraceAddMemorySpace, attributes for
+  /// GcdTraceSetMemorySpaceAttributes.
+  ///
+  UINT64                Value;
+} GCD_TRACE_RECORD;
+
+typedef struct {
+  GCD_TRACE_RECORD  *Records;
+  UINTN             Count;
+  UINTN             MaxCount;
+} GCD_TRACE;
+
+//
+// GCD map of the code under test
+//
+extern LIST_ENTRY         mGcdMemorySpaceMap;
+extern ADDRESS_INDEX      mGcdMemorySpaceMapIndex;
+extern EFI_GCD_MAP_ENTRY  mGcdMemorySpaceMapEntryTemplate;
+
+//
+// DXE Core services and globals used by the code under test
+//
+EFI_HANDLE                                  gDxeCoreImageHandle = (EFI_HANDLE) (UINTN) 0x1000;
+EFI_CPU_ARCH_PROTOCOL                       *gCpu;
+VOID                                        *gHobList;
+EFI_MEMORY_TYPE_INFORMATION                 gMemoryTypeInformation[EfiMaxMemoryType + 1];
+EFI_LOAD_FIXED_ADDRESS_CONFIGURATION_TABLE  gLoadModuleAtFixAddressConfigurationTable;
+BOOLEAN                                     mOnGuarding;
+
+/**
+  Stub of the CPU Arch Protocol service that programs the page tables.
+
+  @param  This                   The CPU Arch Protocol.
+  @param  BaseAddress            The start of the range.
+  @param  Length                 The length of the range.
+  @param  Attributes             The attributes of the range.
+
+  @retval EFI_SUCCESS            Always.
+
+**/
+EFI_STATUS
+EFIAPI
+StubSetMemoryAttributes (
+  IN EFI_CPU_ARCH_PROTOCOL  *This,
+  IN EFI_PHYSICAL_ADDRESS   BaseAddress,
+  IN UINT64                 Length,
+  IN UINT64                 Attributes
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_CPU_ARCH_PROTOCOL  mStubCpu = {
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  StubSetMemoryAttributes,
+  0,
+  0
+};
+
+VOID
+CoreAcquireLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockReleased);
+  Lock->Lock = EfiLockAcquired;
+}
+
+VOID
+CoreReleaseLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockAcquired);
+  Lock->Lock = EfiLockReleased;
+}
+
+EFI_STATUS
+EFIAPI
+CoreFreePool (
+  IN VOID  *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+VOID
+CoreInitializePool (
+  VOID
+  )
+{
+}
+
+VOID
+CoreAddMemoryDescriptor (
+  IN EFI_MEMORY_TYPE       Type,
+  IN EFI_PHYSICAL_ADDRESS  Start,
+  IN UINT64                NumberOfPages,
+  IN UINT64                Attribute
+  )
+{
+}
+
+VOID
+CoreUpdateMemoryAttributes (
+  IN EFI_PHYSICAL_ADDRESS  Start,
+  IN UINT64                NumberOfPages,
+  IN UINT64                NewAttributes
+  )
+{
+}
+
+VOID *
+EFIAPI
+GetFirstHob (
+  IN UINT16  Type
+  )
+{
+  return NULL;
+}
+
+VOID *
+EFIAPI
+GetNextHob (
+  IN UINT16      Type,
+  IN CONST VOID  *HobStart
+  )
+{
+  return NULL;
+}
+
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  return NULL;
+}
+
+/**
+  Frees the GCD memory space map, and creates a new one with a single
+  non-existent entry, as CoreInitializeGcdServices() does.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The map was created.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetGcdMemorySpaceMap (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  LIST_ENTRY         *Link;
+  EFI_GCD_MAP_ENTRY  *Entry;
+
+  while (!IsListEmpty (&mGcdMemorySpaceMap)) {
+    Link = GetFirstNode (&mGcdMemorySpaceMap);
+    RemoveEntryList (Link);
+    FreePool (CR (Link, EFI_GCD_MAP_ENTRY, Link, EFI_GCD_MAP_SIGNATURE));
+  }
+  ZeroMem (&mGcdMemorySpaceMapIndex, sizeof (mGcdMemorySpaceMapIndex));
+
+  Entry = AllocateCopyPool (sizeof (EFI_GCD_MAP_ENTRY), &mGcdMemorySpaceMapEntryTemplate);
+  UT_ASSERT_NOT_NULL (Entry);
+  Entry->EndAddress = LShiftU64 (1, TRACE_MEMORY_SPACE_SIZE) - 1;
+  InsertHeadList (&mGcdMemorySpaceMap, &Entry->Link);
+  CoreAddressIndexInsert (&mGcdMemorySpaceMapIndex, &Entry->IndexNode, Entry->BaseAddress, 1);
+
+  gCpu = &mStubCpu;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Appends a record to a trace.
+
+  @param  Trace                  The trace.
+  @param  Operation              The GCD service called.
+  @param  GcdMemoryType          The memory type passed to the service.
+  @param  BaseAddress            The start of the range passed to the service.
+  @param  Length                 The length of the range passed to the service.
+  @param  Value                  The capabilities or attributes passed to the service.
+
+**/
+VOID
+AppendTraceRecord (
+  IN OUT GCD_TRACE             *Trace,
+  IN     GCD_TRACE_OPERATION   Operation,
+  IN     EFI_GCD_MEMORY_TYPE   GcdMemoryType,
+  IN     EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN     UINT64                Length,
+  IN     UINT64                Value
+  )
+{
+  GCD_TRACE_RECORD  *Record;
+
+  ASSERT (Trace->Count < Trace->MaxCount);
+  Record                = &Trace->Records[Trace->Count++];
+  Record->Operation     = Operation;
+  Record->GcdMemoryType = GcdMemoryType;
+  Record->BaseAddress   = BaseAddress;
+  Record->Length        = Length;
+  Record->Value         = Value;
+}
+
+/**
+  Builds the trace replayed by the test.
+
+  The PCI bus driver adds an MMIO window and allocates a BAR for each device,
+  the image loader protects the sections of each image and unloads a part of
+  them, and the heap guard protects single guard pages. This leaves a map
+  with thousands of descriptors, which is what the GCD services see on
+  platforms that enable memory protection.
+
+  @param  Trace                  The trace to build.
+
+**/
+VOID
+BuildTrace (
+  OUT GCD_TRACE  *Trace
+  )
+{
+  UINTN                 Index;
+  EFI_PHYSICAL_ADDRESS  ImageBase;
+  UINT64                ImagePages;
+  UINT64                CodePages;
+
+  Trace->Count    = 0;
+  Trace->MaxCount = 2 + TRACE_BAR_COUNT * 2 + 1 + TRACE_IMAGE_COUNT * 4 + TRACE_GUARD_PAGE_COUNT * 2;
+  Trace->Records  = AllocatePool (Trace->MaxCount * sizeof (GCD_TRACE_RECORD));
+  ASSERT (Trace->Records != NULL);
+
+  AppendTraceRecord (Trace, GcdTraceAddMemorySpace, EfiGcdMemoryTypeSystemMemory, TRACE_MEMORY_BASE, TRACE_MEMORY_SIZE, TRACE_MEMORY_CAPABILITIES);
+  AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, TRACE_MEMORY_BASE, TRACE_MEMORY_SIZE, EFI_MEMORY_WB);
+
+  AppendTraceRecord (Trace, GcdTraceAddMemorySpace, EfiGcdMemoryTypeMemoryMappedIo, TRACE_MMIO_BASE, TRACE_MMIO_SIZE, EFI_MEMORY_UC);
+  for (Index = 0; Index < TRACE_BAR_COUNT; Index++) {
+    AppendTraceRecord (Trace, GcdTraceAllocateMemorySpace, EfiGcdMemoryTypeMemoryMappedIo, TRACE_MMIO_BASE + Index * TRACE_BAR_STRIDE, TRACE_BAR_SIZE, 0);
+    AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeMemoryMappedIo, TRACE_MMIO_BASE + Index * TRACE_BAR_STRIDE, TRACE_BAR_SIZE, EFI_MEMORY_UC | EFI_MEMORY_RUNTIME);
+  }
+
+  //
+  // Images of 4 to 63 pages, at scattered pages of their slots, with code
+  // sections of different sizes. One image in four is unloaded.
+  //
+  for (Index = 0; Index < TRACE_IMAGE_COUNT; Index++) {
+    ImagePages = 4 + (Index * 7) % 60;
+    CodePages  = 1 + (Index * 11) % (ImagePages - 2);
+    ImageBase  = TRACE_MEMORY_BASE + Index * TRACE_IMAGE_SLOT_SIZE +
+                 EFI_PAGES_TO_SIZE ((Index * 97) % (EFI_SIZE_TO_PAGES (TRACE_IMAGE_SLOT_SIZE) - ImagePages));
+
+    AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, ImageBase, EFI_PAGE_SIZE, EFI_MEMORY_WB | EFI_MEMORY_XP);
+    AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, ImageBase + EFI_PAGE_SIZE, EFI_PAGES_TO_SIZE (CodePages), EFI_MEMORY_WB | EFI_MEMORY_RO);
+    AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, ImageBase + EFI_PAGES_TO_SIZE (1 + CodePages), EFI_PAGES_TO_SIZE (ImagePages - 1 - CodePages), EFI_MEMORY_WB | EFI_MEMORY_XP);
+    if (Index % 4 == 1) {
+      AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, ImageBase, EFI_PAGES_TO_SIZE (ImagePages), EFI_MEMORY_WB);
+    }
+  }
+
+  //
+  // Guard pages scattered over the memory with an odd stride, half of which
+  // are freed again.
+  //
+  for (Index = 0; Index < TRACE_GUARD_PAGE_COUNT; Index++) {
+    ImageBase = TRACE_MEMORY_BASE + EFI_PAGES_TO_SIZE ((Index * 65521) % TRACE_MEMORY_PAGES);
+    AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, ImageBase, EFI_PAGE_SIZE, EFI_MEMORY_WB | EFI_MEMORY_RP);
+    if (Index % 2 == 0) {
+      AppendTraceRecord (Trace, GcdTraceSetMemorySpaceAttributes, EfiGcdMemoryTypeSystemMemory, ImageBase, EFI_PAGE_SIZE, EFI_MEMORY_WB);
+    }
+  }
+
+  for (Index = 0; Index < TRACE_BAR_COUNT; Index += 2) {
+    AppendTraceRecord (Trace, GcdTraceFreeMemorySpace, EfiGcdMemoryTypeMemoryMappedIo, TRACE_MMIO_BASE + Index * TRACE_BAR_STRIDE, TRACE_BAR_SIZE, 0);
+  }
+}
+
+/**
+  Replays a trace against the GCD memory services.
+
+  @param  Trace                  The trace to replay.
+  @param  Shadow                 The attributes of each page of the system
+                                 memory, updated as the trace is replayed.
+
+  @retval EFI_SUCCESS            The trace was replayed.
+  @retval Others                 A GCD service failed.
+
+**/
+EFI_STATUS
+ReplayTrace (
+  IN     GCD_TRACE  *Trace,
+  IN OUT UINT64     *Shadow
+  )
+{
+  EFI_STATUS            Status;
+  GCD_TRACE_RECORD      *Record;
+  EFI_PHYSICAL_ADDRESS  BaseAddress;
+  UINTN                 Index;
+  UINTN                 Page;
+
+  for (Index = 0; Index < Trace->Count; Index++) {
+    Record = &Trace->Records[Index];
+    switch (Record->Operation) {
+    case GcdTraceAddMemorySpace:
+      Status = CoreAddMemorySpace (Record->GcdMemoryType, Record->BaseAddress, Record->Length, Record->Value);
+      break;
+    case GcdTraceAllocateMemorySpace:
+      BaseAddress = Record->BaseAddress;
+      Status = CoreAllocateMemorySpace (
+                 EfiGcdAllocateAddress,
+                 Record->GcdMemoryType,
+                 EFI_PAGE_SHIFT,
+                 Record->Length,
+                 &BaseAddress,
+                 gDxeCoreImageHandle,
+                 NULL
+                 );
+      break;
+    case GcdTraceFreeMemorySpace:
+      Status = CoreFreeMemorySpace (Record->BaseAddress, Record->Length);
+      break;
+    case GcdTraceSetMemorySpaceAttributes:
+      Status = CoreSetMemorySpaceAttributes (Record->BaseAddress, Record->Length, Record->Value);
+      if (!EFI_ERROR (Status) && Record->GcdMemoryType == EfiGcdMemoryTypeSystemMemory) {
+        for (Page = 0; Page < EFI_SIZE_TO_PAGES (Record->Length); Page++) {
+          Shadow[EFI_SIZE_TO_PAGES (Record->BaseAddress - TRACE_MEMORY_BASE) + Page] = Record->Value;
+        }
+      }
+      break;
+    default:
+      Status = EFI_UNSUPPORTED;
+      break;
+    }
+
+    if (EFI_ERROR (Status)) {
+      UT_LOG_ERROR ("Record %d failed with %r\n", Index, Status);
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Replays the trace, checks the resulting map against the shadow attributes,
+  and reports the time spent in the GCD services.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The map matches the trace.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The map does not match the trace.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReplayAttributeTrace (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                       Status;
+  GCD_TRACE                        Trace;
+  UINT64                           *Shadow;
+  clock_t                          Start;
+  clock_t                          End;
+  UINTN                            NumberOfDescriptors;
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR  *MemorySpaceMap;
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR  Descriptor;
+  EFI_PHYSICAL_ADDRESS             Address;
+  UINTN                            Index;
+  UINTN                            Page;
+
+  BuildTrace (&Trace);
+  Shadow = AllocateZeroPool (TRACE_MEMORY_PAGES * sizeof (UINT64));
+  UT_ASSERT_NOT_NULL (Shadow);
+
+  Start  = clock ();
+  Status = ReplayTrace (&Trace, Shadow);
+  End    = clock ();
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Status = CoreGetMemorySpaceMap (&NumberOfDescriptors, &MemorySpaceMap);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NumberOfDescriptors, mGcdMemorySpaceMapIndex.Count);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "GCD trace: %d records, %d descriptors, %d ms\n",
+    (UINT32) Trace.Count,
+    (UINT32) NumberOfDescriptors,
+    (UINT32) ((End - Start) * 1000 / CLOCKS_PER_SEC)
+    ));
+
+  //
+  // The map must cover the memory space without holes, and adjacent
+  // descriptors must not be mergeable.
+  //
+  UT_ASSERT_EQUAL (MemorySpaceMap[0].BaseAddress, 0);
+  for (Index = 1; Index < NumberOfDescriptors; Index++) {
+    UT_ASSERT_EQUAL (MemorySpaceMap[Index].BaseAddress, MemorySpaceMap[Index - 1].BaseAddress + MemorySpaceMap[Index - 1].Length);
+    UT_ASSERT_FALSE (
+      MemorySpaceMap[Index].GcdMemoryType == MemorySpaceMap[Index - 1].GcdMemoryType &&
+      MemorySpaceMap[Index].Capabilities  == MemorySpaceMap[Index - 1].Capabilities  &&
+      MemorySpaceMap[Index].Attributes    == MemorySpaceMap[Index - 1].Attributes    &&
+      MemorySpaceMap[Index].ImageHandle   == MemorySpaceMap[Index - 1].ImageHandle   &&
+      MemorySpaceMap[Index].DeviceHandle  == MemorySpaceMap[Index - 1].DeviceHandle
+      );
+  }
+  UT_ASSERT_EQUAL (
+    MemorySpaceMap[NumberOfDescriptors - 1].BaseAddress + MemorySpaceMap[NumberOfDescriptors - 1].Length,
+    LShiftU64 (1, TRACE_MEMORY_SPACE_SIZE)
+    );
+
+  //
+  // Every page of the system memory must have the attributes last set by the trace.
+  //
+  Page = 0;
+  for (Index = 0; Index < NumberOfDescriptors && Page < TRACE_MEMORY_PAGES; Index++) {
+    while (Page < TRACE_MEMORY_PAGES &&
+           TRACE_MEMORY_BASE + EFI_PAGES_TO_SIZE (Page) < MemorySpaceMap[Index].BaseAddress + MemorySpaceMap[Index].Length) {
+      UT_ASSERT_EQUAL (MemorySpaceMap[Index].GcdMemoryType, EfiGcdMemoryTypeSystemMemory);
+      UT_ASSERT_EQUAL (MemorySpaceMap[Index].Attributes, Shadow[Page]);
+      Page++;
+    }
+  }
+  UT_ASSERT_EQUAL (Page, TRACE_MEMORY_PAGES);
+
+  //
+  // The BARs left allocated must be found by any address in them.
+  //
+  for (Index = 0; Index < TRACE_BAR_COUNT; Index++) {
+    Address = TRACE_MMIO_BASE + Index * TRACE_BAR_STRIDE + ((Index * 4099) % TRACE_BAR_SIZE);
+    Status  = CoreGetMemorySpaceDescriptor (Address, &Descriptor);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Descriptor.GcdMemoryType, EfiGcdMemoryTypeMemoryMappedIo);
+    UT_ASSERT_EQUAL (Descriptor.Attributes, EFI_MEMORY_UC | EFI_MEMORY_RUNTIME);
+    UT_ASSERT_TRUE (Descriptor.ImageHandle == ((Index % 2 == 0) ? NULL : gDxeCoreImageHandle));
+    UT_ASSERT_TRUE (Descriptor.BaseAddress <= Address && Address < Descriptor.BaseAddress + Descriptor.Length);
+  }
+
+  FreePool (MemorySpaceMap);
+  FreePool (Shadow);
+  FreePool (Trace.Records);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates BARs from an MMIO window with each search direction, and checks
+  that free ranges are found in address order.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The allocations returned the expected ranges.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An allocation returned an unexpected range.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocateFromMmioWindow (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  BaseAddress;
+  UINTN                 Index;
+
+  Status = CoreAddMemorySpace (EfiGcdMemoryTypeMemoryMappedIo, TRACE_MMIO_BASE, SIZE_16MB, EFI_MEMORY_UC);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  for (Index = 0; Index < 64; Index++) {
+    Status = CoreAllocateMemorySpace (EfiGcdAllocateAnySearchBottomUp, EfiGcdMemoryTypeMemoryMappedIo, 16, SIZE_64KB, &BaseAddress, gDxeCoreImageHandle, NULL);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (BaseAddress, TRACE_MMIO_BASE + Index * SIZE_64KB);
+  }
+
+  for (Index = 0; Index < 64; Index++) {
+    Status = CoreAllocateMemorySpace (EfiGcdAllocateAnySearchTopDown, EfiGcdMemoryTypeMemoryMappedIo, 16, SIZE_64KB, &BaseAddress, gDxeCoreImageHandle, NULL);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (BaseAddress, TRACE_MMIO_BASE + SIZE_16MB - (Index + 1) * SIZE_64KB);
+  }
+
+  for (Index = 0; Index < 64; Index += 2) {
+    Status = CoreFreeMemorySpace (TRACE_MMIO_BASE + Index * SIZE_64KB, SIZE_64KB);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  for (Index = 0; Index < 64; Index += 2) {
+    Status = CoreAllocateMemorySpace (EfiGcdAllocateAnySearchBottomUp, EfiGcdMemoryTypeMemoryMappedIo, 16, SIZE_64KB, &BaseAddress, gDxeCoreImageHandle, NULL);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (BaseAddress, TRACE_MMIO_BASE + Index * SIZE_64KB);
+  }
+
+  //
+  // Below the top down BARs, the highest free range is the one under them.
+  //
+  BaseAddress = TRACE_MMIO_BASE + SIZE_16MB - 1;
+  Status = CoreAllocateMemorySpace (EfiGcdAllocateMaxAddressSearchTopDown, EfiGcdMemoryTypeMemoryMappedIo, 16, SIZE_128KB, &BaseAddress, gDxeCoreImageHandle, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (BaseAddress, TRACE_MMIO_BASE + SIZE_16MB - 64 * SIZE_64KB - SIZE_128KB);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the GCD map
+  and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      GcdMapTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&GcdMapTests, Framework, "GCD Memory Space Map", "DxeCore.Gcd", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for GcdMapTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite--------Description-------------------------------Class Name------------Function----------------Pre----------------------Post--Context
+  AddTestCase (GcdMapTests, "Replay memory attribute change trace", "ReplayAttributeTrace", ReplayAttributeTrace, ResetGcdMemorySpaceMap, NULL, NULL);
+  AddTestCase (GcdMapTests, "Allocate from MMIO window", "AllocateFromMmioWindow", AllocateFromMmioWindow, ResetGcdMemorySpaceMap, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
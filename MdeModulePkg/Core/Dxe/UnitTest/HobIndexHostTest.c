@@ -0,0 +1,301 @@
+/** @file
+  Host based unit test of the HOB index built by the DXE Core.
+
+  The lookups in a HOB index are tested with BaseHobIndexLib. This test checks
+  what CoreBuildHobIndex() adds: that it indexes every HOB but the freed ones,
+  that the index has room for exactly these HOBs, that it keeps at least half
+  of its GUID slots empty, and that the indexed HOBs end at the end of the HOB
+  list. The HOB lists of the test are laid out in structures, so that every
+  HOB is at a known address.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "DXE Core HOB Index Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_MANY_GUID_COUNT   100
+
+#define TEST_GUID_A  { 0x2D8B1B0C, 0x54F1, 0x4C0B, { 0x9A, 0x61, 0x0B, 0x3E, 0x2A, 0x6C, 0x41, 0x10 } }
+#define TEST_GUID_B  { 0x7C3E5F92, 0x0A4D, 0x4E27, { 0xB1, 0x8F, 0x6D, 0x22, 0x90, 0x3B, 0x5E, 0xC4 } }
+
+///
+/// A HOB list with a HOB of each kind the DXE Core sees, a freed HOB, and two
+/// GUID extension HOBs of one GUID around one of another GUID.
+///
+typedef struct {
+  EFI_HOB_HANDOFF_INFO_TABLE   Handoff;
+  EFI_HOB_MEMORY_ALLOCATION    MemoryAllocation;
+  EFI_HOB_GUID_TYPE            FirstGuidAHob;
+  EFI_HOB_RESOURCE_DESCRIPTOR  ResourceDescriptor;
+  EFI_HOB_GENERIC_HEADER       Unused;
+  EFI_HOB_GUID_TYPE            GuidBHob;
+  EFI_HOB_GUID_TYPE            SecondGuidAHob;
+  EFI_HOB_FIRMWARE_VOLUME      FirmwareVolume;
+  EFI_HOB_GENERIC_HEADER       EndOfHobList;
+} TEST_HOB_LIST;
+
+///
+/// A HOB list with a GUID extension HOB of each of many GUIDs.
+///
+typedef struct {
+  EFI_HOB_HANDOFF_INFO_TABLE  Handoff;
+  EFI_HOB_GUID_TYPE           GuidHobs[TEST_MANY_GUID_COUNT];
+  EFI_HOB_GENERIC_HEADER      EndOfHobList;
+} TEST_MANY_GUIDS_HOB_LIST;
+
+STATIC EFI_GUID  mGuidA = TEST_GUID_A;
+STATIC EFI_GUID  mGuidB = TEST_GUID_B;
+
+STATIC TEST_HOB_LIST  mHobList = {
+  { { EFI_HOB_TYPE_HANDOFF, sizeof (EFI_HOB_HANDOFF_INFO_TABLE), 0 }, EFI_HOB_HANDOFF_TABLE_VERSION },
+  { { EFI_HOB_TYPE_MEMORY_ALLOCATION, sizeof (EFI_HOB_MEMORY_ALLOCATION), 0 } },
+  { { EFI_HOB_TYPE_GUID_EXTENSION, sizeof (EFI_HOB_GUID_TYPE), 0 }, TEST_GUID_A },
+  { { EFI_HOB_TYPE_RESOURCE_DESCRIPTOR, sizeof (EFI_HOB_RESOURCE_DESCRIPTOR), 0 } },
+  { EFI_HOB_TYPE_UNUSED, sizeof (EFI_HOB_GENERIC_HEADER), 0 },
+  { { EFI_HOB_TYPE_GUID_EXTENSION, sizeof (EFI_HOB_GUID_TYPE), 0 }, TEST_GUID_B },
+  { { EFI_HOB_TYPE_GUID_EXTENSION, sizeof (EFI_HOB_GUID_TYPE), 0 }, TEST_GUID_A },
+  { { EFI_HOB_TYPE_FV, sizeof (EFI_HOB_FIRMWARE_VOLUME), 0 } },
+  { EFI_HOB_TYPE_END_OF_HOB_LIST, sizeof (EFI_HOB_GENERIC_HEADER), 0 }
+};
+
+STATIC TEST_MANY_GUIDS_HOB_LIST  mManyGuidsHobList;
+
+/**
+  Looks up the next HOB of a type, or the next GUID extension HOB of a GUID,
+  in a HOB index, and checks that it is found.
+
+  @param  Index                  The HOB index.
+  @param  Type                   The HOB type.
+  @param  Guid                   The GUID when Type is
+                                 EFI_HOB_TYPE_GUID_EXTENSION, or NULL.
+  @param  HobStart               The HOB to search from.
+  @param  Expected               The HOB that must be found.
+
+  @retval UNIT_TEST_PASSED       The expected HOB is found.
+
+**/
+UNIT_TEST_STATUS
+CheckFound (
+  IN EDKII_HOB_INDEX  *Index,
+  IN UINT16           Type,
+  IN CONST EFI_GUID   *Guid,     OPTIONAL
+  IN CONST VOID       *HobStart,
+  IN CONST VOID       *Expected
+  )
+{
+  VOID     *Hob;
+  BOOLEAN  Found;
+
+  Hob = LookupHobIndex (Index, Type, Guid, HobStart, &Found);
+  UT_ASSERT_TRUE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Hob, (UINTN) Expected);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Fills the HOB list with a GUID extension HOB of each of many GUIDs.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB list is filled.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateManyGuidsHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_HOB_GUID_TYPE  *GuidHob;
+  UINTN              Index;
+
+  ZeroMem (&mManyGuidsHobList, sizeof (mManyGuidsHobList));
+  mManyGuidsHobList.Handoff.Header.HobType   = EFI_HOB_TYPE_HANDOFF;
+  mManyGuidsHobList.Handoff.Header.HobLength = sizeof (EFI_HOB_HANDOFF_INFO_TABLE);
+  mManyGuidsHobList.Handoff.Version          = EFI_HOB_HANDOFF_TABLE_VERSION;
+
+  for (Index = 0; Index < TEST_MANY_GUID_COUNT; Index++) {
+    GuidHob = &mManyGuidsHobList.GuidHobs[Index];
+    GuidHob->Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+    GuidHob->Header.HobLength = sizeof (EFI_HOB_GUID_TYPE);
+    CopyGuid (&GuidHob->Name, &mGuidA);
+    GuidHob->Name.Data1 = (UINT32) Index;
+  }
+
+  mManyGuidsHobList.EndOfHobList.HobType   = EFI_HOB_TYPE_END_OF_HOB_LIST;
+  mManyGuidsHobList.EndOfHobList.HobLength = sizeof (EFI_HOB_GENERIC_HEADER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOB index has every HOB of the HOB list but the freed one,
+  in order, that it has room for these HOBs only, and that its lookups find
+  the HOBs of each type and of each GUID.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB index is complete.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FreedHobsAreNotIndexed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_HOB_INDEX  *Index;
+  VOID             *Expected[7];
+  UINTN            Entry;
+  VOID             *Hob;
+  BOOLEAN          Found;
+
+  Expected[0] = &mHobList.Handoff;
+  Expected[1] = &mHobList.MemoryAllocation;
+  Expected[2] = &mHobList.FirstGuidAHob;
+  Expected[3] = &mHobList.ResourceDescriptor;
+  Expected[4] = &mHobList.GuidBHob;
+  Expected[5] = &mHobList.SecondGuidAHob;
+  Expected[6] = &mHobList.FirmwareVolume;
+
+  Index = CoreBuildHobIndex (&mHobList);
+  UT_ASSERT_NOT_NULL (Index);
+  UT_ASSERT_TRUE (IsHobIndexValid (Index, &mHobList));
+  UT_ASSERT_EQUAL (Index->EntryCount, ARRAY_SIZE (Expected));
+  UT_ASSERT_EQUAL (Index->EntryCapacity, Index->EntryCount);
+  UT_ASSERT_EQUAL ((UINTN) Index->IndexedEnd, (UINTN) &mHobList.EndOfHobList);
+
+  for (Entry = 0; Entry < ARRAY_SIZE (Expected); Entry++) {
+    UT_ASSERT_EQUAL ((UINTN) Index->Entries[Entry].Hob, (UINTN) Expected[Entry]);
+  }
+
+  UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_MEMORY_ALLOCATION, NULL, &mHobList, &mHobList.MemoryAllocation), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_RESOURCE_DESCRIPTOR, NULL, &mHobList, &mHobList.ResourceDescriptor), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_FV, NULL, &mHobList, &mHobList.FirmwareVolume), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_GUID_EXTENSION, &mGuidA, &mHobList, &mHobList.FirstGuidAHob), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_GUID_EXTENSION, &mGuidA, &mHobList.ResourceDescriptor, &mHobList.SecondGuidAHob), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_GUID_EXTENSION, &mGuidB, &mHobList, &mHobList.GuidBHob), UNIT_TEST_PASSED);
+
+  //
+  // The HOB list has no HOB of the GUID after its last GUID extension HOB.
+  //
+  Hob = LookupHobIndex (Index, EFI_HOB_TYPE_GUID_EXTENSION, &mGuidA, &mHobList.FirmwareVolume, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Hob, (UINTN) &mHobList.EndOfHobList);
+
+  FreePool (Index);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the GUID slots of the HOB index grow with the number of GUID
+  extension HOBs, so that at least half of them stay empty, and that every
+  GUID is found.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The GUID slots are large enough.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+GuidSlotsGrowWithGuidHobs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_HOB_INDEX    *Index;
+  EFI_HOB_GUID_TYPE  *GuidHob;
+  UINTN              Guid;
+  UINTN              Slot;
+  UINTN              ChainCount;
+
+  Index = CoreBuildHobIndex (&mManyGuidsHobList);
+  UT_ASSERT_NOT_NULL (Index);
+  UT_ASSERT_EQUAL (Index->EntryCount, TEST_MANY_GUID_COUNT + 1);
+  UT_ASSERT_EQUAL (Index->GuidSlotCount & (Index->GuidSlotCount - 1), 0);
+  UT_ASSERT_TRUE (Index->GuidSlotCount >= 2 * TEST_MANY_GUID_COUNT);
+
+  ChainCount = 0;
+  for (Slot = 0; Slot < Index->GuidSlotCount; Slot++) {
+    if (Index->GuidSlots[Slot].First != EDKII_HOB_INDEX_END) {
+      ChainCount++;
+    }
+  }
+
+  UT_ASSERT_EQUAL (ChainCount, TEST_MANY_GUID_COUNT);
+
+  for (Guid = 0; Guid < TEST_MANY_GUID_COUNT; Guid++) {
+    GuidHob = &mManyGuidsHobList.GuidHobs[Guid];
+    UT_ASSERT_EQUAL (CheckFound (Index, EFI_HOB_TYPE_GUID_EXTENSION, &GuidHob->Name, &mManyGuidsHobList, GuidHob), UNIT_TEST_PASSED);
+  }
+
+  FreePool (Index);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the HOB
+  index and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      HobIndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&HobIndexTests, Framework, "HOB Index", "DxeCore.HobIndex", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HobIndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite----------Description---------------------------------Class Name------------------Function-------------------Pre---------------------Post--Context
+  AddTestCase (HobIndexTests, "Every HOB but the freed ones is indexed", "FreedHobsAreNotIndexed", FreedHobsAreNotIndexed, NULL, NULL, NULL);
+  AddTestCase (HobIndexTests, "The GUID slots grow with the GUID HOBs", "GuidSlotsGrowWithGuidHobs", GuidSlotsGrowWithGuidHobs, CreateManyGuidsHobList, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
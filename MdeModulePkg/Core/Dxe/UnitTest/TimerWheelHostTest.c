@@ -0,0 +1,471 @@
+/** @file
+  Host based unit test and benchmark of the timer services of the DXE Core.
+
+  The test drives the timer wheel through the timer interrupt handler and the
+  check timer event, in the way the DXE Core does, and checks that every timer
+  is signalled at the first check at or after its trigger time, in trigger
+  time order. It also reports the rate at which 10000 periodic timers can be
+  re-armed, which is what network, USB and console drivers do constantly.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include "DxeMain.h"
+#include "Event/Event.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "DXE Core Timer Wheel Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_TIMER_COUNT       10000
+#define TEST_TICK_DURATION     100000      // 10 ms in 100ns units
+#define TEST_REARM_COUNT       1000000
+
+///
+/// A timer event of the test and what it has seen.
+///
+typedef struct {
+  IEVENT      Event;
+  UINT64      ArmTime;
+  UINT64      SignalCount;
+  BOOLEAN     Late;
+} TEST_TIMER;
+
+//
+// Timer services of the code under test
+//
+extern EFI_EVENT  mEfiCheckTimerEvent;
+extern UINT64     mEfiSystemTime;
+
+VOID
+EFIAPI
+CoreCheckTimers (
+  IN EFI_EVENT            CheckEvent,
+  IN VOID                 *Context
+  );
+
+//
+// DXE Core services and globals used by the code under test
+//
+EFI_TIMER_ARCH_PROTOCOL  *gTimer;
+
+IEVENT      mCheckTimerEvent;
+BOOLEAN     mCheckTimerSignalled;
+
+TEST_TIMER  *mTimers;
+IEVENT      **mSignalledEvents;
+UINTN       mSignalledEventCount;
+UINT64      mCheckTime;
+UINT64      mPreviousCheckTime;
+UINT64      mLastSignalledTriggerTime;
+BOOLEAN     mOutOfOrder;
+
+VOID
+CoreAcquireLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockReleased);
+  Lock->Lock = EfiLockAcquired;
+}
+
+VOID
+CoreReleaseLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockAcquired);
+  Lock->Lock = EfiLockReleased;
+}
+
+EFI_STATUS
+EFIAPI
+CoreCreateEventInternal (
+  IN       UINT32                   Type,
+  IN       EFI_TPL                  NotifyTpl,
+  IN       EFI_EVENT_NOTIFY         NotifyFunction,    OPTIONAL
+  IN CONST VOID                     *NotifyContext,    OPTIONAL
+  IN CONST EFI_GUID                 *EventGroup,       OPTIONAL
+  OUT      EFI_EVENT                *Event
+  )
+{
+  mCheckTimerEvent.Signature = EVENT_SIGNATURE;
+  *Event = &mCheckTimerEvent;
+  return EFI_SUCCESS;
+}
+
+/**
+  Records the signal of a timer event. The notification functions are not
+  dispatched, so a timer is signalled at most once per check, as in the DXE
+  Core where the check runs at a higher TPL than the notifications.
+
+  @param  UserEvent              The event to signal.
+
+  @retval EFI_SUCCESS            Always.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreSignalEvent (
+  IN EFI_EVENT    UserEvent
+  )
+{
+  IEVENT      *Event;
+  TEST_TIMER  *Timer;
+
+  if (UserEvent == mEfiCheckTimerEvent) {
+    mCheckTimerSignalled = TRUE;
+    return EFI_SUCCESS;
+  }
+
+  Event = UserEvent;
+  if (Event->SignalCount != 0) {
+    return EFI_SUCCESS;
+  }
+  Event->SignalCount = 1;
+  mSignalledEvents[mSignalledEventCount++] = Event;
+
+  Timer = BASE_CR (Event, TEST_TIMER, Event);
+  Timer->SignalCount++;
+
+  //
+  // The timer must be expired, and must not have been due at the previous check
+  //
+  if (Event->Timer.TriggerTime > mCheckTime ||
+      (mPreviousCheckTime != 0 && Event->Timer.TriggerTime <= mPreviousCheckTime)) {
+    Timer->Late = TRUE;
+  }
+
+  if (Event->Timer.TriggerTime < mLastSignalledTriggerTime) {
+    mOutOfOrder = TRUE;
+  }
+  mLastSignalledTriggerTime = Event->Timer.TriggerTime;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Advances the system time as the timer interrupt handler does, runs the check
+  timer event if it was signalled, and then dispatches the notifications.
+
+  @param  Duration               The time elapsed since the previous tick.
+
+**/
+VOID
+Tick (
+  IN UINT64  Duration
+  )
+{
+  UINTN  Index;
+
+  CoreTimerTick (Duration);
+
+  while (mCheckTimerSignalled) {
+    mCheckTimerSignalled      = FALSE;
+    mCheckTime                = mEfiSystemTime;
+    mLastSignalledTriggerTime = 0;
+    CoreCheckTimers (mEfiCheckTimerEvent, NULL);
+  }
+
+  //
+  // The previous check time is the last time all expired timers were signalled
+  //
+  mPreviousCheckTime = mEfiSystemTime;
+
+  for (Index = 0; Index < mSignalledEventCount; Index++) {
+    mSignalledEvents[Index]->SignalCount = 0;
+  }
+  mSignalledEventCount = 0;
+}
+
+/**
+  Allocates the timer events of the test and the check timer event.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The timers were created.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateTimers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  CoreInitializeTimer ();
+
+  mTimers = AllocateZeroPool (TEST_TIMER_COUNT * sizeof (TEST_TIMER));
+  UT_ASSERT_NOT_NULL (mTimers);
+  mSignalledEvents = AllocatePool (TEST_TIMER_COUNT * sizeof (IEVENT *));
+  UT_ASSERT_NOT_NULL (mSignalledEvents);
+  mSignalledEventCount = 0;
+
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    mTimers[Index].Event.Signature = EVENT_SIGNATURE;
+    mTimers[Index].Event.Type      = EVT_TIMER;
+  }
+
+  mPreviousCheckTime = 0;
+  mOutOfOrder        = FALSE;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Cancels and frees the timer events of the test.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeTimers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    CoreSetTimer (&mTimers[Index].Event, TimerCancel, 0);
+  }
+  FreePool (mSignalledEvents);
+  FreePool (mTimers);
+}
+
+/**
+  Runs 10000 periodic timers for a simulated minute, and checks that each one
+  is signalled once per period, on time and in trigger time order.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The timers were signalled as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A timer was signalled late or too often.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PeriodicTimers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINT64      Period;
+  UINT64      EndTime;
+
+  //
+  // Periods from 10 ms to 10 s, multiple of the tick so that no timer falls
+  // behind the system time
+  //
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    Period = TEST_TICK_DURATION * (1 + Index % 1000);
+    mTimers[Index].ArmTime = mEfiSystemTime;
+    Status = CoreSetTimer (&mTimers[Index].Event, TimerPeriodic, Period);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  EndTime = mEfiSystemTime + 60 * 10000000ULL;
+  while (mEfiSystemTime < EndTime) {
+    Tick (TEST_TICK_DURATION);
+  }
+
+  UT_ASSERT_FALSE (mOutOfOrder);
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    UT_ASSERT_FALSE (mTimers[Index].Late);
+    UT_ASSERT_EQUAL (
+      mTimers[Index].SignalCount,
+      DivU64x64Remainder (EndTime - mTimers[Index].ArmTime, mTimers[Index].Event.Timer.Period, NULL)
+      );
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Arms one shot timers from 1 ms to several days ahead, advances the system
+  time in irregular steps, and checks that each timer is signalled once at the
+  first check at or after its trigger time.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The timers were signalled as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A timer was signalled late or not at all.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RelativeTimers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINT64      Delay;
+  UINT64      MaxTriggerTime;
+  UINTN       Step;
+
+  //
+  // Delays in each power of two from 1.6 ms to 20 days, so that the timers
+  // are queued in every level of the wheel, at several offsets in the power
+  // of two, so that they are spread over the slots of the level.
+  //
+  MaxTriggerTime = 0;
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    Delay  = LShiftU64 (1, 14 + Index % 30);
+    Delay += MultU64x32 (RShiftU64 (Delay, 7), (UINT32) (Index % 128));
+    Status = CoreSetTimer (&mTimers[Index].Event, TimerRelative, Delay);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    MaxTriggerTime = MAX (MaxTriggerTime, mTimers[Index].Event.Timer.TriggerTime);
+  }
+
+  //
+  // Steps of every power of two up to 1 hour, in a scattered order, so that
+  // some checks come within a slot and others skip many slots.
+  //
+  for (Step = 0; mEfiSystemTime <= MaxTriggerTime; Step++) {
+    Tick (LShiftU64 (1, (Step * 7) % 36));
+  }
+
+  UT_ASSERT_FALSE (mOutOfOrder);
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    UT_ASSERT_FALSE (mTimers[Index].Late);
+    UT_ASSERT_EQUAL (mTimers[Index].SignalCount, 1);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Re-arms 10000 periodic timers in a scattered order while the system time
+  advances, and reports the rate of SetTimer () calls. Then cancels them, and
+  checks that no timer is signalled anymore.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The cancelled timers were not signalled.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A cancelled timer was signalled.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RearmThroughput (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINTN       Count;
+  clock_t     Start;
+  clock_t     End;
+
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    Status = CoreSetTimer (&mTimers[Index].Event, TimerPeriodic, TEST_TICK_DURATION * (1 + Index % 100));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  //
+  // Re-arm the timers in a scattered order, with a prime stride, as drivers
+  // re-arm their timers independently of each other.
+  //
+  Start = clock ();
+  for (Count = 0; Count < TEST_REARM_COUNT; Count++) {
+    Index  = (Count * 7919) % TEST_TIMER_COUNT;
+    Status = CoreSetTimer (&mTimers[Index].Event, TimerPeriodic, TEST_TICK_DURATION * (1 + Count % 100));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    if (Count % 1000 == 0) {
+      Tick (TEST_TICK_DURATION);
+    }
+  }
+  End = clock ();
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Timer wheel: %d timers, %d re-arms, %d ms\n",
+    TEST_TIMER_COUNT,
+    TEST_REARM_COUNT,
+    (UINT32) ((End - Start) * 1000 / CLOCKS_PER_SEC)
+    ));
+
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    Status = CoreSetTimer (&mTimers[Index].Event, TimerCancel, 0);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    mTimers[Index].SignalCount = 0;
+  }
+
+  for (Count = 0; Count < 1000; Count++) {
+    Tick (TEST_TICK_DURATION);
+  }
+
+  for (Index = 0; Index < TEST_TIMER_COUNT; Index++) {
+    UT_ASSERT_EQUAL (mTimers[Index].SignalCount, 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the timer
+  services and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TimerTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TimerTests, Framework, "Timer Services", "DxeCore.Timer", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TimerTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description------------------------Class Name---------Function---------Pre-----------Post--------Context
+  AddTestCase (TimerTests, "Periodic timers are on time", "PeriodicTimers", PeriodicTimers, CreateTimers, FreeTimers, NULL);
+  AddTestCase (TimerTests, "Relative timers are on time", "RelativeTimers", RelativeTimers, CreateTimers, FreeTimers, NULL);
+  AddTestCase (TimerTests, "Re-arm periodic timers", "RearmThroughput", RearmThroughput, CreateTimers, FreeTimers, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
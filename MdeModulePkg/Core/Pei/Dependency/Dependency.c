@@ -5,7 +5,7 @@
   if a driver can be scheduled for execution.  The criteria to be scheduled is
   that the dependency expression is satisfied.
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -245,3 +245,57 @@ PeimDispatchReadiness (
     }
   }
 }
+
+/**
+  Returns the hash buckets of the PPI GUIDs that a dependency expression
+  refers to. The result of the dependency expression can only change when a
+  PPI whose GUID hashes to one of these buckets is installed or reinstalled.
+
+  @param DependencyExpression   Pointer to a dependency expression.
+
+  @return A mask with bit N set for hash bucket N. All the bits are set if the
+          dependency expression is not a well-formed Grammar.
+
+**/
+UINT32
+GetDepexPpiBucketMask (
+  IN VOID               *DependencyExpression
+  )
+{
+  DEPENDENCY_EXPRESSION_OPERAND  *Iterator;
+  UINTN                          Opcodes;
+  UINT32                         BucketMask;
+  EFI_GUID                       PpiGuid;
+
+  Iterator   = DependencyExpression;
+  BucketMask = 0;
+
+  //
+  // Only the PPI GUIDs are collected. A malformed or unexpectedly long
+  // grammar is given all the buckets to stay on the safe side.
+  //
+  for (Opcodes = 0; Opcodes < 2 * MAX_GRAMMAR_SIZE; Opcodes++) {
+    switch (*(Iterator++)) {
+      case (EFI_DEP_PUSH):
+        CopyMem (&PpiGuid, Iterator, sizeof (EFI_GUID));
+        BucketMask |= (UINT32) 1 << PpiGuidHash (&PpiGuid);
+        Iterator = Iterator + sizeof (EFI_GUID);
+        break;
+
+      case (EFI_DEP_TRUE):
+      case (EFI_DEP_FALSE):
+      case (EFI_DEP_AND):
+      case (EFI_DEP_OR):
+      case (EFI_DEP_NOT):
+        break;
+
+      case (EFI_DEP_END):
+        return BucketMask;
+
+      default:
+        return MAX_UINT32;
+    }
+  }
+
+  return MAX_UINT32;
+}
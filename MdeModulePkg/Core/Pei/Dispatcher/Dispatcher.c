@@ -1,7 +1,7 @@
 /** @file
   EFI PEI Core dispatch services
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2016 Hewlett Packard Enterprise Development LP<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -113,13 +113,15 @@ DiscoverPeimsAndOrderWithApriori (
   }
 
   //
-  // Record PeimCount, allocate buffer for PeimState and FvFileHandles.
+  // Record PeimCount, allocate buffer for PeimState, FvFileHandles and DepexWait.
   //
   CoreFileHandle->PeimCount = PeimCount;
   CoreFileHandle->PeimState = AllocateZeroPool (sizeof (UINT8) * PeimCount);
   ASSERT (CoreFileHandle->PeimState != NULL);
   CoreFileHandle->FvFileHandles = AllocateZeroPool (sizeof (EFI_PEI_FILE_HANDLE) * PeimCount);
   ASSERT (CoreFileHandle->FvFileHandles != NULL);
+  CoreFileHandle->DepexWait = AllocateZeroPool (sizeof (PEI_CORE_DEPEX_WAIT) * PeimCount);
+  ASSERT (CoreFileHandle->DepexWait != NULL);
 
   //
   // Get Apriori File handle
@@ -712,6 +714,9 @@ PeiCheckAndSwitchStack (
       DEBUG ((DEBUG_INFO, "  temporary memory heap occupied by memory pages: %d bytes.\n",
              (UINT32)(UINTN)(Private->HobList.HandoffInformationTable->EfiMemoryTop - Private->HobList.HandoffInformationTable->EfiFreeMemoryTop)
             ));
+      DEBUG ((DEBUG_INFO, "  temporary memory used for PPI GUID index: %d bytes.\n",
+             (UINT32)GetPpiHashIndexSize (Private)
+            ));
       for (Hob.Raw = Private->HobList.Raw; !END_OF_HOB_LIST(Hob); Hob.Raw = GET_NEXT_HOB(Hob)) {
         if (GET_HOB_TYPE (Hob) == EFI_HOB_TYPE_MEMORY_ALLOCATION) {
           DEBUG ((DEBUG_INFO, "Memory Allocation 0x%08x 0x%0lx - 0x%0lx\n", \
@@ -1525,7 +1530,7 @@ PeiDispatcher (
         PeimFileHandle = Private->CurrentFileHandle = Private->CurrentFvFileHandles[PeimCount];
 
         if (Private->Fv[FvCount].PeimState[PeimCount] == PEIM_STATE_NOT_DISPATCHED) {
-          if (!DepexSatisfied (Private, PeimFileHandle, PeimCount)) {
+          if (!DepexSatisfied (Private, PeimFileHandle, PeimCount, &Private->Fv[FvCount].DepexWait[PeimCount])) {
             Private->PeimNeedingDispatch = TRUE;
           } else {
             Status = CoreFvHandle->FvPpi->GetFileInfo (CoreFvHandle->FvPpi, PeimFileHandle, &FvFileInfo);
@@ -1621,6 +1626,11 @@ PeiDispatcher (
             //
             PeiCheckAndSwitchStack (SecCoreData, Private);
 
+            //
+            // Index the GUID extension HOBs built by the PEIM and the notifies.
+            //
+            PeiCoreUpdateHobIndex (Private);
+
             if ((Private->PeiMemoryInstalled) && (Private->Fv[FvCount].PeimState[PeimCount] == PEIM_STATE_REGISTER_FOR_SHADOW) &&   \
                 (PcdGetBool (PcdMigrateTemporaryRamFirmwareVolumes) ||
                  (Private->HobList.HandoffInformationTable->BootMode != BOOT_ON_S3_RESUME) ||
@@ -1731,6 +1741,8 @@ InitializeDispatcherData (
   @param Private         PeiCore's private data structure
   @param FileHandle      PEIM's file handle
   @param PeimCount       Peim count in all dispatched PEIMs.
+  @param DepexWait       The PPIs the PEIM waits on. It is updated when the
+                         Dependency Expression evaluates to FALSE.
 
   @retval TRUE   Can be dispatched
   @retval FALSE  Cannot be dispatched
@@ -1740,12 +1752,34 @@ BOOLEAN
 DepexSatisfied (
   IN PEI_CORE_INSTANCE          *Private,
   IN EFI_PEI_FILE_HANDLE        FileHandle,
-  IN UINTN                      PeimCount
+  IN UINTN                      PeimCount,
+  IN OUT PEI_CORE_DEPEX_WAIT    *DepexWait
   )
 {
   EFI_STATUS           Status;
   VOID                 *DepexData;
   EFI_FV_FILE_INFO     FileInfo;
+  PEI_PPI_LIST         *PpiList;
+  UINT32               BucketMask;
+  UINTN                Bucket;
+
+  //
+  // If the DEPEX evaluated to FALSE before, it can only become TRUE once a
+  // PPI it refers to has been installed or reinstalled. Until then, skip
+  // reading the file from the FV and locating each of its PPIs again.
+  //
+  PpiList = &Private->PpiData.PpiList;
+  if (DepexWait->Stamp != 0) {
+    for (BucketMask = DepexWait->BucketMask, Bucket = 0; BucketMask != 0; BucketMask >>= 1, Bucket++) {
+      if (((BucketMask & 1) != 0) && (PpiList->BucketStamps[Bucket] >= DepexWait->Stamp)) {
+        break;
+      }
+    }
+    if (BucketMask == 0) {
+      return FALSE;
+    }
+    DepexWait->Stamp = 0;
+  }
 
   Status = PeiServicesFfsGetFileInfo (FileHandle, &FileInfo);
   if (EFI_ERROR (Status)) {
@@ -1782,7 +1816,13 @@ DepexSatisfied (
   //
   // Evaluate a given DEPEX
   //
-  return PeimDispatchReadiness (&Private->Ps, DepexData);
+  if (PeimDispatchReadiness (&Private->Ps, DepexData)) {
+    return TRUE;
+  }
+
+  DepexWait->BucketMask = GetDepexPpiBucketMask (DepexData);
+  DepexWait->Stamp      = PpiList->InstallStamp + 1;
+  return FALSE;
 }
 
 /**
@@ -2,7 +2,7 @@
   Pei Core Firmware File System service routines.
 
 Copyright (c) 2015 HP Development Company, L.P.
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -242,6 +242,269 @@ FileHandleToVolume (
   return NULL;
 }
 
+/**
+  Returns the file index that GenFv generated in the extension header of an
+  FV, if the files of the FV still end where the index says.
+
+  @param FwVolHeader     Pointer to the FV header.
+  @param ErasePolarity   Erase polarity of the FV.
+
+  @return Pointer to the file index, or NULL if the FV has no usable one.
+
+**/
+EDKII_FV_FILE_INDEX *
+GetFvFileIndex (
+  IN EFI_FIRMWARE_VOLUME_HEADER     *FwVolHeader,
+  IN UINT8                          ErasePolarity
+  )
+{
+  UINT16                            ExtHeaderOffset;
+  UINT32                            ExtHeaderSize;
+  EFI_FIRMWARE_VOLUME_EXT_HEADER    *ExtHeader;
+  EFI_FIRMWARE_VOLUME_EXT_ENTRY     *ExtEntry;
+  UINT8                             *ExtHeaderEnd;
+  UINT16                            ExtEntrySize;
+  EDKII_FV_FILE_INDEX               *FileIndex;
+  UINT32                            EndOffset;
+
+  ExtHeaderOffset = ReadUnaligned16 (&FwVolHeader->ExtHeaderOffset);
+  if ((ExtHeaderOffset == 0) ||
+      (ExtHeaderOffset + sizeof (EFI_FIRMWARE_VOLUME_EXT_HEADER) > FwVolHeader->FvLength)) {
+    return NULL;
+  }
+
+  //
+  // The index is read from the extension header, which must be in the FV.
+  //
+  ExtHeader     = (EFI_FIRMWARE_VOLUME_EXT_HEADER *) ((UINT8 *) FwVolHeader + ExtHeaderOffset);
+  ExtHeaderSize = ReadUnaligned32 (&ExtHeader->ExtHeaderSize);
+  if (ExtHeaderSize > FwVolHeader->FvLength - ExtHeaderOffset) {
+    return NULL;
+  }
+  ExtHeaderEnd = (UINT8 *) ExtHeader + ExtHeaderSize;
+  ExtEntry     = (EFI_FIRMWARE_VOLUME_EXT_ENTRY *) (ExtHeader + 1);
+  while ((UINT8 *) (ExtEntry + 1) <= ExtHeaderEnd) {
+    ExtEntrySize = ReadUnaligned16 (&ExtEntry->ExtEntrySize);
+    if ((ExtEntrySize < sizeof (EFI_FIRMWARE_VOLUME_EXT_ENTRY)) ||
+        ((UINT8 *) ExtEntry + ExtEntrySize > ExtHeaderEnd)) {
+      break;
+    }
+
+    FileIndex = (EDKII_FV_FILE_INDEX *) ExtEntry;
+    if ((ReadUnaligned16 (&ExtEntry->ExtEntryType) == EFI_FV_EXT_TYPE_GUID_TYPE) &&
+        (ExtEntrySize >= sizeof (EDKII_FV_FILE_INDEX)) &&
+        CompareGuid (&FileIndex->FormatType, &gEdkiiFvFileIndexGuid)) {
+      EndOffset = ReadUnaligned32 (&FileIndex->EndOffset);
+      if ((EndOffset == 0) || (EndOffset > FwVolHeader->FvLength) ||
+          (ReadUnaligned32 (&FileIndex->FileCount) >
+           (ExtEntrySize - sizeof (EDKII_FV_FILE_INDEX)) / sizeof (EDKII_FV_FILE_INDEX_ENTRY))) {
+        return NULL;
+      }
+
+      //
+      // A file added to the FV after the index was generated starts where the
+      // indexed files end.
+      //
+      if ((EndOffset < FwVolHeader->FvLength - sizeof (EFI_FFS_FILE_HEADER)) &&
+          (GetFileState (ErasePolarity, (EFI_FFS_FILE_HEADER *) ((UINT8 *) FwVolHeader + EndOffset)) != 0)) {
+        DEBUG ((DEBUG_WARN, "The file index of the FV at 0x%p is stale\n", FwVolHeader));
+        return NULL;
+      }
+
+      return FileIndex;
+    }
+
+    ExtEntry = (EFI_FIRMWARE_VOLUME_EXT_ENTRY *) ((UINT8 *) ExtEntry + ExtEntrySize);
+  }
+
+  return NULL;
+}
+
+/**
+  Returns the file of an FV that a file index entry locates, after checking
+  that the file is the one the entry was generated for and that it is valid.
+
+  @param FwVolHeader     Pointer to the FV header.
+  @param Entry           Pointer to the entry of the file index.
+  @param ErasePolarity   Erase polarity of the FV.
+  @param IsFfs3Fv        TRUE if the FV is formatted with FFS3.
+
+  @return Pointer to the header of the file, or NULL if the entry does not
+          match the FV.
+
+**/
+EFI_FFS_FILE_HEADER *
+GetIndexedFile (
+  IN EFI_FIRMWARE_VOLUME_HEADER     *FwVolHeader,
+  IN EDKII_FV_FILE_INDEX_ENTRY      *Entry,
+  IN UINT8                          ErasePolarity,
+  IN BOOLEAN                        IsFfs3Fv
+  )
+{
+  UINT32                            Offset;
+  EFI_FFS_FILE_HEADER               *FfsFileHeader;
+  EFI_FFS_FILE_STATE                FileState;
+  UINT32                            HeaderSize;
+  UINT32                            FileLength;
+  UINT8                             DataCheckSum;
+
+  Offset = ReadUnaligned32 (&Entry->Offset);
+  if ((Offset < FwVolHeader->HeaderLength) || ((Offset & 0x07) != 0) ||
+      (Offset >= FwVolHeader->FvLength - sizeof (EFI_FFS_FILE_HEADER))) {
+    return NULL;
+  }
+
+  FfsFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) FwVolHeader + Offset);
+  FileState     = GetFileState (ErasePolarity, FfsFileHeader);
+  if ((FileState != EFI_FILE_DATA_VALID) && (FileState != EFI_FILE_MARKED_FOR_UPDATE)) {
+    return NULL;
+  }
+
+  //
+  // The entry may point anywhere in the FV, so the whole file must be in the
+  // FV before its header and its data are checked.
+  //
+  if (IS_FFS_FILE2 (FfsFileHeader)) {
+    if (!IsFfs3Fv || (Offset > FwVolHeader->FvLength - sizeof (EFI_FFS_FILE_HEADER2))) {
+      return NULL;
+    }
+    HeaderSize = sizeof (EFI_FFS_FILE_HEADER2);
+    FileLength = FFS_FILE2_SIZE (FfsFileHeader);
+  } else {
+    HeaderSize = sizeof (EFI_FFS_FILE_HEADER);
+    FileLength = FFS_FILE_SIZE (FfsFileHeader);
+  }
+  if ((FileLength < HeaderSize) || (FileLength > FwVolHeader->FvLength - Offset)) {
+    return NULL;
+  }
+
+  if ((FfsFileHeader->Type != Entry->Type) ||
+      !CompareGuid (&FfsFileHeader->Name, &Entry->Name) ||
+      (CalculateHeaderChecksum (FfsFileHeader) != 0)) {
+    return NULL;
+  }
+
+  DataCheckSum = FFS_FIXED_CHECKSUM;
+  if ((FfsFileHeader->Attributes & FFS_ATTRIB_CHECKSUM) == FFS_ATTRIB_CHECKSUM) {
+    DataCheckSum = CalculateCheckSum8 ((CONST UINT8 *) FfsFileHeader + HeaderSize, FileLength - HeaderSize);
+  }
+  if (FfsFileHeader->IntegrityCheck.Checksum.File != DataCheckSum) {
+    return NULL;
+  }
+
+  return FfsFileHeader;
+}
+
+/**
+  Searches the file index of an FV for the first matching file, as
+  FindFileEx() searches the FV. Only the files that match are read from the FV.
+
+  @param FwVolHeader     Pointer to the FV header.
+  @param FileIndex       Pointer to the file index of the FV.
+  @param ErasePolarity   Erase polarity of the FV.
+  @param IsFfs3Fv        TRUE if the FV is formatted with FFS3.
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHeader      The file to start after, or NULL to start with the
+                         first file. Updated to the file found.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @retval EFI_SUCCESS           Success to search given file
+  @retval EFI_NOT_FOUND         No files matching the search criteria were found
+  @retval EFI_VOLUME_CORRUPTED  The file index does not match the FV, which
+                                has to be searched instead.
+
+**/
+EFI_STATUS
+FindFileInIndex (
+  IN        EFI_FIRMWARE_VOLUME_HEADER  *FwVolHeader,
+  IN        EDKII_FV_FILE_INDEX         *FileIndex,
+  IN        UINT8                       ErasePolarity,
+  IN        BOOLEAN                     IsFfs3Fv,
+  IN  CONST EFI_GUID                    *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE             SearchType,
+  IN OUT    EFI_FFS_FILE_HEADER         **FileHeader,
+  IN OUT    EFI_PEI_FILE_HANDLE         *AprioriFile  OPTIONAL
+  )
+{
+  EDKII_FV_FILE_INDEX_ENTRY             *Entries;
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  EFI_FV_FILETYPE                       Type;
+  UINT32                                FileCount;
+  UINT32                                FileOffset;
+  UINT32                                Index;
+  UINT32                                Low;
+  UINT32                                High;
+
+  Entries   = (EDKII_FV_FILE_INDEX_ENTRY *) (FileIndex + 1);
+  FileCount = ReadUnaligned32 (&FileIndex->FileCount);
+
+  //
+  // The entries are in the order of the files, so the file to start after is
+  // found by a binary search of its offset.
+  //
+  Index      = 0;
+  FileOffset = 0;
+  if ((*FileHeader != NULL) && (FileName == NULL)) {
+    FileOffset = (UINT32) ((UINT8 *) *FileHeader - (UINT8 *) FwVolHeader);
+    Low        = 0;
+    High       = FileCount;
+    while (Low < High) {
+      Index = (Low + High) / 2;
+      if (ReadUnaligned32 (&Entries[Index].Offset) < FileOffset) {
+        Low = Index + 1;
+      } else {
+        High = Index;
+      }
+    }
+    if ((Low == FileCount) || (ReadUnaligned32 (&Entries[Low].Offset) != FileOffset)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    Index = Low + 1;
+  }
+
+  for (; Index < FileCount; Index++) {
+    Type = Entries[Index].Type;
+    if (FileName != NULL) {
+      if (!CompareGuid (&Entries[Index].Name, FileName)) {
+        continue;
+      }
+    } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
+      if ((Type != EFI_FV_FILETYPE_PEIM) &&
+          (Type != EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) &&
+          (Type != EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+        if ((AprioriFile != NULL) && (Type == EFI_FV_FILETYPE_FREEFORM) &&
+            CompareGuid (&Entries[Index].Name, &gPeiAprioriFileNameGuid)) {
+          FfsFileHeader = GetIndexedFile (FwVolHeader, &Entries[Index], ErasePolarity, IsFfs3Fv);
+          if (FfsFileHeader == NULL) {
+            return EFI_VOLUME_CORRUPTED;
+          }
+          *AprioriFile = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+        }
+        continue;
+      }
+    } else if ((SearchType != Type) && (SearchType != EFI_FV_FILETYPE_ALL)) {
+      continue;
+    }
+
+    //
+    // The file found must follow the file to start after, or a search that
+    // enumerates the files would not end when two entries locate the same file.
+    //
+    FfsFileHeader = GetIndexedFile (FwVolHeader, &Entries[Index], ErasePolarity, IsFfs3Fv);
+    if ((FfsFileHeader == NULL) ||
+        ((UINT32) ((UINT8 *) FfsFileHeader - (UINT8 *) FwVolHeader) <= FileOffset)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    *FileHeader = FfsFileHeader;
+    return EFI_SUCCESS;
+  }
+
+  *FileHeader = NULL;
+  return EFI_NOT_FOUND;
+}
+
 /**
   Given the input file pointer, search for the first matching file in the
   FFS volume as defined by SearchType. The search starts from FileHeader inside
@@ -249,6 +512,8 @@ FileHandleToVolume (
   If SearchType is EFI_FV_FILETYPE_ALL, the first FFS file will return without check its file type.
   If SearchType is PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE,
   the first PEIM, or COMBINED PEIM or FV file type FFS file will return.
+  If the FV has a file index, the index is searched instead of the FV, unless
+  it does not match the FV.
 
   @param FvHandle        Pointer to the FV header of the volume to search
   @param FileName        File name
@@ -270,8 +535,10 @@ FindFileEx (
   IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
   )
 {
+  EFI_STATUS                            Status;
   EFI_FIRMWARE_VOLUME_HEADER            *FwVolHeader;
   EFI_FIRMWARE_VOLUME_EXT_HEADER        *FwVolExtHeader;
+  EDKII_FV_FILE_INDEX                   *FileIndex;
   EFI_FFS_FILE_HEADER                   **FileHeader;
   EFI_FFS_FILE_HEADER                   *FfsFileHeader;
   UINT32                                FileLength;
@@ -298,6 +565,18 @@ FindFileEx (
     ErasePolarity = 0;
   }
 
+  //
+  // Searching the file index reads only the headers of the matching files.
+  //
+  FileIndex = GetFvFileIndex (FwVolHeader, ErasePolarity);
+  if (FileIndex != NULL) {
+    Status = FindFileInIndex (FwVolHeader, FileIndex, ErasePolarity, IsFfs3Fv, FileName, SearchType, FileHeader, AprioriFile);
+    if (Status != EFI_VOLUME_CORRUPTED) {
+      return Status;
+    }
+    DEBUG ((DEBUG_WARN, "The file index of the FV at 0x%p does not match the FV\n", FwVolHeader));
+  }
+
   //
   // If FileHeader is not specified (NULL) or FileName is not NULL,
   // start with the first file in the firmware volume.  Otherwise,
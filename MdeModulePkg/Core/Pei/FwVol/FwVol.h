@@ -302,6 +302,55 @@ FindFileEx (
   IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
   );
 
+/**
+  Returns the file index that GenFv generated in the extension header of an
+  FV, if the files of the FV still end where the index says.
+
+  @param FwVolHeader     Pointer to the FV header.
+  @param ErasePolarity   Erase polarity of the FV.
+
+  @return Pointer to the file index, or NULL if the FV has no usable one.
+
+**/
+EDKII_FV_FILE_INDEX *
+GetFvFileIndex (
+  IN EFI_FIRMWARE_VOLUME_HEADER     *FwVolHeader,
+  IN UINT8                          ErasePolarity
+  );
+
+/**
+  Searches the file index of an FV for the first matching file, as
+  FindFileEx() searches the FV. Only the files that match are read from the FV.
+
+  @param FwVolHeader     Pointer to the FV header.
+  @param FileIndex       Pointer to the file index of the FV.
+  @param ErasePolarity   Erase polarity of the FV.
+  @param IsFfs3Fv        TRUE if the FV is formatted with FFS3.
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHeader      The file to start after, or NULL to start with the
+                         first file. Updated to the file found.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @retval EFI_SUCCESS           Success to search given file
+  @retval EFI_NOT_FOUND         No files matching the search criteria were found
+  @retval EFI_VOLUME_CORRUPTED  The file index does not match the FV, which
+                                has to be searched instead.
+
+**/
+EFI_STATUS
+FindFileInIndex (
+  IN        EFI_FIRMWARE_VOLUME_HEADER  *FwVolHeader,
+  IN        EDKII_FV_FILE_INDEX         *FileIndex,
+  IN        UINT8                       ErasePolarity,
+  IN        BOOLEAN                     IsFfs3Fv,
+  IN  CONST EFI_GUID                    *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE             SearchType,
+  IN OUT    EFI_FFS_FILE_HEADER         **FileHeader,
+  IN OUT    EFI_PEI_FILE_HANDLE         *AprioriFile  OPTIONAL
+  );
+
 /**
   Report the information for a newly discovered FV in an unknown format.
 
@@ -1,13 +1,18 @@
 /** @file
   This module provide Hand-Off Block manipulation.
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 
 #include "PeiMain.h"
 
+//
+// The smallest number of entries of the HOB index.
+//
+#define PEI_HOB_INDEX_MIN_CAPACITY  64
+
 /**
 
   Gets the pointer to the HOB List.
@@ -209,14 +214,26 @@ PeiCoreBuildHobHandoffInfoTable (
   )
 {
   EFI_HOB_HANDOFF_INFO_TABLE   *Hob;
+  EFI_HOB_GUID_TYPE            *IndexHob;
   EFI_HOB_GENERIC_HEADER       *HobEnd;
 
   Hob                      = (VOID *)(UINTN)MemoryBegin;
-  HobEnd                   = (EFI_HOB_GENERIC_HEADER*) (Hob+1);
+  IndexHob                 = (EFI_HOB_GUID_TYPE *) (Hob+1);
+  HobEnd                   = (EFI_HOB_GENERIC_HEADER*) ((UINT8 *) (IndexHob+1) + sizeof (EFI_PHYSICAL_ADDRESS));
   Hob->Header.HobType      = EFI_HOB_TYPE_HANDOFF;
   Hob->Header.HobLength    = (UINT16) sizeof (EFI_HOB_HANDOFF_INFO_TABLE);
   Hob->Header.Reserved     = 0;
 
+  //
+  // The second HOB holds the address of the HOB index, which is built once
+  // permanent memory is installed.
+  //
+  IndexHob->Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+  IndexHob->Header.HobLength = (UINT16) (sizeof (EFI_HOB_GUID_TYPE) + sizeof (EFI_PHYSICAL_ADDRESS));
+  IndexHob->Header.Reserved  = 0;
+  CopyGuid (&IndexHob->Name, &gEdkiiHobIndexGuid);
+  WriteUnaligned64 ((UINT64 *) (IndexHob+1), 0);
+
   HobEnd->HobType          = EFI_HOB_TYPE_END_OF_HOB_LIST;
   HobEnd->HobLength        = (UINT16) sizeof (EFI_HOB_GENERIC_HEADER);
   HobEnd->Reserved         = 0;
@@ -232,3 +249,110 @@ PeiCoreBuildHobHandoffInfoTable (
 
   return EFI_SUCCESS;
 }
+
+/**
+  Indexes the GUID extension HOBs added to the HOB list since the HOB index
+  was last updated. The index is built, or moved to a larger buffer, when it
+  has no room for them. Nothing is done until permanent memory is installed.
+
+  Only the GUID extension HOBs are indexed, because the types of the memory
+  HOBs change while the PEI Core reuses and frees them.
+
+  @param PrivateData     Pointer to the PEI Core data.
+
+**/
+VOID
+PeiCoreUpdateHobIndex (
+  IN PEI_CORE_INSTANCE     *PrivateData
+  )
+{
+  EFI_STATUS                   Status;
+  CONST EFI_PEI_SERVICES       **PeiServices;
+  EFI_PEI_HOB_POINTERS         IndexHob;
+  EFI_PEI_HOB_POINTERS         Hob;
+  EDKII_HOB_INDEX              *Index;
+  EDKII_HOB_INDEX              *NewIndex;
+  EFI_PHYSICAL_ADDRESS         Memory;
+  UINT32                       NewCount;
+  UINT32                       EntryCapacity;
+  UINT32                       GuidSlotCount;
+  UINT32                       Entry;
+
+  if (!PrivateData->PeiMemoryInstalled) {
+    return;
+  }
+
+  IndexHob.Raw = PrivateData->HobList.Raw;
+  IndexHob.Raw = GET_NEXT_HOB (IndexHob);
+  if (IndexHob.Header->HobType != EFI_HOB_TYPE_GUID_EXTENSION ||
+      !CompareGuid (&IndexHob.Guid->Name, &gEdkiiHobIndexGuid)) {
+    return;
+  }
+
+  Index = (EDKII_HOB_INDEX *) (UINTN) ReadUnaligned64 (GET_GUID_HOB_DATA (IndexHob));
+  if (!IsHobIndexValid (Index, PrivateData->HobList.Raw)) {
+    Index = NULL;
+  }
+
+  NewCount = 0;
+  for (Hob.Raw = (Index != NULL) ? Index->IndexedEnd : PrivateData->HobList.Raw; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      NewCount++;
+    }
+  }
+
+  if (Index == NULL || Index->EntryCount + NewCount > Index->EntryCapacity) {
+    //
+    // Leave room for as many HOBs as are indexed, so that the index is only
+    // moved a logarithmic number of times as the HOB list grows, and keep at
+    // least half of the GUID slots empty.
+    //
+    EntryCapacity = MAX (2 * (((Index != NULL) ? Index->EntryCount : 0) + NewCount), PEI_HOB_INDEX_MIN_CAPACITY);
+    GuidSlotCount = GetPowerOfTwo32 (EntryCapacity) * 4;
+
+    PeiServices = (CONST EFI_PEI_SERVICES **) &PrivateData->Ps;
+    Status = PeiAllocatePages (
+               PeiServices,
+               EfiBootServicesData,
+               EFI_SIZE_TO_PAGES (GetHobIndexSize (EntryCapacity, GuidSlotCount)),
+               &Memory
+               );
+    if (EFI_ERROR (Status)) {
+      //
+      // The HOB libraries search the HOBs after the index in the HOB list.
+      //
+      return;
+    }
+
+    NewIndex = (EDKII_HOB_INDEX *) (UINTN) Memory;
+    InitializeHobIndex (NewIndex, PrivateData->HobList.Raw, BIT0 << EFI_HOB_TYPE_GUID_EXTENSION, EntryCapacity, GuidSlotCount);
+    if (Index != NULL) {
+      for (Entry = 0; Entry < Index->EntryCount; Entry++) {
+        //
+        // Drop the HOBs that were freed since they were indexed.
+        //
+        Hob.Raw = Index->Entries[Entry].Hob;
+        if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+          AppendHobToIndex (NewIndex, Hob.Raw);
+        }
+      }
+      NewIndex->IndexedEnd = Index->IndexedEnd;
+      PeiFreePages (
+        PeiServices,
+        (EFI_PHYSICAL_ADDRESS) (UINTN) Index,
+        EFI_SIZE_TO_PAGES (GetHobIndexSize (Index->EntryCapacity, Index->GuidSlotCount))
+        );
+    }
+
+    Index = NewIndex;
+    WriteUnaligned64 (GET_GUID_HOB_DATA (IndexHob), (UINT64) (UINTN) Index);
+  }
+
+  for (Hob.Raw = Index->IndexedEnd; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      AppendHobToIndex (Index, Hob.Raw);
+    }
+  }
+
+  Index->IndexedEnd = Hob.Raw;
+}
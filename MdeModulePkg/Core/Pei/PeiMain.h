@@ -1,7 +1,7 @@
 /** @file
   Definition of Pei Core Structures and Services
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -30,6 +30,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PeiCoreEntryPoint.h>
 #include <Library/BaseLib.h>
 #include <Library/HobLib.h>
+#include <Library/HobIndexLib.h>
 #include <Library/PerformanceLib.h>
 #include <Library/PeiServicesLib.h>
 #include <Library/ReportStatusCodeLib.h>
@@ -45,6 +46,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/FirmwareFileSystem3.h>
 #include <Guid/AprioriFileName.h>
 #include <Guid/MigratedFvInfo.h>
+#include <Guid/FvFileIndex.h>
+#include <Guid/HobIndex.h>
 
 ///
 /// It is an FFS type extension used for PeiFindFileEx. It indicates current
@@ -68,23 +71,53 @@ typedef union {
 #define CALLBACK_NOTIFY_GROWTH_STEP 32
 #define DISPATCH_NOTIFY_GROWTH_STEP 8
 
+///
+/// Number of hash buckets of each PPI and notify list, a power of two.
+///
+#define PPI_HASH_BUCKET_COUNT       32
+
+///
+/// The entries of a PPI or notify list whose GUIDs hash to the same bucket
+/// are linked in a chain, in the order of the list. A link is one more than
+/// the index of an entry, so that 0 ends a chain and a zeroed bucket is empty.
+///
+typedef struct {
+  UINT16                Head;
+  UINT16                Tail;
+} PEI_PPI_HASH_BUCKET;
+
+///
+/// The chain links of a PPI or notify list. They follow the MaxCount entries
+/// in the same buffer, so that they move with the entries.
+///
+#define PPI_HASH_CHAIN(Ptrs, MaxCount)  ((UINT16 *) ((Ptrs) + (MaxCount)))
+
 typedef struct {
   UINTN                 CurrentCount;
   UINTN                 MaxCount;
   UINTN                 LastDispatchedCount;
   ///
-  /// MaxCount number of entries.
+  /// MaxCount number of entries, followed by their chain links.
   ///
   PEI_PPI_LIST_POINTERS *PpiPtrs;
+  PEI_PPI_HASH_BUCKET   Buckets[PPI_HASH_BUCKET_COUNT];
+  ///
+  /// Counts the calls that install or reinstall PPIs. BucketStamps[N] is the
+  /// count of the last call that installed, or removed by reinstalling, a PPI
+  /// whose GUID hashes to bucket N.
+  ///
+  UINT32                InstallStamp;
+  UINT32                BucketStamps[PPI_HASH_BUCKET_COUNT];
 } PEI_PPI_LIST;
 
 typedef struct {
   UINTN                 CurrentCount;
   UINTN                 MaxCount;
   ///
-  /// MaxCount number of entries.
+  /// MaxCount number of entries, followed by their chain links.
   ///
   PEI_PPI_LIST_POINTERS *NotifyPtrs;
+  PEI_PPI_HASH_BUCKET   Buckets[PPI_HASH_BUCKET_COUNT];
 } PEI_CALLBACK_NOTIFY_LIST;
 
 typedef struct {
@@ -92,9 +125,10 @@ typedef struct {
   UINTN                 MaxCount;
   UINTN                 LastDispatchedCount;
   ///
-  /// MaxCount number of entries.
+  /// MaxCount number of entries, followed by their chain links.
   ///
   PEI_PPI_LIST_POINTERS *NotifyPtrs;
+  PEI_PPI_HASH_BUCKET   Buckets[PPI_HASH_BUCKET_COUNT];
 } PEI_DISPATCH_NOTIFY_LIST;
 
 ///
@@ -131,6 +165,23 @@ typedef struct {
 //
 #define FV_GROWTH_STEP 8
 
+///
+/// Records the PPIs a PEIM waits on when its DEPEX evaluates to FALSE. The
+/// DEPEX is not evaluated again until a PPI that may change its result has
+/// been installed or reinstalled.
+///
+typedef struct {
+  ///
+  /// Bit N is set if the DEPEX refers to a PPI GUID that hashes to bucket N.
+  ///
+  UINT32                              BucketMask;
+  ///
+  /// One more than PpiList.InstallStamp when the DEPEX evaluated to FALSE,
+  /// or 0 if the DEPEX has to be evaluated.
+  ///
+  UINT32                              Stamp;
+} PEI_CORE_DEPEX_WAIT;
+
 typedef struct {
   EFI_FIRMWARE_VOLUME_HEADER          *FvHeader;
   EFI_PEI_FIRMWARE_VOLUME_PPI         *FvPpi;
@@ -144,6 +195,10 @@ typedef struct {
   // Pointer to the buffer with the PeimCount number of Entries.
   //
   EFI_PEI_FILE_HANDLE                 *FvFileHandles;
+  //
+  // Pointer to the buffer with the PeimCount number of Entries.
+  //
+  PEI_CORE_DEPEX_WAIT                 *DepexWait;
   BOOLEAN                             ScanFv;
   UINT32                              AuthenticationStatus;
 } PEI_CORE_FV_HANDLE;
@@ -395,6 +450,22 @@ PeimDispatchReadiness (
   IN VOID               *DependencyExpression
   );
 
+/**
+  Returns the hash buckets of the PPI GUIDs that a dependency expression
+  refers to. The result of the dependency expression can only change when a
+  PPI whose GUID hashes to one of these buckets is installed or reinstalled.
+
+  @param DependencyExpression   Pointer to a dependency expression.
+
+  @return A mask with bit N set for hash bucket N. All the bits are set if the
+          dependency expression is not a well-formed Grammar.
+
+**/
+UINT32
+GetDepexPpiBucketMask (
+  IN VOID               *DependencyExpression
+  );
+
 /**
   Migrate a PEIM from temporary RAM to permanent memory.
 
@@ -468,6 +539,8 @@ InitializeDispatcherData (
   @param Private         PeiCore's private data structure
   @param FileHandle      PEIM's file handle
   @param PeimCount       The index of last dispatched PEIM.
+  @param DepexWait       The PPIs the PEIM waits on. It is updated when the
+                         Dependency Expression evaluates to FALSE.
 
   @retval TRUE           Can be dispatched
   @retval FALSE          Cannot be dispatched
@@ -477,7 +550,8 @@ BOOLEAN
 DepexSatisfied (
   IN PEI_CORE_INSTANCE          *Private,
   IN EFI_PEI_FILE_HANDLE        FileHandle,
-  IN UINTN                      PeimCount
+  IN UINTN                      PeimCount,
+  IN OUT PEI_CORE_DEPEX_WAIT    *DepexWait
   );
 
 //
@@ -557,6 +631,34 @@ DumpPpiList (
   IN PEI_CORE_INSTANCE    *PrivateData
   );
 
+/**
+
+  Returns the hash bucket of the GUID of a PPI or notify descriptor.
+
+  @param Guid            Pointer to the GUID.
+
+  @return The index of the hash bucket.
+
+**/
+UINTN
+PpiGuidHash (
+  IN CONST EFI_GUID       *Guid
+  );
+
+/**
+
+  Returns the size of the GUID hash index of the PPI lists.
+
+  @param PrivateData     Points to PeiCore's private instance data.
+
+  @return The size in bytes of the hash buckets and chain links.
+
+**/
+UINTN
+GetPpiHashIndexSize (
+  IN PEI_CORE_INSTANCE    *PrivateData
+  );
+
 /**
 
   Install PPI services. It is implementation of EFI_PEI_SERVICE.InstallPpi.
@@ -843,6 +945,19 @@ PeiCoreBuildHobHandoffInfoTable (
   IN UINT64                MemoryLength
   );
 
+/**
+  Indexes the GUID extension HOBs added to the HOB list since the HOB index
+  was last updated. The index is built, or moved to a larger buffer, when it
+  has no room for them. Nothing is done until permanent memory is installed.
+
+  @param PrivateData     Pointer to the PEI Core data.
+
+**/
+VOID
+PeiCoreUpdateHobIndex (
+  IN PEI_CORE_INSTANCE     *PrivateData
+  );
+
 /**
   Install SEC HOB data to the HOB List.
 
@@ -1,7 +1,7 @@
 /** @file
   EFI PEI Core PPI services
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -419,6 +419,209 @@ DumpPpiList (
   DEBUG_CODE_END ();
 }
 
+/**
+
+  Returns the hash bucket of the GUID of a PPI or notify descriptor.
+
+  @param Guid            Pointer to the GUID.
+
+  @return The index of the hash bucket.
+
+**/
+UINTN
+PpiGuidHash (
+  IN CONST EFI_GUID       *Guid
+  )
+{
+  return CalculateGuidHash (Guid) & (PPI_HASH_BUCKET_COUNT - 1);
+}
+
+/**
+
+  Compares the GUIDs of two PPI or notify descriptors.
+
+  @param Guid1           Pointer to the first GUID.
+  @param Guid2           Pointer to the second GUID.
+
+  @retval TRUE           The GUIDs are equal.
+  @retval FALSE          The GUIDs are different.
+
+**/
+STATIC
+BOOLEAN
+IsPpiGuidEqual (
+  IN CONST EFI_GUID       *Guid1,
+  IN CONST EFI_GUID       *Guid2
+  )
+{
+  //
+  // Don't use CompareGuid function here for performance reasons.
+  // Instead we compare the GUID as INT32 at a time and branch
+  // on the first failed comparison.
+  //
+  return (BOOLEAN) ((((INT32 *)Guid1)[0] == ((INT32 *)Guid2)[0]) &&
+                    (((INT32 *)Guid1)[1] == ((INT32 *)Guid2)[1]) &&
+                    (((INT32 *)Guid1)[2] == ((INT32 *)Guid2)[2]) &&
+                    (((INT32 *)Guid1)[3] == ((INT32 *)Guid2)[3]));
+}
+
+/**
+
+  Grows the buffer of a PPI or notify list and of its chain links.
+
+  @param Ptrs            Pointer to the entries of the list.
+  @param MaxCount        Pointer to the number of entries of the buffer.
+  @param GrowthStep      Number of entries to grow the buffer by.
+
+**/
+STATIC
+VOID
+GrowPpiList (
+  IN OUT PEI_PPI_LIST_POINTERS  **Ptrs,
+  IN OUT UINTN                  *MaxCount,
+  IN     UINTN                  GrowthStep
+  )
+{
+  PEI_PPI_LIST_POINTERS *TempPtr;
+  UINTN                 NewMaxCount;
+
+  NewMaxCount = *MaxCount + GrowthStep;
+
+  //
+  // The chain links are 16-bit.
+  //
+  ASSERT (NewMaxCount < MAX_UINT16);
+
+  TempPtr = AllocateZeroPool (
+              (sizeof (PEI_PPI_LIST_POINTERS) + sizeof (UINT16)) * NewMaxCount
+              );
+  ASSERT (TempPtr != NULL);
+  if (*MaxCount != 0) {
+    CopyMem (
+      TempPtr,
+      *Ptrs,
+      sizeof (PEI_PPI_LIST_POINTERS) * *MaxCount
+      );
+    CopyMem (
+      PPI_HASH_CHAIN (TempPtr, NewMaxCount),
+      PPI_HASH_CHAIN (*Ptrs, *MaxCount),
+      sizeof (UINT16) * *MaxCount
+      );
+  }
+  *Ptrs     = TempPtr;
+  *MaxCount = NewMaxCount;
+}
+
+/**
+
+  Links an entry of a PPI or notify list into the chain of its hash bucket,
+  in the order of the list.
+
+  @param Buckets         The hash buckets of the list.
+  @param Ptrs            The entries of the list.
+  @param MaxCount        The number of entries of the buffer of the list.
+  @param Index           The index of the entry.
+
+**/
+STATIC
+VOID
+InsertPpiHash (
+  IN OUT PEI_PPI_HASH_BUCKET    *Buckets,
+  IN     PEI_PPI_LIST_POINTERS  *Ptrs,
+  IN     UINTN                  MaxCount,
+  IN     UINTN                  Index
+  )
+{
+  UINT16                *Chain;
+  PEI_PPI_HASH_BUCKET   *Bucket;
+  UINT16                *Link;
+
+  Chain  = PPI_HASH_CHAIN (Ptrs, MaxCount);
+  Bucket = &Buckets[PpiGuidHash (Ptrs[Index].Ppi->Guid)];
+
+  if (Bucket->Tail == 0) {
+    Chain[Index] = 0;
+    Bucket->Head = (UINT16) (Index + 1);
+    Bucket->Tail = (UINT16) (Index + 1);
+  } else if (Bucket->Tail <= Index) {
+    //
+    // New entries are appended to the list, so they go to the end of the chain.
+    //
+    Chain[Index] = 0;
+    Chain[Bucket->Tail - 1] = (UINT16) (Index + 1);
+    Bucket->Tail = (UINT16) (Index + 1);
+  } else {
+    for (Link = &Bucket->Head; *Link <= Index; Link = &Chain[*Link - 1]) {
+    }
+    Chain[Index] = *Link;
+    *Link = (UINT16) (Index + 1);
+  }
+}
+
+/**
+
+  Unlinks an entry of a PPI or notify list from the chain of its hash bucket.
+
+  @param Buckets         The hash buckets of the list.
+  @param Ptrs            The entries of the list.
+  @param MaxCount        The number of entries of the buffer of the list.
+  @param Index           The index of the entry.
+
+**/
+STATIC
+VOID
+RemovePpiHash (
+  IN OUT PEI_PPI_HASH_BUCKET    *Buckets,
+  IN     PEI_PPI_LIST_POINTERS  *Ptrs,
+  IN     UINTN                  MaxCount,
+  IN     UINTN                  Index
+  )
+{
+  UINT16                *Chain;
+  PEI_PPI_HASH_BUCKET   *Bucket;
+  UINT16                *Link;
+  UINT16                Previous;
+
+  Chain    = PPI_HASH_CHAIN (Ptrs, MaxCount);
+  Bucket   = &Buckets[PpiGuidHash (Ptrs[Index].Ppi->Guid)];
+  Previous = 0;
+
+  for (Link = &Bucket->Head; *Link != Index + 1; Link = &Chain[*Link - 1]) {
+    if (*Link == 0) {
+      ASSERT (FALSE);
+      return;
+    }
+    Previous = *Link;
+  }
+
+  *Link = Chain[Index];
+  if (Bucket->Tail == Index + 1) {
+    Bucket->Tail = Previous;
+  }
+}
+
+/**
+
+  Returns the size of the GUID hash index of the PPI lists.
+
+  @param PrivateData     Points to PeiCore's private instance data.
+
+  @return The size in bytes of the hash buckets and chain links.
+
+**/
+UINTN
+GetPpiHashIndexSize (
+  IN PEI_CORE_INSTANCE    *PrivateData
+  )
+{
+  return sizeof (PrivateData->PpiData.PpiList.Buckets) +
+         sizeof (PrivateData->PpiData.CallbackNotifyList.Buckets) +
+         sizeof (PrivateData->PpiData.DispatchNotifyList.Buckets) +
+         sizeof (UINT16) * (PrivateData->PpiData.PpiList.MaxCount +
+                            PrivateData->PpiData.CallbackNotifyList.MaxCount +
+                            PrivateData->PpiData.DispatchNotifyList.MaxCount);
+}
+
 /**
 
   This function installs an interface in the PEI PPI database by GUID.
@@ -448,7 +651,6 @@ InternalPeiInstallPpi (
   PEI_PPI_LIST          *PpiListPointer;
   UINTN                 Index;
   UINTN                 LastCount;
-  VOID                  *TempPtr;
 
   if (PpiList == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -482,17 +684,7 @@ InternalPeiInstallPpi (
       //
       // Run out of room, grow the buffer.
       //
-      TempPtr = AllocateZeroPool (
-                  sizeof (PEI_PPI_LIST_POINTERS) * (PpiListPointer->MaxCount + PPI_GROWTH_STEP)
-                  );
-      ASSERT (TempPtr != NULL);
-      CopyMem (
-        TempPtr,
-        PpiListPointer->PpiPtrs,
-        sizeof (PEI_PPI_LIST_POINTERS) * PpiListPointer->MaxCount
-        );
-      PpiListPointer->PpiPtrs = TempPtr;
-      PpiListPointer->MaxCount = PpiListPointer->MaxCount + PPI_GROWTH_STEP;
+      GrowPpiList (&PpiListPointer->PpiPtrs, &PpiListPointer->MaxCount, PPI_GROWTH_STEP);
     }
 
     DEBUG((EFI_D_INFO, "Install PPI: %g\n", PpiList->Guid));
@@ -518,6 +710,16 @@ InternalPeiInstallPpi (
     PpiList++;
   }
 
+  //
+  // Index the new PPIs once they are all valid, and stamp their buckets so
+  // that the dispatcher evaluates the DEPEXes waiting on them again.
+  //
+  PpiListPointer->InstallStamp++;
+  for (Index = LastCount; Index < PpiListPointer->CurrentCount; Index++) {
+    InsertPpiHash (PpiListPointer->Buckets, PpiListPointer->PpiPtrs, PpiListPointer->MaxCount, Index);
+    PpiListPointer->BucketStamps[PpiGuidHash (PpiListPointer->PpiPtrs[Index].Ppi->Guid)] = PpiListPointer->InstallStamp;
+  }
+
   //
   // Process any callback level notifies for newly installed PPIs.
   //
@@ -584,7 +786,9 @@ PeiReInstallPpi (
   )
 {
   PEI_CORE_INSTANCE   *PrivateData;
+  PEI_PPI_LIST        *PpiListPointer;
   UINTN               Index;
+  UINT16              Link;
 
 
   if ((OldPpi == NULL) || (NewPpi == NULL)) {
@@ -597,24 +801,39 @@ PeiReInstallPpi (
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
 
+  PpiListPointer = &PrivateData->PpiData.PpiList;
+
   //
   // Find the old PPI instance in the database.  If we can not find it,
   // return the EFI_NOT_FOUND error.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiList.CurrentCount; Index++) {
-    if (OldPpi == PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi) {
+  for (Link = PpiListPointer->Buckets[PpiGuidHash (OldPpi->Guid)].Head;
+       Link != 0;
+       Link = PPI_HASH_CHAIN (PpiListPointer->PpiPtrs, PpiListPointer->MaxCount)[Link - 1]) {
+    if (OldPpi == PpiListPointer->PpiPtrs[Link - 1].Ppi) {
       break;
     }
   }
-  if (Index == PrivateData->PpiData.PpiList.CurrentCount) {
+  if (Link == 0) {
     return EFI_NOT_FOUND;
   }
+  Index = Link - 1;
 
   //
   // Replace the old PPI with the new one.
   //
   DEBUG((EFI_D_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
-  PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  RemovePpiHash (PpiListPointer->Buckets, PpiListPointer->PpiPtrs, PpiListPointer->MaxCount, Index);
+  PpiListPointer->PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  InsertPpiHash (PpiListPointer->Buckets, PpiListPointer->PpiPtrs, PpiListPointer->MaxCount, Index);
+
+  //
+  // The old GUID may no longer be installed, which can satisfy a NOT in a
+  // DEPEX, so both buckets are stamped.
+  //
+  PpiListPointer->InstallStamp++;
+  PpiListPointer->BucketStamps[PpiGuidHash (OldPpi->Guid)] = PpiListPointer->InstallStamp;
+  PpiListPointer->BucketStamps[PpiGuidHash (NewPpi->Guid)] = PpiListPointer->InstallStamp;
 
   //
   // Process any callback level notifies for the newly installed PPI.
@@ -658,29 +877,24 @@ PeiLocatePpi (
   )
 {
   PEI_CORE_INSTANCE         *PrivateData;
-  UINTN                     Index;
-  EFI_GUID                  *CheckGuid;
+  PEI_PPI_LIST              *PpiListPointer;
+  UINT16                    *Chain;
+  UINT16                    Link;
   EFI_PEI_PPI_DESCRIPTOR    *TempPtr;
 
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PpiListPointer = &PrivateData->PpiData.PpiList;
+  Chain = PPI_HASH_CHAIN (PpiListPointer->PpiPtrs, PpiListPointer->MaxCount);
 
   //
-  // Search the data base for the matching instance of the GUIDed PPI.
+  // Search the hash bucket of the GUID for the matching instance of the
+  // GUIDed PPI. The bucket has the PPIs in the order of the data base.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiList.CurrentCount; Index++) {
-    TempPtr = PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi;
-    CheckGuid = TempPtr->Guid;
+  for (Link = PpiListPointer->Buckets[PpiGuidHash (Guid)].Head; Link != 0; Link = Chain[Link - 1]) {
+    TempPtr = PpiListPointer->PpiPtrs[Link - 1].Ppi;
 
-    //
-    // Don't use CompareGuid function here for performance reasons.
-    // Instead we compare the GUID as INT32 at a time and branch
-    // on the first failed comparison.
-    //
-    if ((((INT32 *)Guid)[0] == ((INT32 *)CheckGuid)[0]) &&
-        (((INT32 *)Guid)[1] == ((INT32 *)CheckGuid)[1]) &&
-        (((INT32 *)Guid)[2] == ((INT32 *)CheckGuid)[2]) &&
-        (((INT32 *)Guid)[3] == ((INT32 *)CheckGuid)[3])) {
+    if (IsPpiGuidEqual (Guid, TempPtr->Guid)) {
       if (Instance == 0) {
 
         if (PpiDescriptor != NULL) {
@@ -732,7 +946,6 @@ InternalPeiNotifyPpi (
   PEI_DISPATCH_NOTIFY_LIST  *DispatchNotifyListPointer;
   UINTN                     DispatchNotifyIndex;
   UINTN                     LastDispatchNotifyCount;
-  VOID                      *TempPtr;
 
   if (NotifyList == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -770,17 +983,7 @@ InternalPeiNotifyPpi (
         //
         // Run out of room, grow the buffer.
         //
-        TempPtr = AllocateZeroPool (
-                    sizeof (PEI_PPI_LIST_POINTERS) * (CallbackNotifyListPointer->MaxCount + CALLBACK_NOTIFY_GROWTH_STEP)
-                    );
-        ASSERT (TempPtr != NULL);
-        CopyMem (
-          TempPtr,
-          CallbackNotifyListPointer->NotifyPtrs,
-          sizeof (PEI_PPI_LIST_POINTERS) * CallbackNotifyListPointer->MaxCount
-          );
-        CallbackNotifyListPointer->NotifyPtrs = TempPtr;
-        CallbackNotifyListPointer->MaxCount = CallbackNotifyListPointer->MaxCount + CALLBACK_NOTIFY_GROWTH_STEP;
+        GrowPpiList (&CallbackNotifyListPointer->NotifyPtrs, &CallbackNotifyListPointer->MaxCount, CALLBACK_NOTIFY_GROWTH_STEP);
       }
       CallbackNotifyListPointer->NotifyPtrs[CallbackNotifyIndex].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
       CallbackNotifyIndex++;
@@ -790,17 +993,7 @@ InternalPeiNotifyPpi (
         //
         // Run out of room, grow the buffer.
         //
-        TempPtr = AllocateZeroPool (
-                    sizeof (PEI_PPI_LIST_POINTERS) * (DispatchNotifyListPointer->MaxCount + DISPATCH_NOTIFY_GROWTH_STEP)
-                    );
-        ASSERT (TempPtr != NULL);
-        CopyMem (
-          TempPtr,
-          DispatchNotifyListPointer->NotifyPtrs,
-          sizeof (PEI_PPI_LIST_POINTERS) * DispatchNotifyListPointer->MaxCount
-          );
-        DispatchNotifyListPointer->NotifyPtrs = TempPtr;
-        DispatchNotifyListPointer->MaxCount = DispatchNotifyListPointer->MaxCount + DISPATCH_NOTIFY_GROWTH_STEP;
+        GrowPpiList (&DispatchNotifyListPointer->NotifyPtrs, &DispatchNotifyListPointer->MaxCount, DISPATCH_NOTIFY_GROWTH_STEP);
       }
       DispatchNotifyListPointer->NotifyPtrs[DispatchNotifyIndex].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
       DispatchNotifyIndex++;
@@ -827,6 +1020,26 @@ InternalPeiNotifyPpi (
     NotifyList++;
   }
 
+  //
+  // Index the new notifies once they are all valid.
+  //
+  for (CallbackNotifyIndex = LastCallbackNotifyCount; CallbackNotifyIndex < CallbackNotifyListPointer->CurrentCount; CallbackNotifyIndex++) {
+    InsertPpiHash (
+      CallbackNotifyListPointer->Buckets,
+      CallbackNotifyListPointer->NotifyPtrs,
+      CallbackNotifyListPointer->MaxCount,
+      CallbackNotifyIndex
+      );
+  }
+  for (DispatchNotifyIndex = LastDispatchNotifyCount; DispatchNotifyIndex < DispatchNotifyListPointer->CurrentCount; DispatchNotifyIndex++) {
+    InsertPpiHash (
+      DispatchNotifyListPointer->Buckets,
+      DispatchNotifyListPointer->NotifyPtrs,
+      DispatchNotifyListPointer->MaxCount,
+      DispatchNotifyIndex
+      );
+  }
+
   //
   // Process any callback level notifies for all previously installed PPIs.
   //
@@ -930,10 +1143,84 @@ ProcessDispatchNotifyList (
   return;
 }
 
+/**
+
+  Returns the notify list of a notify type.
+
+  @param PrivateData        PeiCore's private data structure
+  @param NotifyType         Type of notify.
+  @param MaxCount           Returns the number of entries of the buffer of the list.
+  @param Buckets            Returns the hash buckets of the list.
+
+  @return The entries of the list.
+
+**/
+STATIC
+PEI_PPI_LIST_POINTERS *
+GetNotifyList (
+  IN  PEI_CORE_INSTANCE    *PrivateData,
+  IN  UINTN                NotifyType,
+  OUT UINTN                *MaxCount,
+  OUT PEI_PPI_HASH_BUCKET  **Buckets
+  )
+{
+  if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+    *MaxCount = PrivateData->PpiData.CallbackNotifyList.MaxCount;
+    *Buckets  = PrivateData->PpiData.CallbackNotifyList.Buckets;
+    return PrivateData->PpiData.CallbackNotifyList.NotifyPtrs;
+  }
+
+  *MaxCount = PrivateData->PpiData.DispatchNotifyList.MaxCount;
+  *Buckets  = PrivateData->PpiData.DispatchNotifyList.Buckets;
+  return PrivateData->PpiData.DispatchNotifyList.NotifyPtrs;
+}
+
+/**
+
+  Invokes a notify for the installed PPIs with its GUID.
+
+  @param PrivateData        PeiCore's private data structure
+  @param NotifyDescriptor   The notify.
+  @param InstallStartIndex  Install Beginning index.
+  @param InstallStopIndex   Install Ending index.
+
+**/
+STATIC
+VOID
+InvokeNotify (
+  IN PEI_CORE_INSTANCE          *PrivateData,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN INTN                       InstallStartIndex,
+  IN INTN                       InstallStopIndex
+  )
+{
+  INTN                          Index2;
+  EFI_GUID                      *SearchGuid;
+
+  for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
+    SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
+    if (IsPpiGuidEqual (SearchGuid, NotifyDescriptor->Guid)) {
+      DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
+        SearchGuid,
+        NotifyDescriptor->Notify
+        ));
+      NotifyDescriptor->Notify (
+                          (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
+                          NotifyDescriptor,
+                          (PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi)->Ppi
+                          );
+    }
+  }
+}
+
 /**
 
   Process notifications.
 
+  Each notify is invoked for each installed PPI with its GUID, in the order
+  of the notify list, then of the PPI list. Only the entries in the hash
+  buckets of the GUIDs of the shorter range are visited.
+
   @param PrivateData        PeiCore's private data structure
   @param NotifyType         Type of notify to fire.
   @param InstallStartIndex  Install Beginning index.
@@ -954,40 +1241,60 @@ ProcessNotify (
 {
   INTN                          Index1;
   INTN                          Index2;
-  EFI_GUID                      *SearchGuid;
-  EFI_GUID                      *CheckGuid;
+  INTN                          NextNotify;
+  UINT16                        Link;
+  PEI_PPI_LIST_POINTERS         *NotifyPtrs;
+  UINTN                         NotifyMaxCount;
+  PEI_PPI_HASH_BUCKET           *NotifyBuckets;
   EFI_PEI_NOTIFY_DESCRIPTOR     *NotifyDescriptor;
+  PEI_PPI_LIST                  *PpiListPointer;
 
-  for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
-    if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
-      NotifyDescriptor = PrivateData->PpiData.CallbackNotifyList.NotifyPtrs[Index1].Notify;
-    } else {
-      NotifyDescriptor = PrivateData->PpiData.DispatchNotifyList.NotifyPtrs[Index1].Notify;
-    }
+  PpiListPointer = &PrivateData->PpiData.PpiList;
 
-    CheckGuid = NotifyDescriptor->Guid;
+  //
+  // The notifies may install PPIs and notifies, which can move the lists,
+  // so the lists are looked up again after each notify.
+  //
+  if (NotifyStopIndex - NotifyStartIndex <= InstallStopIndex - InstallStartIndex) {
+    //
+    // Visit the PPIs in the hash bucket of each notify.
+    //
+    for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
+      NotifyPtrs = GetNotifyList (PrivateData, NotifyType, &NotifyMaxCount, &NotifyBuckets);
+      NotifyDescriptor = NotifyPtrs[Index1].Notify;
+
+      for (Link = PpiListPointer->Buckets[PpiGuidHash (NotifyDescriptor->Guid)].Head;
+           Link != 0 && Link <= InstallStopIndex;
+           Link = PPI_HASH_CHAIN (PpiListPointer->PpiPtrs, PpiListPointer->MaxCount)[Link - 1]) {
+        if (Link > InstallStartIndex) {
+          InvokeNotify (PrivateData, NotifyDescriptor, Link - 1, Link);
+        }
+      }
+    }
+  } else {
+    //
+    // Visit the notifies in the hash buckets of the PPIs, merged in the order
+    // of the notify list.
+    //
+    for (NextNotify = NotifyStartIndex; ; NextNotify = Index1 + 1) {
+      NotifyPtrs = GetNotifyList (PrivateData, NotifyType, &NotifyMaxCount, &NotifyBuckets);
+      Index1 = NotifyStopIndex;
+      for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
+        for (Link = NotifyBuckets[PpiGuidHash (PpiListPointer->PpiPtrs[Index2].Ppi->Guid)].Head;
+             Link != 0 && Link <= Index1;
+             Link = PPI_HASH_CHAIN (NotifyPtrs, NotifyMaxCount)[Link - 1]) {
+          if (Link > NextNotify) {
+            Index1 = Link - 1;
+            break;
+          }
+        }
+      }
 
-    for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
-      SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
-      //
-      // Don't use CompareGuid function here for performance reasons.
-      // Instead we compare the GUID as INT32 at a time and branch
-      // on the first failed comparison.
-      //
-      if ((((INT32 *)SearchGuid)[0] == ((INT32 *)CheckGuid)[0]) &&
-          (((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
-          (((INT32 *)SearchGuid)[2] == ((INT32 *)CheckGuid)[2]) &&
-          (((INT32 *)SearchGuid)[3] == ((INT32 *)CheckGuid)[3])) {
-        DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
-          SearchGuid,
-          NotifyDescriptor->Notify
-          ));
-        NotifyDescriptor->Notify (
-                            (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
-                            NotifyDescriptor,
-                            (PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi)->Ppi
-                            );
+      if (Index1 == NotifyStopIndex) {
+        break;
       }
+
+      InvokeNotify (PrivateData, NotifyPtrs[Index1].Notify, InstallStartIndex, InstallStopIndex);
     }
   }
 }
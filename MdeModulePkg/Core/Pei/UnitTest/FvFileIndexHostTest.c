@@ -0,0 +1,842 @@
+/** @file
+  Host based unit test of the FV file index used by the PEI Core.
+
+  The test builds an FV with a file index the way GenFv does, and checks that
+  FindFileEx() finds every file through the index. It then moves files after
+  the index was generated, or corrupts the offsets and the counts of the
+  index, and checks that FindFileEx() still finds every file, by walking the
+  FV. The FV is allocated with its exact size, so that the address sanitizer
+  of the host build reports any read outside of it.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "FwVol/FwVol.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "PEI Core FV File Index Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_FV_SIZE           SIZE_16KB
+#define TEST_FV_HEADER_LENGTH  (sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY))
+#define TEST_FILE_COUNT        20
+#define TEST_INDEX_CAPACITY    32
+#define TEST_CORRUPT_ENTRY     7
+
+///
+/// A file of the FV, other than a pad file.
+///
+typedef struct {
+  EFI_GUID         Name;
+  EFI_FV_FILETYPE  Type;
+  UINT32           Offset;
+} TEST_FILE;
+
+///
+/// The ways the test corrupts the file index.
+///
+typedef enum {
+  TestFileCountOutOfEntry,
+  TestFileCountOfUnusedEntries,
+  TestEndOffsetOutOfFv,
+  TestEntrySizeOutOfExtHeader,
+  TestExtHeaderSizeOutOfFv,
+  TestOffsetOutOfFv,
+  TestOffsetInFreeSpace,
+  TestOffsetInFvHeader,
+  TestOffsetUnaligned,
+  TestOffsetOfAnotherFile,
+  TestOffsetsOutOfOrder,
+  TestOffsetOfHeaderInFileData,
+  TestCorruptionCount
+} TEST_CORRUPTION;
+
+EFI_FIRMWARE_VOLUME_HEADER      *mFv;
+EFI_FIRMWARE_VOLUME_EXT_HEADER  *mExtHeader;
+EDKII_FV_FILE_INDEX             *mFileIndex;
+EDKII_FV_FILE_INDEX_ENTRY       *mEntries;
+UINT32                          mEndOffset;
+
+TEST_FILE                       mFiles[TEST_FILE_COUNT + 1];
+UINTN                           mFileCount;
+
+//
+// The types of the files, so that some are dispatched and some are not.
+//
+STATIC CONST EFI_FV_FILETYPE  mFileTypes[] = {
+  EFI_FV_FILETYPE_PEIM,
+  EFI_FV_FILETYPE_FREEFORM,
+  EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER,
+  EFI_FV_FILETYPE_DRIVER,
+  EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE,
+  EFI_FV_FILETYPE_RAW
+};
+
+STATIC CONST EFI_GUID  mPadFileName;
+STATIC CONST EFI_GUID  mFileNameTemplate = {
+  0x00000000, 0x6F3A, 0x4C21, { 0x9B, 0x5E, 0x30, 0xD8, 0x47, 0xA1, 0x2C, 0x96 }
+};
+
+//
+// PEI Core services and libraries used by FwVol.c out of the file lookup
+//
+CONST EFI_PEI_SERVICES **
+EFIAPI
+GetPeiServicesTablePointer (
+  VOID
+  )
+{
+  return NULL;
+}
+
+EFI_STATUS
+EFIAPI
+PeiServicesInstallPpi (
+  IN CONST EFI_PEI_PPI_DESCRIPTOR  *PpiList
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+PeiServicesReInstallPpi (
+  IN CONST EFI_PEI_PPI_DESCRIPTOR  *OldPpi,
+  IN CONST EFI_PEI_PPI_DESCRIPTOR  *NewPpi
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+PeiServicesLocatePpi (
+  IN CONST EFI_GUID              *Guid,
+  IN UINTN                       Instance,
+  IN OUT EFI_PEI_PPI_DESCRIPTOR  **PpiDescriptor, OPTIONAL
+  IN OUT VOID                    **Ppi
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+PeiServicesNotifyPpi (
+  IN CONST EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyList
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+VOID
+EFIAPI
+PeiServicesInstallFvInfoPpi (
+  IN CONST EFI_GUID  *FvFormat, OPTIONAL
+  IN CONST VOID      *FvInfo,
+  IN       UINT32    FvInfoSize,
+  IN CONST EFI_GUID  *ParentFvName, OPTIONAL
+  IN CONST EFI_GUID  *ParentFileName OPTIONAL
+  )
+{
+}
+
+VOID
+EFIAPI
+PeiServicesInstallFvInfo2Ppi (
+  IN CONST EFI_GUID  *FvFormat, OPTIONAL
+  IN CONST VOID      *FvInfo,
+  IN       UINT32    FvInfoSize,
+  IN CONST EFI_GUID  *ParentFvName, OPTIONAL
+  IN CONST EFI_GUID  *ParentFileName, OPTIONAL
+  IN       UINT32    AuthenticationStatus
+  )
+{
+}
+
+VOID *
+EFIAPI
+GetHobList (
+  VOID
+  )
+{
+  return NULL;
+}
+
+VOID *
+EFIAPI
+GetNextHob (
+  IN UINT16      Type,
+  IN CONST VOID  *HobStart
+  )
+{
+  return NULL;
+}
+
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  return NULL;
+}
+
+VOID
+EFIAPI
+BuildFvHob (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length
+  )
+{
+}
+
+VOID
+EFIAPI
+BuildFv2Hob (
+  IN       EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN       UINT64                Length,
+  IN CONST EFI_GUID              *FvName,
+  IN CONST EFI_GUID              *FileName
+  )
+{
+}
+
+VOID
+EFIAPI
+BuildFv3Hob (
+  IN       EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN       UINT64                Length,
+  IN       UINT32                AuthenticationStatus,
+  IN       BOOLEAN               ExtractedFv,
+  IN CONST EFI_GUID              *FvName, OPTIONAL
+  IN CONST EFI_GUID              *FileName OPTIONAL
+  )
+{
+}
+
+BOOLEAN
+PeimDispatchReadiness (
+  IN EFI_PEI_SERVICES  **PeiServices,
+  IN VOID              *DependencyExpression
+  )
+{
+  return FALSE;
+}
+
+EFI_STATUS
+VerifyFv (
+  IN EFI_FIRMWARE_VOLUME_HEADER  *CurrentFvAddress
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+VerifyPeim (
+  IN PEI_CORE_INSTANCE    *PrivateData,
+  IN EFI_PEI_FV_HANDLE    VolumeHandle,
+  IN EFI_PEI_FILE_HANDLE  FileHandle,
+  IN UINT32               AuthenticationStatus
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes the header of a file of the FV, with a valid header checksum.
+
+  @param  FileHeader             The header to write.
+  @param  Name                   The name of the file.
+  @param  Type                   The type of the file.
+  @param  FileSize               The size of the file, header included.
+  @param  Attributes             The attributes of the file.
+
+**/
+VOID
+WriteFileHeader (
+  OUT EFI_FFS_FILE_HEADER      *FileHeader,
+  IN  CONST EFI_GUID           *Name,
+  IN  EFI_FV_FILETYPE          Type,
+  IN  UINT32                   FileSize,
+  IN  EFI_FFS_FILE_ATTRIBUTES  Attributes
+  )
+{
+  ZeroMem (FileHeader, sizeof (EFI_FFS_FILE_HEADER));
+  CopyGuid (&FileHeader->Name, Name);
+  FileHeader->Type       = Type;
+  FileHeader->Attributes = Attributes;
+  FileHeader->Size[0]    = (UINT8) FileSize;
+  FileHeader->Size[1]    = (UINT8) (FileSize >> 8);
+  FileHeader->Size[2]    = (UINT8) (FileSize >> 16);
+  FileHeader->IntegrityCheck.Checksum.Header = CalculateCheckSum8 ((UINT8 *) FileHeader, sizeof (EFI_FFS_FILE_HEADER));
+  FileHeader->IntegrityCheck.Checksum.File   = FFS_FIXED_CHECKSUM;
+  FileHeader->State = (EFI_FFS_FILE_STATE) ~(EFI_FILE_HEADER_CONSTRUCTION | EFI_FILE_HEADER_VALID | EFI_FILE_DATA_VALID);
+}
+
+/**
+  Writes a file in the FV.
+
+  @param  Offset                 The offset of the file from the FV header.
+  @param  Name                   The name of the file.
+  @param  Type                   The type of the file.
+  @param  DataSize               The size of the data of the file.
+  @param  Checksum               TRUE to checksum the data of the file.
+
+  @return The header of the file.
+
+**/
+EFI_FFS_FILE_HEADER *
+WriteFile (
+  IN UINT32           Offset,
+  IN CONST EFI_GUID   *Name,
+  IN EFI_FV_FILETYPE  Type,
+  IN UINT32           DataSize,
+  IN BOOLEAN          Checksum
+  )
+{
+  EFI_FFS_FILE_HEADER  *FileHeader;
+
+  FileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) mFv + Offset);
+  WriteFileHeader (FileHeader, Name, Type, sizeof (EFI_FFS_FILE_HEADER) + DataSize, Checksum ? FFS_ATTRIB_CHECKSUM : 0);
+  SetMem (FileHeader + 1, DataSize, (UINT8) Offset);
+  if (Checksum) {
+    FileHeader->IntegrityCheck.Checksum.File = CalculateCheckSum8 ((UINT8 *) (FileHeader + 1), DataSize);
+  }
+
+  return FileHeader;
+}
+
+/**
+  Appends a file to the files of the FV.
+
+  @param  Name                   The name of the file.
+  @param  Type                   The type of the file.
+  @param  DataSize               The size of the data of the file.
+  @param  Checksum               TRUE to checksum the data of the file.
+
+  @return The header of the file.
+
+**/
+EFI_FFS_FILE_HEADER *
+AppendFile (
+  IN CONST EFI_GUID   *Name,
+  IN EFI_FV_FILETYPE  Type,
+  IN UINT32           DataSize,
+  IN BOOLEAN          Checksum
+  )
+{
+  EFI_FFS_FILE_HEADER  *FileHeader;
+
+  FileHeader = WriteFile (mEndOffset, Name, Type, DataSize, Checksum);
+  if (Type != EFI_FV_FILETYPE_FFS_PAD) {
+    CopyGuid (&mFiles[mFileCount].Name, Name);
+    mFiles[mFileCount].Type   = Type;
+    mFiles[mFileCount].Offset = mEndOffset;
+    mFileCount++;
+  }
+
+  mEndOffset += ALIGN_VALUE (sizeof (EFI_FFS_FILE_HEADER) + DataSize, 8);
+  return FileHeader;
+}
+
+/**
+  Builds an FV with a file index, the way GenFv does: the extension header is
+  in a pad file at the start of the FV and reserves the index, which is filled
+  in once the files are placed.
+
+  The files are the apriori file, then files of each type, of a few sizes,
+  with and without a data checksum, and a pad file after every fifth file.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The FV is built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BuildFv (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_FFS_FILE_HEADER  *PadFile;
+  UINT32               ExtHeaderSize;
+  EFI_GUID             Name;
+  UINTN                Index;
+
+  mFv = AllocatePool (TEST_FV_SIZE);
+  UT_ASSERT_NOT_NULL (mFv);
+
+  SetMem (mFv, TEST_FV_SIZE, 0xFF);
+  ZeroMem (mFv, TEST_FV_HEADER_LENGTH);
+  CopyGuid (&mFv->FileSystemGuid, &gEfiFirmwareFileSystem2Guid);
+  mFv->FvLength               = TEST_FV_SIZE;
+  mFv->Signature              = EFI_FVH_SIGNATURE;
+  mFv->Attributes             = EFI_FVB2_READ_STATUS | EFI_FVB2_MEMORY_MAPPED | EFI_FVB2_ERASE_POLARITY;
+  mFv->HeaderLength           = TEST_FV_HEADER_LENGTH;
+  mFv->Revision               = EFI_FVH_REVISION;
+  mFv->BlockMap[0].NumBlocks  = TEST_FV_SIZE / SIZE_4KB;
+  mFv->BlockMap[0].Length     = SIZE_4KB;
+  mEndOffset = TEST_FV_HEADER_LENGTH;
+  mFileCount = 0;
+
+  ExtHeaderSize = sizeof (EFI_FIRMWARE_VOLUME_EXT_HEADER) + sizeof (EDKII_FV_FILE_INDEX) +
+                  TEST_INDEX_CAPACITY * sizeof (EDKII_FV_FILE_INDEX_ENTRY);
+  PadFile    = AppendFile (&mPadFileName, EFI_FV_FILETYPE_FFS_PAD, ExtHeaderSize, FALSE);
+  mExtHeader = (EFI_FIRMWARE_VOLUME_EXT_HEADER *) (PadFile + 1);
+  mFileIndex = (EDKII_FV_FILE_INDEX *) (mExtHeader + 1);
+  mEntries   = (EDKII_FV_FILE_INDEX_ENTRY *) (mFileIndex + 1);
+  ZeroMem (mExtHeader, ExtHeaderSize);
+  mExtHeader->ExtHeaderSize    = ExtHeaderSize;
+  mFileIndex->Hdr.ExtEntrySize = (UINT16) (ExtHeaderSize - sizeof (EFI_FIRMWARE_VOLUME_EXT_HEADER));
+  mFileIndex->Hdr.ExtEntryType = EFI_FV_EXT_TYPE_GUID_TYPE;
+  CopyGuid (&mFileIndex->FormatType, &gEdkiiFvFileIndexGuid);
+  mFv->ExtHeaderOffset = (UINT16) ((UINT8 *) mExtHeader - (UINT8 *) mFv);
+
+  AppendFile (&gPeiAprioriFileNameGuid, EFI_FV_FILETYPE_FREEFORM, 16, TRUE);
+  CopyGuid (&Name, &mFileNameTemplate);
+  for (Index = 1; Index < TEST_FILE_COUNT; Index++) {
+    Name.Data1 = (UINT32) Index;
+    AppendFile (&Name, mFileTypes[Index % ARRAY_SIZE (mFileTypes)], 8 + (Index % 4) * 40, (BOOLEAN) (Index % 2 == 0));
+    if (Index % 5 == 0) {
+      AppendFile (&mPadFileName, EFI_FV_FILETYPE_FFS_PAD, 16, FALSE);
+    }
+  }
+
+  for (Index = 0; Index < mFileCount; Index++) {
+    CopyGuid (&mEntries[Index].Name, &mFiles[Index].Name);
+    mEntries[Index].Offset = mFiles[Index].Offset;
+    mEntries[Index].Type   = mFiles[Index].Type;
+  }
+  mFileIndex->FileCount = (UINT32) mFileCount;
+  mFileIndex->EndOffset = mEndOffset;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the FV of the test.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeFv (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePool (mFv);
+  mFv = NULL;
+}
+
+/**
+  Returns the header of a file of the test.
+
+  @param  Index                  The index of the file in mFiles.
+
+  @return The header of the file.
+
+**/
+EFI_PEI_FILE_HANDLE
+TestFileHandle (
+  IN UINTN  Index
+  )
+{
+  return (EFI_PEI_FILE_HANDLE) ((UINT8 *) mFv + mFiles[Index].Offset);
+}
+
+/**
+  Checks that FindFileEx() finds every file by name, every file in order by
+  type, and the files to dispatch and the apriori file, as a walk of the FV
+  finds them.
+
+  @retval UNIT_TEST_PASSED       Every file is found.
+
+**/
+UNIT_TEST_STATUS
+CheckFindFile (
+  VOID
+  )
+{
+  EFI_STATUS           Status;
+  EFI_PEI_FILE_HANDLE  FileHandle;
+  EFI_PEI_FILE_HANDLE  AprioriFile;
+  EFI_GUID             Name;
+  UINTN                Index;
+
+  for (Index = 0; Index < mFileCount; Index++) {
+    FileHandle = NULL;
+    Status     = FindFileEx (mFv, &mFiles[Index].Name, EFI_FV_FILETYPE_ALL, &FileHandle, NULL);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL ((UINTN) FileHandle, (UINTN) TestFileHandle (Index));
+  }
+
+  CopyGuid (&Name, &mFileNameTemplate);
+  Name.Data1 = MAX_UINT32;
+  FileHandle = NULL;
+  Status     = FindFileEx (mFv, &Name, EFI_FV_FILETYPE_ALL, &FileHandle, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  FileHandle = NULL;
+  for (Index = 0; Index < mFileCount; Index++) {
+    Status = FindFileEx (mFv, NULL, EFI_FV_FILETYPE_ALL, &FileHandle, NULL);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL ((UINTN) FileHandle, (UINTN) TestFileHandle (Index));
+  }
+  Status = FindFileEx (mFv, NULL, EFI_FV_FILETYPE_ALL, &FileHandle, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  FileHandle  = NULL;
+  AprioriFile = NULL;
+  for (Index = 0; Index < mFileCount; Index++) {
+    if ((mFiles[Index].Type != EFI_FV_FILETYPE_PEIM) &&
+        (mFiles[Index].Type != EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) &&
+        (mFiles[Index].Type != EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+      continue;
+    }
+    Status = FindFileEx (mFv, NULL, PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE, &FileHandle, &AprioriFile);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL ((UINTN) FileHandle, (UINTN) TestFileHandle (Index));
+  }
+  Status = FindFileEx (mFv, NULL, PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE, &FileHandle, &AprioriFile);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL ((UINTN) AprioriFile, (UINTN) TestFileHandle (0));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Searches the file index for a file of the test by name.
+
+  @param  Index                  The index of the file in mFiles.
+
+  @return The status returned by FindFileInIndex().
+
+**/
+EFI_STATUS
+FindTestFileInIndex (
+  IN UINTN  Index
+  )
+{
+  EFI_FFS_FILE_HEADER  *FileHeader;
+
+  FileHeader = NULL;
+  return FindFileInIndex (mFv, mFileIndex, 1, FALSE, &mFiles[Index].Name, EFI_FV_FILETYPE_ALL, &FileHeader, NULL);
+}
+
+/**
+  Checks that the file index of the FV finds every file.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every file is found through the index.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ValidIndexFindsEveryFile (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_FFS_FILE_HEADER  *FileHeader;
+  UINTN                Index;
+
+  UT_ASSERT_EQUAL ((UINTN) GetFvFileIndex (mFv, 1), (UINTN) mFileIndex);
+
+  for (Index = 0; Index < mFileCount; Index++) {
+    FileHeader = NULL;
+    UT_ASSERT_NOT_EFI_ERROR (
+      FindFileInIndex (mFv, mFileIndex, 1, FALSE, &mFiles[Index].Name, EFI_FV_FILETYPE_ALL, &FileHeader, NULL)
+      );
+    UT_ASSERT_EQUAL ((UINTN) FileHeader, (UINTN) TestFileHandle (Index));
+  }
+
+  UT_ASSERT_EQUAL (CheckFindFile (), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Swaps two files of the same size in the FV after the index was generated,
+  and checks that the index no longer finds them, and that FindFileEx()
+  finds them by walking the FV.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The moved files are found.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MovedFilesAreFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8      Buffer[SIZE_1KB];
+  UINT8      *First;
+  UINT8      *Second;
+  UINTN      Size;
+  TEST_FILE  File;
+
+  First  = (UINT8 *) TestFileHandle (4);
+  Second = (UINT8 *) TestFileHandle (8);
+  Size   = FFS_FILE_SIZE ((EFI_FFS_FILE_HEADER *) First);
+  UT_ASSERT_EQUAL (FFS_FILE_SIZE ((EFI_FFS_FILE_HEADER *) Second), Size);
+  UT_ASSERT_TRUE (Size <= sizeof (Buffer));
+
+  CopyMem (Buffer, First, Size);
+  CopyMem (First, Second, Size);
+  CopyMem (Second, Buffer, Size);
+
+  CopyMem (&File, &mFiles[4], sizeof (File));
+  CopyMem (&mFiles[4], &mFiles[8], sizeof (File));
+  CopyMem (&mFiles[8], &File, sizeof (File));
+  mFiles[8].Offset = mFiles[4].Offset;
+  mFiles[4].Offset = File.Offset;
+
+  UT_ASSERT_EQUAL ((UINTN) GetFvFileIndex (mFv, 1), (UINTN) mFileIndex);
+  UT_ASSERT_STATUS_EQUAL (FindTestFileInIndex (4), EFI_VOLUME_CORRUPTED);
+  UT_ASSERT_STATUS_EQUAL (FindTestFileInIndex (8), EFI_VOLUME_CORRUPTED);
+
+  UT_ASSERT_EQUAL (CheckFindFile (), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Inserts a pad file in the FV after the index was generated, which moves the
+  files after it, and checks that FindFileEx() finds every file.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The moved files are found.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ShiftedFilesAreFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT32  Offset;
+  UINTN   Index;
+
+  Offset = mFiles[TEST_CORRUPT_ENTRY].Offset;
+  CopyMem ((UINT8 *) mFv + Offset + sizeof (EFI_FFS_FILE_HEADER), (UINT8 *) mFv + Offset, mEndOffset - Offset);
+  WriteFile (Offset, &mPadFileName, EFI_FV_FILETYPE_FFS_PAD, 0, FALSE);
+  for (Index = TEST_CORRUPT_ENTRY; Index < mFileCount; Index++) {
+    mFiles[Index].Offset += sizeof (EFI_FFS_FILE_HEADER);
+  }
+  mEndOffset += sizeof (EFI_FFS_FILE_HEADER);
+
+  if (GetFvFileIndex (mFv, 1) != NULL) {
+    UT_ASSERT_STATUS_EQUAL (FindTestFileInIndex (TEST_CORRUPT_ENTRY), EFI_VOLUME_CORRUPTED);
+  }
+
+  UT_ASSERT_EQUAL (CheckFindFile (), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Appends a file to the FV after the index was generated, and checks that the
+  index is not used, as it does not list the file.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The appended file is found.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AppendedFileIsFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_GUID  Name;
+
+  CopyGuid (&Name, &mFileNameTemplate);
+  Name.Data1 = TEST_FILE_COUNT;
+  AppendFile (&Name, EFI_FV_FILETYPE_PEIM, 100, TRUE);
+
+  UT_ASSERT_TRUE (GetFvFileIndex (mFv, 1) == NULL);
+  UT_ASSERT_EQUAL (CheckFindFile (), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Corrupts the file index in each of the ways of TEST_CORRUPTION, in a new FV
+  each time, and checks that the index is not used, or that it reports that
+  it does not match the FV, and that FindFileEx() finds every file.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every file is found despite the corruption.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CorruptIndexIsNotTrusted (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CORRUPTION      Corruption;
+  UINTN                Entry;
+  UINT32               Offset;
+  EFI_FFS_FILE_HEADER  *FileHeader;
+  BOOLEAN              Usable;
+
+  for (Corruption = 0; Corruption < TestCorruptionCount; Corruption++) {
+    if (Corruption != 0) {
+      FreeFv (NULL);
+      UT_ASSERT_EQUAL (BuildFv (NULL), UNIT_TEST_PASSED);
+    }
+
+    Entry  = TEST_CORRUPT_ENTRY;
+    Usable = TRUE;
+    switch (Corruption) {
+      case TestFileCountOutOfEntry:
+        mFileIndex->FileCount = TEST_INDEX_CAPACITY + 1;
+        Usable = FALSE;
+        break;
+      case TestFileCountOfUnusedEntries:
+        mFileIndex->FileCount = TEST_INDEX_CAPACITY;
+        Entry = mFileCount;
+        break;
+      case TestEndOffsetOutOfFv:
+        mFileIndex->EndOffset = TEST_FV_SIZE + 8;
+        Usable = FALSE;
+        break;
+      case TestEntrySizeOutOfExtHeader:
+        mFileIndex->Hdr.ExtEntrySize += 8;
+        Usable = FALSE;
+        break;
+      case TestExtHeaderSizeOutOfFv:
+        mExtHeader->ExtHeaderSize = TEST_FV_SIZE;
+        Usable = FALSE;
+        break;
+      case TestOffsetOutOfFv:
+        mEntries[Entry].Offset = MAX_UINT32 & ~0x07;
+        break;
+      case TestOffsetInFreeSpace:
+        mEntries[Entry].Offset = mEndOffset + 64;
+        break;
+      case TestOffsetInFvHeader:
+        mEntries[Entry].Offset = 8;
+        break;
+      case TestOffsetUnaligned:
+        mEntries[Entry].Offset += 4;
+        break;
+      case TestOffsetOfAnotherFile:
+        mEntries[Entry].Offset = mEntries[Entry + 1].Offset;
+        break;
+      case TestOffsetsOutOfOrder:
+        Offset                     = mEntries[Entry].Offset;
+        mEntries[Entry].Offset     = mEntries[Entry + 1].Offset;
+        mEntries[Entry + 1].Offset = Offset;
+        break;
+      case TestOffsetOfHeaderInFileData:
+        //
+        // A header in the data of the last file, for the name and the type
+        // of the last file, whose size runs past the end of the FV.
+        //
+        Entry = mFileCount - 1;
+        UT_ASSERT_TRUE (FFS_FILE_SIZE ((EFI_FFS_FILE_HEADER *) TestFileHandle (Entry)) >= 2 * sizeof (EFI_FFS_FILE_HEADER));
+        FileHeader = (EFI_FFS_FILE_HEADER *) TestFileHandle (Entry) + 1;
+        WriteFileHeader (FileHeader, &mFiles[Entry].Name, mFiles[Entry].Type, 0xFFFFF8, FFS_ATTRIB_CHECKSUM);
+        mEntries[Entry].Offset = (UINT32) ((UINT8 *) FileHeader - (UINT8 *) mFv);
+        break;
+      default:
+        break;
+    }
+
+    if (!Usable) {
+      UT_ASSERT_TRUE (GetFvFileIndex (mFv, 1) == NULL);
+    } else {
+      UT_ASSERT_EQUAL ((UINTN) GetFvFileIndex (mFv, 1), (UINTN) mFileIndex);
+      if (Entry < mFileCount) {
+        UT_ASSERT_STATUS_EQUAL (FindTestFileInIndex (Entry), EFI_VOLUME_CORRUPTED);
+      } else {
+        FileHeader = (EFI_FFS_FILE_HEADER *) TestFileHandle (mFileCount - 1);
+        UT_ASSERT_STATUS_EQUAL (
+          FindFileInIndex (mFv, mFileIndex, 1, FALSE, NULL, EFI_FV_FILETYPE_ALL, &FileHeader, NULL),
+          EFI_VOLUME_CORRUPTED
+          );
+      }
+    }
+
+    //
+    // The walk starts after the extension header, so it can not find the
+    // files when the extension header does not fit in the FV.
+    //
+    if (Corruption != TestExtHeaderSizeOutOfFv) {
+      UT_ASSERT_EQUAL (CheckFindFile (), UNIT_TEST_PASSED);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the FV file
+  index and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      FileIndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&FileIndexTests, Framework, "FV File Index", "PeiCore.FwVol", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for FileIndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-----------Description----------------------------------------Class Name-------------------Function------------------Pre------Post----Context
+  AddTestCase (FileIndexTests, "A valid index finds every file", "ValidIndexFindsEveryFile", ValidIndexFindsEveryFile, BuildFv, FreeFv, NULL);
+  AddTestCase (FileIndexTests, "Files swapped after the index are found", "MovedFilesAreFound", MovedFilesAreFound, BuildFv, FreeFv, NULL);
+  AddTestCase (FileIndexTests, "Files moved after the index are found", "ShiftedFilesAreFound", ShiftedFilesAreFound, BuildFv, FreeFv, NULL);
+  AddTestCase (FileIndexTests, "A file appended after the index is found", "AppendedFileIsFound", AppendedFileIsFound, BuildFv, FreeFv, NULL);
+  AddTestCase (FileIndexTests, "A corrupt index is not trusted", "CorruptIndexIsNotTrusted", CorruptIndexIsNotTrusted, BuildFv, FreeFv, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,552 @@
+/** @file
+  Host based unit test of the HOB index built by the PEI Core.
+
+  The test grows a HOB list with GUID extension HOBs and memory allocation
+  HOBs, and updates the HOB index as the PEI Dispatcher does after each PEIM.
+  It checks that the index has every GUID extension HOB in order, that it is
+  moved to a larger buffer a logarithmic number of times and that the old
+  buffer is freed, that the HOBs freed since they were indexed are dropped
+  when the index is moved, and that a failed allocation leaves the previous
+  index usable.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "PeiMain.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "PEI Core HOB Index Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_HOB_LIST_SIZE     SIZE_1MB
+#define TEST_ROUNDS            60
+#define TEST_MAX_ALLOCATIONS   8
+
+///
+/// Pages allocated by PeiAllocatePages() and not freed yet.
+///
+typedef struct {
+  EFI_PHYSICAL_ADDRESS  Memory;
+  UINTN                 Pages;
+} TEST_ALLOCATION;
+
+PEI_CORE_INSTANCE       mPrivateData;
+CONST EFI_PEI_SERVICES  **mPeiServices;
+
+VOID                    *mHobBuffer;
+UINTN                   mHobCount;
+
+TEST_ALLOCATION         mAllocations[TEST_MAX_ALLOCATIONS];
+UINTN                   mAllocationCount;
+UINTN                   mFreeCount;
+BOOLEAN                 mFailAllocations;
+
+//
+// The GUIDs of the GUID extension HOBs of the test. The lookups in the GUID
+// slots are tested with BaseHobIndexLib, so a few GUIDs are enough.
+//
+STATIC EFI_GUID  mGuids[] = {
+  { 0x3F0C9A41, 0x7B2E, 0x4D58, { 0x8E, 0x14, 0x5A, 0x9B, 0x06, 0xC2, 0x73, 0xD1 } },
+  { 0xA6E21D07, 0x1C93, 0x4F6A, { 0x92, 0x3D, 0xB8, 0x40, 0x7E, 0x15, 0xCA, 0x68 } },
+  { 0x58B74E2C, 0xD0F5, 0x4193, { 0xA7, 0x6B, 0x21, 0xE8, 0x3C, 0x9F, 0x04, 0x5E } }
+};
+
+//
+// PEI Core services used by the code under test
+//
+EFI_STATUS
+EFIAPI
+PeiAllocatePages (
+  IN CONST EFI_PEI_SERVICES     **PeiServices,
+  IN       EFI_MEMORY_TYPE      MemoryType,
+  IN       UINTN                Pages,
+  OUT      EFI_PHYSICAL_ADDRESS *Memory
+  )
+{
+  VOID  *Buffer;
+
+  if (mFailAllocations || mAllocationCount == TEST_MAX_ALLOCATIONS) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Buffer = AllocateZeroPool (EFI_PAGES_TO_SIZE (Pages));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Memory = (EFI_PHYSICAL_ADDRESS) (UINTN) Buffer;
+  mAllocations[mAllocationCount].Memory = *Memory;
+  mAllocations[mAllocationCount].Pages  = Pages;
+  mAllocationCount++;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+PeiFreePages (
+  IN CONST EFI_PEI_SERVICES     **PeiServices,
+  IN EFI_PHYSICAL_ADDRESS       Memory,
+  IN UINTN                      Pages
+  )
+{
+  UINTN  Index;
+
+  //
+  // Only the pages of a previous allocation, with its size, can be freed.
+  //
+  for (Index = 0; Index < mAllocationCount; Index++) {
+    if (mAllocations[Index].Memory == Memory && mAllocations[Index].Pages == Pages) {
+      FreePool ((VOID *) (UINTN) Memory);
+      mAllocations[Index] = mAllocations[--mAllocationCount];
+      mFreeCount++;
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Returns the HOB index that the second HOB of the HOB list points to.
+
+  @return The HOB index, or NULL if it is not built yet.
+
+**/
+EDKII_HOB_INDEX *
+GetHobIndex (
+  VOID
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+
+  Hob.Raw = mPrivateData.HobList.Raw;
+  Hob.Raw = GET_NEXT_HOB (Hob);
+  return (EDKII_HOB_INDEX *) (UINTN) ReadUnaligned64 (GET_GUID_HOB_DATA (Hob));
+}
+
+/**
+  Adds HOBs to the HOB list. Every third HOB is a memory allocation HOB, which
+  is not indexed. The other HOBs are GUID extension HOBs of the GUIDs of the
+  test in turn, of varying sizes.
+
+  @param  Count                  The number of HOBs to add.
+
+  @retval UNIT_TEST_PASSED       The HOBs are added.
+
+**/
+UNIT_TEST_STATUS
+AddHobs (
+  IN UINTN  Count
+  )
+{
+  EFI_STATUS         Status;
+  EFI_HOB_GUID_TYPE  *GuidHob;
+  VOID               *Hob;
+
+  for (; Count > 0; Count--, mHobCount++) {
+    if (mHobCount % 3 == 0) {
+      Status = PeiCreateHob (mPeiServices, EFI_HOB_TYPE_MEMORY_ALLOCATION, sizeof (EFI_HOB_MEMORY_ALLOCATION), &Hob);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+    } else {
+      Status = PeiCreateHob (mPeiServices, EFI_HOB_TYPE_GUID_EXTENSION, (UINT16) (sizeof (EFI_HOB_GUID_TYPE) + 8 * (mHobCount % 4)), (VOID **) &GuidHob);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      CopyGuid (&GuidHob->Name, &mGuids[mHobCount % ARRAY_SIZE (mGuids)]);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that looking up every GUID of the test in the HOB index, from the
+  start of the HOB list, finds its first GUID extension HOB.
+
+  @param  Index                  The HOB index.
+
+  @retval UNIT_TEST_PASSED       Every lookup finds the first HOB of its GUID.
+
+**/
+UNIT_TEST_STATUS
+CheckHobIndexLookups (
+  IN EDKII_HOB_INDEX  *Index
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  EFI_PEI_HOB_POINTERS  Expected;
+  UINTN                 Guid;
+  BOOLEAN               Found;
+
+  for (Guid = 0; Guid < ARRAY_SIZE (mGuids); Guid++) {
+    for (Expected.Raw = mPrivateData.HobList.Raw; !END_OF_HOB_LIST (Expected); Expected.Raw = GET_NEXT_HOB (Expected)) {
+      if (Expected.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION && CompareGuid (&Expected.Guid->Name, &mGuids[Guid])) {
+        break;
+      }
+    }
+
+    Hob.Raw = LookupHobIndex (Index, EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[Guid], mPrivateData.HobList.Raw, &Found);
+    if (END_OF_HOB_LIST (Expected)) {
+      UT_ASSERT_FALSE (Found);
+    } else {
+      UT_ASSERT_TRUE (Found);
+      UT_ASSERT_EQUAL ((UINTN) Hob.Raw, (UINTN) Expected.Raw);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOB index has every GUID extension HOB of the HOB list, in
+  order, and nothing else.
+
+  @param  Index                  The HOB index.
+
+  @retval UNIT_TEST_PASSED       The HOB index is complete.
+
+**/
+UNIT_TEST_STATUS
+CheckHobIndex (
+  IN EDKII_HOB_INDEX  *Index
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  UINT32                Entry;
+
+  UT_ASSERT_NOT_NULL (Index);
+  UT_ASSERT_TRUE (IsHobIndexValid (Index, mPrivateData.HobList.Raw));
+  UT_ASSERT_EQUAL (Index->TypeMask, BIT0 << EFI_HOB_TYPE_GUID_EXTENSION);
+  UT_ASSERT_TRUE (Index->EntryCount <= Index->EntryCapacity);
+  UT_ASSERT_TRUE (Index->GuidSlotCount >= 2 * Index->EntryCapacity);
+
+  Entry = 0;
+  for (Hob.Raw = mPrivateData.HobList.Raw; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      UT_ASSERT_TRUE (Entry < Index->EntryCount);
+      UT_ASSERT_EQUAL ((UINTN) Index->Entries[Entry].Hob, (UINTN) Hob.Raw);
+      Entry++;
+    }
+  }
+
+  UT_ASSERT_EQUAL (Entry, Index->EntryCount);
+  UT_ASSERT_EQUAL ((UINTN) Index->IndexedEnd, (UINTN) Hob.Raw);
+
+  return CheckHobIndexLookups (Index);
+}
+
+/**
+  Builds a HOB list in permanent memory with the PHIT HOB and the HOB that
+  points to the HOB index, as the PEI Core does.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB list is built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mHobCount        = 0;
+  mAllocationCount = 0;
+  mFreeCount       = 0;
+  mFailAllocations = FALSE;
+
+  mHobBuffer = AllocateZeroPool (TEST_HOB_LIST_SIZE);
+  UT_ASSERT_NOT_NULL (mHobBuffer);
+
+  ZeroMem (&mPrivateData, sizeof (mPrivateData));
+  mPrivateData.Signature          = PEI_CORE_HANDLE_SIGNATURE;
+  mPrivateData.PeiMemoryInstalled = TRUE;
+  mPeiServices = (CONST EFI_PEI_SERVICES **) &mPrivateData.Ps;
+
+  PeiCoreBuildHobHandoffInfoTable (BOOT_WITH_FULL_CONFIGURATION, (EFI_PHYSICAL_ADDRESS) (UINTN) mHobBuffer, TEST_HOB_LIST_SIZE);
+  mPrivateData.HobList.Raw = mHobBuffer;
+  UT_ASSERT_EQUAL ((UINTN) GetHobIndex (), (UINTN) NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the HOB list and the HOB index of the test.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  while (mAllocationCount > 0) {
+    PeiFreePages (mPeiServices, mAllocations[0].Memory, mAllocations[0].Pages);
+  }
+  FreePool (mHobBuffer);
+}
+
+/**
+  Checks that the HOB index has every GUID extension HOB as the HOB list
+  grows, and that it is moved a logarithmic number of times, each time to a
+  buffer at least twice as large, the previous buffer being freed.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB index grows with the HOB list.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexGrowsWithHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_HOB_INDEX  *Index;
+  EDKII_HOB_INDEX  *PreviousIndex;
+  UINT32           PreviousCapacity;
+  UINTN            Round;
+  UINTN            Moves;
+
+  PreviousIndex    = NULL;
+  PreviousCapacity = 0;
+  Moves            = 0;
+  for (Round = 0; Round < TEST_ROUNDS; Round++) {
+    UT_ASSERT_EQUAL (AddHobs (2 * Round + 1), UNIT_TEST_PASSED);
+    PeiCoreUpdateHobIndex (&mPrivateData);
+
+    Index = GetHobIndex ();
+    UT_ASSERT_EQUAL (CheckHobIndex (Index), UNIT_TEST_PASSED);
+    UT_ASSERT_EQUAL (mAllocationCount, 1);
+    UT_ASSERT_EQUAL (mAllocations[0].Memory, (EFI_PHYSICAL_ADDRESS) (UINTN) Index);
+    UT_ASSERT_TRUE (EFI_PAGES_TO_SIZE (mAllocations[0].Pages) >= GetHobIndexSize (Index->EntryCapacity, Index->GuidSlotCount));
+
+    if (Index != PreviousIndex) {
+      UT_ASSERT_TRUE (Index->EntryCapacity >= 2 * PreviousCapacity);
+      UT_ASSERT_EQUAL (mFreeCount, Moves);
+      Moves++;
+    } else {
+      UT_ASSERT_EQUAL (Index->EntryCapacity, PreviousCapacity);
+    }
+
+    PreviousIndex    = Index;
+    PreviousCapacity = Index->EntryCapacity;
+  }
+
+  UT_ASSERT_TRUE (Moves > 2);
+  UT_ASSERT_TRUE (Moves <= HighBitSet32 (PreviousCapacity));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOBs freed after they were indexed are dropped when the HOB
+  index is moved, and skipped until then.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The freed HOBs are dropped.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FreedHobsAreDropped (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_HOB_INDEX       *Index;
+  EFI_PEI_HOB_POINTERS  Hob;
+  UINTN                 Count;
+
+  UT_ASSERT_EQUAL (AddHobs (100), UNIT_TEST_PASSED);
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  Index = GetHobIndex ();
+  UT_ASSERT_NOT_NULL (Index);
+
+  //
+  // Free every other GUID extension HOB but the one that points to the index.
+  //
+  Count   = 0;
+  Hob.Raw = mPrivateData.HobList.Raw;
+  Hob.Raw = GET_NEXT_HOB (Hob);
+  for (Hob.Raw = GET_NEXT_HOB (Hob); !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION && Count++ % 2 == 0) {
+      Hob.Header->HobType = EFI_HOB_TYPE_UNUSED;
+    }
+  }
+
+  //
+  // The index still has the freed HOBs, and its lookups skip them.
+  //
+  UT_ASSERT_EQUAL (CheckHobIndexLookups (Index), UNIT_TEST_PASSED);
+
+  //
+  // Add HOBs until the index is moved.
+  //
+  while (GetHobIndex () == Index) {
+    UT_ASSERT_EQUAL (AddHobs (Index->EntryCapacity / 4), UNIT_TEST_PASSED);
+    PeiCoreUpdateHobIndex (&mPrivateData);
+  }
+
+  UT_ASSERT_EQUAL (CheckHobIndex (GetHobIndex ()), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mAllocationCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOB index stays usable when a larger buffer cannot be
+  allocated for it, and that the HOBs it has no room for are indexed once a
+  larger buffer can be allocated.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB index survives allocation failures.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocationFailureKeepsIndex (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_HOB_INDEX  *Index;
+  VOID             *IndexedEnd;
+  UINT32           EntryCount;
+  VOID             *Hob;
+  BOOLEAN          Found;
+
+  //
+  // Without memory for the first index, the HOB list has no index.
+  //
+  mFailAllocations = TRUE;
+  UT_ASSERT_EQUAL (AddHobs (10), UNIT_TEST_PASSED);
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  UT_ASSERT_EQUAL ((UINTN) GetHobIndex (), (UINTN) NULL);
+
+  mFailAllocations = FALSE;
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  Index = GetHobIndex ();
+  UT_ASSERT_EQUAL (CheckHobIndex (Index), UNIT_TEST_PASSED);
+
+  //
+  // Without memory for a larger index, the index is left as it was.
+  //
+  mFailAllocations = TRUE;
+  IndexedEnd = Index->IndexedEnd;
+  EntryCount = Index->EntryCount;
+  UT_ASSERT_EQUAL (AddHobs (Index->EntryCapacity * 2), UNIT_TEST_PASSED);
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  UT_ASSERT_EQUAL ((UINTN) GetHobIndex (), (UINTN) Index);
+  UT_ASSERT_TRUE (IsHobIndexValid (Index, mPrivateData.HobList.Raw));
+  UT_ASSERT_EQUAL ((UINTN) Index->IndexedEnd, (UINTN) IndexedEnd);
+  UT_ASSERT_EQUAL (Index->EntryCount, EntryCount);
+  UT_ASSERT_EQUAL (mFreeCount, 0);
+
+  //
+  // The HOBs after the index are left to a walk of the HOB list.
+  //
+  Hob = LookupHobIndex (Index, EFI_HOB_TYPE_GUID_EXTENSION, &gEfiCallerIdGuid, mPrivateData.HobList.Raw, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Hob, (UINTN) IndexedEnd);
+
+  mFailAllocations = FALSE;
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  UT_ASSERT_EQUAL (CheckHobIndex (GetHobIndex ()), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mFreeCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOB index is not built before permanent memory is
+  installed.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB index is not built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+NoIndexBeforeMemory (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mPrivateData.PeiMemoryInstalled = FALSE;
+  UT_ASSERT_EQUAL (AddHobs (10), UNIT_TEST_PASSED);
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  UT_ASSERT_EQUAL ((UINTN) GetHobIndex (), (UINTN) NULL);
+  UT_ASSERT_EQUAL (mAllocationCount, 0);
+
+  mPrivateData.PeiMemoryInstalled = TRUE;
+  PeiCoreUpdateHobIndex (&mPrivateData);
+  UT_ASSERT_EQUAL (CheckHobIndex (GetHobIndex ()), UNIT_TEST_PASSED);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the HOB
+  index of the PEI Core and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      HobIndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&HobIndexTests, Framework, "HOB Index", "PeiCore.HobIndex", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HobIndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite----------Description-----------------------------------------Class Name--------------------Function---------------------Pre-----------Post---------Context
+  AddTestCase (HobIndexTests, "The index grows with the HOB list", "IndexGrowsWithHobList", IndexGrowsWithHobList, CreateHobList, FreeHobList, NULL);
+  AddTestCase (HobIndexTests, "Freed HOBs are dropped when the index moves", "FreedHobsAreDropped", FreedHobsAreDropped, CreateHobList, FreeHobList, NULL);
+  AddTestCase (HobIndexTests, "An allocation failure keeps the index", "AllocationFailureKeepsIndex", AllocationFailureKeepsIndex, CreateHobList, FreeHobList, NULL);
+  AddTestCase (HobIndexTests, "No index before permanent memory", "NoIndexBeforeMemory", NoIndexBeforeMemory, CreateHobList, FreeHobList, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,833 @@
+/** @file
+  Host based unit test and benchmark of the PPI services of the PEI Core.
+
+  The test installs PPIs and notifies of GUIDs that share hash buckets, and
+  checks that PeiLocatePpi() finds every instance in installation order, and
+  that the notifies are invoked for the same PPIs, in the same order, as a
+  scan of the notify list and the PPI list would invoke them. It checks that
+  the result of a DEPEX only changes when a PPI of the hash buckets it waits on
+  is installed or reinstalled. It also reports the rate of PPI lookups and the
+  size of the GUID hash index.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include "PeiMain.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "PEI Core PPI Database Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_GUID_COUNT        100
+#define TEST_PPI_COUNT         300
+#define TEST_NOTIFY_COUNT      60
+#define TEST_MAX_INVOCATIONS   100000
+#define TEST_LOCATE_COUNT      1000000
+#define TEST_DEPEX_COUNT       40
+#define TEST_DEPEX_SIZE        64
+
+///
+/// An invocation of a notify.
+///
+typedef struct {
+  EFI_PEI_NOTIFY_DESCRIPTOR  *Notify;
+  VOID                       *Ppi;
+} TEST_INVOCATION;
+
+PEI_CORE_INSTANCE          mPrivateData;
+CONST EFI_PEI_SERVICES     **mPeiServices;
+
+EFI_GUID                   *mGuids;
+EFI_PEI_PPI_DESCRIPTOR     *mPpis;
+UINTN                      mPpiCount;
+EFI_PEI_NOTIFY_DESCRIPTOR  *mNotifies;
+UINTN                      mNotifyCount;
+
+TEST_INVOCATION            *mInvocations;
+UINTN                      mInvocationCount;
+
+//
+// PEI Core services used by the code under test
+//
+CONST EFI_PEI_SERVICES **
+EFIAPI
+GetPeiServicesTablePointer (
+  VOID
+  )
+{
+  return mPeiServices;
+}
+
+EFI_STATUS
+EFIAPI
+PeiServicesLocatePpi (
+  IN CONST EFI_GUID              *Guid,
+  IN UINTN                       Instance,
+  IN OUT EFI_PEI_PPI_DESCRIPTOR  **PpiDescriptor, OPTIONAL
+  IN OUT VOID                    **Ppi
+  )
+{
+  return PeiLocatePpi (mPeiServices, Guid, Instance, PpiDescriptor, Ppi);
+}
+
+EFI_STATUS
+PeiInstallSecHobData (
+  IN CONST EFI_PEI_SERVICES  **PeiServices,
+  IN EFI_HOB_GENERIC_HEADER  *SecHobList
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+PeiGetPe32Data (
+  IN     EFI_PEI_FILE_HANDLE  FileHandle,
+  OUT    VOID                 **Pe32Data
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+RETURN_STATUS
+EFIAPI
+PeCoffLoaderGetEntryPoint (
+  IN  VOID  *Pe32Data,
+  OUT VOID  **EntryPoint
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+VOID
+EFIAPI
+_ModuleEntryPoint (
+  IN CONST  EFI_SEC_PEI_HAND_OFF    *SecCoreData,
+  IN CONST  EFI_PEI_PPI_DESCRIPTOR  *PpiList
+  )
+{
+}
+
+/**
+  Records the invocation of a notify.
+
+  @param  PeiServices            The PEI services table.
+  @param  NotifyDescriptor       The notify.
+  @param  Ppi                    The PPI.
+
+  @retval EFI_SUCCESS            Always.
+
+**/
+EFI_STATUS
+EFIAPI
+TestNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  ASSERT (mInvocationCount < TEST_MAX_INVOCATIONS);
+  mInvocations[mInvocationCount].Notify = NotifyDescriptor;
+  mInvocations[mInvocationCount].Ppi    = Ppi;
+  mInvocationCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Checks that the notifies were invoked as a scan of the notify list and of
+  the PPI list would invoke them, and forgets the invocations.
+
+  @param  NotifyType             The type of the notifies.
+  @param  InstallStart           The first PPI to notify.
+  @param  InstallStop            One past the last PPI to notify.
+  @param  NotifyStart            The first notify to invoke.
+  @param  NotifyStop             One past the last notify to invoke.
+
+  @retval UNIT_TEST_PASSED       The invocations are as expected.
+
+**/
+UNIT_TEST_STATUS
+CheckInvocations (
+  IN UINTN  NotifyType,
+  IN UINTN  InstallStart,
+  IN UINTN  InstallStop,
+  IN UINTN  NotifyStart,
+  IN UINTN  NotifyStop
+  )
+{
+  PEI_PPI_LIST_POINTERS  *NotifyPtrs;
+  PEI_PPI_LIST_POINTERS  *PpiPtrs;
+  UINTN                  Notify;
+  UINTN                  Ppi;
+  UINTN                  Invocation;
+
+  if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+    NotifyPtrs = mPrivateData.PpiData.CallbackNotifyList.NotifyPtrs;
+  } else {
+    NotifyPtrs = mPrivateData.PpiData.DispatchNotifyList.NotifyPtrs;
+  }
+  PpiPtrs = mPrivateData.PpiData.PpiList.PpiPtrs;
+
+  Invocation = 0;
+  for (Notify = NotifyStart; Notify < NotifyStop; Notify++) {
+    for (Ppi = InstallStart; Ppi < InstallStop; Ppi++) {
+      if (CompareGuid (NotifyPtrs[Notify].Notify->Guid, PpiPtrs[Ppi].Ppi->Guid)) {
+        UT_ASSERT_TRUE (Invocation < mInvocationCount);
+        UT_ASSERT_EQUAL ((UINTN) mInvocations[Invocation].Notify, (UINTN) NotifyPtrs[Notify].Notify);
+        UT_ASSERT_EQUAL ((UINTN) mInvocations[Invocation].Ppi, (UINTN) PpiPtrs[Ppi].Ppi->Ppi);
+        Invocation++;
+      }
+    }
+  }
+
+  UT_ASSERT_EQUAL (Invocation, mInvocationCount);
+  mInvocationCount = 0;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Creates an empty PPI database, and GUIDs that share hash buckets, with PPI
+  and notify descriptors of those GUIDs.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The database and the descriptors are created.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreatePpiDatabase (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Index;
+  UINT32  Candidate;
+  UINTN   BucketCount[PPI_HASH_BUCKET_COUNT];
+
+  ZeroMem (&mPrivateData, sizeof (mPrivateData));
+  mPrivateData.Signature = PEI_CORE_HANDLE_SIGNATURE;
+  mPeiServices = (CONST EFI_PEI_SERVICES **) &mPrivateData.Ps;
+
+  mGuids       = AllocateZeroPool (TEST_GUID_COUNT * sizeof (EFI_GUID));
+  mPpis        = AllocateZeroPool (TEST_PPI_COUNT * sizeof (EFI_PEI_PPI_DESCRIPTOR));
+  mNotifies    = AllocateZeroPool (TEST_NOTIFY_COUNT * sizeof (EFI_PEI_NOTIFY_DESCRIPTOR));
+  mInvocations = AllocateZeroPool (TEST_MAX_INVOCATIONS * sizeof (TEST_INVOCATION));
+  UT_ASSERT_NOT_NULL (mGuids);
+  UT_ASSERT_NOT_NULL (mPpis);
+  UT_ASSERT_NOT_NULL (mNotifies);
+  UT_ASSERT_NOT_NULL (mInvocations);
+  mPpiCount        = 0;
+  mNotifyCount     = 0;
+  mInvocationCount = 0;
+
+  //
+  // Pick GUIDs so that every hash bucket holds three or four of them, and
+  // the lookups must skip the other GUIDs of the bucket.
+  //
+  ZeroMem (BucketCount, sizeof (BucketCount));
+  Index = 0;
+  for (Candidate = 0; Index < TEST_GUID_COUNT; Candidate++) {
+    mGuids[Index].Data1 = Candidate;
+    if (BucketCount[PpiGuidHash (&mGuids[Index])] < (TEST_GUID_COUNT + PPI_HASH_BUCKET_COUNT - 1) / PPI_HASH_BUCKET_COUNT) {
+      BucketCount[PpiGuidHash (&mGuids[Index])]++;
+      Index++;
+    }
+  }
+
+  //
+  // Three PPIs of each GUID, installed apart from each other, so that the
+  // instances of a GUID are interleaved with those of the other GUIDs.
+  //
+  for (Index = 0; Index < TEST_PPI_COUNT; Index++) {
+    mPpis[Index].Flags = EFI_PEI_PPI_DESCRIPTOR_PPI | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+    mPpis[Index].Guid  = &mGuids[(Index * 7) % TEST_GUID_COUNT];
+    mPpis[Index].Ppi   = &mPpis[Index];
+  }
+
+  //
+  // Three notifies of each of 20 GUIDs.
+  //
+  for (Index = 0; Index < TEST_NOTIFY_COUNT; Index++) {
+    mNotifies[Index].Flags  = EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+    mNotifies[Index].Guid   = &mGuids[(Index * 5) % TEST_GUID_COUNT];
+    mNotifies[Index].Notify = TestNotify;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the PPI database and the descriptors.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreePpiDatabase (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI GUID index: %d PPIs, %d notifies, %d bytes\n",
+    mPrivateData.PpiData.PpiList.CurrentCount,
+    mPrivateData.PpiData.CallbackNotifyList.CurrentCount + mPrivateData.PpiData.DispatchNotifyList.CurrentCount,
+    GetPpiHashIndexSize (&mPrivateData)
+    ));
+
+  FreePool (mGuids);
+  FreePool (mPpis);
+  FreePool (mNotifies);
+  FreePool (mInvocations);
+}
+
+/**
+  Checks that PeiLocatePpi() finds every instance of every GUID in
+  installation order, as a scan of the PPI list would.
+
+  @retval UNIT_TEST_PASSED       Every instance is found.
+
+**/
+UNIT_TEST_STATUS
+CheckLocate (
+  VOID
+  )
+{
+  EFI_STATUS              Status;
+  EFI_PEI_PPI_DESCRIPTOR  *Descriptor;
+  VOID                    *Ppi;
+  UINTN                   Guid;
+  UINTN                   Index;
+  UINTN                   Instance;
+
+  for (Guid = 0; Guid < TEST_GUID_COUNT; Guid++) {
+    Instance = 0;
+    for (Index = 0; Index < mPrivateData.PpiData.PpiList.CurrentCount; Index++) {
+      if (CompareGuid (mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi->Guid, &mGuids[Guid])) {
+        Status = PeiLocatePpi (mPeiServices, &mGuids[Guid], Instance, &Descriptor, &Ppi);
+        UT_ASSERT_NOT_EFI_ERROR (Status);
+        UT_ASSERT_EQUAL ((UINTN) Descriptor, (UINTN) mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi);
+        UT_ASSERT_EQUAL ((UINTN) Ppi, (UINTN) Descriptor->Ppi);
+        Instance++;
+      }
+    }
+
+    Status = PeiLocatePpi (mPeiServices, &mGuids[Guid], Instance, &Descriptor, &Ppi);
+    UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Installs PPIs one at a time and in lists, and checks that they are found.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every PPI is found.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LocatePpis (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINTN       Count;
+  UINTN       List;
+
+  for (List = 0; mPpiCount < TEST_PPI_COUNT; List++) {
+    //
+    // Install a list of one to eight PPIs.
+    //
+    Count = 1 + List % 8;
+    Count = MIN (Count, TEST_PPI_COUNT - mPpiCount);
+    for (Index = mPpiCount; Index < mPpiCount + Count - 1; Index++) {
+      mPpis[Index].Flags &= ~EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+    }
+    Status = PeiInstallPpi (mPeiServices, &mPpis[mPpiCount]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    mPpiCount += Count;
+
+    if (mPpiCount % 50 < 8) {
+      UT_ASSERT_EQUAL (CheckLocate (), UNIT_TEST_PASSED);
+    }
+  }
+
+  UT_ASSERT_EQUAL (mPrivateData.PpiData.PpiList.CurrentCount, TEST_PPI_COUNT);
+  UT_ASSERT_EQUAL (CheckLocate (), UNIT_TEST_PASSED);
+
+  //
+  // An invalid descriptor in a list installs none of the list.
+  //
+  mPpis[0].Flags = 0;
+  Status = PeiInstallPpi (mPeiServices, &mPpis[0]);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (mPrivateData.PpiData.PpiList.CurrentCount, TEST_PPI_COUNT);
+  UT_ASSERT_EQUAL (CheckLocate (), UNIT_TEST_PASSED);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reinstalls PPIs with other GUIDs, and checks that they are found under
+  their new GUIDs, in their places in the PPI list.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every PPI is found.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReinstallPpis (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS              Status;
+  EFI_PEI_PPI_DESCRIPTOR  *NewPpis;
+  EFI_PEI_PPI_DESCRIPTOR  Unknown;
+  UINTN                   Index;
+  UINTN                   Count;
+
+  for (Index = 0; Index < TEST_PPI_COUNT; Index++) {
+    Status = InternalPeiInstallPpi (mPeiServices, &mPpis[Index], TRUE);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  NewPpis = AllocateZeroPool (TEST_PPI_COUNT * sizeof (EFI_PEI_PPI_DESCRIPTOR));
+  UT_ASSERT_NOT_NULL (NewPpis);
+
+  //
+  // Reinstall every PPI once, in a scattered order, mostly with a GUID of
+  // another bucket.
+  //
+  for (Count = 0; Count < TEST_PPI_COUNT; Count++) {
+    Index = (Count * 7) % TEST_PPI_COUNT;
+    NewPpis[Count].Flags = EFI_PEI_PPI_DESCRIPTOR_PPI | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+    NewPpis[Count].Guid  = &mGuids[(Count * 11) % TEST_GUID_COUNT];
+    NewPpis[Count].Ppi   = &NewPpis[Count];
+
+    Status = PeiReInstallPpi (mPeiServices, mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi, &NewPpis[Count]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL ((UINTN) mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi, (UINTN) &NewPpis[Count]);
+
+    if (Count % 25 == 0) {
+      UT_ASSERT_EQUAL (CheckLocate (), UNIT_TEST_PASSED);
+    }
+  }
+
+  UT_ASSERT_EQUAL (CheckLocate (), UNIT_TEST_PASSED);
+
+  //
+  // A PPI that is not installed can not be reinstalled.
+  //
+  CopyMem (&Unknown, &mPpis[0], sizeof (Unknown));
+  Status = PeiReInstallPpi (mPeiServices, &Unknown, &NewPpis[0]);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  //
+  // Restore the PPIs before they are freed.
+  //
+  for (Index = 0; Index < TEST_PPI_COUNT; Index++) {
+    mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi = &mPpis[Index];
+  }
+  FreePool (NewPpis);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Registers callback notifies between PPI installations, and checks that
+  each installation and each registration invokes the notifies of the PPIs
+  as a scan of the notify list and the PPI list would.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The notifies are invoked as expected.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+NotifyInOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Count;
+  UINTN       LastPpiCount;
+  UINTN       LastNotifyCount;
+  UINTN       Step;
+
+  for (Step = 0; mPpiCount < TEST_PPI_COUNT || mNotifyCount < TEST_NOTIFY_COUNT; Step++) {
+    if (mNotifyCount < TEST_NOTIFY_COUNT && (mPpiCount == TEST_PPI_COUNT || Step % 4 == 0)) {
+      //
+      // Register a notify, which is invoked for the PPIs installed before.
+      //
+      LastNotifyCount = mPrivateData.PpiData.CallbackNotifyList.CurrentCount;
+      Status = PeiNotifyPpi (mPeiServices, &mNotifies[mNotifyCount]);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      mNotifyCount++;
+      UT_ASSERT_EQUAL (
+        CheckInvocations (
+          EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK,
+          0,
+          mPrivateData.PpiData.PpiList.CurrentCount,
+          LastNotifyCount,
+          mPrivateData.PpiData.CallbackNotifyList.CurrentCount
+          ),
+        UNIT_TEST_PASSED
+        );
+    } else {
+      //
+      // Install a list of PPIs, which are notified to the notifies registered before.
+      //
+      Count = 1 + Step % 6;
+      Count = MIN (Count, TEST_PPI_COUNT - mPpiCount);
+      for (LastPpiCount = mPpiCount; mPpiCount < LastPpiCount + Count; mPpiCount++) {
+        if (mPpiCount < LastPpiCount + Count - 1) {
+          mPpis[mPpiCount].Flags &= ~EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+        }
+      }
+      Status = PeiInstallPpi (mPeiServices, &mPpis[LastPpiCount]);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_EQUAL (
+        CheckInvocations (
+          EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK,
+          LastPpiCount,
+          mPpiCount,
+          0,
+          mPrivateData.PpiData.CallbackNotifyList.CurrentCount
+          ),
+        UNIT_TEST_PASSED
+        );
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks the order of the dispatch level notifies after a PEIM, with the
+  new notifies and the new PPIs given separately.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The notifies are invoked as expected.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+DispatchNotifyInOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  //
+  // PPIs dispatched before.
+  //
+  for (Index = 0; Index < TEST_PPI_COUNT / 2; Index++) {
+    Status = InternalPeiInstallPpi (mPeiServices, &mPpis[Index], TRUE);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  ProcessDispatchNotifyList (&mPrivateData);
+  UT_ASSERT_EQUAL (mInvocationCount, 0);
+
+  //
+  // Dispatch notifies registered by a PEIM are invoked for the PPIs dispatched before.
+  //
+  for (Index = 0; Index < TEST_NOTIFY_COUNT / 2; Index++) {
+    mNotifies[Index].Flags = EFI_PEI_PPI_DESCRIPTOR_NOTIFY_DISPATCH | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+    Status = PeiNotifyPpi (mPeiServices, &mNotifies[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  UT_ASSERT_EQUAL (mInvocationCount, 0);
+  ProcessDispatchNotifyList (&mPrivateData);
+  UT_ASSERT_EQUAL (
+    CheckInvocations (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_DISPATCH, 0, TEST_PPI_COUNT / 2, 0, TEST_NOTIFY_COUNT / 2),
+    UNIT_TEST_PASSED
+    );
+
+  //
+  // PPIs installed by a PEIM are notified to the dispatch notifies registered before.
+  //
+  for (Index = TEST_PPI_COUNT / 2; Index < TEST_PPI_COUNT; Index++) {
+    Status = InternalPeiInstallPpi (mPeiServices, &mPpis[Index], TRUE);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  UT_ASSERT_EQUAL (mInvocationCount, 0);
+  ProcessDispatchNotifyList (&mPrivateData);
+  UT_ASSERT_EQUAL (
+    CheckInvocations (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_DISPATCH, TEST_PPI_COUNT / 2, TEST_PPI_COUNT, 0, TEST_NOTIFY_COUNT / 2),
+    UNIT_TEST_PASSED
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measures the rate of PPI lookups in a full PPI database.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every lookup succeeds.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LocateThroughput (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINTN       Count;
+  VOID        *Ppi;
+  clock_t     Start;
+  clock_t     End;
+
+  for (Index = 0; Index < TEST_PPI_COUNT; Index++) {
+    Status = InternalPeiInstallPpi (mPeiServices, &mPpis[Index], TRUE);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  Start = clock ();
+  for (Count = 0; Count < TEST_LOCATE_COUNT; Count++) {
+    Index  = Count % TEST_PPI_COUNT;
+    Status = PeiLocatePpi (mPeiServices, mPpis[Index].Guid, 0, NULL, &Ppi);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  End = clock ();
+
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI database: %d PPIs, %d lookups, %d ms\n",
+    TEST_PPI_COUNT,
+    TEST_LOCATE_COUNT,
+    (UINT32) ((End - Start) * 1000 / CLOCKS_PER_SEC)
+    ));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Appends a PUSH of a GUID to a DEPEX.
+
+  @param  Depex                  The end of the DEPEX.
+  @param  Guid                   The GUID.
+  @param  BucketMask             The hash buckets of the GUIDs of the DEPEX.
+
+  @return The new end of the DEPEX.
+
+**/
+UINT8 *
+PushTestGuid (
+  IN     UINT8           *Depex,
+  IN     CONST EFI_GUID  *Guid,
+  IN OUT UINT32          *BucketMask
+  )
+{
+  *Depex++ = EFI_DEP_PUSH;
+  CopyMem (Depex, Guid, sizeof (EFI_GUID));
+  *BucketMask |= (UINT32) 1 << PpiGuidHash (Guid);
+
+  return Depex + sizeof (EFI_GUID);
+}
+
+/**
+  Installs and reinstalls PPIs, and checks that a DEPEX only changes its
+  result when a PPI of the hash buckets it waits on is installed or
+  reinstalled, which is when the dispatcher evaluates it again.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       No DEPEX changes its result while waiting.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+DepexWaitsOnPpis (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS              Status;
+  UINT8                   *Depexes;
+  UINT8                   *Depex;
+  EFI_PEI_PPI_DESCRIPTOR  *NewPpis;
+  UINT32                  BucketMask[TEST_DEPEX_COUNT];
+  BOOLEAN                 Result[TEST_DEPEX_COUNT];
+  UINT32                  Stamp;
+  UINTN                   Index;
+  UINTN                   Bucket;
+  UINTN                   Step;
+  UINTN                   Waiting;
+  UINTN                   Evaluated;
+
+  Depexes = AllocateZeroPool (TEST_DEPEX_COUNT * TEST_DEPEX_SIZE);
+  NewPpis = AllocateZeroPool (TEST_PPI_COUNT * sizeof (EFI_PEI_PPI_DESCRIPTOR));
+  UT_ASSERT_NOT_NULL (Depexes);
+  UT_ASSERT_NOT_NULL (NewPpis);
+
+  //
+  // Make DEPEXes of one or two GUIDs of the PPIs, with AND, OR and NOT.
+  //
+  for (Index = 0; Index < TEST_DEPEX_COUNT; Index++) {
+    Depex = &Depexes[Index * TEST_DEPEX_SIZE];
+    BucketMask[Index] = 0;
+    Depex = PushTestGuid (Depex, mPpis[Index].Guid, &BucketMask[Index]);
+    switch (Index % 4) {
+      case 0:
+        break;
+      case 1:
+        Depex = PushTestGuid (Depex, mPpis[TEST_PPI_COUNT - 1 - Index].Guid, &BucketMask[Index]);
+        *Depex++ = EFI_DEP_AND;
+        break;
+      case 2:
+        Depex = PushTestGuid (Depex, mPpis[TEST_PPI_COUNT - 1 - Index].Guid, &BucketMask[Index]);
+        *Depex++ = EFI_DEP_OR;
+        break;
+      default:
+        Depex = PushTestGuid (Depex, mPpis[TEST_PPI_COUNT - 1 - Index].Guid, &BucketMask[Index]);
+        *Depex++ = EFI_DEP_NOT;
+        *Depex++ = EFI_DEP_AND;
+        break;
+    }
+    *Depex = EFI_DEP_END;
+
+    UT_ASSERT_EQUAL (GetDepexPpiBucketMask (&Depexes[Index * TEST_DEPEX_SIZE]), BucketMask[Index]);
+  }
+
+  //
+  // A DEPEX with an unknown opcode waits on every bucket.
+  //
+  Depexes[0] = 0xFF;
+  UT_ASSERT_EQUAL (GetDepexPpiBucketMask (Depexes), MAX_UINT32);
+  Depexes[0] = EFI_DEP_PUSH;
+
+  Waiting   = 0;
+  Evaluated = 0;
+  for (Step = 0; Step < TEST_PPI_COUNT; Step++) {
+    for (Index = 0; Index < TEST_DEPEX_COUNT; Index++) {
+      Result[Index] = PeimDispatchReadiness ((EFI_PEI_SERVICES **) mPeiServices, &Depexes[Index * TEST_DEPEX_SIZE]);
+    }
+    Stamp = mPrivateData.PpiData.PpiList.InstallStamp + 1;
+
+    //
+    // Install a PPI, or reinstall an installed PPI with another GUID.
+    //
+    if ((Step % 4 == 3) && (mPpiCount != 0)) {
+      NewPpis[Step].Flags = EFI_PEI_PPI_DESCRIPTOR_PPI | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST;
+      NewPpis[Step].Guid  = &mGuids[(Step * 11) % TEST_GUID_COUNT];
+      NewPpis[Step].Ppi   = &NewPpis[Step];
+      Index  = (Step * 7) % mPpiCount;
+      Status = PeiReInstallPpi (mPeiServices, mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi, &NewPpis[Step]);
+    } else {
+      Status = InternalPeiInstallPpi (mPeiServices, &mPpis[mPpiCount++], TRUE);
+    }
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+
+    for (Index = 0; Index < TEST_DEPEX_COUNT; Index++) {
+      for (Bucket = 0; Bucket < PPI_HASH_BUCKET_COUNT; Bucket++) {
+        if (((BucketMask[Index] & ((UINT32) 1 << Bucket)) != 0) &&
+            (mPrivateData.PpiData.PpiList.BucketStamps[Bucket] >= Stamp)) {
+          break;
+        }
+      }
+      if (Bucket == PPI_HASH_BUCKET_COUNT) {
+        UT_ASSERT_EQUAL (
+          PeimDispatchReadiness ((EFI_PEI_SERVICES **) mPeiServices, &Depexes[Index * TEST_DEPEX_SIZE]),
+          Result[Index]
+          );
+        Waiting++;
+      } else {
+        Evaluated++;
+      }
+    }
+  }
+
+  DEBUG ((DEBUG_INFO, "DEPEX evaluations: %d skipped, %d done\n", Waiting, Evaluated));
+
+  //
+  // Restore the PPIs before they are freed.
+  //
+  for (Index = 0; Index < mPpiCount; Index++) {
+    mPrivateData.PpiData.PpiList.PpiPtrs[Index].Ppi = &mPpis[Index];
+  }
+  FreePool (NewPpis);
+  FreePool (Depexes);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the PPI
+  services and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PpiTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&PpiTests, Framework, "PPI Services", "PeiCore.Ppi", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PpiTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-----Description----------------------------------Class Name--------------Function---------------Pre----------------Post-------------Context
+  AddTestCase (PpiTests, "PPIs are found in installation order", "LocatePpis", LocatePpis, CreatePpiDatabase, FreePpiDatabase, NULL);
+  AddTestCase (PpiTests, "Reinstalled PPIs are found", "ReinstallPpis", ReinstallPpis, CreatePpiDatabase, FreePpiDatabase, NULL);
+  AddTestCase (PpiTests, "Callback notifies are invoked in order", "NotifyInOrder", NotifyInOrder, CreatePpiDatabase, FreePpiDatabase, NULL);
+  AddTestCase (PpiTests, "Dispatch notifies are invoked in order", "DispatchNotifyInOrder", DispatchNotifyInOrder, CreatePpiDatabase, FreePpiDatabase, NULL);
+  AddTestCase (PpiTests, "DEPEXes change only with the PPIs they wait on", "DepexWaitsOnPpis", DepexWaitsOnPpis, CreatePpiDatabase, FreePpiDatabase, NULL);
+  AddTestCase (PpiTests, "Locate PPIs", "LocateThroughput", LocateThroughput, CreatePpiDatabase, FreePpiDatabase, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,70 @@
+/** @file
+  GUID and layout of the FV file index.
+
+  The file index is an FV extension entry that lists the name, type and
+  offset of each file of the FV, except the pad files, in the order of the
+  files in the FV. It lets a file be found by name or by type by reading the
+  index and the header of the file, instead of the header of every file before
+  it. The build reserves the entry when the FDF sets FvFileIndexEnable for an
+  FV, and GenFv fills it in once the files are placed.
+
+  The index may be stale if the FV was changed after it was built, so the
+  header of a file found through it must be checked against the entry, and
+  EndOffset must still be the end of the files of the FV.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+  @par Revision Reference:
+  This GUID is not defined by the PI Specification.
+
+**/
+
+#ifndef __EDKII_FV_FILE_INDEX_GUID_H__
+#define __EDKII_FV_FILE_INDEX_GUID_H__
+
+#define EDKII_FV_FILE_INDEX_GUID \
+  { \
+    0x7e1c3a96, 0x4b2d, 0x4f58, {0xa1, 0x6e, 0x93, 0xd4, 0x0b, 0x5c, 0x27, 0xe8 } \
+  }
+
+///
+/// Locates a file of the FV.
+///
+typedef struct {
+  ///
+  /// The name of the file.
+  ///
+  EFI_GUID                        Name;
+  ///
+  /// The offset of the FFS file header from the FV header.
+  ///
+  UINT32                          Offset;
+  ///
+  /// The EFI_FV_FILETYPE of the file.
+  ///
+  UINT8                           Type;
+  UINT8                           Reserved[3];
+} EDKII_FV_FILE_INDEX_ENTRY;
+
+///
+/// The FV extension entry of the file index. Hdr.ExtEntryType is
+/// EFI_FV_EXT_TYPE_GUID_TYPE and FormatType is EDKII_FV_FILE_INDEX_GUID.
+/// FileCount entries follow, and room is reserved for as many as fit in
+/// Hdr.ExtEntrySize.
+///
+typedef struct {
+  EFI_FIRMWARE_VOLUME_EXT_ENTRY   Hdr;
+  EFI_GUID                        FormatType;
+  ///
+  /// The offset of the end of the last file from the FV header, or 0 if the
+  /// index has not been generated.
+  ///
+  UINT32                          EndOffset;
+  UINT32                          FileCount;
+//EDKII_FV_FILE_INDEX_ENTRY       Entries[];
+} EDKII_FV_FILE_INDEX;
+
+extern EFI_GUID gEdkiiFvFileIndexGuid;
+
+#endif
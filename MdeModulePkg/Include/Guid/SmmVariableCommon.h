@@ -1,7 +1,7 @@
 /** @file
   The file defined some common structures used for communicating between SMM variable module and SMM variable wrapper module.
 
-Copyright (c) 2011 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -77,6 +77,10 @@ typedef struct {
 // The payload for this function is SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO
 //
 #define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO                14
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH.
+//
+#define SMM_VARIABLE_FUNCTION_SET_VARIABLE_BATCH                    15
 
 ///
 /// Size of SMM communicate header, without including the payload.
@@ -99,6 +103,31 @@ typedef struct {
   CHAR16      Name[1];
 } SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE;
 
+///
+/// This structure is used to communicate with SMI handler by the variable batch
+/// protocol. VariableCount SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE structures
+/// follow it, each at a UINTN aligned offset.
+///
+typedef struct {
+  UINTN       VariableCount;
+} SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH;
+
+///
+/// A variable of SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH, with the status
+/// of its update returned by the SMI handler.
+///
+typedef struct {
+  EFI_STATUS                                Status;
+  SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE  Variable;
+} SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE;
+
+///
+/// Size of a variable of SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH, with the
+/// padding to the next variable.
+///
+#define SMM_VARIABLE_BATCH_VARIABLE_SIZE(NameSize, DataSize) \
+  ALIGN_VALUE (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Variable.Name) + (NameSize) + (DataSize), sizeof (UINTN))
+
 ///
 /// This structure is used to communicate with SMI handler by GetNextVariableName.
 ///
@@ -138,6 +167,7 @@ typedef struct {
   VARIABLE_STORE_HEADER   *RuntimeHobCache;
   VARIABLE_STORE_HEADER   *RuntimeNvCache;
   VARIABLE_STORE_HEADER   *RuntimeVolatileCache;
+  UINT32                  *StoreGeneration;
 } SMM_VARIABLE_COMMUNICATE_RUNTIME_VARIABLE_CACHE_CONTEXT;
 
 typedef struct {
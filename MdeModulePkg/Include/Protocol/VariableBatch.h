@@ -0,0 +1,79 @@
+/** @file
+  Variable Batch Protocol is related to EDK II-specific implementation of variables
+  and intended for use as a means to set several non-volatile variables with a
+  single update of the variable store.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_BATCH_H__
+#define __VARIABLE_BATCH_H__
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0x6c3a8d25, 0x41f7, 0x4b9e, { 0x8a, 0x03, 0xd2, 0x5e, 0x97, 0x1c, 0xb4, 0x68 } \
+  }
+
+typedef struct _EDKII_VARIABLE_BATCH_PROTOCOL  EDKII_VARIABLE_BATCH_PROTOCOL;
+
+///
+/// A variable to set with EDKII_VARIABLE_BATCH_PROTOCOL. The fields other
+/// than Status are the parameters of SetVariable().
+///
+typedef struct {
+  CHAR16      *VariableName;
+  EFI_GUID    *VendorGuid;
+  UINT32      Attributes;
+  UINTN       DataSize;
+  VOID        *Data;
+  ///
+  /// Returns the status of SetVariable() for this variable, or EFI_ABORTED
+  /// if the variable was not set because another variable of the batch
+  /// could not be set.
+  ///
+  EFI_STATUS  Status;
+} EDKII_VARIABLE_BATCH_ENTRY;
+
+/**
+  Set several non-volatile variables with a single update of the variable store.
+
+  The variables are set in order as SetVariable() sets them, then committed
+  together. If any of them cannot be set, none of them is. The variables must
+  be non-volatile, and must not be authenticated variables, nor the Lang and
+  PlatformLang variables.
+
+  @param[in]      This           The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      VariableCount  The number of variables to set.
+  @param[in, out] Variables      The variables to set. On return, their Status
+                                 fields are updated.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  VariableCount is 0, or Variables is NULL.
+  @retval EFI_BAD_BUFFER_SIZE    The variables do not fit in a single update.
+  @retval EFI_UNSUPPORTED        The variable store cannot be updated in batches.
+  @retval Others                 The status of the first variable that could not
+                                 be set, or of the update of the variable store.
+                                 No variable was set.
+**/
+typedef
+EFI_STATUS
+(EFIAPI * EDKII_VARIABLE_BATCH_PROTOCOL_SET_VARIABLES) (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN       UINTN                          VariableCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY     *Variables
+  );
+
+///
+/// Variable Batch Protocol is related to EDK II-specific implementation of variables
+/// and intended for use as a means to set several non-volatile variables with a
+/// single update of the variable store.
+///
+struct _EDKII_VARIABLE_BATCH_PROTOCOL {
+  EDKII_VARIABLE_BATCH_PROTOCOL_SET_VARIABLES  SetVariables;
+};
+
+extern EFI_GUID gEdkiiVariableBatchProtocolGuid;
+
+#endif
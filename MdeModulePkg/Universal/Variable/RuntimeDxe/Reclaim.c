@@ -2,7 +2,7 @@
   Handles non-volatile variable store garbage collection, using FTW
   (Fault Tolerant Write) protocol.
 
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -92,6 +92,10 @@ GetLbaAndOffsetByAddress (
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the blocks from the first to the last block whose content differs
+  from the buffer are written, with a single fault tolerant write, so that a
+  reclaim that moves few variables does not rewrite the whole store.
+
   @param  VariableBase   Base address of variable to write
   @param  VariableBuffer Point to the variable data buffer.
 
@@ -106,12 +110,23 @@ FtwVariableSpace (
   IN VARIABLE_STORE_HEADER  *VariableBuffer
   )
 {
-  EFI_STATUS                         Status;
-  EFI_HANDLE                         FvbHandle;
-  EFI_LBA                            VarLba;
-  UINTN                              VarOffset;
-  UINTN                              FtwBufferSize;
-  EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
+  EFI_STATUS                          Status;
+  EFI_HANDLE                          FvbHandle;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  EFI_LBA                             VarLba;
+  UINTN                               VarOffset;
+  UINTN                               FtwBufferSize;
+  UINTN                               BlockSize;
+  UINTN                               NumberOfBlocks;
+  UINTN                               BlockStart;
+  UINTN                               BlockEnd;
+  UINTN                               BlockCount;
+  UINTN                               WriteStart;
+  UINTN                               WriteEnd;
+  UINTN                               FirstWriteBlock;
+  UINTN                               WriteBlockCount;
+  VARIABLE_RECLAIM_STATISTICS         *Statistics;
+  EFI_FAULT_TOLERANT_WRITE_PROTOCOL   *FtwProtocol;
 
   //
   // Locate fault tolerant write protocol.
@@ -123,7 +138,7 @@ FtwVariableSpace (
   //
   // Locate Fvb handle by address.
   //
-  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, NULL);
+  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, &Fvb);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -138,18 +153,78 @@ FtwVariableSpace (
   FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
   ASSERT (FtwBufferSize == VariableBuffer->Size);
 
+  Status = Fvb->GetBlockSize (Fvb, VarLba, &BlockSize, &NumberOfBlocks);
+  if (EFI_ERROR (Status) || (BlockSize == 0)) {
+    //
+    // Compare the whole store as a single block.
+    //
+    BlockSize = VarOffset + FtwBufferSize;
+  }
+
   //
-  // FTW write record.
+  // Compare the store with the buffer block by block, to find the range of
+  // blocks that must be written. The first block of the store may begin in
+  // the middle of a flash block.
   //
-  Status = FtwProtocol->Write (
-                          FtwProtocol,
-                          VarLba,         // LBA
-                          VarOffset,      // Offset
-                          FtwBufferSize,  // NumBytes
-                          NULL,           // PrivateData NULL
-                          FvbHandle,      // Fvb Handle
-                          (VOID *) VariableBuffer // write buffer
-                          );
+  BlockCount      = 0;
+  WriteStart      = 0;
+  WriteEnd        = 0;
+  FirstWriteBlock = 0;
+  WriteBlockCount = 0;
+  for (BlockStart = 0; BlockStart < FtwBufferSize; BlockStart = BlockEnd) {
+    BlockEnd = ((VarOffset + BlockStart) / BlockSize + 1) * BlockSize - VarOffset;
+    if (BlockEnd > FtwBufferSize) {
+      BlockEnd = FtwBufferSize;
+    }
+
+    if (CompareMem (
+          (VOID *) (UINTN) (VariableBase + BlockStart),
+          (UINT8 *) VariableBuffer + BlockStart,
+          BlockEnd - BlockStart
+          ) != 0) {
+      if (WriteEnd == 0) {
+        WriteStart      = BlockStart;
+        FirstWriteBlock = BlockCount;
+      }
+      WriteEnd        = BlockEnd;
+      WriteBlockCount = BlockCount - FirstWriteBlock + 1;
+    }
+
+    BlockCount++;
+  }
+
+  if (WriteEnd == 0) {
+    //
+    // The store already holds the content of the buffer.
+    //
+    Status = EFI_SUCCESS;
+  } else {
+    Status = GetLbaAndOffsetByAddress (VariableBase + WriteStart, &VarLba, &VarOffset);
+    if (EFI_ERROR (Status)) {
+      return EFI_ABORTED;
+    }
+
+    //
+    // FTW write record.
+    //
+    Status = FtwProtocol->Write (
+                            FtwProtocol,
+                            VarLba,                 // LBA
+                            VarOffset,              // Offset
+                            WriteEnd - WriteStart,  // NumBytes
+                            NULL,                   // PrivateData NULL
+                            FvbHandle,              // Fvb Handle
+                            (UINT8 *) VariableBuffer + WriteStart // write buffer
+                            );
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Statistics = &mVariableModuleGlobal->ReclaimStatistics;
+    Statistics->LastStoreBlocks   = (UINT32) BlockCount;
+    Statistics->LastWrittenBlocks = (UINT32) WriteBlockCount;
+    Statistics->StoreBlocks      += BlockCount;
+    Statistics->WrittenBlocks    += WriteBlockCount;
+  }
 
   return Status;
 }
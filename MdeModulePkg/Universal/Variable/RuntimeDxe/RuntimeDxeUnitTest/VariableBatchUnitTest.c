@@ -0,0 +1,1216 @@
+/** @file
+  Host based unit test of the batches of variable updates of the SMM variable
+  driver.
+
+  The test sends batches to SmmSetVariableBatch() as the SMI handler does,
+  with a non-volatile variable store in a firmware volume in memory. Malformed
+  batches must be rejected before any variable is set, and the batches that
+  are discarded, because one of their variables cannot be set or because the
+  fault tolerant write fails, must leave the store and the counters of the
+  driver as they were.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableSmmBatch.h"
+#include "VariableNonVolatile.h"
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "Variable Batch Unit Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_BLOCK_SIZE            SIZE_4KB
+#define TEST_BLOCK_COUNT           4
+#define TEST_FV_HEADER_LENGTH      (sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY))
+#define TEST_NV_STORE_SIZE         (TEST_BLOCK_SIZE * TEST_BLOCK_COUNT - TEST_FV_HEADER_LENGTH)
+#define TEST_VOLATILE_STORE_SIZE   SIZE_4KB
+#define TEST_MAX_VARIABLE_SIZE     0x400
+#define TEST_BATCH_SIZE            SIZE_2KB
+
+#define TEST_ATTRIBUTES            (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+//
+// The state of the driver that a discarded batch must restore.
+//
+typedef struct {
+  UINT8           Flash[TEST_NV_STORE_SIZE];
+  UINT8           NvCache[TEST_NV_STORE_SIZE];
+  UINTN           NonVolatileLastVariableOffset;
+  UINTN           CommonVariableTotalSize;
+  UINTN           CommonUserVariableTotalSize;
+  UINTN           HwErrVariableTotalSize;
+  VAR_ERROR_FLAG  CurrentBootVarErrFlag;
+} TEST_DRIVER_STATE;
+
+extern VAR_ERROR_FLAG        mCurrentBootVarErrFlag;
+extern VARIABLE_BATCH_STATE  mVariableBatchState;
+
+EFI_GUID               mTestVendorGuid = {
+  0x4D3C6F51, 0x0B7E, 0x4A8B, { 0x9C, 0x21, 0x5E, 0x37, 0xD4, 0x86, 0xA2, 0x1F }
+};
+
+UINT8                  *mFlash;
+VARIABLE_STORE_HEADER  *mFlashStore;
+VARIABLE_STORE_HEADER  *mVolatileStore;
+UINTN                  mBatchBuffer[TEST_BATCH_SIZE / sizeof (UINTN)];
+UINTN                  mBatchSize;
+UINTN                  mFtwWriteCount;
+EFI_STATUS             mFtwWriteStatus;
+TEST_DRIVER_STATE      mSavedState;
+
+/**
+  Returns the attributes of the firmware volume of the test.
+
+  @param[in]  This              Unused.
+  @param[out] Attributes        The attributes of the firmware volume.
+
+  @retval EFI_SUCCESS           The attributes are returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetAttributes (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT      EFI_FVB_ATTRIBUTES_2                *Attributes
+  )
+{
+  *Attributes = EFI_FVB2_WRITE_STATUS;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the base address of the firmware volume of the test.
+
+  @param[in]  This              Unused.
+  @param[out] Address           The base address of the firmware volume.
+
+  @retval EFI_SUCCESS           The address is returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetPhysicalAddress (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT      EFI_PHYSICAL_ADDRESS                *Address
+  )
+{
+  *Address = (EFI_PHYSICAL_ADDRESS) (UINTN) mFlash;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the size of the blocks of the firmware volume of the test.
+
+  @param[in]  This              Unused.
+  @param[in]  Lba               The block.
+  @param[out] BlockSize         The size of the block.
+  @param[out] NumberOfBlocks    The number of blocks from Lba on.
+
+  @retval EFI_SUCCESS           The size is returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetBlockSize (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN       EFI_LBA                             Lba,
+  OUT      UINTN                               *BlockSize,
+  OUT      UINTN                               *NumberOfBlocks
+  )
+{
+  *BlockSize      = TEST_BLOCK_SIZE;
+  *NumberOfBlocks = TEST_BLOCK_COUNT - (UINTN) Lba;
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes to the firmware volume of the test, unless the test makes the fault
+  tolerant writes fail.
+
+  @param[in] This               Unused.
+  @param[in] Lba                The block to write to.
+  @param[in] Offset             The offset in the block.
+  @param[in] Length             The number of bytes to write.
+  @param[in] PrivateData        Unused.
+  @param[in] FvBlockHandle      Unused.
+  @param[in] Buffer             The bytes to write.
+
+  @retval EFI_SUCCESS           The bytes are written.
+  @retval Others                The status the test makes the writes fail with.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFtwWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *This,
+  IN EFI_LBA                            Lba,
+  IN UINTN                              Offset,
+  IN UINTN                              Length,
+  IN VOID                               *PrivateData,
+  IN EFI_HANDLE                         FvBlockHandle,
+  IN VOID                               *Buffer
+  )
+{
+  mFtwWriteCount++;
+  if (EFI_ERROR (mFtwWriteStatus)) {
+    return mFtwWriteStatus;
+  }
+
+  CopyMem (mFlash + (UINTN) Lba * TEST_BLOCK_SIZE + Offset, Buffer, Length);
+  return EFI_SUCCESS;
+}
+
+EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  mTestFvb = {
+  TestFvbGetAttributes,
+  NULL,
+  TestFvbGetPhysicalAddress,
+  TestFvbGetBlockSize
+};
+
+EFI_FAULT_TOLERANT_WRITE_PROTOCOL  mTestFtw = {
+  NULL,
+  NULL,
+  TestFtwWrite
+};
+
+/**
+  Returns whether the runtime is entered. The test runs at boot time.
+
+  @retval FALSE                 The runtime is not entered.
+
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Initializes a basic mutual exclusion lock. The test has no lock.
+
+  @param[in, out] Lock          The lock.
+  @param[in]      Priority      Unused.
+
+  @return The lock.
+
+**/
+EFI_LOCK *
+InitializeLock (
+  IN OUT EFI_LOCK  *Lock,
+  IN     EFI_TPL   Priority
+  )
+{
+  return Lock;
+}
+
+/**
+  Acquires a lock only at boot time. The test has no lock.
+
+  @param[in] Lock               Unused.
+
+**/
+VOID
+AcquireLockOnlyAtBootTime (
+  IN EFI_LOCK  *Lock
+  )
+{
+}
+
+/**
+  Releases a lock only at boot time. The test has no lock.
+
+  @param[in] Lock               Unused.
+
+**/
+VOID
+ReleaseLockOnlyAtBootTime (
+  IN EFI_LOCK  *Lock
+  )
+{
+}
+
+/**
+  Retrieve the FVB protocol interface by HANDLE.
+
+  @param[in]  FvBlockHandle     Unused, the test has a single firmware volume.
+  @param[out] FvBlock           The firmware volume of the test.
+
+  @retval EFI_SUCCESS           The firmware volume of the test is returned.
+
+**/
+EFI_STATUS
+GetFvbByHandle (
+  IN  EFI_HANDLE                          FvBlockHandle,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvBlock
+  )
+{
+  *FvBlock = &mTestFvb;
+  return EFI_SUCCESS;
+}
+
+/**
+  Function returns an array of handles that support the FVB protocol
+  in a buffer allocated from pool.
+
+  @param[out] NumberHandles     The number of handles returned in Buffer.
+  @param[out] Buffer            The handle of the firmware volume of the test.
+
+  @retval EFI_SUCCESS           The handle is returned.
+  @retval EFI_OUT_OF_RESOURCES  The buffer could not be allocated.
+
+**/
+EFI_STATUS
+GetFvbCountAndBuffer (
+  OUT UINTN                               *NumberHandles,
+  OUT EFI_HANDLE                          **Buffer
+  )
+{
+  *Buffer = AllocatePool (sizeof (EFI_HANDLE));
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  (*Buffer)[0]   = (EFI_HANDLE) &mTestFvb;
+  *NumberHandles = 1;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get Fault Tolerant Write protocol interface.
+
+  @param[out] FtwProtocol       The interface of Ftw protocol
+
+  @retval EFI_SUCCESS           The Fault Tolerant Write protocol of the test is returned.
+
+**/
+EFI_STATUS
+GetFtwProtocol (
+  OUT VOID                                **FtwProtocol
+  )
+{
+  *FtwProtocol = &mTestFtw;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get non-volatile maximum variable size. Not used by the test.
+
+  @return The maximum variable size of the test.
+
+**/
+UINTN
+GetNonVolatileMaxVariableSize (
+  VOID
+  )
+{
+  return TEST_MAX_VARIABLE_SIZE;
+}
+
+/**
+  Init non-volatile variable store. Not used by the test, which builds the
+  store itself.
+
+  @retval EFI_UNSUPPORTED       The store is not initialized.
+
+**/
+EFI_STATUS
+InitNonVolatileVariableStore (
+  VOID
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Measure secure boot policy variable. The test has no secure boot variable.
+
+  @param[in]  VariableName      Unused.
+  @param[in]  VendorGuid        Unused.
+
+**/
+VOID
+EFIAPI
+SecureBootHook (
+  IN CHAR16                                 *VariableName,
+  IN EFI_GUID                               *VendorGuid
+  )
+{
+}
+
+/**
+  Initialize the MOR and MorLock variables. Not used by the test.
+
+  @retval EFI_SUCCESS           Nothing is initialized.
+
+**/
+EFI_STATUS
+MorLockInit (
+  VOID
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Check the MOR and MorLock variables. The test sets neither of them.
+
+  @param[in]  VariableName      Unused.
+  @param[in]  VendorGuid        Unused.
+  @param[in]  Attributes        Unused.
+  @param[in]  DataSize          Unused.
+  @param[in]  Data              Unused.
+
+  @retval EFI_SUCCESS           The variable can be set.
+
+**/
+EFI_STATUS
+SetVariableCheckHandlerMor (
+  IN CHAR16     *VariableName,
+  IN EFI_GUID   *VendorGuid,
+  IN UINT32     Attributes,
+  IN UINTN      DataSize,
+  IN VOID       *Data
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  This service is consumed by the variable modules to place a barrier to stop
+  speculative execution. The test runs the checks in order.
+
+**/
+VOID
+VariableSpeculationBarrier (
+  VOID
+  )
+{
+}
+
+/**
+  Initialize the AuthVariableLib. Not used by the test, which has no
+  authenticated variable.
+
+  @param[in]  AuthVarLibContextIn   Unused.
+  @param[out] AuthVarLibContextOut  Unused.
+
+  @retval EFI_UNSUPPORTED       The authenticated variables are not supported.
+
+**/
+EFI_STATUS
+EFIAPI
+AuthVariableLibInitialize (
+  IN  AUTH_VAR_LIB_CONTEXT_IN   *AuthVarLibContextIn,
+  OUT AUTH_VAR_LIB_CONTEXT_OUT  *AuthVarLibContextOut
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Process an authenticated variable. Not used by the test, which has no
+  authenticated variable.
+
+  @param[in] VariableName       Unused.
+  @param[in] VendorGuid         Unused.
+  @param[in] Data               Unused.
+  @param[in] DataSize           Unused.
+  @param[in] Attributes         Unused.
+
+  @retval EFI_UNSUPPORTED       The authenticated variables are not supported.
+
+**/
+EFI_STATUS
+EFIAPI
+AuthVariableLibProcessVariable (
+  IN CHAR16         *VariableName,
+  IN EFI_GUID       *VendorGuid,
+  IN VOID           *Data,
+  IN UINTN          DataSize,
+  IN UINT32         Attributes
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  SetVariable check. The test has no variable check.
+
+  @param[in] VariableName       Unused.
+  @param[in] VendorGuid         Unused.
+  @param[in] Attributes         Unused.
+  @param[in] DataSize           Unused.
+  @param[in] Data               Unused.
+  @param[in] RequestSource      Unused.
+
+  @retval EFI_SUCCESS           The variable can be set.
+
+**/
+EFI_STATUS
+EFIAPI
+VarCheckLibSetVariableCheck (
+  IN CHAR16                     *VariableName,
+  IN EFI_GUID                   *VendorGuid,
+  IN UINT32                     Attributes,
+  IN UINTN                      DataSize,
+  IN VOID                       *Data,
+  IN VAR_CHECK_REQUEST_SOURCE   RequestSource
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Variable property get. The test variables have no property.
+
+  @param[in]  Name              Unused.
+  @param[in]  Guid              Unused.
+  @param[out] VariableProperty  Unused.
+
+  @retval EFI_NOT_FOUND         The variable has no property.
+
+**/
+EFI_STATUS
+EFIAPI
+VarCheckLibVariablePropertyGet (
+  IN CHAR16                         *Name,
+  IN EFI_GUID                       *Guid,
+  OUT VAR_CHECK_VARIABLE_PROPERTY   *VariableProperty
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Variable property set. Not used by the test.
+
+  @param[in] Name               Unused.
+  @param[in] Guid               Unused.
+  @param[in] VariableProperty   Unused.
+
+  @retval EFI_SUCCESS           Nothing is set.
+
+**/
+EFI_STATUS
+EFIAPI
+VarCheckLibVariablePropertySet (
+  IN CHAR16                         *Name,
+  IN EFI_GUID                       *Guid,
+  IN VAR_CHECK_VARIABLE_PROPERTY    *VariableProperty
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the first instance of a HOB with a given GUID. The test has no HOB.
+
+  @param[in] Guid               Unused.
+
+  @retval NULL                  No HOB is found.
+
+**/
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  return NULL;
+}
+
+/**
+  Returns the next instance of a HOB with a given GUID. The test has no HOB.
+
+  @param[in] Guid               Unused.
+  @param[in] HobStart           Unused.
+
+  @retval NULL                  No HOB is found.
+
+**/
+VOID *
+EFIAPI
+GetNextGuidHob (
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  return NULL;
+}
+
+/**
+  Formats an empty variable store.
+
+  @param[out] Store             The store.
+  @param[in]  Size              The size of the store.
+
+**/
+VOID
+FormatStore (
+  OUT VARIABLE_STORE_HEADER  *Store,
+  IN  UINTN                  Size
+  )
+{
+  SetMem (Store, Size, 0xFF);
+  ZeroMem (Store, sizeof (*Store));
+  CopyGuid (&Store->Signature, &gEfiVariableGuid);
+  Store->Size   = (UINT32) Size;
+  Store->Format = VARIABLE_STORE_FORMATTED;
+  Store->State  = VARIABLE_STORE_HEALTHY;
+}
+
+/**
+  Builds a firmware volume with an empty non-volatile variable store, and the
+  volatile variable store, and initializes the driver with them.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The driver is initialized.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateStores (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+  UINTN                       StartOffset;
+
+  mVariableModuleGlobal = AllocateZeroPool (sizeof (*mVariableModuleGlobal));
+  mFlash                = AllocatePool (TEST_BLOCK_SIZE * TEST_BLOCK_COUNT);
+  mNvVariableCache      = AllocatePool (TEST_NV_STORE_SIZE);
+  mVolatileStore        = AllocatePool (TEST_VOLATILE_STORE_SIZE + TEST_MAX_VARIABLE_SIZE);
+  UT_ASSERT_NOT_NULL (mVariableModuleGlobal);
+  UT_ASSERT_NOT_NULL (mFlash);
+  UT_ASSERT_NOT_NULL (mNvVariableCache);
+  UT_ASSERT_NOT_NULL (mVolatileStore);
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) mFlash;
+  ZeroMem (FvHeader, TEST_FV_HEADER_LENGTH);
+  FvHeader->FvLength              = TEST_BLOCK_SIZE * TEST_BLOCK_COUNT;
+  FvHeader->HeaderLength          = TEST_FV_HEADER_LENGTH;
+  FvHeader->BlockMap[0].NumBlocks = TEST_BLOCK_COUNT;
+  FvHeader->BlockMap[0].Length    = TEST_BLOCK_SIZE;
+
+  mFlashStore = (VARIABLE_STORE_HEADER *) (mFlash + TEST_FV_HEADER_LENGTH);
+  FormatStore (mFlashStore, TEST_NV_STORE_SIZE);
+  CopyMem (mNvVariableCache, mFlashStore, TEST_NV_STORE_SIZE);
+  FormatStore (mVolatileStore, TEST_VOLATILE_STORE_SIZE);
+
+  StartOffset = (UINTN) GetStartPointer (mFlashStore) - (UINTN) mFlashStore;
+  mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = (EFI_PHYSICAL_ADDRESS) (UINTN) mFlashStore;
+  mVariableModuleGlobal->VariableGlobal.VolatileVariableBase    = (EFI_PHYSICAL_ADDRESS) (UINTN) mVolatileStore;
+  mVariableModuleGlobal->NonVolatileLastVariableOffset          = StartOffset;
+  mVariableModuleGlobal->VolatileLastVariableOffset             = StartOffset;
+  mVariableModuleGlobal->CommonVariableSpace                    = TEST_NV_STORE_SIZE - StartOffset;
+  mVariableModuleGlobal->CommonMaxUserVariableSpace             = TEST_NV_STORE_SIZE - StartOffset;
+  mVariableModuleGlobal->CommonRuntimeVariableSpace             = TEST_NV_STORE_SIZE - StartOffset;
+  mVariableModuleGlobal->MaxVariableSize                        = TEST_MAX_VARIABLE_SIZE;
+  mVariableModuleGlobal->ScratchBufferSize                      = TEST_MAX_VARIABLE_SIZE;
+  mVariableModuleGlobal->FvbInstance                            = &mTestFvb;
+  mNvFvHeaderCache       = FvHeader;
+  mCurrentBootVarErrFlag = VAR_ERROR_FLAG_NO_ERROR;
+  mFtwWriteCount         = 0;
+  mFtwWriteStatus        = EFI_SUCCESS;
+
+  InitializeVariableStoreIndex (VariableStoreTypeNv, mNvVariableCache, FALSE);
+  InitializeVariableStoreIndex (VariableStoreTypeVolatile, mVolatileStore, FALSE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the stores and the indexes of the driver.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeStores (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreeVariableStoreIndex (VariableStoreTypeNv);
+  FreeVariableStoreIndex (VariableStoreTypeVolatile);
+  FreePool (mVariableModuleGlobal);
+  FreePool (mFlash);
+  FreePool (mNvVariableCache);
+  FreePool (mVolatileStore);
+  mVariableModuleGlobal = NULL;
+  mNvVariableCache      = NULL;
+  mNvFvHeaderCache      = NULL;
+}
+
+/**
+  Empties the batch of the test.
+
+  @param  VariableCount          The number of variables of the batch.
+
+**/
+VOID
+ResetBatch (
+  IN UINTN  VariableCount
+  )
+{
+  ZeroMem (mBatchBuffer, sizeof (mBatchBuffer));
+  ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer)->VariableCount = VariableCount;
+  mBatchSize = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+}
+
+/**
+  Appends a variable to the batch of the test.
+
+  @param  Name                   The name of the variable.
+  @param  Attributes             The attributes of the variable.
+  @param  Data                   The first byte of the data of the variable.
+  @param  DataSize               The size of the data, every byte of which is Data.
+
+  @return The variable in the batch.
+
+**/
+SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *
+AppendBatchVariable (
+  IN CHAR16  *Name,
+  IN UINT32  Attributes,
+  IN UINT8   Data,
+  IN UINTN   DataSize
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *BatchVariable;
+  UINTN                                    NameSize;
+
+  NameSize      = StrSize (Name);
+  BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) ((UINT8 *) mBatchBuffer + mBatchSize);
+  ASSERT (mBatchSize + SMM_VARIABLE_BATCH_VARIABLE_SIZE (NameSize, DataSize) <= sizeof (mBatchBuffer));
+
+  BatchVariable->Status              = EFI_NOT_READY;
+  BatchVariable->Variable.Attributes = Attributes;
+  BatchVariable->Variable.NameSize   = NameSize;
+  BatchVariable->Variable.DataSize   = DataSize;
+  CopyGuid (&BatchVariable->Variable.Guid, &mTestVendorGuid);
+  CopyMem (BatchVariable->Variable.Name, Name, NameSize);
+  SetMem ((UINT8 *) BatchVariable->Variable.Name + NameSize, DataSize, Data);
+
+  mBatchSize += SMM_VARIABLE_BATCH_VARIABLE_SIZE (NameSize, DataSize);
+  return BatchVariable;
+}
+
+/**
+  Saves the store and the counters of the driver.
+
+**/
+VOID
+SaveDriverState (
+  VOID
+  )
+{
+  CopyMem (mSavedState.Flash, mFlashStore, TEST_NV_STORE_SIZE);
+  CopyMem (mSavedState.NvCache, mNvVariableCache, TEST_NV_STORE_SIZE);
+  mSavedState.NonVolatileLastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  mSavedState.CommonVariableTotalSize       = mVariableModuleGlobal->CommonVariableTotalSize;
+  mSavedState.CommonUserVariableTotalSize   = mVariableModuleGlobal->CommonUserVariableTotalSize;
+  mSavedState.HwErrVariableTotalSize        = mVariableModuleGlobal->HwErrVariableTotalSize;
+  mSavedState.CurrentBootVarErrFlag         = mCurrentBootVarErrFlag;
+}
+
+/**
+  Checks that the store and the counters of the driver are those saved by
+  SaveDriverState(), and that no batch is left started.
+
+  @retval UNIT_TEST_PASSED       The driver is in the state saved.
+
+**/
+UNIT_TEST_STATUS
+CheckDriverStateRestored (
+  VOID
+  )
+{
+  UT_ASSERT_FALSE (mVariableBatchState.Active);
+  UT_ASSERT_FALSE (mVariableModuleGlobal->VariableGlobal.EmuNvMode);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase, (UINTN) mFlashStore);
+  UT_ASSERT_MEM_EQUAL (mFlashStore, mSavedState.Flash, TEST_NV_STORE_SIZE);
+  UT_ASSERT_MEM_EQUAL (mNvVariableCache, mSavedState.NvCache, TEST_NV_STORE_SIZE);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->NonVolatileLastVariableOffset, mSavedState.NonVolatileLastVariableOffset);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->CommonVariableTotalSize, mSavedState.CommonVariableTotalSize);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->CommonUserVariableTotalSize, mSavedState.CommonUserVariableTotalSize);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->HwErrVariableTotalSize, mSavedState.HwErrVariableTotalSize);
+  UT_ASSERT_EQUAL (mCurrentBootVarErrFlag, mSavedState.CurrentBootVarErrFlag);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks whether a variable of the test is in the store with the data given.
+
+  @param  Name                   The name of the variable.
+  @param  Data                   The first byte of the data of the variable.
+  @param  DataSize               The size of the data, every byte of which is Data,
+                                 or 0 if the variable must not be found.
+
+  @retval UNIT_TEST_PASSED       The variable is found with its data, or is not
+                                 found as expected.
+
+**/
+UNIT_TEST_STATUS
+CheckVariable (
+  IN CHAR16  *Name,
+  IN UINT8   Data,
+  IN UINTN   DataSize
+  )
+{
+  EFI_STATUS              Status;
+  VARIABLE_POINTER_TRACK  Variable;
+  UINT8                   *VariableData;
+  UINTN                   Index;
+
+  Status = FindVariable (Name, &mTestVendorGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE);
+  if (DataSize == 0) {
+    UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+    return UNIT_TEST_PASSED;
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (DataSizeOfVariable (Variable.CurrPtr, FALSE), DataSize);
+  VariableData = GetVariableDataPtr (Variable.CurrPtr, FALSE);
+  for (Index = 0; Index < DataSize; Index++) {
+    UT_ASSERT_EQUAL (VariableData[Index], Data);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Sends the batch of the test with a malformed variable, and checks that it
+  is rejected before any variable is set.
+
+  @param  Expected               The status expected.
+
+  @retval UNIT_TEST_PASSED       The batch is rejected.
+
+**/
+UNIT_TEST_STATUS
+CheckBatchRejected (
+  IN EFI_STATUS  Expected
+  )
+{
+  EFI_STATUS  Status;
+
+  SaveDriverState ();
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_STATUS_EQUAL (Status, Expected);
+  UT_ASSERT_EQUAL (mFtwWriteCount, 0);
+  UT_ASSERT_STATUS_EQUAL (((SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer + 1))->Status, EFI_NOT_READY);
+  UT_ASSERT_EQUAL (CheckDriverStateRestored (), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var1", 0, 0), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that a batch without variable, or with more variables than it holds,
+  is rejected.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batches are rejected.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BadVariableCountIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ResetBatch (0);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_INVALID_PARAMETER), UNIT_TEST_PASSED);
+
+  ResetBatch (3);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, 8);
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  ResetBatch (MAX_UINTN);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  return CheckBatchRejected (EFI_ACCESS_DENIED);
+}
+
+/**
+  Checks that a variable whose name or data size overflows the batch is
+  rejected.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batches are rejected.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+OverflowingSizeIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *BatchVariable;
+
+  ResetBatch (2);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  BatchVariable = AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, 8);
+  BatchVariable->Variable.NameSize = MAX_UINTN;
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  BatchVariable->Variable.NameSize = StrSize (L"Var2");
+  BatchVariable->Variable.DataSize = MAX_UINTN - 1;
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  //
+  // Sizes whose sum wraps around to the size of the variable.
+  //
+  BatchVariable->Variable.NameSize = MAX_UINTN - 7;
+  BatchVariable->Variable.DataSize = StrSize (L"Var2") + 16;
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  BatchVariable->Variable.NameSize = StrSize (L"Var2") + 16;
+  BatchVariable->Variable.DataSize = MAX_UINTN - 7;
+  return CheckBatchRejected (EFI_ACCESS_DENIED);
+}
+
+/**
+  Checks that a variable whose name is not a Null-terminated string is
+  rejected.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batches are rejected.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnterminatedNameIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *BatchVariable;
+
+  ResetBatch (2);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  BatchVariable = AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, 8);
+  BatchVariable->Variable.Name[StrLen (L"Var2")] = L'X';
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  //
+  // The terminator is cut from the name, and the data follows the name.
+  //
+  BatchVariable->Variable.Name[StrLen (L"Var2")]  = L'\0';
+  BatchVariable->Variable.NameSize = StrLen (L"Var2") * sizeof (CHAR16);
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  BatchVariable->Variable.NameSize = 0;
+  return CheckBatchRejected (EFI_ACCESS_DENIED);
+}
+
+/**
+  Checks that a batch whose last variable is cut is rejected.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batches are rejected.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TruncatedBatchIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *BatchVariable;
+  UINTN                                    FullSize;
+
+  ResetBatch (2);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  BatchVariable = AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, 8);
+  FullSize      = mBatchSize;
+
+  //
+  // The data, the name and the header of the last variable are cut.
+  //
+  mBatchSize = FullSize - sizeof (UINTN) - 1;
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  mBatchSize = (UINTN) BatchVariable->Variable.Name - (UINTN) mBatchBuffer + 2;
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  mBatchSize = (UINTN) BatchVariable - (UINTN) mBatchBuffer + 4;
+  UT_ASSERT_EQUAL (CheckBatchRejected (EFI_ACCESS_DENIED), UNIT_TEST_PASSED);
+
+  mBatchSize = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+  return CheckBatchRejected (EFI_ACCESS_DENIED);
+}
+
+/**
+  Checks that the variables of a batch are written to the flash together.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The variables are written.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CommittedBatchIsWritten (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                               Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var1;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var2;
+  UINTN                                    LastVariableOffset;
+
+  LastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  ResetBatch (2);
+  Var1   = AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  Var2   = AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, 24);
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_NOT_EFI_ERROR (Var1->Status);
+  UT_ASSERT_NOT_EFI_ERROR (Var2->Status);
+
+  UT_ASSERT_FALSE (mVariableBatchState.Active);
+  UT_ASSERT_FALSE (mVariableModuleGlobal->VariableGlobal.EmuNvMode);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase, (UINTN) mFlashStore);
+  UT_ASSERT_EQUAL (mFtwWriteCount, 1);
+  UT_ASSERT_MEM_EQUAL (mFlashStore, mNvVariableCache, TEST_NV_STORE_SIZE);
+  UT_ASSERT_TRUE (mVariableModuleGlobal->NonVolatileLastVariableOffset > LastVariableOffset);
+  UT_ASSERT_EQUAL (
+    mVariableModuleGlobal->CommonVariableTotalSize,
+    mVariableModuleGlobal->NonVolatileLastVariableOffset - LastVariableOffset
+    );
+
+  UT_ASSERT_EQUAL (CheckVariable (L"Var1", 0x11, 8), UNIT_TEST_PASSED);
+  return CheckVariable (L"Var2", 0x22, 24);
+}
+
+/**
+  Checks that a batch with a variable that cannot be set is discarded, and
+  that the other variables of the batch are reported as aborted.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batch is discarded.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FailingVariableDiscardsBatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                               Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var1;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var2;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var3;
+
+  //
+  // Var1 is in the store before the batch updates it.
+  //
+  ResetBatch (1);
+  AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  mFtwWriteCount = 0;
+
+  //
+  // A volatile variable cannot be discarded with the batch.
+  //
+  ResetBatch (3);
+  Var1 = AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x33, 16);
+  Var2 = AppendBatchVariable (L"Var2", EFI_VARIABLE_BOOTSERVICE_ACCESS, 0x22, 8);
+  Var3 = AppendBatchVariable (L"Var3", TEST_ATTRIBUTES, 0x44, 8);
+  SaveDriverState ();
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (Var1->Status, EFI_ABORTED);
+  UT_ASSERT_STATUS_EQUAL (Var2->Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (Var3->Status, EFI_ABORTED);
+  UT_ASSERT_EQUAL (mFtwWriteCount, 0);
+  UT_ASSERT_EQUAL (CheckDriverStateRestored (), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var1", 0x11, 8), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var3", 0, 0), UNIT_TEST_PASSED);
+
+  //
+  // Lang and PlatformLang update the language of the driver with each other.
+  //
+  ResetBatch (2);
+  Var1 = AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x33, 16);
+  Var2 = AppendBatchVariable (EFI_LANG_VARIABLE_NAME, TEST_ATTRIBUTES, 'e', 4);
+  CopyGuid (&Var2->Variable.Guid, &gEfiGlobalVariableGuid);
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (Var1->Status, EFI_ABORTED);
+  UT_ASSERT_STATUS_EQUAL (Var2->Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (mFtwWriteCount, 0);
+  UT_ASSERT_EQUAL (CheckDriverStateRestored (), UNIT_TEST_PASSED);
+  return CheckVariable (L"Var1", 0x11, 8);
+}
+
+/**
+  Checks that a batch that does not fit in the store is discarded with the
+  variable error flag it recorded.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batch is discarded.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+OutOfSpaceDiscardsBatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                               Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var1;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var2;
+
+  //
+  // Only the first variable fits in the space of the variables.
+  //
+  mVariableModuleGlobal->CommonVariableSpace        = TEST_MAX_VARIABLE_SIZE;
+  mVariableModuleGlobal->CommonMaxUserVariableSpace = TEST_MAX_VARIABLE_SIZE;
+
+  ResetBatch (2);
+  Var1 = AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, TEST_MAX_VARIABLE_SIZE / 2);
+  Var2 = AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, TEST_MAX_VARIABLE_SIZE / 2);
+  SaveDriverState ();
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_STATUS_EQUAL (Var1->Status, EFI_ABORTED);
+  UT_ASSERT_STATUS_EQUAL (Var2->Status, EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL (mFtwWriteCount, 0);
+  UT_ASSERT_EQUAL (mCurrentBootVarErrFlag, VAR_ERROR_FLAG_NO_ERROR);
+  UT_ASSERT_EQUAL (CheckDriverStateRestored (), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var1", 0, 0), UNIT_TEST_PASSED);
+  return CheckVariable (L"Var2", 0, 0);
+}
+
+/**
+  Checks that a batch whose fault tolerant write fails is discarded, that
+  all its variables are reported with the error of the write, and that the
+  next batch is written.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The batch is discarded.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FailingWriteDiscardsBatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                               Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var1;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE  *Var2;
+
+  ResetBatch (2);
+  Var1 = AppendBatchVariable (L"Var1", TEST_ATTRIBUTES, 0x11, 8);
+  Var2 = AppendBatchVariable (L"Var2", TEST_ATTRIBUTES, 0x22, 8);
+  SaveDriverState ();
+  mFtwWriteStatus = EFI_DEVICE_ERROR;
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_DEVICE_ERROR);
+  UT_ASSERT_STATUS_EQUAL (Var1->Status, EFI_DEVICE_ERROR);
+  UT_ASSERT_STATUS_EQUAL (Var2->Status, EFI_DEVICE_ERROR);
+  UT_ASSERT_EQUAL (mFtwWriteCount, 1);
+  UT_ASSERT_EQUAL (CheckDriverStateRestored (), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var1", 0, 0), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var2", 0, 0), UNIT_TEST_PASSED);
+
+  mFtwWriteStatus = EFI_SUCCESS;
+  Status = SmmSetVariableBatch ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mBatchBuffer, mBatchSize);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (mFlashStore, mNvVariableCache, TEST_NV_STORE_SIZE);
+  UT_ASSERT_EQUAL (CheckVariable (L"Var1", 0x11, 8), UNIT_TEST_PASSED);
+  return CheckVariable (L"Var2", 0x22, 8);
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the batches
+  of variable updates and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      MalformedBatchTests;
+  UNIT_TEST_SUITE_HANDLE      BatchTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&MalformedBatchTests, Framework, "Malformed Variable Batches", "Variable.Batch.Malformed", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MalformedBatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite--------------Description--------------------------------------Class Name--------------------Function---------------------Pre-----------Post-------Context
+  AddTestCase (MalformedBatchTests, "A bad variable count is rejected",            "BadVariableCountIsRejected", BadVariableCountIsRejected, CreateStores, FreeStores, NULL);
+  AddTestCase (MalformedBatchTests, "An overflowing size is rejected",             "OverflowingSizeIsRejected",  OverflowingSizeIsRejected,  CreateStores, FreeStores, NULL);
+  AddTestCase (MalformedBatchTests, "A name without terminator is rejected",       "UnterminatedNameIsRejected", UnterminatedNameIsRejected, CreateStores, FreeStores, NULL);
+  AddTestCase (MalformedBatchTests, "A truncated batch is rejected",               "TruncatedBatchIsRejected",   TruncatedBatchIsRejected,   CreateStores, FreeStores, NULL);
+
+  Status = CreateUnitTestSuite (&BatchTests, Framework, "Variable Batches", "Variable.Batch", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BatchTests, "A committed batch is written",                         "CommittedBatchIsWritten",      CommittedBatchIsWritten,      CreateStores, FreeStores, NULL);
+  AddTestCase (BatchTests, "A failing variable discards the batch",                "FailingVariableDiscardsBatch", FailingVariableDiscardsBatch, CreateStores, FreeStores, NULL);
+  AddTestCase (BatchTests, "A batch out of space is discarded",                    "OutOfSpaceDiscardsBatch",      OutOfSpaceDiscardsBatch,      CreateStores, FreeStores, NULL);
+  AddTestCase (BatchTests, "A failing flash write discards the batch",             "FailingWriteDiscardsBatch",    FailingWriteDiscardsBatch,    CreateStores, FreeStores, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,566 @@
+/** @file
+  Host based unit test of the hash index of the variable stores.
+
+  The test updates and deletes variables of a variable store the way
+  UpdateVariable() and Reclaim() do, and checks after every update that the
+  index finds the same variables as walking the store with FindVariableEx(),
+  and that GetNextVariableName() enumerates the same variables with the index
+  as without it.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "Variable Store Index Unit Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_STORE_SIZE        SIZE_64KB
+#define TEST_NAME_COUNT        100
+#define TEST_GUID_COUNT        3
+#define TEST_UPDATE_COUNT      6000
+#define TEST_CHECK_INTERVAL    97
+#define TEST_RECLAIM_THRESHOLD 512
+
+VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
+VARIABLE_MODULE_GLOBAL  mTestModuleGlobal;
+VARIABLE_STORE_HEADER   *mStore;
+UINT8                   *mReclaimBuffer;
+UINTN                   mLastVariableOffset;
+BOOLEAN                 mAtRuntime;
+CHAR16                  mNames[TEST_NAME_COUNT][20];
+EFI_GUID                mGuids[TEST_GUID_COUNT];
+
+CHAR16   *mPrefixes[]  = { L"Boot", L"Driver", L"PlatformConfig" };
+BOOLEAN  mAuthFormat   = TRUE;
+BOOLEAN  mNormalFormat = FALSE;
+
+/**
+  Return TRUE if ExitBootServices () has been called.
+
+  @retval TRUE If ExitBootServices () has been called.
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return mAtRuntime;
+}
+
+/**
+  Appends a variable to the variable store of the test. The data size depends
+  on where the variable goes, so that the variables of a name do not keep the
+  same size across updates.
+
+  @param  VariableName           The name of the variable.
+  @param  VendorGuid             The GUID of the variable.
+  @param  Attributes             The attributes of the variable.
+  @param  State                  The state of the variable.
+
+  @return The header of the variable, or NULL if the store is full.
+
+**/
+VARIABLE_HEADER *
+AppendVariable (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid,
+  IN UINT32    Attributes,
+  IN UINT8     State
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  BOOLEAN          AuthFormat;
+  UINTN            NameSize;
+  UINTN            DataSize;
+  UINTN            VariableSize;
+
+  AuthFormat   = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  NameSize     = StrSize (VariableName);
+  DataSize     = 1 + (mLastVariableOffset / HEADER_ALIGNMENT) % 40;
+  VariableSize = GetVariableHeaderSize (AuthFormat) + NameSize + GET_PAD_SIZE (NameSize) + DataSize;
+  if (mLastVariableOffset + HEADER_ALIGN (VariableSize) > mStore->Size) {
+    return NULL;
+  }
+
+  Variable = (VARIABLE_HEADER *) ((UINTN) mStore + mLastVariableOffset);
+  ZeroMem (Variable, GetVariableHeaderSize (AuthFormat));
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = State;
+  Variable->Attributes = Attributes;
+  SetNameSizeOfVariable (Variable, NameSize, AuthFormat);
+  SetDataSizeOfVariable (Variable, DataSize, AuthFormat);
+  CopyGuid (GetVendorGuidPtr (Variable, AuthFormat), VendorGuid);
+  CopyMem (GetVariableNamePtr (Variable, AuthFormat), VariableName, NameSize);
+  SetMem (GetVariableDataPtr (Variable, AuthFormat), DataSize, (UINT8) DataSize);
+
+  mLastVariableOffset += HEADER_ALIGN (VariableSize);
+  return Variable;
+}
+
+/**
+  Moves the added and in deleted transition variables to the start of the
+  variable store of the test, as Reclaim() does, and indexes them again.
+
+**/
+VOID
+ReclaimStore (
+  VOID
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  VARIABLE_HEADER  *NextVariable;
+  UINT8            *CurrPtr;
+  UINTN            VariableSize;
+  BOOLEAN          AuthFormat;
+
+  AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  SetMem (mReclaimBuffer, mStore->Size, 0xff);
+  CopyMem (mReclaimBuffer, mStore, sizeof (VARIABLE_STORE_HEADER));
+  CurrPtr = (UINT8 *) GetStartPointer ((VARIABLE_STORE_HEADER *) mReclaimBuffer);
+
+  for ( Variable = GetStartPointer (mStore)
+      ; IsValidVariableHeader (Variable, GetEndPointer (mStore))
+      ; Variable = NextVariable
+      ) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    if ((Variable->State == VAR_ADDED) || (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      VariableSize = (UINTN) NextVariable - (UINTN) Variable;
+      CopyMem (CurrPtr, Variable, VariableSize);
+      CurrPtr += VariableSize;
+    }
+  }
+
+  CopyMem (mStore, mReclaimBuffer, mStore->Size);
+  mLastVariableOffset = (UINTN) CurrPtr - (UINTN) mReclaimBuffer;
+  RebuildVariableStoreIndex (VariableStoreTypeNv);
+}
+
+/**
+  Builds an empty variable store, indexes it, and makes the names and the
+  GUIDs of the variables of the test.
+
+  @param  Context                A pointer to TRUE to use the authenticated
+                                 variable format.
+
+  @retval UNIT_TEST_PASSED       The variable store is built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateVariableStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+  UINTN  Digit;
+  UINTN  Length;
+
+  mAtRuntime            = FALSE;
+  mVariableModuleGlobal = &mTestModuleGlobal;
+  mVariableModuleGlobal->VariableGlobal.AuthFormat = *(BOOLEAN *) Context;
+
+  mStore         = AllocatePool (TEST_STORE_SIZE);
+  mReclaimBuffer = AllocatePool (TEST_STORE_SIZE);
+  UT_ASSERT_NOT_NULL (mStore);
+  UT_ASSERT_NOT_NULL (mReclaimBuffer);
+
+  SetMem (mStore, TEST_STORE_SIZE, 0xff);
+  CopyGuid (
+    &mStore->Signature,
+    mVariableModuleGlobal->VariableGlobal.AuthFormat ? &gEfiAuthenticatedVariableGuid : &gEfiVariableGuid
+    );
+  mStore->Size      = TEST_STORE_SIZE;
+  mStore->Format    = VARIABLE_STORE_FORMATTED;
+  mStore->State     = VARIABLE_STORE_HEALTHY;
+  mStore->Reserved  = 0;
+  mStore->Reserved1 = 0;
+  mLastVariableOffset = (UINTN) GetStartPointer (mStore) - (UINTN) mStore;
+
+  //
+  // Names like Boot0000 of different lengths, and GUIDs that differ in one
+  // byte, so that the variables differ in a few bytes only.
+  //
+  ZeroMem (mNames, sizeof (mNames));
+  for (Index = 0; Index < TEST_NAME_COUNT; Index++) {
+    StrCpyS (mNames[Index], ARRAY_SIZE (mNames[Index]), mPrefixes[Index % ARRAY_SIZE (mPrefixes)]);
+    Length = StrLen (mNames[Index]);
+    for (Digit = 0; Digit < 4; Digit++) {
+      mNames[Index][Length + Digit] = L"0123456789ABCDEF"[(Index >> (4 * (3 - Digit))) & 0xF];
+    }
+  }
+
+  for (Index = 0; Index < TEST_GUID_COUNT; Index++) {
+    CopyGuid (&mGuids[Index], &gEfiGlobalVariableGuid);
+    mGuids[Index].Data4[7] += (UINT8) Index;
+  }
+
+  InitializeVariableStoreIndex (VariableStoreTypeNv, mStore, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+  UT_ASSERT_NOT_NULL (mVariableStoreIndex[VariableStoreTypeNv].Slots);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the variable store of the test and its index.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeVariableStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreeVariableStoreIndex (VariableStoreTypeNv);
+  FreePool (mStore);
+  FreePool (mReclaimBuffer);
+}
+
+/**
+  Checks that the index finds every variable of the test as FindVariableEx()
+  does, before and after ExitBootServices().
+
+  @retval UNIT_TEST_PASSED       The index finds the same variables.
+
+**/
+UNIT_TEST_STATUS
+CheckIndex (
+  VOID
+  )
+{
+  VARIABLE_POINTER_TRACK  Expected;
+  VARIABLE_POINTER_TRACK  Actual;
+  EFI_STATUS              ExpectedStatus;
+  EFI_STATUS              Status;
+  UINTN                   Name;
+  UINTN                   Guid;
+  UINTN                   Mode;
+
+  for (Mode = 0; Mode < 4; Mode++) {
+    mAtRuntime = (BOOLEAN) ((Mode & 1) != 0);
+    for (Name = 0; Name < TEST_NAME_COUNT; Name++) {
+      for (Guid = 0; Guid < TEST_GUID_COUNT; Guid++) {
+        ZeroMem (&Expected, sizeof (Expected));
+        Expected.StartPtr = GetStartPointer (mStore);
+        Expected.EndPtr   = GetEndPointer (mStore);
+        CopyMem (&Actual, &Expected, sizeof (Actual));
+
+        ExpectedStatus = FindVariableEx (mNames[Name], &mGuids[Guid], (BOOLEAN) ((Mode & 2) != 0), &Expected, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+        Status         = FindVariableInStoreIndex (mNames[Name], &mGuids[Guid], (BOOLEAN) ((Mode & 2) != 0), &Actual, VariableStoreTypeNv);
+        UT_ASSERT_STATUS_EQUAL (Status, ExpectedStatus);
+        UT_ASSERT_EQUAL ((UINTN) Actual.CurrPtr, (UINTN) Expected.CurrPtr);
+        UT_ASSERT_EQUAL ((UINTN) Actual.InDeletedTransitionPtr, (UINTN) Expected.InDeletedTransitionPtr);
+      }
+    }
+  }
+
+  mAtRuntime = FALSE;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Enumerates the variables of the store of the test with
+  VariableServiceGetNextVariableInternal(), with the index or without it.
+
+  @param  UseIndex               TRUE to enumerate with the index.
+  @param  Variables              The headers of the variables enumerated.
+  @param  Count                  The number of variables enumerated.
+
+  @retval UNIT_TEST_PASSED       The variables were enumerated.
+
+**/
+UNIT_TEST_STATUS
+EnumerateVariables (
+  IN  BOOLEAN          UseIndex,
+  OUT VARIABLE_HEADER  **Variables,
+  OUT UINTN            *Count
+  )
+{
+  VARIABLE_STORE_HEADER  *VariableStoreList[VariableStoreTypeMax];
+  VARIABLE_HEADER        *Variable;
+  CHAR16                 Name[40];
+  EFI_GUID               Guid;
+  BOOLEAN                AuthFormat;
+  BOOLEAN                Disabled;
+  EFI_STATUS             Status;
+
+  AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  Disabled   = mVariableStoreIndex[VariableStoreTypeNv].Disabled;
+  mVariableStoreIndex[VariableStoreTypeNv].Disabled = (BOOLEAN) (Disabled || !UseIndex);
+
+  ZeroMem (VariableStoreList, sizeof (VariableStoreList));
+  VariableStoreList[VariableStoreTypeNv] = mStore;
+  Name[0] = L'\0';
+  ZeroMem (&Guid, sizeof (Guid));
+  *Count  = 0;
+
+  while (TRUE) {
+    Status = VariableServiceGetNextVariableInternal (Name, &Guid, VariableStoreList, &Variable, AuthFormat);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    UT_ASSERT_TRUE (*Count < TEST_STORE_SIZE / sizeof (VARIABLE_HEADER));
+    UT_ASSERT_TRUE (NameSizeOfVariable (Variable, AuthFormat) <= sizeof (Name));
+    Variables[(*Count)++] = Variable;
+    CopyMem (Name, GetVariableNamePtr (Variable, AuthFormat), NameSizeOfVariable (Variable, AuthFormat));
+    CopyGuid (&Guid, GetVendorGuidPtr (Variable, AuthFormat));
+  }
+
+  mVariableStoreIndex[VariableStoreTypeNv].Disabled = Disabled;
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that VariableServiceGetNextVariableInternal() enumerates the same
+  variables with the index as by walking the store, before and after
+  ExitBootServices().
+
+  @retval UNIT_TEST_PASSED       The same variables are enumerated.
+
+**/
+UNIT_TEST_STATUS
+CheckEnumeration (
+  VOID
+  )
+{
+  VARIABLE_HEADER  **Expected;
+  VARIABLE_HEADER  **Actual;
+  UINTN            ExpectedCount;
+  UINTN            ActualCount;
+  UINTN            Mode;
+
+  Expected = AllocatePool (TEST_STORE_SIZE / sizeof (VARIABLE_HEADER) * sizeof (VARIABLE_HEADER *));
+  Actual   = AllocatePool (TEST_STORE_SIZE / sizeof (VARIABLE_HEADER) * sizeof (VARIABLE_HEADER *));
+  UT_ASSERT_NOT_NULL (Expected);
+  UT_ASSERT_NOT_NULL (Actual);
+
+  for (Mode = 0; Mode < 2; Mode++) {
+    mAtRuntime = (BOOLEAN) (Mode != 0);
+    UT_ASSERT_EQUAL (EnumerateVariables (FALSE, Expected, &ExpectedCount), UNIT_TEST_PASSED);
+    UT_ASSERT_EQUAL (EnumerateVariables (TRUE, Actual, &ActualCount), UNIT_TEST_PASSED);
+    UT_ASSERT_EQUAL (ActualCount, ExpectedCount);
+    UT_ASSERT_MEM_EQUAL (Actual, Expected, ActualCount * sizeof (VARIABLE_HEADER *));
+  }
+
+  mAtRuntime = FALSE;
+  FreePool (Expected);
+  FreePool (Actual);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Updates, deletes and reclaims variables as UpdateVariable() does, and
+  checks that the index finds the same variables as FindVariableEx().
+
+  The updates go through the names with a stride prime to their count, and
+  through the GUIDs in turn. One update in eight deletes the variable, one in
+  sixteen leaves the old variable in deleted transition, as a reset during
+  UpdateVariable() does, and one in thirty-two leaves a header of a variable
+  whose data was not written. One update in three is indexed by
+  UpdateVariableStoreIndex() and the others by the search that follows them. The variables are also
+  enumerated, with the index and without it, every few updates.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The index finds the same variables.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexFindsVariables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_POINTER_TRACK  Variable;
+  VARIABLE_HEADER         *NewVariable;
+  UINTN                   Update;
+  UINTN                   Name;
+  UINTN                   Guid;
+  UINT32                  Attributes;
+  UINTN                   Reclaims;
+
+  Reclaims = 0;
+  for (Update = 0; Update < TEST_UPDATE_COUNT; Update++) {
+    if (mLastVariableOffset + TEST_RECLAIM_THRESHOLD > mStore->Size) {
+      ReclaimStore ();
+      Reclaims++;
+    }
+
+    Name = (Update * 37) % TEST_NAME_COUNT;
+    Guid = Update % TEST_GUID_COUNT;
+
+    ZeroMem (&Variable, sizeof (Variable));
+    Variable.StartPtr = GetStartPointer (mStore);
+    Variable.EndPtr   = GetEndPointer (mStore);
+    FindVariableEx (mNames[Name], &mGuids[Guid], TRUE, &Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+
+    if (Variable.InDeletedTransitionPtr != NULL) {
+      Variable.InDeletedTransitionPtr->State &= VAR_DELETED;
+    }
+
+    if ((Variable.CurrPtr != NULL) && (Update % 8 == 5)) {
+      //
+      // Delete the variable.
+      //
+      Variable.CurrPtr->State &= VAR_DELETED;
+    } else {
+      Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+      if ((Name % 2) == 0) {
+        Attributes |= EFI_VARIABLE_RUNTIME_ACCESS;
+      }
+
+      if (Variable.CurrPtr != NULL) {
+        Variable.CurrPtr->State &= VAR_IN_DELETED_TRANSITION;
+      }
+
+      NewVariable = AppendVariable (mNames[Name], &mGuids[Guid], Attributes, VAR_ADDED);
+      UT_ASSERT_NOT_NULL (NewVariable);
+
+      if ((Variable.CurrPtr != NULL) && (Update % 16 != 3)) {
+        Variable.CurrPtr->State &= VAR_DELETED;
+      }
+
+      if (Update % 32 == 7) {
+        //
+        // A header whose data was not written.
+        //
+        NewVariable = AppendVariable (mNames[(Update * 13) % TEST_NAME_COUNT], &mGuids[Guid], Attributes, VAR_HEADER_VALID_ONLY);
+        UT_ASSERT_NOT_NULL (NewVariable);
+        SetMem (GetVariableNamePtr (NewVariable, mVariableModuleGlobal->VariableGlobal.AuthFormat), NameSizeOfVariable (NewVariable, mVariableModuleGlobal->VariableGlobal.AuthFormat), 0xff);
+      }
+
+      if (Update % 3 == 0) {
+        UpdateVariableStoreIndex (VariableStoreTypeNv);
+      }
+    }
+
+    if ((Update % TEST_CHECK_INTERVAL) == 0) {
+      UT_ASSERT_EQUAL (CheckIndex (), UNIT_TEST_PASSED);
+      UT_ASSERT_EQUAL (CheckEnumeration (), UNIT_TEST_PASSED);
+    }
+  }
+
+  UT_ASSERT_EQUAL (CheckIndex (), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckEnumeration (), UNIT_TEST_PASSED);
+  UT_ASSERT_TRUE (Reclaims > 0);
+  UT_ASSERT_FALSE (mVariableStoreIndex[VariableStoreTypeNv].Disabled);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the index is not used for a variable store it does not index,
+  nor while the store holds a variable whose name does not end at the end of
+  its NameSize, and that it is used again once a reclaim removed it.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The index is only used when it is complete.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexIsOnlyUsedWhenComplete (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_POINTER_TRACK  Variable;
+  VARIABLE_HEADER         *Malformed;
+  BOOLEAN                 AuthFormat;
+
+  AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  UT_ASSERT_NOT_NULL (AppendVariable (mNames[1], &mGuids[0], EFI_VARIABLE_BOOTSERVICE_ACCESS, VAR_ADDED));
+
+  ZeroMem (&Variable, sizeof (Variable));
+  Variable.StartPtr = GetStartPointer ((VARIABLE_STORE_HEADER *) mReclaimBuffer);
+  Variable.EndPtr   = GetEndPointer ((VARIABLE_STORE_HEADER *) mReclaimBuffer);
+  UT_ASSERT_STATUS_EQUAL (FindVariableInStoreIndex (mNames[1], &mGuids[0], FALSE, &Variable, VariableStoreTypeNv), EFI_UNSUPPORTED);
+
+  Variable.StartPtr = GetStartPointer (mStore);
+  Variable.EndPtr   = GetEndPointer (mStore);
+  UT_ASSERT_NOT_EFI_ERROR (FindVariableInStoreIndex (mNames[1], &mGuids[0], FALSE, &Variable, VariableStoreTypeNv));
+
+  //
+  // A name with a Null-terminator before the end of its NameSize.
+  //
+  Malformed = AppendVariable (L"Boot00000", &mGuids[0], EFI_VARIABLE_BOOTSERVICE_ACCESS, VAR_ADDED);
+  UT_ASSERT_NOT_NULL (Malformed);
+  GetVariableNamePtr (Malformed, AuthFormat)[4] = L'\0';
+  UT_ASSERT_STATUS_EQUAL (FindVariableInStoreIndex (mNames[1], &mGuids[0], FALSE, &Variable, VariableStoreTypeNv), EFI_UNSUPPORTED);
+  UT_ASSERT_TRUE (mVariableStoreIndex[VariableStoreTypeNv].Disabled);
+
+  Malformed->State &= VAR_DELETED;
+  ReclaimStore ();
+  UT_ASSERT_FALSE (mVariableStoreIndex[VariableStoreTypeNv].Disabled);
+  UT_ASSERT_EQUAL (CheckIndex (), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the variable
+  store index and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "Variable Store Index", "Variable.Index", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description--------------------------------------------Class Name--------------------Function---------------------Pre-------------------Post---------------Context
+  AddTestCase (IndexTests, "The index finds auth variables as a walk does",       "IndexFindsAuthVariables",     IndexFindsVariables,         CreateVariableStore, FreeVariableStore, &mAuthFormat);
+  AddTestCase (IndexTests, "The index finds variables as a walk does",            "IndexFindsVariables",         IndexFindsVariables,         CreateVariableStore, FreeVariableStore, &mNormalFormat);
+  AddTestCase (IndexTests, "The index is only used when it is complete",          "IndexIsOnlyUsedWhenComplete", IndexIsOnlyUsedWhenComplete, CreateVariableStore, FreeVariableStore, &mAuthFormat);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
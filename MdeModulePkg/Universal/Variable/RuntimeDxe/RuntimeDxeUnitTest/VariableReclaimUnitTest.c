@@ -0,0 +1,444 @@
+/** @file
+  Host based unit test of the writes of a reclaim of the non-volatile
+  variable store.
+
+  The test writes buffers that differ from the store in a few blocks with
+  FtwVariableSpace(), through a Fault Tolerant Write protocol that writes to
+  a firmware volume in memory, and checks that only the blocks that changed
+  are written.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Variable.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "Variable Reclaim Unit Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_BLOCK_SIZE        SIZE_4KB
+#define TEST_BLOCK_COUNT       8
+//
+// The store begins in the middle of the first block of the firmware volume,
+// and ends in the middle of its fifth block.
+//
+#define TEST_STORE_OFFSET      (TEST_BLOCK_SIZE / 2)
+#define TEST_STORE_SIZE        (4 * TEST_BLOCK_SIZE)
+#define TEST_STORE_BLOCKS      5
+
+typedef struct {
+  UINTN    WriteCount;
+  EFI_LBA  Lba;
+  UINTN    Offset;
+  UINTN    Length;
+} TEST_FTW_WRITE;
+
+VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
+VARIABLE_MODULE_GLOBAL  mTestModuleGlobal;
+UINT8                   *mFlash;
+VARIABLE_STORE_HEADER   *mBuffer;
+TEST_FTW_WRITE          mFtwWrite;
+
+/**
+  Returns the base address of the firmware volume of the test.
+
+  @param[in]  This              Unused.
+  @param[out] Address           The base address of the firmware volume.
+
+  @retval EFI_SUCCESS           The address is returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetPhysicalAddress (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT      EFI_PHYSICAL_ADDRESS                *Address
+  )
+{
+  *Address = (EFI_PHYSICAL_ADDRESS) (UINTN) mFlash;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the size of the blocks of the firmware volume of the test.
+
+  @param[in]  This              Unused.
+  @param[in]  Lba               The block.
+  @param[out] BlockSize         The size of the block.
+  @param[out] NumberOfBlocks    The number of blocks from Lba on.
+
+  @retval EFI_SUCCESS           The size is returned.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFvbGetBlockSize (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN       EFI_LBA                             Lba,
+  OUT      UINTN                               *BlockSize,
+  OUT      UINTN                               *NumberOfBlocks
+  )
+{
+  *BlockSize      = TEST_BLOCK_SIZE;
+  *NumberOfBlocks = TEST_BLOCK_COUNT - (UINTN) Lba;
+  return EFI_SUCCESS;
+}
+
+/**
+  Records a fault tolerant write and writes it to the firmware volume of the
+  test.
+
+  @param[in] This               Unused.
+  @param[in] Lba                The block to write to.
+  @param[in] Offset             The offset in the block.
+  @param[in] Length             The number of bytes to write.
+  @param[in] PrivateData        Unused.
+  @param[in] FvBlockHandle      Unused.
+  @param[in] Buffer             The bytes to write.
+
+  @retval EFI_SUCCESS           The bytes are written.
+
+**/
+EFI_STATUS
+EFIAPI
+TestFtwWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *This,
+  IN EFI_LBA                            Lba,
+  IN UINTN                              Offset,
+  IN UINTN                              Length,
+  IN VOID                               *PrivateData,
+  IN EFI_HANDLE                         FvBlockHandle,
+  IN VOID                               *Buffer
+  )
+{
+  mFtwWrite.WriteCount++;
+  mFtwWrite.Lba    = Lba;
+  mFtwWrite.Offset = Offset;
+  mFtwWrite.Length = Length;
+  CopyMem (mFlash + (UINTN) Lba * TEST_BLOCK_SIZE + Offset, Buffer, Length);
+  return EFI_SUCCESS;
+}
+
+EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  mTestFvb = {
+  NULL,
+  NULL,
+  TestFvbGetPhysicalAddress,
+  TestFvbGetBlockSize
+};
+
+EFI_FAULT_TOLERANT_WRITE_PROTOCOL  mTestFtw = {
+  NULL,
+  NULL,
+  TestFtwWrite
+};
+
+/**
+  Get the proper fvb handle and/or fvb protocol by the given Flash address.
+
+  @param[in]  Address       The Flash address.
+  @param[out] FvbHandle     In output, if it is not NULL, it points to the proper FVB handle.
+  @param[out] FvbProtocol   In output, if it is not NULL, it points to the proper FVB protocol.
+
+  @retval EFI_SUCCESS       The firmware volume of the test is returned.
+
+**/
+EFI_STATUS
+GetFvbInfoByAddress (
+  IN  EFI_PHYSICAL_ADDRESS                Address,
+  OUT EFI_HANDLE                          *FvbHandle OPTIONAL,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvbProtocol OPTIONAL
+  )
+{
+  if (FvbHandle != NULL) {
+    *FvbHandle = (EFI_HANDLE) &mTestFvb;
+  }
+
+  if (FvbProtocol != NULL) {
+    *FvbProtocol = &mTestFvb;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get Fault Tolerant Write protocol interface.
+
+  @param[out] FtwProtocol       The interface of Ftw protocol
+
+  @retval EFI_SUCCESS           The Fault Tolerant Write protocol of the test is returned.
+
+**/
+EFI_STATUS
+GetFtwProtocol (
+  OUT VOID                                **FtwProtocol
+  )
+{
+  *FtwProtocol = &mTestFtw;
+  return EFI_SUCCESS;
+}
+
+/**
+  Builds a firmware volume with a variable store, and a buffer with the same
+  content as the store.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The firmware volume is built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+  VARIABLE_STORE_HEADER       *Store;
+  UINTN                       Index;
+
+  mVariableModuleGlobal = &mTestModuleGlobal;
+  ZeroMem (mVariableModuleGlobal, sizeof (*mVariableModuleGlobal));
+  ZeroMem (&mFtwWrite, sizeof (mFtwWrite));
+
+  mFlash  = AllocatePool (TEST_BLOCK_SIZE * TEST_BLOCK_COUNT);
+  mBuffer = AllocatePool (TEST_STORE_SIZE);
+  UT_ASSERT_NOT_NULL (mFlash);
+  UT_ASSERT_NOT_NULL (mBuffer);
+
+  for (Index = 0; Index < TEST_BLOCK_SIZE * TEST_BLOCK_COUNT; Index++) {
+    mFlash[Index] = (UINT8) (Index * 7);
+  }
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) mFlash;
+  ZeroMem (FvHeader, sizeof (*FvHeader));
+  FvHeader->FvLength              = TEST_BLOCK_SIZE * TEST_BLOCK_COUNT;
+  FvHeader->HeaderLength          = sizeof (*FvHeader);
+  FvHeader->BlockMap[0].NumBlocks = TEST_BLOCK_COUNT;
+  FvHeader->BlockMap[0].Length    = TEST_BLOCK_SIZE;
+
+  Store = (VARIABLE_STORE_HEADER *) (mFlash + TEST_STORE_OFFSET);
+  ZeroMem (Store, sizeof (*Store));
+  CopyGuid (&Store->Signature, &gEfiAuthenticatedVariableGuid);
+  Store->Size   = TEST_STORE_SIZE;
+  Store->Format = VARIABLE_STORE_FORMATTED;
+  Store->State  = VARIABLE_STORE_HEALTHY;
+
+  CopyMem (mBuffer, Store, TEST_STORE_SIZE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the firmware volume and the buffer of the test.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePool (mFlash);
+  FreePool (mBuffer);
+}
+
+/**
+  Writes the buffer of the test to the store after changing the bytes of the
+  buffer at the offsets given, and checks the blocks written.
+
+  @param  ChangeOffsets          The offsets in the store of the bytes to change.
+  @param  ChangeCount            The number of offsets.
+  @param  Lba                    The first block expected to be written.
+  @param  Offset                 The offset in that block expected to be written.
+  @param  BlockCount             The number of blocks expected to be written.
+  @param  Length                 The number of bytes expected to be written.
+
+  @retval UNIT_TEST_PASSED       The blocks expected are written.
+
+**/
+UNIT_TEST_STATUS
+CheckReclaimWrite (
+  IN UINTN    *ChangeOffsets,
+  IN UINTN    ChangeCount,
+  IN EFI_LBA  Lba,
+  IN UINTN    Offset,
+  IN UINTN    BlockCount,
+  IN UINTN    Length
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  for (Index = 0; Index < ChangeCount; Index++) {
+    ((UINT8 *) mBuffer)[ChangeOffsets[Index]] ^= 0x5A;
+  }
+
+  Status = FtwVariableSpace ((EFI_PHYSICAL_ADDRESS) (UINTN) (mFlash + TEST_STORE_OFFSET), mBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->ReclaimStatistics.LastStoreBlocks, TEST_STORE_BLOCKS);
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->ReclaimStatistics.LastWrittenBlocks, BlockCount);
+  if (BlockCount == 0) {
+    UT_ASSERT_EQUAL (mFtwWrite.WriteCount, 0);
+  } else {
+    UT_ASSERT_EQUAL (mFtwWrite.WriteCount, 1);
+    UT_ASSERT_EQUAL (mFtwWrite.Lba, Lba);
+    UT_ASSERT_EQUAL (mFtwWrite.Offset, Offset);
+    UT_ASSERT_EQUAL (mFtwWrite.Length, Length);
+  }
+
+  UT_ASSERT_MEM_EQUAL (mFlash + TEST_STORE_OFFSET, mBuffer, TEST_STORE_SIZE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that a store that did not change is not written.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Nothing is written.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnchangedStoreIsNotWritten (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  return CheckReclaimWrite (NULL, 0, 0, 0, 0, 0);
+}
+
+/**
+  Checks that a change in a single block writes that block only.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The block is written.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ChangedBlockIsWritten (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Offsets[2];
+
+  //
+  // Two bytes of the third block of the firmware volume.
+  //
+  Offsets[0] = 2 * TEST_BLOCK_SIZE - TEST_STORE_OFFSET;
+  Offsets[1] = 3 * TEST_BLOCK_SIZE - TEST_STORE_OFFSET - 1;
+  return CheckReclaimWrite (Offsets, ARRAY_SIZE (Offsets), 2, 0, 1, TEST_BLOCK_SIZE);
+}
+
+/**
+  Checks that changes in two blocks write these blocks and those between
+  them with one write.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The blocks are written.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ChangedBlockRangeIsWritten (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Offsets[2];
+
+  Offsets[0] = TEST_BLOCK_SIZE - TEST_STORE_OFFSET + 0x10;
+  Offsets[1] = 3 * TEST_BLOCK_SIZE - TEST_STORE_OFFSET + 0x20;
+  return CheckReclaimWrite (Offsets, ARRAY_SIZE (Offsets), 1, 0, 3, 3 * TEST_BLOCK_SIZE);
+}
+
+/**
+  Checks that changes in the first and the last block of the store, which
+  the store shares with the rest of the firmware volume, write the store
+  only.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The whole store is written.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ChangedStoreEndsAreWritten (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Offsets[2];
+
+  Offsets[0] = OFFSET_OF (VARIABLE_STORE_HEADER, State);
+  Offsets[1] = TEST_STORE_SIZE - 1;
+  return CheckReclaimWrite (Offsets, ARRAY_SIZE (Offsets), 0, TEST_STORE_OFFSET, TEST_STORE_BLOCKS, TEST_STORE_SIZE);
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the writes
+  of a reclaim and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ReclaimTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&ReclaimTests, Framework, "Variable Reclaim Writes", "Variable.Reclaim", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ReclaimTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite---------Description--------------------------------------------Class Name-------------------------Function--------------------------Pre--------Post------Context
+  AddTestCase (ReclaimTests, "An unchanged store is not written",                   "UnchangedStoreIsNotWritten",      UnchangedStoreIsNotWritten,      CreateFlash, FreeFlash, NULL);
+  AddTestCase (ReclaimTests, "A changed block is written alone",                    "ChangedBlockIsWritten",           ChangedBlockIsWritten,           CreateFlash, FreeFlash, NULL);
+  AddTestCase (ReclaimTests, "The blocks between changed blocks are written",       "ChangedBlockRangeIsWritten",      ChangedBlockRangeIsWritten,      CreateFlash, FreeFlash, NULL);
+  AddTestCase (ReclaimTests, "Changes at the ends of the store write the store",    "ChangedStoreEndsAreWritten",      ChangedStoreEndsAreWritten,      CreateFlash, FreeFlash, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
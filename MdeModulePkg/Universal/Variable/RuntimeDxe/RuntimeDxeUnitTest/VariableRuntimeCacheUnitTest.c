@@ -0,0 +1,384 @@
+/** @file
+  Host based unit test of the synchronization of the runtime variable caches.
+
+  The test synchronizes ranges of the variable stores with their runtime
+  caches, while the runtime cache read lock is held and while it is free, and
+  checks that only the ranges synchronized are copied to the runtime caches,
+  and that the store generation is only incremented when a runtime cache is
+  copied from its start.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableRuntimeCache.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "Variable Runtime Cache Unit Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_STORE_SIZE        SIZE_4KB
+#define TEST_CACHE_ERASED      0xFF
+
+VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
+VARIABLE_MODULE_GLOBAL  mTestModuleGlobal;
+VARIABLE_STORE_HEADER   *mNvVariableCache;
+VARIABLE_STORE_HEADER   *mVolatileStore;
+VARIABLE_STORE_HEADER   *mNvRuntimeCache;
+VARIABLE_STORE_HEADER   *mVolatileRuntimeCache;
+UINT8                   *mExpected;
+BOOLEAN                 mReadLock;
+BOOLEAN                 mPendingUpdate;
+BOOLEAN                 mHobFlushComplete;
+UINT32                  mStoreGeneration;
+
+/**
+  Return TRUE if ExitBootServices () has been called.
+
+  @retval TRUE If ExitBootServices () has been called.
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Allocates a variable store of the test, or a runtime cache of one.
+
+  @param[in]  Fill              The byte an erased runtime cache is filled with,
+                                or 0 to fill a variable store with a pattern
+                                that differs at every offset.
+
+  @return The variable store, or NULL if it cannot be allocated.
+
+**/
+VARIABLE_STORE_HEADER *
+CreateStore (
+  IN UINT8  Fill
+  )
+{
+  UINT8  *Store;
+  UINTN  Index;
+
+  Store = AllocatePool (TEST_STORE_SIZE);
+  if (Store == NULL) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < TEST_STORE_SIZE; Index++) {
+    Store[Index] = (Fill != 0) ? Fill : (UINT8) (Index * 7 + 1);
+  }
+
+  if (Fill == 0) {
+    ((VARIABLE_STORE_HEADER *) Store)->Size = TEST_STORE_SIZE;
+  }
+
+  return (VARIABLE_STORE_HEADER *) Store;
+}
+
+/**
+  Builds the non-volatile and volatile variable stores of the test and their
+  runtime caches, and sets up the runtime cache context as the variable
+  module that works with the DXE_SMM variable module does.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The runtime caches are built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateRuntimeCaches (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT  *CacheContext;
+
+  mVariableModuleGlobal = &mTestModuleGlobal;
+  ZeroMem (mVariableModuleGlobal, sizeof (*mVariableModuleGlobal));
+
+  mNvVariableCache      = CreateStore (0);
+  mVolatileStore        = CreateStore (0);
+  mNvRuntimeCache       = CreateStore (TEST_CACHE_ERASED);
+  mVolatileRuntimeCache = CreateStore (TEST_CACHE_ERASED);
+  mExpected             = AllocatePool (TEST_STORE_SIZE);
+  UT_ASSERT_NOT_NULL (mNvVariableCache);
+  UT_ASSERT_NOT_NULL (mVolatileStore);
+  UT_ASSERT_NOT_NULL (mNvRuntimeCache);
+  UT_ASSERT_NOT_NULL (mVolatileRuntimeCache);
+  UT_ASSERT_NOT_NULL (mExpected);
+  CopyMem (mExpected, mNvRuntimeCache, TEST_STORE_SIZE);
+
+  mVariableModuleGlobal->VariableGlobal.VolatileVariableBase = (EFI_PHYSICAL_ADDRESS) (UINTN) mVolatileStore;
+
+  mReadLock         = FALSE;
+  mPendingUpdate    = FALSE;
+  mHobFlushComplete = FALSE;
+  mStoreGeneration  = 0;
+
+  CacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+  CacheContext->ReadLock                           = &mReadLock;
+  CacheContext->PendingUpdate                      = &mPendingUpdate;
+  CacheContext->HobFlushComplete                   = &mHobFlushComplete;
+  CacheContext->StoreGeneration                    = &mStoreGeneration;
+  CacheContext->VariableRuntimeNvCache.Store       = mNvRuntimeCache;
+  CacheContext->VariableRuntimeVolatileCache.Store = mVolatileRuntimeCache;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the variable stores of the test and their runtime caches.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeRuntimeCaches (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePool (mNvVariableCache);
+  FreePool (mVolatileStore);
+  FreePool (mNvRuntimeCache);
+  FreePool (mVolatileRuntimeCache);
+  FreePool (mExpected);
+}
+
+/**
+  Synchronizes a range of the non-volatile store with its runtime cache, and
+  records the range in the expected content of the runtime cache.
+
+  @param  Offset                 The offset of the range.
+  @param  Length                 The length of the range.
+
+  @retval UNIT_TEST_PASSED       The range was synchronized.
+
+**/
+UNIT_TEST_STATUS
+SynchronizeNvRange (
+  IN UINTN  Offset,
+  IN UINTN  Length
+  )
+{
+  UT_ASSERT_NOT_EFI_ERROR (
+    SynchronizeRuntimeVariableCache (
+      &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+      Offset,
+      Length
+      )
+    );
+  CopyMem (mExpected + Offset, (UINT8 *) mNvVariableCache + Offset, Length);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the updates synchronized while the read lock is held are only
+  copied once it is free, each to its own range, and that updates that
+  overlap or adjoin are merged.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Only the ranges synchronized are copied.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UpdatesAreCopiedAtTheirOffsets (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE  *NvCache;
+  UINT8                   Erased[TEST_STORE_SIZE];
+
+  NvCache = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache;
+  SetMem (Erased, sizeof (Erased), TEST_CACHE_ERASED);
+
+  mReadLock = TRUE;
+  UT_ASSERT_EQUAL (SynchronizeNvRange (100, 8), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (SynchronizeNvRange (300, 1), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (SynchronizeNvRange (108, 4), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (SynchronizeNvRange (2000, 16), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (SynchronizeNvRange (296, 8), UNIT_TEST_PASSED);
+
+  //
+  // The state of a variable that is not in the store is not synchronized.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (SynchronizeRuntimeVariableCacheState (NvCache, mNvVariableCache, NULL));
+  UT_ASSERT_NOT_EFI_ERROR (
+    SynchronizeRuntimeVariableCacheState (NvCache, mNvVariableCache, GetStartPointer (mVolatileStore))
+    );
+
+  UT_ASSERT_TRUE (mPendingUpdate);
+  UT_ASSERT_EQUAL (NvCache->PendingUpdateCount, 3);
+  UT_ASSERT_MEM_EQUAL (mNvRuntimeCache, Erased, TEST_STORE_SIZE);
+
+  mReadLock = FALSE;
+  UT_ASSERT_NOT_EFI_ERROR (FlushPendingRuntimeVariableCacheUpdates ());
+  UT_ASSERT_FALSE (mPendingUpdate);
+  UT_ASSERT_EQUAL (NvCache->PendingUpdateCount, 0);
+  UT_ASSERT_MEM_EQUAL (mNvRuntimeCache, mExpected, TEST_STORE_SIZE);
+  UT_ASSERT_MEM_EQUAL (mVolatileRuntimeCache, Erased, TEST_STORE_SIZE);
+  UT_ASSERT_EQUAL (mStoreGeneration, 0);
+
+  //
+  // With the read lock free, an update is copied at once.
+  //
+  UT_ASSERT_EQUAL (SynchronizeNvRange (3000, 2), UNIT_TEST_PASSED);
+  UT_ASSERT_FALSE (mPendingUpdate);
+  UT_ASSERT_MEM_EQUAL (mNvRuntimeCache, mExpected, TEST_STORE_SIZE);
+  UT_ASSERT_EQUAL (mStoreGeneration, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the pending updates are merged into one once the runtime cache
+  holds as many as it can.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The updates are merged and copied.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TooManyUpdatesAreMerged (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE  *NvCache;
+  UINTN                   Index;
+  UINTN                   First;
+  UINTN                   Last;
+
+  NvCache = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache;
+  First   = 100;
+  Last    = First + 200 * VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES + 4;
+
+  mReadLock = TRUE;
+  for (Index = 0; Index < VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES; Index++) {
+    UT_ASSERT_EQUAL (SynchronizeNvRange (First + 200 * Index, 4), UNIT_TEST_PASSED);
+    UT_ASSERT_EQUAL (NvCache->PendingUpdateCount, Index + 1);
+  }
+
+  UT_ASSERT_EQUAL (SynchronizeNvRange (Last - 4, 4), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (NvCache->PendingUpdateCount, 1);
+  UT_ASSERT_EQUAL (NvCache->PendingUpdateOffset[0], First);
+  UT_ASSERT_EQUAL (NvCache->PendingUpdateLength[0], Last - First);
+
+  mReadLock = FALSE;
+  UT_ASSERT_NOT_EFI_ERROR (FlushPendingRuntimeVariableCacheUpdates ());
+  CopyMem (mExpected + First, (UINT8 *) mNvVariableCache + First, Last - First);
+  UT_ASSERT_MEM_EQUAL (mNvRuntimeCache, mExpected, TEST_STORE_SIZE);
+  UT_ASSERT_EQUAL (mStoreGeneration, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the store generation is incremented when a runtime cache is
+  copied from its start, as after a reclaim, and only then.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The store generation is incremented.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StoreCopyIncrementsGeneration (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE  *VolatileCache;
+  VARIABLE_HEADER         *Variable;
+
+  VolatileCache = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache;
+
+  mReadLock = TRUE;
+  UT_ASSERT_EQUAL (SynchronizeNvRange (500, 8), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (SynchronizeNvRange (0, TEST_STORE_SIZE), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mStoreGeneration, 0);
+
+  mReadLock = FALSE;
+  UT_ASSERT_NOT_EFI_ERROR (FlushPendingRuntimeVariableCacheUpdates ());
+  UT_ASSERT_MEM_EQUAL (mNvRuntimeCache, mNvVariableCache, TEST_STORE_SIZE);
+  UT_ASSERT_EQUAL (mStoreGeneration, 1);
+
+  //
+  // The state of a variable is copied alone.
+  //
+  Variable = (VARIABLE_HEADER *) ((UINTN) GetStartPointer (mVolatileStore) + 64);
+  UT_ASSERT_NOT_EFI_ERROR (SynchronizeRuntimeVariableCacheState (VolatileCache, mVolatileStore, Variable));
+  UT_ASSERT_EQUAL (((VARIABLE_HEADER *) ((UINTN) Variable - (UINTN) mVolatileStore + (UINTN) mVolatileRuntimeCache))->State, Variable->State);
+  UT_ASSERT_EQUAL (((VARIABLE_HEADER *) ((UINTN) Variable - (UINTN) mVolatileStore + (UINTN) mVolatileRuntimeCache))->Attributes, 0xFFFFFFFF);
+  UT_ASSERT_EQUAL (mStoreGeneration, 1);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  synchronization of the runtime variable caches and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      RuntimeCacheTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&RuntimeCacheTests, Framework, "Variable Runtime Cache Synchronization", "Variable.RuntimeCache", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for RuntimeCacheTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite--------------Description--------------------------------------------Class Name------------------------Function-------------------------Pre-------------------Post---------------Context
+  AddTestCase (RuntimeCacheTests, "Updates are copied at their offsets",                  "UpdatesAreCopiedAtTheirOffsets", UpdatesAreCopiedAtTheirOffsets, CreateRuntimeCaches, FreeRuntimeCaches, NULL);
+  AddTestCase (RuntimeCacheTests, "Too many pending updates are merged",                  "TooManyUpdatesAreMerged",        TooManyUpdatesAreMerged,        CreateRuntimeCaches, FreeRuntimeCaches, NULL);
+  AddTestCase (RuntimeCacheTests, "A copy of a whole store increments the generation",    "StoreCopyIncrementsGeneration",  StoreCopyIncrementsGeneration,  CreateRuntimeCaches, FreeRuntimeCaches, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
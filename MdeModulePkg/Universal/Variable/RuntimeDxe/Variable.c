@@ -28,6 +28,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "VariableNonVolatile.h"
 #include "VariableParsing.h"
 #include "VariableRuntimeCache.h"
+#include "VariableIndex.h"
 
 VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
 
@@ -63,6 +64,12 @@ VAR_CHECK_REQUEST_SOURCE mRequestSource       = VarCheckFromUntrusted;
 //
 VAR_ERROR_FLAG         mCurrentBootVarErrFlag = VAR_ERROR_FLAG_NO_ERROR;
 
+///
+/// The state of the non-volatile variable store when the current batch of
+/// updates began.
+///
+VARIABLE_BATCH_STATE   mVariableBatchState;
+
 VARIABLE_ENTRY_PROPERTY mVariableEntryProperty[] = {
   {
     &gEdkiiVarErrorFlagGuid,
@@ -337,8 +344,8 @@ RecordVarErrorFlag (
       *VarErrFlag = TempFlag;
       Status =  SynchronizeRuntimeVariableCache (
                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
-                  0,
-                  mNvVariableCache->Size
+                  (UINTN) VarErrFlag - (UINTN) mNvVariableCache,
+                  sizeof (TempFlag)
                   );
       ASSERT_EFI_ERROR (Status);
     }
@@ -538,6 +545,7 @@ Reclaim (
   VARIABLE_HEADER       *UpdatingVariable;
   VARIABLE_HEADER       *UpdatingInDeletedTransition;
   BOOLEAN               AuthFormat;
+  VARIABLE_RECLAIM_STATISTICS *Statistics;
 
   AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
   UpdatingVariable = NULL;
@@ -747,6 +755,21 @@ Reclaim (
               (VARIABLE_STORE_HEADER *) ValidBuffer
               );
     if (!EFI_ERROR (Status)) {
+      Statistics = &mVariableModuleGlobal->ReclaimStatistics;
+      Statistics->ReclaimCount++;
+      if (mVariableModuleGlobal->NonVolatileLastVariableOffset > (UINTN) CurrPtr - (UINTN) ValidBuffer) {
+        Statistics->ReclaimedSize += mVariableModuleGlobal->NonVolatileLastVariableOffset - ((UINTN) CurrPtr - (UINTN) ValidBuffer);
+      }
+      DEBUG ((
+        DEBUG_INFO,
+        "Variable driver: Reclaim wrote %d of %d blocks (%ld of %ld in %d reclaims)\n",
+        Statistics->LastWrittenBlocks,
+        Statistics->LastStoreBlocks,
+        Statistics->WrittenBlocks,
+        Statistics->StoreBlocks,
+        Statistics->ReclaimCount
+        ));
+
       *LastVariableOffset = (UINTN) CurrPtr - (UINTN) ValidBuffer;
       mVariableModuleGlobal->HwErrVariableTotalSize = HwErrVariableTotalSize;
       mVariableModuleGlobal->CommonVariableTotalSize = CommonVariableTotalSize;
@@ -778,7 +801,9 @@ Done:
   DoneStatus = EFI_SUCCESS;
   if (IsVolatile || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
     DoneStatus = SynchronizeRuntimeVariableCache (
-                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache,
+                   IsVolatile ?
+                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache :
+                   &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
                    0,
                    VariableStoreHeader->Size
                    );
@@ -797,6 +822,11 @@ Done:
     ASSERT_EFI_ERROR (DoneStatus);
   }
 
+  //
+  // The variables have moved, so index them again.
+  //
+  RebuildVariableStoreIndex (IsVolatile ? VariableStoreTypeVolatile : VariableStoreTypeNv);
+
   if (!EFI_ERROR (Status) && EFI_ERROR (DoneStatus)) {
     Status = DoneStatus;
   }
@@ -868,11 +898,12 @@ FindVariable (
     PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader[Type]);
     PtrTrack->Volatile = (BOOLEAN) (Type == VariableStoreTypeVolatile);
 
-    Status =  FindVariableEx (
+    Status =  FindVariableInStore (
                 VariableName,
                 VendorGuid,
                 IgnoreRtCheck,
                 PtrTrack,
+                Type,
                 mVariableModuleGlobal->VariableGlobal.AuthFormat
                 );
     if (!EFI_ERROR (Status)) {
@@ -1650,6 +1681,11 @@ UpdateVariable (
   BOOLEAN                             IsCommonUserVariable;
   AUTHENTICATED_VARIABLE_HEADER       *AuthVariable;
   BOOLEAN                             AuthFormat;
+  VARIABLE_STORE_HEADER               *CacheStoreHeader;
+  UINTN                               StartVariableOffset;
+  UINTN                               LastVariableOffset;
+  UINTN                               NvLastVariableOffset;
+  UINTN                               VolatileLastVariableOffset;
 
   if (mVariableModuleGlobal->FvbInstance == NULL && !mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
     //
@@ -1673,6 +1709,12 @@ UpdateVariable (
 
   AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
 
+  //
+  // The variables appended from these offsets are copied to the runtime cache.
+  //
+  NvLastVariableOffset       = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  VolatileLastVariableOffset = mVariableModuleGlobal->VolatileLastVariableOffset;
+
   //
   // Check if CacheVariable points to the variable in variable HOB.
   // If yes, let CacheVariable points to the variable in NV variable cache.
@@ -2189,6 +2231,7 @@ UpdateVariable (
     }
 
     mVariableModuleGlobal->NonVolatileLastVariableOffset += HEADER_ALIGN (VarSize);
+    UpdateVariableStoreIndex (VariableStoreTypeNv);
 
     if ((Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) {
       mVariableModuleGlobal->HwErrVariableTotalSize += HEADER_ALIGN (VarSize);
@@ -2246,6 +2289,7 @@ UpdateVariable (
     }
 
     mVariableModuleGlobal->VolatileLastVariableOffset += HEADER_ALIGN (VarSize);
+    UpdateVariableStoreIndex (VariableStoreTypeVolatile);
   }
 
   //
@@ -2306,17 +2350,33 @@ Done:
   if (!EFI_ERROR (Status)) {
     if ((Variable->CurrPtr != NULL && !Variable->Volatile) || (Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
       VolatileCacheInstance = &(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache);
+      CacheStoreHeader      = mNvVariableCache;
+      LastVariableOffset    = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+      StartVariableOffset   = NvLastVariableOffset;
     } else {
       VolatileCacheInstance = &(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache);
+      CacheStoreHeader      = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+      LastVariableOffset    = mVariableModuleGlobal->VolatileLastVariableOffset;
+      StartVariableOffset   = VolatileLastVariableOffset;
     }
 
     if (VolatileCacheInstance->Store != NULL) {
-      Status =  SynchronizeRuntimeVariableCache (
-                  VolatileCacheInstance,
-                  0,
-                  VolatileCacheInstance->Store->Size
-                  );
+      //
+      // Copy the states of the old variables and the variable appended to the runtime cache.
+      // A reclaim has copied the whole store already.
+      //
+      Status = SynchronizeRuntimeVariableCacheState (VolatileCacheInstance, CacheStoreHeader, CacheVariable->InDeletedTransitionPtr);
       ASSERT_EFI_ERROR (Status);
+      Status = SynchronizeRuntimeVariableCacheState (VolatileCacheInstance, CacheStoreHeader, CacheVariable->CurrPtr);
+      ASSERT_EFI_ERROR (Status);
+      if (LastVariableOffset > StartVariableOffset) {
+        Status =  SynchronizeRuntimeVariableCache (
+                    VolatileCacheInstance,
+                    StartVariableOffset,
+                    LastVariableOffset - StartVariableOffset
+                    );
+        ASSERT_EFI_ERROR (Status);
+      }
     }
   }
 
@@ -2804,6 +2864,169 @@ Done:
   return Status;
 }
 
+/**
+  Starts a batch of updates of non-volatile variables.
+
+  Until EndVariableBatch() is called, the non-volatile variables are only
+  updated in the memory copy of the variable store, so that the updates of
+  the batch are written to the flash together, or discarded together.
+
+  @retval EFI_SUCCESS             The batch is started.
+  @retval EFI_ALREADY_STARTED     A batch is already started.
+  @retval EFI_NOT_AVAILABLE_YET   The non-volatile variables cannot be written yet.
+  @retval EFI_UNSUPPORTED         The non-volatile variables are emulated, or
+                                  variables of the variable HOB are not yet
+                                  flushed to the flash.
+
+**/
+EFI_STATUS
+BeginVariableBatch (
+  VOID
+  )
+{
+  if (mVariableBatchState.Active) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  if (mVariableModuleGlobal->VariableGlobal.EmuNvMode ||
+      (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (mVariableModuleGlobal->FvbInstance == NULL) {
+    return EFI_NOT_AVAILABLE_YET;
+  }
+
+  mVariableBatchState.NonVolatileVariableBase       = mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  mVariableBatchState.NonVolatileLastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  mVariableBatchState.CommonVariableTotalSize       = mVariableModuleGlobal->CommonVariableTotalSize;
+  mVariableBatchState.CommonUserVariableTotalSize   = mVariableModuleGlobal->CommonUserVariableTotalSize;
+  mVariableBatchState.HwErrVariableTotalSize        = mVariableModuleGlobal->HwErrVariableTotalSize;
+  mVariableBatchState.CurrentBootVarErrFlag         = mCurrentBootVarErrFlag;
+  mVariableBatchState.Active                        = TRUE;
+
+  //
+  // Update the memory copy of the flash as in emulated non-volatile variable
+  // mode. A reclaim then compacts the memory copy too.
+  //
+  mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = (EFI_PHYSICAL_ADDRESS) (UINTN) mNvVariableCache;
+  mVariableModuleGlobal->VariableGlobal.EmuNvMode               = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Sets a variable of the batch started by BeginVariableBatch().
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+
+  @return EFI_INVALID_PARAMETER           The variable is not non-volatile, is an
+                                          authenticated variable, or is Lang or
+                                          PlatformLang.
+  @return Others                          The status returned by VariableServiceSetVariable().
+
+**/
+EFI_STATUS
+SetVariableInBatch (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data
+  )
+{
+  ASSERT (mVariableBatchState.Active);
+
+  //
+  // Volatile variables are not in the memory copy of the flash, and the
+  // authenticated variables update the state of the AuthVariableLib, so
+  // neither could be discarded with the batch. Lang and PlatformLang also
+  // update each other and the language of the module.
+  //
+  if (((Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) ||
+      ((Attributes & VARIABLE_ATTRIBUTE_AT_AW) != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (CompareGuid (VendorGuid, &gEfiGlobalVariableGuid) &&
+      ((StrCmp (VariableName, EFI_PLATFORM_LANG_VARIABLE_NAME) == 0) ||
+       (StrCmp (VariableName, EFI_LANG_VARIABLE_NAME) == 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return VariableServiceSetVariable (VariableName, VendorGuid, Attributes, DataSize, Data);
+}
+
+/**
+  Ends the batch started by BeginVariableBatch().
+
+  If Commit is TRUE, the non-volatile variable store is written to the flash
+  with a single fault tolerant write. Otherwise, or if the write fails, the
+  updates of the batch are discarded.
+
+  @param[in] Commit               TRUE to write the updates of the batch.
+
+  @retval EFI_SUCCESS             The updates of the batch are written, or discarded
+                                  as requested.
+  @retval Others                  The updates of the batch could not be written,
+                                  and are discarded.
+
+**/
+EFI_STATUS
+EndVariableBatch (
+  IN BOOLEAN                 Commit
+  )
+{
+  EFI_STATUS  Status;
+  EFI_STATUS  DoneStatus;
+
+  ASSERT (mVariableBatchState.Active);
+
+  mVariableModuleGlobal->VariableGlobal.EmuNvMode               = FALSE;
+  mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = mVariableBatchState.NonVolatileVariableBase;
+  mVariableBatchState.Active                                         = FALSE;
+
+  Status = EFI_SUCCESS;
+  if (Commit) {
+    //
+    // Only the blocks that the batch changed are written.
+    //
+    Status = FtwVariableSpace (mVariableBatchState.NonVolatileVariableBase, mNvVariableCache);
+    if (!EFI_ERROR (Status)) {
+      return EFI_SUCCESS;
+    }
+  }
+
+  //
+  // Discard the updates of the batch.
+  //
+  CopyMem (
+    mNvVariableCache,
+    (UINT8 *) (UINTN) mVariableBatchState.NonVolatileVariableBase,
+    mNvVariableCache->Size
+    );
+  mVariableModuleGlobal->NonVolatileLastVariableOffset = mVariableBatchState.NonVolatileLastVariableOffset;
+  mVariableModuleGlobal->CommonVariableTotalSize       = mVariableBatchState.CommonVariableTotalSize;
+  mVariableModuleGlobal->CommonUserVariableTotalSize   = mVariableBatchState.CommonUserVariableTotalSize;
+  mVariableModuleGlobal->HwErrVariableTotalSize        = mVariableBatchState.HwErrVariableTotalSize;
+  mCurrentBootVarErrFlag                               = mVariableBatchState.CurrentBootVarErrFlag;
+  RebuildVariableStoreIndex (VariableStoreTypeNv);
+
+  DoneStatus = SynchronizeRuntimeVariableCache (
+                 &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+                 0,
+                 mNvVariableCache->Size
+                 );
+  ASSERT_EFI_ERROR (DoneStatus);
+
+  return Status;
+}
+
 /**
 
   This code returns information about the EFI variables.
@@ -3269,6 +3492,7 @@ FlushHobVariableToFlash (
         *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.HobFlushComplete) = TRUE;
       }
       if (!AtRuntime ()) {
+        FreeVariableStoreIndex (VariableStoreTypeHob);
         FreePool ((VOID *) VariableStoreHeader);
       }
     }
@@ -3658,6 +3882,19 @@ VariableCommonInitialize (
   VolatileVariableStore->Reserved    = 0;
   VolatileVariableStore->Reserved1   = 0;
 
+  //
+  // Index the variables of the variable stores for FindVariable().
+  //
+  InitializeVariableStoreIndex (VariableStoreTypeVolatile, VolatileVariableStore, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+  if (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) {
+    InitializeVariableStoreIndex (
+      VariableStoreTypeHob,
+      (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase,
+      mVariableModuleGlobal->VariableGlobal.AuthFormat
+      );
+  }
+  InitializeVariableStoreIndex (VariableStoreTypeNv, mNvVariableCache, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+
   return EFI_SUCCESS;
 }
 
@@ -64,9 +64,16 @@ typedef enum {
   VariableStoreTypeMax
 } VARIABLE_STORE_TYPE;
 
+///
+/// The number of ranges of a runtime cache that are kept apart while they
+/// wait to be copied. Beyond it, they are merged into one range.
+///
+#define VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES  8
+
 typedef struct {
-  UINT32                  PendingUpdateOffset;
-  UINT32                  PendingUpdateLength;
+  UINT32                  PendingUpdateCount;
+  UINT32                  PendingUpdateOffset[VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES];
+  UINT32                  PendingUpdateLength[VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES];
   VARIABLE_STORE_HEADER   *Store;
 } VARIABLE_RUNTIME_CACHE;
 
@@ -74,6 +81,11 @@ typedef struct {
   BOOLEAN                 *ReadLock;
   BOOLEAN                 *PendingUpdate;
   BOOLEAN                 *HobFlushComplete;
+  //
+  // Incremented when a runtime cache is copied from its start, as the
+  // variables in it may have been moved.
+  //
+  UINT32                  *StoreGeneration;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeHobCache;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeNvCache;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeVolatileCache;
@@ -105,6 +117,34 @@ typedef struct {
   BOOLEAN                         EmuNvMode;
 } VARIABLE_GLOBAL;
 
+///
+/// The state of the non-volatile variable store when a batch of updates began,
+/// to restore if the batch is discarded.
+///
+typedef struct {
+  BOOLEAN               Active;
+  EFI_PHYSICAL_ADDRESS  NonVolatileVariableBase;
+  UINTN                 NonVolatileLastVariableOffset;
+  UINTN                 CommonVariableTotalSize;
+  UINTN                 CommonUserVariableTotalSize;
+  UINTN                 HwErrVariableTotalSize;
+  VAR_ERROR_FLAG        CurrentBootVarErrFlag;
+} VARIABLE_BATCH_STATE;
+
+///
+/// The cost of the reclaims of the non-volatile variable store, in flash
+/// blocks written, against the blocks of the whole store that a rewrite of
+/// the store would write.
+///
+typedef struct {
+  UINT32          ReclaimCount;
+  UINT64          ReclaimedSize;
+  UINT64          StoreBlocks;
+  UINT64          WrittenBlocks;
+  UINT32          LastStoreBlocks;
+  UINT32          LastWrittenBlocks;
+} VARIABLE_RECLAIM_STATISTICS;
+
 typedef struct {
   VARIABLE_GLOBAL VariableGlobal;
   UINTN           VolatileLastVariableOffset;
@@ -124,6 +164,7 @@ typedef struct {
   CHAR8           *PlatformLang;
   CHAR8           Lang[ISO_639_2_ENTRY_SIZE + 1];
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL *FvbInstance;
+  VARIABLE_RECLAIM_STATISTICS        ReclaimStatistics;
 } VARIABLE_MODULE_GLOBAL;
 
 /**
@@ -145,6 +186,8 @@ FlushHobVariableToFlash (
   This function writes a buffer to variable storage space into a firmware
   volume block device. The destination is specified by the parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
+  Only the blocks that differ from the buffer, from the first to the last
+  one, are written.
 
   @param  VariableBase   Base address of the variable to write.
   @param  VariableBuffer Point to the variable data buffer.
@@ -689,6 +732,71 @@ InitializeVariableQuota (
   VOID
   );
 
+/**
+  Starts a batch of updates of non-volatile variables.
+
+  Until EndVariableBatch() is called, the non-volatile variables are only
+  updated in the memory copy of the variable store, so that the updates of
+  the batch are written to the flash together, or discarded together.
+
+  @retval EFI_SUCCESS             The batch is started.
+  @retval EFI_ALREADY_STARTED     A batch is already started.
+  @retval EFI_NOT_AVAILABLE_YET   The non-volatile variables cannot be written yet.
+  @retval EFI_UNSUPPORTED         The non-volatile variables are emulated, or
+                                  variables of the variable HOB are not yet
+                                  flushed to the flash.
+
+**/
+EFI_STATUS
+BeginVariableBatch (
+  VOID
+  );
+
+/**
+  Sets a variable of the batch started by BeginVariableBatch().
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+
+  @return EFI_INVALID_PARAMETER           The variable is not non-volatile, is an
+                                          authenticated variable, or is Lang or
+                                          PlatformLang.
+  @return Others                          The status returned by VariableServiceSetVariable().
+
+**/
+EFI_STATUS
+SetVariableInBatch (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data
+  );
+
+/**
+  Ends the batch started by BeginVariableBatch().
+
+  If Commit is TRUE, the non-volatile variable store is written to the flash
+  with a single fault tolerant write. Otherwise, or if the write fails, the
+  updates of the batch are discarded.
+
+  @param[in] Commit               TRUE to write the updates of the batch.
+
+  @retval EFI_SUCCESS             The updates of the batch are written, or discarded
+                                  as requested.
+  @retval Others                  The updates of the batch could not be written,
+                                  and are discarded.
+
+**/
+EFI_STATUS
+EndVariableBatch (
+  IN BOOLEAN                 Commit
+  );
+
 extern VARIABLE_MODULE_GLOBAL       *mVariableModuleGlobal;
 extern EFI_FIRMWARE_VOLUME_HEADER   *mNvFvHeaderCache;
 extern VARIABLE_STORE_HEADER        *mNvVariableCache;
@@ -0,0 +1,362 @@
+/** @file
+  Hash index of the variable stores, so that a variable is found without
+  walking the variables stored before it.
+
+  Variables are only appended to a variable store, and only their states are
+  updated in place, until a reclaim moves them. The index of a store keeps the
+  offset of the store it has indexed up to, indexes the variables appended
+  after it before every search, and is built again after a reclaim. The index
+  only holds offsets, and the variables it returns are checked as the store is
+  walked, so a variable deleted since it was indexed is not returned.
+
+  Caution: This module requires additional review when modified.
+  This driver will have external input - variable data. They may be input in SMM mode.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+
+//
+// FNV-1a hash of the name and the GUID of a variable.
+//
+#define VARIABLE_INDEX_HASH_BASIS  0x811C9DC5
+#define VARIABLE_INDEX_HASH_PRIME  0x01000193
+
+VARIABLE_STORE_INDEX  mVariableStoreIndex[VariableStoreTypeMax];
+
+/**
+  Returns the hash of the name and the GUID of a variable.
+
+  @param[in] VariableName   The name of the variable.
+  @param[in] NameLength     The number of characters of the name, without the
+                            Null-terminator.
+  @param[in] VendorGuid     The GUID of the variable.
+
+  @return The hash of the name and the GUID.
+
+**/
+STATIC
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16    *VariableName,
+  IN UINTN           NameLength,
+  IN CONST EFI_GUID  *VendorGuid
+  )
+{
+  CONST UINT8  *Guid;
+  UINT32       Hash;
+  UINTN        Index;
+
+  Hash = VARIABLE_INDEX_HASH_BASIS;
+  for (Index = 0; Index < NameLength; Index++) {
+    Hash = (Hash ^ VariableName[Index]) * VARIABLE_INDEX_HASH_PRIME;
+  }
+
+  Guid = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Guid[Index]) * VARIABLE_INDEX_HASH_PRIME;
+  }
+
+  return Hash;
+}
+
+/**
+  Adds a variable to the index of its variable store.
+
+  @param[in, out] StoreIndex    The index of the variable store.
+  @param[in]      Variable      The header of the variable.
+  @param[in]      AuthFormat    TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+
+  @retval TRUE    The variable was added to the index.
+  @retval FALSE   The index is full, or the name of the variable is not
+                  Null-terminated at the end of its NameSize.
+
+**/
+STATIC
+BOOLEAN
+VariableIndexInsert (
+  IN OUT VARIABLE_STORE_INDEX  *StoreIndex,
+  IN     VARIABLE_HEADER       *Variable,
+  IN     BOOLEAN               AuthFormat
+  )
+{
+  CHAR16  *Name;
+  UINTN   NameSize;
+  UINTN   NameLength;
+  UINT32  Slot;
+
+  if (StoreIndex->Count == StoreIndex->MaxCount) {
+    return FALSE;
+  }
+
+  //
+  // FindVariableEx() compares NameSize bytes, so the name is only found by
+  // its hash if it ends at the end of NameSize.
+  //
+  Name     = GetVariableNamePtr (Variable, AuthFormat);
+  NameSize = NameSizeOfVariable (Variable, AuthFormat);
+  if ((NameSize < sizeof (CHAR16)) || ((NameSize % sizeof (CHAR16)) != 0)) {
+    return FALSE;
+  }
+
+  for (NameLength = 0; Name[NameLength] != 0; NameLength++) {
+    if (NameLength == NameSize / sizeof (CHAR16) - 1) {
+      return FALSE;
+    }
+  }
+
+  if (NameLength != NameSize / sizeof (CHAR16) - 1) {
+    return FALSE;
+  }
+
+  Slot = VariableIndexHash (Name, NameLength, GetVendorGuidPtr (Variable, AuthFormat)) & StoreIndex->SlotMask;
+  while (StoreIndex->Slots[Slot] != 0) {
+    Slot = (Slot + 1) & StoreIndex->SlotMask;
+  }
+
+  StoreIndex->Slots[Slot] = (UINT32) ((UINTN) Variable - (UINTN) StoreIndex->Store);
+  StoreIndex->Count++;
+  return TRUE;
+}
+
+/**
+  Indexes the variables of a variable store from the first one that has not
+  been indexed yet.
+
+  Only the variables that are added or in deleted transition are indexed, as
+  the state of the others is never set back to one of them.
+
+  @param[in, out] StoreIndex    The index of the variable store.
+
+**/
+STATIC
+VOID
+VariableIndexSync (
+  IN OUT VARIABLE_STORE_INDEX  *StoreIndex
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  VARIABLE_HEADER  *EndPtr;
+  BOOLEAN          AuthFormat;
+
+  AuthFormat = StoreIndex->AuthFormat;
+  EndPtr     = GetEndPointer (StoreIndex->Store);
+  for ( Variable = (VARIABLE_HEADER *) ((UINTN) StoreIndex->Store + StoreIndex->IndexedEnd)
+      ; IsValidVariableHeader (Variable, EndPtr)
+      ; Variable = GetNextVariablePtr (Variable, AuthFormat)
+      ) {
+    if ((Variable->State == VAR_ADDED) || (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      if (!VariableIndexInsert (StoreIndex, Variable, AuthFormat)) {
+        DEBUG ((DEBUG_INFO, "Variable driver: variable store 0x%p is searched without index\n", StoreIndex->Store));
+        StoreIndex->Disabled = TRUE;
+        return;
+      }
+    }
+  }
+
+  StoreIndex->IndexedEnd = (UINTN) Variable - (UINTN) StoreIndex->Store;
+}
+
+/**
+  Allocates the index of a variable store and indexes the variables in it.
+
+  If the index cannot be allocated, the variables of the store are found by
+  walking the store.
+
+  @param[in] Type                 The type of the variable store.
+  @param[in] VariableStoreHeader  The variable store.
+  @param[in] AuthFormat           TRUE indicates authenticated variables are used.
+                                  FALSE indicates authenticated variables are not used.
+
+**/
+VOID
+InitializeVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type,
+  IN VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN BOOLEAN                AuthFormat
+  )
+{
+  VARIABLE_STORE_INDEX  *StoreIndex;
+  UINTN                 MinVariableSize;
+  UINT32                MaxCount;
+  UINT32                SlotCount;
+
+  StoreIndex = &mVariableStoreIndex[Type];
+  ZeroMem (StoreIndex, sizeof (*StoreIndex));
+
+  //
+  // A variable has a name of one character and one byte of data at least,
+  // and the index is kept at most half full.
+  //
+  MinVariableSize = HEADER_ALIGN (GetVariableHeaderSize (AuthFormat) + 2 * sizeof (CHAR16) + 1);
+  MaxCount        = (UINT32) (VariableStoreHeader->Size / MinVariableSize) + 1;
+  SlotCount       = GetPowerOfTwo32 (2 * MaxCount);
+  if (SlotCount < 2 * MaxCount) {
+    SlotCount <<= 1;
+  }
+
+  StoreIndex->Slots = AllocateRuntimeZeroPool (SlotCount * sizeof (UINT32));
+  if (StoreIndex->Slots == NULL) {
+    return;
+  }
+
+  StoreIndex->Store      = VariableStoreHeader;
+  StoreIndex->AuthFormat = AuthFormat;
+  StoreIndex->SlotMask   = SlotCount - 1;
+  StoreIndex->MaxCount   = SlotCount / 2;
+  StoreIndex->IndexedEnd = (UINTN) GetStartPointer (VariableStoreHeader) - (UINTN) VariableStoreHeader;
+  VariableIndexSync (StoreIndex);
+}
+
+/**
+  Frees the index of a variable store that is no longer used.
+
+  @param[in] Type                 The type of the variable store.
+
+**/
+VOID
+FreeVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  if (mVariableStoreIndex[Type].Slots != NULL) {
+    FreePool (mVariableStoreIndex[Type].Slots);
+  }
+
+  ZeroMem (&mVariableStoreIndex[Type], sizeof (mVariableStoreIndex[Type]));
+}
+
+/**
+  Indexes the variables appended to a variable store since it was last
+  indexed.
+
+  @param[in] Type                 The type of the variable store.
+
+**/
+VOID
+UpdateVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  VARIABLE_STORE_INDEX  *StoreIndex;
+
+  StoreIndex = &mVariableStoreIndex[Type];
+  if ((StoreIndex->Slots != NULL) && !StoreIndex->Disabled) {
+    VariableIndexSync (StoreIndex);
+  }
+}
+
+/**
+  Indexes the variables of a variable store again, after its variables
+  were moved by a reclaim.
+
+  @param[in] Type                 The type of the variable store.
+
+**/
+VOID
+RebuildVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  VARIABLE_STORE_INDEX  *StoreIndex;
+
+  StoreIndex = &mVariableStoreIndex[Type];
+  if (StoreIndex->Slots == NULL) {
+    return;
+  }
+
+  ZeroMem (StoreIndex->Slots, (StoreIndex->SlotMask + 1) * sizeof (UINT32));
+  StoreIndex->Count      = 0;
+  StoreIndex->Disabled   = FALSE;
+  StoreIndex->IndexedEnd = (UINTN) GetStartPointer (StoreIndex->Store) - (UINTN) StoreIndex->Store;
+  VariableIndexSync (StoreIndex);
+}
+
+/**
+  Find the variable in the specified variable store with its index.
+
+  The variable found is the one FindVariableEx() finds in the store.
+
+  @param[in]       VariableName        Name of the variable to be found.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+                                       StartPtr and EndPtr are those of the variable store.
+  @param[in]       Type                The type of the variable store.
+
+  @retval          EFI_SUCCESS         Variable found successfully.
+  @retval          EFI_NOT_FOUND       Variable not found.
+  @retval          EFI_UNSUPPORTED     The variable store has no index, and must
+                                       be searched by FindVariableEx().
+**/
+EFI_STATUS
+FindVariableInStoreIndex (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     VARIABLE_STORE_TYPE     Type
+  )
+{
+  VARIABLE_STORE_INDEX  *StoreIndex;
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *InDeletedVariable;
+  UINTN                 NameLength;
+  UINT32                Slot;
+  BOOLEAN               AuthFormat;
+
+  StoreIndex = &mVariableStoreIndex[Type];
+  if ((StoreIndex->Slots == NULL) || StoreIndex->Disabled ||
+      (PtrTrack->StartPtr != GetStartPointer (StoreIndex->Store))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  VariableIndexSync (StoreIndex);
+  if (StoreIndex->Disabled) {
+    return EFI_UNSUPPORTED;
+  }
+
+  AuthFormat        = StoreIndex->AuthFormat;
+  NameLength        = StrLen (VariableName);
+  InDeletedVariable = NULL;
+  PtrTrack->InDeletedTransitionPtr = NULL;
+
+  for ( Slot = VariableIndexHash (VariableName, NameLength, VendorGuid) & StoreIndex->SlotMask
+      ; StoreIndex->Slots[Slot] != 0
+      ; Slot = (Slot + 1) & StoreIndex->SlotMask
+      ) {
+    Variable = (VARIABLE_HEADER *) ((UINTN) StoreIndex->Store + StoreIndex->Slots[Slot]);
+    if ((Variable->State != VAR_ADDED) && (Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      continue;
+    }
+
+    if (!IgnoreRtCheck && AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+      continue;
+    }
+
+    if (!CompareGuid (VendorGuid, GetVendorGuidPtr (Variable, AuthFormat)) ||
+        (NameSizeOfVariable (Variable, AuthFormat) != (NameLength + 1) * sizeof (CHAR16)) ||
+        (CompareMem (VariableName, GetVariableNamePtr (Variable, AuthFormat), NameLength * sizeof (CHAR16)) != 0)) {
+      continue;
+    }
+
+    if (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      InDeletedVariable = Variable;
+    } else {
+      PtrTrack->CurrPtr                = Variable;
+      PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+      return EFI_SUCCESS;
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
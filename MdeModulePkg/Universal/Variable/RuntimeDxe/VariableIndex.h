@@ -0,0 +1,129 @@
+/** @file
+  The hash index of the variable stores shared by the DXE_RUNTIME variable
+  module and the DXE_SMM variable module, and of the runtime variable caches
+  of the variable module that works with the DXE_SMM variable module.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_INDEX_H_
+#define _VARIABLE_INDEX_H_
+
+#include "Variable.h"
+
+///
+/// The hash index of a variable store. It maps the hash of the name and the
+/// GUID of the valid variables to the offsets of their headers in the store,
+/// with linear probing, so that the headers of a variable are found in the
+/// order they are in the store.
+///
+typedef struct {
+  VARIABLE_STORE_HEADER  *Store;
+  //
+  // The offsets of the variable headers from Store, 0 for a free slot.
+  //
+  UINT32                 *Slots;
+  UINT32                 SlotMask;
+  UINT32                 Count;
+  UINT32                 MaxCount;
+  //
+  // The offset of the first variable header that has not been indexed yet.
+  //
+  UINTN                  IndexedEnd;
+  //
+  // TRUE if the variables of the store are authenticated variables.
+  //
+  BOOLEAN                AuthFormat;
+  //
+  // TRUE if the store holds more variables, or variables with names of
+  // another form, than the index can hold. The store is then walked.
+  //
+  BOOLEAN                Disabled;
+} VARIABLE_STORE_INDEX;
+
+extern VARIABLE_STORE_INDEX  mVariableStoreIndex[VariableStoreTypeMax];
+
+/**
+  Allocates the index of a variable store and indexes the variables in it.
+
+  If the index cannot be allocated, the variables of the store are found by
+  walking the store.
+
+  @param[in] Type                 The type of the variable store.
+  @param[in] VariableStoreHeader  The variable store.
+  @param[in] AuthFormat           TRUE indicates authenticated variables are used.
+                                  FALSE indicates authenticated variables are not used.
+
+**/
+VOID
+InitializeVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type,
+  IN VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN BOOLEAN                AuthFormat
+  );
+
+/**
+  Frees the index of a variable store that is no longer used.
+
+  @param[in] Type                 The type of the variable store.
+
+**/
+VOID
+FreeVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  );
+
+/**
+  Indexes the variables appended to a variable store since it was last
+  indexed.
+
+  @param[in] Type                 The type of the variable store.
+
+**/
+VOID
+UpdateVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  );
+
+/**
+  Indexes the variables of a variable store again, after its variables
+  were moved by a reclaim.
+
+  @param[in] Type                 The type of the variable store.
+
+**/
+VOID
+RebuildVariableStoreIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  );
+
+/**
+  Find the variable in the specified variable store with its index.
+
+  The variable found is the one FindVariableEx() finds in the store.
+
+  @param[in]       VariableName        Name of the variable to be found.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+                                       StartPtr and EndPtr are those of the variable store.
+  @param[in]       Type                The type of the variable store.
+
+  @retval          EFI_SUCCESS         Variable found successfully.
+  @retval          EFI_NOT_FOUND       Variable not found.
+  @retval          EFI_UNSUPPORTED     The variable store has no index, and must
+                                       be searched by FindVariableEx().
+**/
+EFI_STATUS
+FindVariableInStoreIndex (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     VARIABLE_STORE_TYPE     Type
+  );
+
+#endif
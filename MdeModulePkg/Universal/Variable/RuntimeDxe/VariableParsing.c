@@ -8,6 +8,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "VariableParsing.h"
+#include "VariableIndex.h"
 
 /**
 
@@ -508,6 +509,49 @@ FindVariableEx (
   return (PtrTrack->CurrPtr  == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
 }
 
+/**
+  Find the variable in the specified variable store with the index of the
+  store, or by walking the store if the store has no index.
+
+  @param[in]       VariableName        Name of the variable to be found
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       StoreType           The type of the variable store.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+**/
+EFI_STATUS
+FindVariableInStore (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     VARIABLE_STORE_TYPE     StoreType,
+  IN     BOOLEAN                 AuthFormat
+  )
+{
+  EFI_STATUS  Status;
+
+  //
+  // An empty name finds the first variable of the store, which has no hash.
+  //
+  Status = EFI_UNSUPPORTED;
+  if (VariableName[0] != 0) {
+    Status = FindVariableInStoreIndex (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack, StoreType);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    Status = FindVariableEx (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack, AuthFormat);
+  }
+
+  return Status;
+}
+
 /**
   This code finds the next available variable.
 
@@ -563,7 +607,7 @@ VariableServiceGetNextVariableInternal (
     Variable.EndPtr   = GetEndPointer   (VariableStoreList[StoreType]);
     Variable.Volatile = (BOOLEAN) (StoreType == VariableStoreTypeVolatile);
 
-    Status = FindVariableEx (VariableName, VendorGuid, FALSE, &Variable, AuthFormat);
+    Status = FindVariableInStore (VariableName, VendorGuid, FALSE, &Variable, StoreType, AuthFormat);
     if (!EFI_ERROR (Status)) {
       break;
     }
@@ -642,11 +686,12 @@ VariableServiceGetNextVariableInternal (
           //
           VariablePtrTrack.StartPtr = Variable.StartPtr;
           VariablePtrTrack.EndPtr = Variable.EndPtr;
-          Status = FindVariableEx (
+          Status = FindVariableInStore (
                      GetVariableNamePtr (Variable.CurrPtr, AuthFormat),
                      GetVendorGuidPtr (Variable.CurrPtr, AuthFormat),
                      FALSE,
                      &VariablePtrTrack,
+                     StoreType,
                      AuthFormat
                      );
           if (!EFI_ERROR (Status) && VariablePtrTrack.CurrPtr->State == VAR_ADDED) {
@@ -663,11 +708,12 @@ VariableServiceGetNextVariableInternal (
            ) {
           VariableInHob.StartPtr = GetStartPointer (VariableStoreList[VariableStoreTypeHob]);
           VariableInHob.EndPtr   = GetEndPointer   (VariableStoreList[VariableStoreTypeHob]);
-          Status = FindVariableEx (
+          Status = FindVariableInStore (
                      GetVariableNamePtr (Variable.CurrPtr, AuthFormat),
                      GetVendorGuidPtr (Variable.CurrPtr, AuthFormat),
                      FALSE,
                      &VariableInHob,
+                     VariableStoreTypeHob,
                      AuthFormat
                      );
           if (!EFI_ERROR (Status)) {
@@ -18,9 +18,110 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 extern VARIABLE_MODULE_GLOBAL   *mVariableModuleGlobal;
 extern VARIABLE_STORE_HEADER    *mNvVariableCache;
 
+/**
+  Copies the pending updates of a runtime variable cache from the variable store it caches.
+
+  @param[in, out] VariableRuntimeCache  Variable runtime cache structure for the runtime cache being updated.
+  @param[in]      VariableStoreBase     The variable store cached by the runtime cache.
+
+  @retval TRUE                    An update copied the runtime cache from its start, so the variables in it
+                                  may have been moved.
+  @retval FALSE                   The updates were copied to the offsets they were made at.
+
+**/
+STATIC
+BOOLEAN
+FlushRuntimeVariableCache (
+  IN OUT  VARIABLE_RUNTIME_CACHE          *VariableRuntimeCache,
+  IN      UINT8                           *VariableStoreBase
+  )
+{
+  UINT32   Index;
+  BOOLEAN  StoreMoved;
+
+  StoreMoved = FALSE;
+  for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+    CopyMem (
+      (VOID *) (((UINT8 *) (UINTN) VariableRuntimeCache->Store) + VariableRuntimeCache->PendingUpdateOffset[Index]),
+      (VOID *) (VariableStoreBase + VariableRuntimeCache->PendingUpdateOffset[Index]),
+      VariableRuntimeCache->PendingUpdateLength[Index]
+      );
+    if (VariableRuntimeCache->PendingUpdateOffset[Index] == 0) {
+      StoreMoved = TRUE;
+    }
+  }
+
+  VariableRuntimeCache->PendingUpdateCount = 0;
+  return StoreMoved;
+}
+
+/**
+  Adds an update to the pending updates of a runtime variable cache.
+
+  An update is merged with the pending updates it overlaps or adjoins. If the runtime cache has as many
+  pending updates as it can hold, they are merged with the update into one.
+
+  @param[in, out] VariableRuntimeCache  Variable runtime cache structure for the runtime cache being synchronized.
+  @param[in]      Offset                Offset in bytes to apply the update.
+  @param[in]      Length                Length of data in bytes of the update.
+
+**/
+STATIC
+VOID
+AddPendingRuntimeVariableCacheUpdate (
+  IN OUT  VARIABLE_RUNTIME_CACHE          *VariableRuntimeCache,
+  IN      UINTN                           Offset,
+  IN      UINTN                           Length
+  )
+{
+  UINT32  Index;
+  UINT32  Count;
+  UINTN   Start;
+  UINTN   End;
+
+  Start = Offset;
+  End   = Offset + Length;
+  Count = VariableRuntimeCache->PendingUpdateCount;
+
+  Index = 0;
+  while (Index < Count) {
+    if ((Start <= (UINTN) VariableRuntimeCache->PendingUpdateOffset[Index] + VariableRuntimeCache->PendingUpdateLength[Index]) &&
+        ((UINTN) VariableRuntimeCache->PendingUpdateOffset[Index] <= End)) {
+      Start = MIN (Start, (UINTN) VariableRuntimeCache->PendingUpdateOffset[Index]);
+      End   = MAX (End, (UINTN) VariableRuntimeCache->PendingUpdateOffset[Index] + VariableRuntimeCache->PendingUpdateLength[Index]);
+
+      //
+      // Remove the merged update, and check the others again against the larger range.
+      //
+      Count--;
+      VariableRuntimeCache->PendingUpdateOffset[Index] = VariableRuntimeCache->PendingUpdateOffset[Count];
+      VariableRuntimeCache->PendingUpdateLength[Index] = VariableRuntimeCache->PendingUpdateLength[Count];
+      Index = 0;
+    } else {
+      Index++;
+    }
+  }
+
+  if (Count == VARIABLE_RUNTIME_CACHE_MAX_PENDING_UPDATES) {
+    for (Index = 0; Index < Count; Index++) {
+      Start = MIN (Start, (UINTN) VariableRuntimeCache->PendingUpdateOffset[Index]);
+      End   = MAX (End, (UINTN) VariableRuntimeCache->PendingUpdateOffset[Index] + VariableRuntimeCache->PendingUpdateLength[Index]);
+    }
+
+    Count = 0;
+  }
+
+  VariableRuntimeCache->PendingUpdateOffset[Count] = (UINT32) Start;
+  VariableRuntimeCache->PendingUpdateLength[Count] = (UINT32) (End - Start);
+  VariableRuntimeCache->PendingUpdateCount         = Count + 1;
+}
+
 /**
   Copies any pending updates to runtime variable caches.
 
+  If an update copied a runtime cache from its start, the store generation is incremented so that the
+  variables in the runtime caches are indexed again.
+
   @retval EFI_UNSUPPORTED         The volatile store to be updated is not initialized properly.
   @retval EFI_SUCCESS             The volatile store was updated successfully.
 
@@ -31,60 +132,38 @@ FlushPendingRuntimeVariableCacheUpdates (
   )
 {
   VARIABLE_RUNTIME_CACHE_CONTEXT    *VariableRuntimeCacheContext;
+  BOOLEAN                           StoreMoved;
 
   VariableRuntimeCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
 
   if (VariableRuntimeCacheContext->VariableRuntimeNvCache.Store == NULL ||
       VariableRuntimeCacheContext->VariableRuntimeVolatileCache.Store == NULL ||
-      VariableRuntimeCacheContext->PendingUpdate == NULL) {
+      VariableRuntimeCacheContext->PendingUpdate == NULL ||
+      VariableRuntimeCacheContext->StoreGeneration == NULL) {
     return EFI_UNSUPPORTED;
   }
 
   if (*(VariableRuntimeCacheContext->PendingUpdate)) {
+    StoreMoved = FALSE;
     if (VariableRuntimeCacheContext->VariableRuntimeHobCache.Store != NULL &&
         mVariableModuleGlobal->VariableGlobal.HobVariableBase > 0) {
-      CopyMem (
-        (VOID *) (
-          ((UINT8 *) (UINTN) VariableRuntimeCacheContext->VariableRuntimeHobCache.Store) +
-          VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset
-          ),
-        (VOID *) (
-          ((UINT8 *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase) +
-          VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset
-          ),
-        VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateLength
-        );
-      VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateLength = 0;
-      VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
+      StoreMoved |= FlushRuntimeVariableCache (
+                      &VariableRuntimeCacheContext->VariableRuntimeHobCache,
+                      (UINT8 *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase
+                      );
     }
 
-    CopyMem (
-      (VOID *) (
-        ((UINT8 *) (UINTN) VariableRuntimeCacheContext->VariableRuntimeNvCache.Store) +
-        VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset
-        ),
-      (VOID *) (
-        ((UINT8 *) (UINTN) mNvVariableCache) +
-        VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset
-        ),
-      VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateLength
-      );
-    VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateLength = 0;
-    VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset = 0;
-
-    CopyMem (
-      (VOID *) (
-        ((UINT8 *) (UINTN) VariableRuntimeCacheContext->VariableRuntimeVolatileCache.Store) +
-        VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset
-      ),
-      (VOID *) (
-        ((UINT8 *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase) +
-        VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset
-        ),
-      VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength
-      );
-    VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength = 0;
-    VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset = 0;
+    StoreMoved |= FlushRuntimeVariableCache (
+                    &VariableRuntimeCacheContext->VariableRuntimeNvCache,
+                    (UINT8 *) mNvVariableCache
+                    );
+    StoreMoved |= FlushRuntimeVariableCache (
+                    &VariableRuntimeCacheContext->VariableRuntimeVolatileCache,
+                    (UINT8 *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase
+                    );
+    if (StoreMoved) {
+      (*(VariableRuntimeCacheContext->StoreGeneration))++;
+    }
     *(VariableRuntimeCacheContext->PendingUpdate) = FALSE;
   }
 
@@ -128,21 +207,10 @@ SynchronizeRuntimeVariableCache (
     return EFI_UNSUPPORTED;
   }
 
-  if (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) &&
-      VariableRuntimeCache->PendingUpdateLength > 0) {
-    VariableRuntimeCache->PendingUpdateLength =
-      (UINT32) (
-        MAX (
-          (UINTN) (VariableRuntimeCache->PendingUpdateOffset + VariableRuntimeCache->PendingUpdateLength),
-          Offset + Length
-        ) - MIN ((UINTN) VariableRuntimeCache->PendingUpdateOffset, Offset)
-      );
-    VariableRuntimeCache->PendingUpdateOffset =
-      (UINT32) MIN ((UINTN) VariableRuntimeCache->PendingUpdateOffset, Offset);
-  } else {
-    VariableRuntimeCache->PendingUpdateLength = (UINT32) Length;
-    VariableRuntimeCache->PendingUpdateOffset = (UINT32) Offset;
+  if (!*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate)) {
+    VariableRuntimeCache->PendingUpdateCount = 0;
   }
+  AddPendingRuntimeVariableCacheUpdate (VariableRuntimeCache, Offset, Length);
   *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) = TRUE;
 
   if (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.ReadLock) == FALSE) {
@@ -151,3 +219,36 @@ SynchronizeRuntimeVariableCache (
 
   return EFI_SUCCESS;
 }
+
+/**
+  Synchronizes the runtime variable cache of a variable store with the state of a variable in the store.
+
+  @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being synchronized.
+  @param[in] VariableStoreHeader  The variable store cached by the runtime cache.
+  @param[in] Variable             The variable whose state was updated. Nothing is synchronized if it is
+                                  NULL or not in the variable store.
+
+  @retval EFI_SUCCESS             The update was added as a pending update successfully. If the variable runtime
+                                  cache ReadLock was available, the runtime cache was updated successfully.
+  @retval EFI_UNSUPPORTED         The volatile store to be updated is not initialized properly.
+
+**/
+EFI_STATUS
+SynchronizeRuntimeVariableCacheState (
+  IN  VARIABLE_RUNTIME_CACHE          *VariableRuntimeCache,
+  IN  VARIABLE_STORE_HEADER           *VariableStoreHeader,
+  IN  VARIABLE_HEADER                 *Variable
+  )
+{
+  if (Variable == NULL ||
+      (UINTN) Variable < (UINTN) GetStartPointer (VariableStoreHeader) ||
+      (UINTN) Variable >= (UINTN) GetEndPointer (VariableStoreHeader)) {
+    return EFI_SUCCESS;
+  }
+
+  return SynchronizeRuntimeVariableCache (
+           VariableRuntimeCache,
+           (UINTN) &Variable->State - (UINTN) VariableStoreHeader,
+           sizeof (Variable->State)
+           );
+}
@@ -15,6 +15,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 /**
   Copies any pending updates to runtime variable caches.
 
+  If an update copied a runtime cache from its start, the store generation is incremented so that the
+  variables in the runtime caches are indexed again.
+
   @retval EFI_UNSUPPORTED         The volatile store to be updated is not initialized properly.
   @retval EFI_SUCCESS             The volatile store was updated successfully.
 
@@ -48,4 +51,24 @@ SynchronizeRuntimeVariableCache (
   IN  UINTN                           Length
   );
 
+/**
+  Synchronizes the runtime variable cache of a variable store with the state of a variable in the store.
+
+  @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being synchronized.
+  @param[in] VariableStoreHeader  The variable store cached by the runtime cache.
+  @param[in] Variable             The variable whose state was updated. Nothing is synchronized if it is
+                                  NULL or not in the variable store.
+
+  @retval EFI_SUCCESS             The update was added as a pending update successfully. If the variable runtime
+                                  cache ReadLock was available, the runtime cache was updated successfully.
+  @retval EFI_UNSUPPORTED         The volatile store to be updated is not initialized properly.
+
+**/
+EFI_STATUS
+SynchronizeRuntimeVariableCacheState (
+  IN  VARIABLE_RUNTIME_CACHE          *VariableRuntimeCache,
+  IN  VARIABLE_STORE_HEADER           *VariableStoreHeader,
+  IN  VARIABLE_HEADER                 *Variable
+  );
+
 #endif
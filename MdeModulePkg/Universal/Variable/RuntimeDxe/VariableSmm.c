@@ -14,7 +14,7 @@
   VariableServiceSetVariable(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
   SmmVariableGetStatistics() should also do validation based on its own knowledge.
 
-Copyright (c) 2010 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2021, Intel Corporation. All rights reserved.<BR>
 Copyright (c) 2018, Linaro, Ltd. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -33,6 +33,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "Variable.h"
 #include "VariableParsing.h"
 #include "VariableRuntimeCache.h"
+#include "VariableSmmBatch.h"
 
 extern VARIABLE_STORE_HEADER                         *mNvVariableCache;
 
@@ -658,6 +659,22 @@ SmmVariableHandler (
                  );
       break;
 
+    case SMM_VARIABLE_FUNCTION_SET_VARIABLE_BATCH:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH)) {
+        DEBUG ((DEBUG_ERROR, "SetVariableBatch: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      //
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      Status = SmmSetVariableBatch (
+                 (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mVariableBufferPayload,
+                 CommBufferPayloadSize
+                 );
+      CopyMem (SmmVariableFunctionHeader->Data, mVariableBufferPayload, CommBufferPayloadSize);
+      break;
+
     case SMM_VARIABLE_FUNCTION_QUERY_VARIABLE_INFO:
       if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_QUERY_VARIABLE_INFO)) {
         DEBUG ((EFI_D_ERROR, "QueryVariableInfo: SMM communication buffer size invalid!\n"));
@@ -824,7 +841,8 @@ SmmVariableHandler (
           RuntimeVariableCacheContext->RuntimeNvCache == NULL ||
           RuntimeVariableCacheContext->PendingUpdate == NULL ||
           RuntimeVariableCacheContext->ReadLock == NULL ||
-          RuntimeVariableCacheContext->HobFlushComplete == NULL) {
+          RuntimeVariableCacheContext->HobFlushComplete == NULL ||
+          RuntimeVariableCacheContext->StoreGeneration == NULL) {
         DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Required runtime cache buffer is NULL!\n"));
         Status = EFI_ACCESS_DENIED;
         goto EXIT;
@@ -888,6 +906,13 @@ SmmVariableHandler (
         Status = EFI_ACCESS_DENIED;
         goto EXIT;
       }
+      if (!VariableSmmIsBufferOutsideSmmValid (
+            (UINTN) RuntimeVariableCacheContext->StoreGeneration,
+            sizeof (*(RuntimeVariableCacheContext->StoreGeneration)))) {
+        DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Runtime cache store generation buffer in SMRAM or overflow!\n"));
+        Status = EFI_ACCESS_DENIED;
+        goto EXIT;
+      }
 
       VariableCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
       VariableCacheContext->VariableRuntimeHobCache.Store      = RuntimeVariableCacheContext->RuntimeHobCache;
@@ -896,24 +921,28 @@ SmmVariableHandler (
       VariableCacheContext->PendingUpdate                      = RuntimeVariableCacheContext->PendingUpdate;
       VariableCacheContext->ReadLock                           = RuntimeVariableCacheContext->ReadLock;
       VariableCacheContext->HobFlushComplete                   = RuntimeVariableCacheContext->HobFlushComplete;
+      VariableCacheContext->StoreGeneration                    = RuntimeVariableCacheContext->StoreGeneration;
 
       // Set up the intial pending request since the RT cache needs to be in sync with SMM cache
-      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength = 0;
+      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateCount = 0;
       if (mVariableModuleGlobal->VariableGlobal.HobVariableBase > 0 &&
           VariableCacheContext->VariableRuntimeHobCache.Store != NULL) {
         VariableCache = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase;
-        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
+        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateCount     = 1;
+        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateOffset[0] = 0;
+        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength[0] = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
         CopyGuid (&(VariableCacheContext->VariableRuntimeHobCache.Store->Signature), &(VariableCache->Signature));
       }
       VariableCache = (VARIABLE_STORE_HEADER  *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
-      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset   = 0;
-      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength   = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateCount     = 1;
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset[0] = 0;
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength[0] = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
       CopyGuid (&(VariableCacheContext->VariableRuntimeVolatileCache.Store->Signature), &(VariableCache->Signature));
 
       VariableCache = (VARIABLE_STORE_HEADER  *) (UINTN) mNvVariableCache;
-      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateLength = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateCount     = 1;
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateOffset[0] = 0;
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateLength[0] = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
       CopyGuid (&(VariableCacheContext->VariableRuntimeNvCache.Store->Signature), &(VariableCache->Signature));
 
       *(VariableCacheContext->PendingUpdate) = TRUE;
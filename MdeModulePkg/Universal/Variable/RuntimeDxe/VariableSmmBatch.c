@@ -0,0 +1,143 @@
+/** @file
+  The SMI handler of the batches of variable updates, shared by the DXE_SMM
+  and the standalone MM variable modules.
+
+  Caution: This module requires additional review when modified.
+  This driver will have external input - communicate buffer in SMM mode.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+  SmmSetVariableBatch() will receive untrusted input and do basic validation.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableSmmBatch.h"
+
+/**
+  Sets the variables of a batch of the communicate buffer with a single update
+  of the variable store.
+
+  Caution: This function may receive untrusted input.
+  The batch is external input, so this function checks that every variable of
+  the batch is inside the batch before any variable is set.
+
+  @param[in, out] Batch         The batch, copied to SMRAM. On return, the status
+                                of each variable is updated.
+  @param[in]      BatchSize     The size of the batch.
+
+  @retval EFI_SUCCESS           All the variables were set.
+  @retval EFI_ACCESS_DENIED     A variable is not inside the batch, or its name
+                                is not a Null-terminated string.
+  @retval EFI_INVALID_PARAMETER The batch has no variable.
+  @retval Others                The status of the variable that could not be set,
+                                or of the update of the variable store.
+
+**/
+EFI_STATUS
+SmmSetVariableBatch (
+  IN OUT SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH  *Batch,
+  IN     UINTN                                        BatchSize
+  )
+{
+  EFI_STATUS                                Status;
+  EFI_STATUS                                EndStatus;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE   *BatchVariable;
+  SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE  *Variable;
+  UINTN                                     Index;
+  UINTN                                     FailedIndex;
+  UINTN                                     Offset;
+  UINTN                                     VariableSize;
+
+  if (Batch->VariableCount == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Check all the variables before any of them is set.
+  //
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+  for (Index = 0; Index < Batch->VariableCount; Index++) {
+    if (BatchSize - Offset < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Variable.Name)) {
+      return EFI_ACCESS_DENIED;
+    }
+
+    Variable = &((SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) ((UINT8 *) Batch + Offset))->Variable;
+    if ((BatchSize - Offset - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Variable.Name) < Variable->NameSize) ||
+        (BatchSize - Offset - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Variable.Name) - Variable->NameSize < Variable->DataSize)) {
+      return EFI_ACCESS_DENIED;
+    }
+
+    VariableSize = SMM_VARIABLE_BATCH_VARIABLE_SIZE (Variable->NameSize, Variable->DataSize);
+    if (VariableSize > BatchSize - Offset) {
+      return EFI_ACCESS_DENIED;
+    }
+
+    //
+    // The VariableSpeculationBarrier() call here is to ensure the previous
+    // range checks for the CommBuffer have been completed before the
+    // subsequent consumption of the CommBuffer content.
+    //
+    VariableSpeculationBarrier ();
+    if ((Variable->NameSize < sizeof (CHAR16)) || (Variable->Name[Variable->NameSize / sizeof (CHAR16) - 1] != L'\0')) {
+      //
+      // Make sure VariableName is A Null-terminated string.
+      //
+      return EFI_ACCESS_DENIED;
+    }
+
+    Offset += VariableSize;
+  }
+
+  Index  = Batch->VariableCount;
+  Status = BeginVariableBatch ();
+  if (!EFI_ERROR (Status)) {
+    Offset = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+    for (Index = 0; Index < Batch->VariableCount; Index++) {
+      BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) ((UINT8 *) Batch + Offset);
+      Variable      = &BatchVariable->Variable;
+      Status = SetVariableInBatch (
+                 Variable->Name,
+                 &Variable->Guid,
+                 Variable->Attributes,
+                 Variable->DataSize,
+                 (UINT8 *) Variable->Name + Variable->NameSize
+                 );
+      BatchVariable->Status = Status;
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      Offset += SMM_VARIABLE_BATCH_VARIABLE_SIZE (Variable->NameSize, Variable->DataSize);
+    }
+
+    EndStatus = EndVariableBatch ((BOOLEAN) !EFI_ERROR (Status));
+    if (!EFI_ERROR (Status)) {
+      Status = EndStatus;
+    }
+  }
+
+  //
+  // If the batch was discarded, the variables other than the one that could
+  // not be set are not set either. If the batch could not be started or
+  // written, none of its variables is set.
+  //
+  if (EFI_ERROR (Status)) {
+    FailedIndex = Index;
+    Offset      = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+    for (Index = 0; Index < Batch->VariableCount; Index++) {
+      BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) ((UINT8 *) Batch + Offset);
+      if (FailedIndex == Batch->VariableCount) {
+        BatchVariable->Status = Status;
+      } else if (Index != FailedIndex) {
+        BatchVariable->Status = EFI_ABORTED;
+      }
+
+      Offset += SMM_VARIABLE_BATCH_VARIABLE_SIZE (BatchVariable->Variable.NameSize, BatchVariable->Variable.DataSize);
+    }
+  }
+
+  return Status;
+}
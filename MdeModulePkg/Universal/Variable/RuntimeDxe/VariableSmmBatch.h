@@ -0,0 +1,42 @@
+/** @file
+  The SMI handler of the batches of variable updates, shared by the DXE_SMM
+  and the standalone MM variable modules.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_SMM_BATCH_H_
+#define _VARIABLE_SMM_BATCH_H_
+
+#include <Guid/SmmVariableCommon.h>
+#include "Variable.h"
+
+/**
+  Sets the variables of a batch of the communicate buffer with a single update
+  of the variable store.
+
+  Caution: This function may receive untrusted input.
+  The batch is external input, so this function checks that every variable of
+  the batch is inside the batch before any variable is set.
+
+  @param[in, out] Batch         The batch, copied to SMRAM. On return, the status
+                                of each variable is updated.
+  @param[in]      BatchSize     The size of the batch.
+
+  @retval EFI_SUCCESS           All the variables were set.
+  @retval EFI_ACCESS_DENIED     A variable is not inside the batch, or its name
+                                is not a Null-terminated string.
+  @retval EFI_INVALID_PARAMETER The batch has no variable.
+  @retval Others                The status of the variable that could not be set,
+                                or of the update of the variable store.
+
+**/
+EFI_STATUS
+SmmSetVariableBatch (
+  IN OUT SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH  *Batch,
+  IN     UINTN                                        BatchSize
+  );
+
+#endif
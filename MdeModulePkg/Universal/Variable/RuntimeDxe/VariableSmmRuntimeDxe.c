@@ -13,7 +13,7 @@
 
   InitCommunicateBuffer() is really function to check the variable data size.
 
-Copyright (c) 2010 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2021, Intel Corporation. All rights reserved.<BR>
 Copyright (c) Microsoft Corporation.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -25,6 +25,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmVariable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -42,6 +43,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "PrivilegePolymorphic.h"
 #include "VariableParsing.h"
+#include "VariableIndex.h"
 
 EFI_HANDLE                       mHandle                    = NULL;
 EFI_SMM_VARIABLE_PROTOCOL       *mSmmVariable               = NULL;
@@ -62,9 +64,12 @@ BOOLEAN                          mVariableRuntimeCachePendingUpdate;
 BOOLEAN                          mVariableRuntimeCacheReadLock;
 BOOLEAN                          mVariableAuthFormat;
 BOOLEAN                          mHobFlushComplete;
+UINT32                           mVariableRuntimeCacheStoreGeneration;
+UINT32                           mVariableStoreIndexGeneration;
 EFI_LOCK                         mVariableServicesLock;
 EDKII_VARIABLE_LOCK_PROTOCOL     mVariableLock;
 EDKII_VAR_CHECK_PROTOCOL         mVarCheck;
+EDKII_VARIABLE_BATCH_PROTOCOL    mVariableBatchProtocol;
 
 /**
   The logic to initialize the VariablePolicy engine is in its own file.
@@ -574,12 +579,40 @@ CheckForRuntimeCacheSync (
   //
   if (mHobFlushComplete && mVariableRuntimeHobCacheBuffer != NULL) {
     if (!EfiAtRuntime ()) {
+      FreeVariableStoreIndex (VariableStoreTypeHob);
       FreePages (mVariableRuntimeHobCacheBuffer, EFI_SIZE_TO_PAGES (mVariableRuntimeHobCacheBufferSize));
     }
     mVariableRuntimeHobCacheBuffer = NULL;
   }
 }
 
+/**
+  Index the variables of the runtime caches again if SMM copied a runtime cache from its start, which may
+  have moved the variables in it, since they were last indexed.
+
+  The variables appended to a runtime cache, and the states updated in it, need no new index. They are
+  indexed, and their states checked, when a variable is found in the runtime cache.
+
+  The runtime cache read lock must be held, so that SMM does not update the runtime caches meanwhile.
+
+**/
+VOID
+CheckForRuntimeCacheIndexUpdate (
+  VOID
+  )
+{
+  VARIABLE_STORE_TYPE  StoreType;
+
+  ASSERT (mVariableRuntimeCacheReadLock);
+
+  if (mVariableStoreIndexGeneration != mVariableRuntimeCacheStoreGeneration) {
+    mVariableStoreIndexGeneration = mVariableRuntimeCacheStoreGeneration;
+    for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+      RebuildVariableStoreIndex (StoreType);
+    }
+  }
+}
+
 /**
   Finds the given variable in a runtime cache variable store.
 
@@ -633,6 +666,8 @@ FindVariableInRuntimeCache (
   CheckForRuntimeCacheSync ();
 
   if (!mVariableRuntimeCachePendingUpdate) {
+    CheckForRuntimeCacheIndexUpdate ();
+
     //
     // 0: Volatile, 1: HOB, 2: Non-Volatile.
     // The index and attributes mapping must be kept in this order as FindVariable
@@ -651,7 +686,7 @@ FindVariableInRuntimeCache (
       RtPtrTrack.EndPtr   = GetEndPointer   (VariableStoreList[StoreType]);
       RtPtrTrack.Volatile = (BOOLEAN) (StoreType == VariableStoreTypeVolatile);
 
-      Status = FindVariableEx (VariableName, VendorGuid, FALSE, &RtPtrTrack, mVariableAuthFormat);
+      Status = FindVariableInStore (VariableName, VendorGuid, FALSE, &RtPtrTrack, StoreType, mVariableAuthFormat);
       if (!EFI_ERROR (Status)) {
         break;
       }
@@ -893,6 +928,8 @@ GetNextVariableNameInRuntimeCache (
 
   mVariableRuntimeCacheReadLock = TRUE;
   if (!mVariableRuntimeCachePendingUpdate) {
+    CheckForRuntimeCacheIndexUpdate ();
+
     //
     // 0: Volatile, 1: HOB, 2: Non-Volatile.
     // The index and attributes mapping must be kept in this order as FindVariable
@@ -1176,6 +1213,135 @@ Done:
 }
 
 
+/**
+  Set several non-volatile variables with a single update of the variable store.
+
+  The variables are sent to SMM in one communicate buffer, so that they are set
+  with a single SMI.
+
+  @param[in]      This           The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      VariableCount  The number of variables to set.
+  @param[in, out] Variables      The variables to set. On return, their Status
+                                 fields are updated.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  VariableCount is 0, or Variables is NULL, or
+                                 a variable has invalid parameters.
+  @retval EFI_BAD_BUFFER_SIZE    The variables do not fit in the communicate buffer.
+  @retval EFI_UNSUPPORTED        The variable store cannot be updated in batches.
+  @retval Others                 The status of the first variable that could not
+                                 be set, or of the update of the variable store.
+                                 No variable was set.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN       UINTN                          VariableCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY     *Variables
+  )
+{
+  EFI_STATUS                                   Status;
+  UINTN                                        Index;
+  UINTN                                        PayloadSize;
+  UINTN                                        VariableNameSize;
+  UINT8                                        *Payload;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH  *Batch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE      *BatchVariable;
+
+  if ((VariableCount == 0) || (Variables == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Check input parameters, and that the variables fit in the SMM payload.
+  //
+  for (Index = 0; Index < VariableCount; Index++) {
+    Variables[Index].Status = EFI_ABORTED;
+  }
+
+  PayloadSize = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+  for (Index = 0; Index < VariableCount; Index++) {
+    if ((Variables[Index].VariableName == NULL) || (Variables[Index].VariableName[0] == 0) ||
+        (Variables[Index].VendorGuid == NULL) ||
+        ((Variables[Index].DataSize != 0) && (Variables[Index].Data == NULL))) {
+      Variables[Index].Status = EFI_INVALID_PARAMETER;
+      return EFI_INVALID_PARAMETER;
+    }
+
+    VariableNameSize = StrSize (Variables[Index].VariableName);
+    if ((VariableNameSize > mVariableBufferPayloadSize) ||
+        (Variables[Index].DataSize > mVariableBufferPayloadSize - VariableNameSize) ||
+        (SMM_VARIABLE_BATCH_VARIABLE_SIZE (VariableNameSize, Variables[Index].DataSize) > mVariableBufferPayloadSize - PayloadSize)) {
+      Variables[Index].Status = EFI_BAD_BUFFER_SIZE;
+      return EFI_BAD_BUFFER_SIZE;
+    }
+
+    PayloadSize += SMM_VARIABLE_BATCH_VARIABLE_SIZE (VariableNameSize, Variables[Index].DataSize);
+  }
+
+  AcquireLockOnlyAtBootTime(&mVariableServicesLock);
+
+  //
+  // Init the communicate buffer. The buffer data size is:
+  // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
+  //
+  Batch  = NULL;
+  Status = InitCommunicateBuffer ((VOID **) &Batch, PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE_BATCH);
+  if (EFI_ERROR (Status)) {
+    for (Index = 0; Index < VariableCount; Index++) {
+      Variables[Index].Status = Status;
+    }
+    goto Done;
+  }
+  ASSERT (Batch != NULL);
+
+  ZeroMem (Batch, PayloadSize);
+  Batch->VariableCount = VariableCount;
+  Payload = (UINT8 *) (Batch + 1);
+  for (Index = 0; Index < VariableCount; Index++) {
+    BatchVariable                      = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) Payload;
+    BatchVariable->Status              = EFI_ABORTED;
+    CopyGuid (&BatchVariable->Variable.Guid, Variables[Index].VendorGuid);
+    BatchVariable->Variable.DataSize   = Variables[Index].DataSize;
+    BatchVariable->Variable.NameSize   = StrSize (Variables[Index].VariableName);
+    BatchVariable->Variable.Attributes = Variables[Index].Attributes;
+    CopyMem (BatchVariable->Variable.Name, Variables[Index].VariableName, BatchVariable->Variable.NameSize);
+    CopyMem (
+      (UINT8 *) BatchVariable->Variable.Name + BatchVariable->Variable.NameSize,
+      Variables[Index].Data,
+      Variables[Index].DataSize
+      );
+    Payload += SMM_VARIABLE_BATCH_VARIABLE_SIZE (BatchVariable->Variable.NameSize, BatchVariable->Variable.DataSize);
+  }
+
+  //
+  // Send data to SMM.
+  //
+  Status = SendCommunicateBuffer (PayloadSize);
+
+  Payload = (UINT8 *) (Batch + 1);
+  for (Index = 0; Index < VariableCount; Index++) {
+    BatchVariable           = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) Payload;
+    Variables[Index].Status = BatchVariable->Status;
+    Payload += SMM_VARIABLE_BATCH_VARIABLE_SIZE (BatchVariable->Variable.NameSize, BatchVariable->Variable.DataSize);
+  }
+
+Done:
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+
+  if (!EfiAtRuntime () && !EFI_ERROR (Status)) {
+    for (Index = 0; Index < VariableCount; Index++) {
+      SecureBootHook (
+        Variables[Index].VariableName,
+        Variables[Index].VendorGuid
+        );
+    }
+  }
+  return Status;
+}
+
+
 /**
   This code returns information about the EFI variables.
 
@@ -1336,11 +1502,17 @@ VariableAddressChangeEvent (
   IN VOID                                   *Context
   )
 {
+  VARIABLE_STORE_TYPE  StoreType;
+
   EfiConvertPointer (0x0, (VOID **) &mVariableBuffer);
   EfiConvertPointer (0x0, (VOID **) &mMmCommunication2);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeHobCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeNvCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeVolatileCacheBuffer);
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableStoreIndex[StoreType].Store);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableStoreIndex[StoreType].Slots);
+  }
 }
 
 /**
@@ -1549,6 +1721,7 @@ SendRuntimeVariableCacheContextToSmm (
   SmmRuntimeVarCacheContext->PendingUpdate = &mVariableRuntimeCachePendingUpdate;
   SmmRuntimeVarCacheContext->ReadLock = &mVariableRuntimeCacheReadLock;
   SmmRuntimeVarCacheContext->HobFlushComplete = &mHobFlushComplete;
+  SmmRuntimeVarCacheContext->StoreGeneration = &mVariableRuntimeCacheStoreGeneration;
 
   //
   // Request to unblock this region to be accessible from inside MM environment
@@ -1578,6 +1751,14 @@ SendRuntimeVariableCacheContextToSmm (
     goto Done;
   }
 
+  Status = MmUnblockMemoryRequest (
+            (EFI_PHYSICAL_ADDRESS) ALIGN_VALUE ((UINTN) SmmRuntimeVarCacheContext->StoreGeneration - EFI_PAGE_SIZE + 1, EFI_PAGE_SIZE),
+            EFI_SIZE_TO_PAGES (sizeof(mVariableRuntimeCacheStoreGeneration))
+            );
+  if (Status != EFI_UNSUPPORTED && EFI_ERROR (Status)) {
+    goto Done;
+  }
+
   //
   // Send data to SMM.
   //
@@ -1657,6 +1838,16 @@ SmmVariableReady (
             Status = SendRuntimeVariableCacheContextToSmm ();
             if (!EFI_ERROR (Status)) {
               SyncRuntimeCache ();
+
+              //
+              // Index the variables of the runtime caches for GetVariable() and GetNextVariableName().
+              //
+              mVariableStoreIndexGeneration = mVariableRuntimeCacheStoreGeneration;
+              if (mVariableRuntimeHobCacheBuffer != NULL) {
+                InitializeVariableStoreIndex (VariableStoreTypeHob, mVariableRuntimeHobCacheBuffer, mVariableAuthFormat);
+              }
+              InitializeVariableStoreIndex (VariableStoreTypeNv, mVariableRuntimeNvCacheBuffer, mVariableAuthFormat);
+              InitializeVariableStoreIndex (VariableStoreTypeVolatile, mVariableRuntimeVolatileCacheBuffer, mVariableAuthFormat);
             }
           }
         }
@@ -1697,6 +1888,15 @@ SmmVariableReady (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  mVariableBatchProtocol.SetVariables = VariableBatchSetVariables;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gEdkiiVariableBatchProtocolGuid,
+                  &mVariableBatchProtocol,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   mVarCheck.RegisterSetVariableCheckHandler = VarCheckRegisterSetVariableCheckHandler;
   mVarCheck.VariablePropertySet = VarCheckVariablePropertySet;
   mVarCheck.VariablePropertyGet = VarCheckVariablePropertyGet;
@@ -0,0 +1,108 @@
+/** @file
+  GUID and layout of the HOB index.
+
+  The HOB index lets the HOB libraries find the HOBs of a type, or the GUID
+  extension HOBs of a GUID, without walking the HOB list. The DXE Core builds
+  it once and installs it in the EFI System Table's Configuration Table with
+  this GUID. The PEI Core publishes it in a GUID extension HOB with this GUID,
+  which is the second HOB of the HOB list, and extends it as HOBs are added.
+  The data of that HOB is the EFI_PHYSICAL_ADDRESS of the index, or 0 while
+  there is no index.
+
+  The index covers the HOBs from HobList up to IndexedEnd, which is the end of
+  the HOB list when the index was last updated. HOBs after IndexedEnd must
+  still be searched in the HOB list.
+
+  The entries are ordered by HOB address. The entries of a HOB type, or of a
+  GUID for the GUID extension HOBs, are linked into a chain in the same order.
+  The chain of a GUID is found in GuidSlots by linear probing from the slot
+  given by folding the four 32-bit words of the GUID with XOR, then folding
+  the result with itself shifted right by 16 and by 8 bits.
+
+  A HOB may become EFI_HOB_TYPE_UNUSED after it is indexed, so the type and
+  the GUID of a HOB found in the index must be checked before it is returned.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+  @par Revision Reference:
+  This GUID is not defined by the PI Specification.
+
+**/
+
+#ifndef __HOB_INDEX_GUID_H__
+#define __HOB_INDEX_GUID_H__
+
+#define EDKII_HOB_INDEX_GUID \
+  { \
+    0x5d3b4a1e, 0x7c62, 0x4f0b, {0x9e, 0x41, 0x2a, 0xd8, 0x63, 0x1f, 0xb5, 0x07 } \
+  }
+
+#define EDKII_HOB_INDEX_SIGNATURE  SIGNATURE_32 ('H', 'O', 'B', 'I')
+#define EDKII_HOB_INDEX_REVISION   0x00000001
+
+///
+/// HOB types below this value can be indexed.
+///
+#define EDKII_HOB_INDEX_TYPE_COUNT  16
+
+///
+/// Ends a chain, or marks an empty GUID slot.
+///
+#define EDKII_HOB_INDEX_END         MAX_UINT32
+
+typedef struct {
+  ///
+  /// The indexed HOB.
+  ///
+  VOID    *Hob;
+  ///
+  /// The next entry of the same chain, or EDKII_HOB_INDEX_END.
+  ///
+  UINT32  Next;
+  ///
+  /// The type of the HOB when it was indexed.
+  ///
+  UINT16  HobType;
+  UINT16  Reserved;
+} EDKII_HOB_INDEX_ENTRY;
+
+typedef struct {
+  ///
+  /// The first and the last entries of the chain, or EDKII_HOB_INDEX_END.
+  ///
+  UINT32  First;
+  UINT32  Last;
+} EDKII_HOB_INDEX_CHAIN;
+
+typedef struct {
+  UINT32                 Signature;
+  UINT32                 Revision;
+  ///
+  /// The first HOB of the indexed HOB list.
+  ///
+  VOID                   *HobList;
+  ///
+  /// The first HOB that is not indexed.
+  ///
+  VOID                   *IndexedEnd;
+  ///
+  /// Bit N is set if the HOBs of type N are indexed. The GUID extension HOBs
+  /// are only indexed by GUID, so Types[EFI_HOB_TYPE_GUID_EXTENSION] is
+  /// always empty.
+  ///
+  UINT32                 TypeMask;
+  UINT32                 EntryCount;
+  UINT32                 EntryCapacity;
+  ///
+  /// The number of GUID slots, a power of two.
+  ///
+  UINT32                 GuidSlotCount;
+  EDKII_HOB_INDEX_CHAIN  Types[EDKII_HOB_INDEX_TYPE_COUNT];
+  EDKII_HOB_INDEX_CHAIN  *GuidSlots;
+  EDKII_HOB_INDEX_ENTRY  *Entries;
+} EDKII_HOB_INDEX;
+
+extern EFI_GUID gEdkiiHobIndexGuid;
+
+#endif
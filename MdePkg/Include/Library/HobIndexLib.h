@@ -0,0 +1,127 @@
+/** @file
+  Provides the functions that build and search the HOB index.
+
+  The PEI Core and the DXE Core build the HOB index, and the HOB libraries
+  search it. The layout of the index is defined in Guid/HobIndex.h.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __HOB_INDEX_LIB_H__
+#define __HOB_INDEX_LIB_H__
+
+#include <Guid/HobIndex.h>
+
+/**
+  Returns the size of a HOB index with its GUID slots and its entries.
+
+  @param  EntryCapacity          The number of entries of the index.
+  @param  GuidSlotCount          The number of GUID slots of the index.
+
+  @return The size of the HOB index.
+
+**/
+UINTN
+EFIAPI
+GetHobIndexSize (
+  IN UINT32  EntryCapacity,
+  IN UINT32  GuidSlotCount
+  );
+
+/**
+  Initializes an empty HOB index in a buffer, with its GUID slots and its
+  entries following the header.
+
+  If GuidSlotCount is not a power of two, then ASSERT().
+
+  @param  Index                  The buffer of the HOB index, of the size
+                                 returned by GetHobIndexSize().
+  @param  HobList                The HOB list to index.
+  @param  TypeMask               The HOB types to index.
+  @param  EntryCapacity          The number of entries of the index.
+  @param  GuidSlotCount          The number of GUID slots, a power of two
+                                 larger than the number of GUIDs to index.
+
+**/
+VOID
+EFIAPI
+InitializeHobIndex (
+  OUT EDKII_HOB_INDEX  *Index,
+  IN  VOID             *HobList,
+  IN  UINT32           TypeMask,
+  IN  UINT32           EntryCapacity,
+  IN  UINT32           GuidSlotCount
+  );
+
+/**
+  Appends a HOB to a HOB index, and to the chain of its type, or of its GUID
+  for a GUID extension HOB. The HOB must follow all the HOBs of the index.
+
+  If the index is full, then ASSERT().
+  If the HOB type is not below EDKII_HOB_INDEX_TYPE_COUNT, then ASSERT().
+
+  @param  Index                  The HOB index.
+  @param  Hob                    The HOB to append.
+
+**/
+VOID
+EFIAPI
+AppendHobToIndex (
+  IN OUT EDKII_HOB_INDEX  *Index,
+  IN     VOID             *Hob
+  );
+
+/**
+  Checks that a HOB index has the signature and the revision of this library,
+  and that it indexes a HOB list.
+
+  @param  Index                  The HOB index, or NULL.
+  @param  HobList                The HOB list.
+
+  @retval TRUE                   The HOB index can be searched for the HOBs
+                                 of the HOB list.
+  @retval FALSE                  The HOB index is NULL or can't be used.
+
+**/
+BOOLEAN
+EFIAPI
+IsHobIndexValid (
+  IN CONST EDKII_HOB_INDEX  *Index,   OPTIONAL
+  IN CONST VOID             *HobList
+  );
+
+/**
+  Looks up the next HOB of a type, or the next GUID extension HOB of a GUID,
+  in a HOB index.
+
+  The index is searched from the first entry of the chain that is not before
+  HobStart. When HobStart follows an entry of the chain, as it does when the
+  HOB list is walked with GET_NEXT_HOB(), that entry is found by a binary
+  search and its next entry is used. The HOBs whose type changed since they
+  were indexed are skipped.
+
+  @param  Index                  The HOB index, or NULL if there is none.
+  @param  Type                   The HOB type to return.
+  @param  Guid                   The GUID to match when Type is
+                                 EFI_HOB_TYPE_GUID_EXTENSION.
+  @param  HobStart               The starting HOB pointer to search from.
+  @param  Found                  Returns TRUE if a matching HOB was found in
+                                 the index.
+
+  @return The matching HOB if Found is TRUE. Otherwise, the HOB from which the
+          HOB list must still be searched.
+
+**/
+VOID *
+EFIAPI
+LookupHobIndex (
+  IN  CONST EDKII_HOB_INDEX  *Index,     OPTIONAL
+  IN  UINT16                 Type,
+  IN  CONST EFI_GUID         *Guid,      OPTIONAL
+  IN  CONST VOID             *HobStart,
+  OUT BOOLEAN                *Found
+  );
+
+#endif
@@ -0,0 +1,431 @@
+/** @file
+  Provides atomic operations, ticket locks, sequence locks and a bounded
+  multi-producer multi-consumer ring buffer that do not take spin locks.
+
+  All the atomic operations are full memory barriers. The ring buffer, the
+  ticket lock and the sequence lock are in caller-provided memory, so they can
+  be used in any phase and shared by processors that do not run the same
+  module.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __LOCK_FREE_LIB_H__
+#define __LOCK_FREE_LIB_H__
+
+///
+/// The size of a cache line that the ring buffer keeps its producer and
+/// consumer positions apart by.
+///
+#define LOCK_FREE_CACHE_LINE_SIZE  64
+
+///
+/// A ticket lock. Processors acquire it in the order they ask for it.
+///
+typedef struct {
+  volatile UINT32  NextTicket;
+  volatile UINT32  NowServing;
+} TICKET_LOCK;
+
+///
+/// A sequence lock. Writers take it in turn, and readers retry their reads
+/// when a writer took it while they read.
+///
+typedef struct {
+  volatile UINT32  Sequence;
+} SEQ_LOCK;
+
+///
+/// A bounded multi-producer multi-consumer ring buffer of fixed-size
+/// elements. Its cells are in a buffer of LOCK_FREE_RING_BUFFER_SIZE() bytes.
+///
+typedef struct {
+  UINT8            *Cells;
+  UINT32           Mask;
+  UINT32           CellSize;
+  UINT32           ElementSize;
+  UINT8            Reserved0[LOCK_FREE_CACHE_LINE_SIZE - sizeof (UINT8 *) - 3 * sizeof (UINT32)];
+  volatile UINT32  EnqueuePosition;
+  UINT8            Reserved1[LOCK_FREE_CACHE_LINE_SIZE - sizeof (UINT32)];
+  volatile UINT32  DequeuePosition;
+  UINT8            Reserved2[LOCK_FREE_CACHE_LINE_SIZE - sizeof (UINT32)];
+} LOCK_FREE_RING;
+
+/**
+  Returns the size, in bytes, of a cell of a ring buffer. A cell holds an
+  element after a 32-bit sequence number, both aligned on 64 bits.
+
+  @param  ElementSize   The size, in bytes, of the elements of the ring buffer.
+
+  @return The size, in bytes, of a cell.
+
+**/
+#define LOCK_FREE_RING_CELL_SIZE(ElementSize) \
+  (sizeof (UINT64) + ALIGN_VALUE ((ElementSize), sizeof (UINT64)))
+
+/**
+  Returns the size, in bytes, of the buffer of a ring buffer.
+
+  @param  ElementSize   The size, in bytes, of the elements of the ring buffer.
+  @param  Capacity      The number of elements the ring buffer holds.
+
+  @return The size, in bytes, of the buffer.
+
+**/
+#define LOCK_FREE_RING_BUFFER_SIZE(ElementSize, Capacity) \
+  ((Capacity) * LOCK_FREE_RING_CELL_SIZE (ElementSize))
+
+/**
+  Atomically adds a value to a 32-bit unsigned integer and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 32-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 32-bit value to add to.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+AtomicFetchAdd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           Addend
+  );
+
+/**
+  Atomically adds a value to a 64-bit unsigned integer and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 64-bit value to add to.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+AtomicFetchAdd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           Addend
+  );
+
+/**
+  Atomically performs a bitwise AND of a 32-bit unsigned integer with a value
+  and returns its original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 32-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 32-bit value to AND.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+AtomicFetchAnd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           AndData
+  );
+
+/**
+  Atomically performs a bitwise AND of a 64-bit unsigned integer with a value
+  and returns its original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 64-bit value to AND.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+AtomicFetchAnd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           AndData
+  );
+
+/**
+  Atomically performs a bitwise OR of a 32-bit unsigned integer with a value
+  and returns its original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 32-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 32-bit value to OR.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+AtomicFetchOr32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           OrData
+  );
+
+/**
+  Atomically performs a bitwise OR of a 64-bit unsigned integer with a value
+  and returns its original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 64-bit value to OR.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+AtomicFetchOr64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           OrData
+  );
+
+/**
+  Initializes a ticket lock to the released state and returns the ticket lock.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to initialize.
+
+  @return TicketLock in released state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+InitializeTicketLock (
+  OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Waits until the ticket lock is released by the processors that asked for it
+  before, then acquires it.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @return TicketLock in acquired state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+AcquireTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Acquires the ticket lock if it is released and no processor waits for it.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @retval TRUE   TicketLock was acquired.
+  @retval FALSE  TicketLock was not acquired.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireTicketLockOrFail (
+  IN OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Releases a ticket lock to the next processor that asked for it.
+
+  If TicketLock is NULL, then ASSERT().
+  If TicketLock is not acquired, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to release.
+
+  @return TicketLock in released state, or acquired by the next processor.
+
+**/
+TICKET_LOCK *
+EFIAPI
+ReleaseTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  );
+
+/**
+  Initializes a sequence lock to the released state and returns the sequence
+  lock.
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock to initialize.
+
+  @return SeqLock in released state.
+
+**/
+SEQ_LOCK *
+EFIAPI
+InitializeSeqLock (
+  OUT SEQ_LOCK  *SeqLock
+  );
+
+/**
+  Waits until the sequence lock is released by the other writers, then takes
+  it to write the data it protects.
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+
+**/
+VOID
+EFIAPI
+SeqLockWriteBegin (
+  IN OUT SEQ_LOCK  *SeqLock
+  );
+
+/**
+  Releases a sequence lock taken by SeqLockWriteBegin(), after the data it
+  protects is written.
+
+  If SeqLock is NULL, then ASSERT().
+  If SeqLock is not taken, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+
+**/
+VOID
+EFIAPI
+SeqLockWriteEnd (
+  IN OUT SEQ_LOCK  *SeqLock
+  );
+
+/**
+  Waits until no writer holds a sequence lock and returns its sequence, before
+  the data it protects is read.
+
+  The data may be updated while it is read, so it must be read into a copy
+  that is only used after SeqLockReadRetry() returns FALSE.
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+
+  @return The sequence to pass to SeqLockReadRetry().
+
+**/
+UINT32
+EFIAPI
+SeqLockReadBegin (
+  IN SEQ_LOCK  *SeqLock
+  );
+
+/**
+  Checks, after the data protected by a sequence lock is read, whether a
+  writer took the lock since SeqLockReadBegin().
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+  @param  Sequence  The sequence returned by SeqLockReadBegin().
+
+  @retval TRUE   The data may have been updated while it was read, and must
+                 be read again.
+  @retval FALSE  The data that was read is consistent.
+
+**/
+BOOLEAN
+EFIAPI
+SeqLockReadRetry (
+  IN SEQ_LOCK  *SeqLock,
+  IN UINT32    Sequence
+  );
+
+/**
+  Initializes an empty ring buffer of Capacity elements of ElementSize bytes.
+
+  If Ring is NULL, then ASSERT().
+  If Buffer is NULL, then ASSERT().
+  If Buffer is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Ring          A pointer to the ring buffer to initialize.
+  @param  Buffer        The buffer of the cells of the ring buffer, of
+                        LOCK_FREE_RING_BUFFER_SIZE (ElementSize, Capacity)
+                        bytes.
+  @param  ElementSize   The size, in bytes, of the elements.
+  @param  Capacity      The number of elements the ring buffer holds. It must
+                        be a power of two, from 2 to SIZE_2GB.
+
+  @retval RETURN_SUCCESS            The ring buffer was initialized.
+  @retval RETURN_INVALID_PARAMETER  ElementSize is 0, or Capacity is not a
+                                    power of two from 2 to SIZE_2GB.
+
+**/
+RETURN_STATUS
+EFIAPI
+LockFreeRingInitialize (
+  OUT LOCK_FREE_RING  *Ring,
+  IN  VOID            *Buffer,
+  IN  UINTN           ElementSize,
+  IN  UINTN           Capacity
+  );
+
+/**
+  Copies an element to the tail of a ring buffer.
+
+  Any number of processors may enqueue and dequeue elements of the same ring
+  buffer at the same time.
+
+  If Ring is NULL, then ASSERT().
+  If Element is NULL, then ASSERT().
+
+  @param  Ring      A pointer to the ring buffer.
+  @param  Element   The element to copy.
+
+  @retval TRUE   The element was enqueued.
+  @retval FALSE  The ring buffer is full.
+
+**/
+BOOLEAN
+EFIAPI
+LockFreeRingEnqueue (
+  IN OUT LOCK_FREE_RING  *Ring,
+  IN     CONST VOID      *Element
+  );
+
+/**
+  Removes the element at the head of a ring buffer and copies it.
+
+  Any number of processors may enqueue and dequeue elements of the same ring
+  buffer at the same time.
+
+  If Ring is NULL, then ASSERT().
+  If Element is NULL, then ASSERT().
+
+  @param  Ring      A pointer to the ring buffer.
+  @param  Element   The buffer to copy the element to.
+
+  @retval TRUE   An element was dequeued.
+  @retval FALSE  The ring buffer is empty.
+
+**/
+BOOLEAN
+EFIAPI
+LockFreeRingDequeue (
+  IN OUT LOCK_FREE_RING  *Ring,
+  OUT    VOID            *Element
+  );
+
+#endif
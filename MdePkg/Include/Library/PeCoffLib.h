@@ -5,7 +5,7 @@
   IA-32, x86, IPF, and EBC processor types. The library functions are memory-based
   and can be ported easily to any environment.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -338,7 +338,8 @@ PeCoffLoaderImageReadFromMemory (
   and ImageSize so the image will execute correctly when the PE/COFF image is mapped
   to the address specified by VirtualImageBase. RelocationData must be identical
   to the FiuxupData buffer from the PE_COFF_LOADER_IMAGE_CONTEXT structure
-  after this PE/COFF image was relocated with PeCoffLoaderRelocateImage().
+  after this PE/COFF image was relocated with PeCoffLoaderRelocateImage(), or
+  be the table built from this image by PeCoffLoaderBuildRuntimeRelocationTable().
 
   Note that if the platform does not maintain coherency between the instruction cache(s) and the data
   cache(s) in hardware, then the caller is responsible for performing cache maintenance operations
@@ -350,7 +351,8 @@ PeCoffLoaderImageReadFromMemory (
                              be fixed up for.
   @param  ImageSize          The size, in bytes, of the PE/COFF image.
   @param  RelocationData     A pointer to the relocation data that was collected when the PE/COFF
-                             image was relocated using PeCoffLoaderRelocateImage().
+                             image was relocated using PeCoffLoaderRelocateImage(), or to the
+                             table built by PeCoffLoaderBuildRuntimeRelocationTable().
 
 **/
 VOID
@@ -362,6 +364,45 @@ PeCoffLoaderRelocateImageForRuntime (
   IN  VOID                    *RelocationData
   );
 
+/**
+  Builds the runtime relocation table of a PE32 or PE32+ image that was
+  relocated with PeCoffLoaderRelocateImage().
+
+  The table lists the fixups of the image that PeCoffLoaderRelocateImageForRuntime()
+  reapplies, with their content once relocated, and is passed to it in place
+  of the FixupData buffer. It leaves out the ABSOLUTE relocations, and the
+  relocations are checked against the image once, when the table is built.
+  The table of an image is usually smaller than its FixupData buffer.
+
+  The table must be built before the image runs, so that the content of each
+  fixup is the one the image was relocated with.
+
+  If ImageContext is NULL, then ASSERT().
+  If TableSize is NULL, then ASSERT().
+
+  @param  ImageContext        The pointer to the image context structure that describes the
+                              PE/COFF image that was relocated.
+  @param  Table               The buffer, 8-byte aligned, to build the table in, or NULL to get
+                              the size of the table.
+  @param  TableSize           On input, the size in bytes of Table. On output, the size in
+                              bytes of the table.
+
+  @retval RETURN_SUCCESS            The table was built.
+  @retval RETURN_BUFFER_TOO_SMALL   Table is NULL or smaller than the table. TableSize is set
+                                    to the size of the table.
+  @retval RETURN_UNSUPPORTED        The image has relocations that the table cannot describe,
+                                    so the FixupData buffer must be used instead.
+  @retval RETURN_LOAD_ERROR         The relocation data of the image is not valid.
+
+**/
+RETURN_STATUS
+EFIAPI
+PeCoffLoaderBuildRuntimeRelocationTable (
+  IN     PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  OUT    VOID                          *Table,  OPTIONAL
+  IN OUT UINTN                         *TableSize
+  );
+
 /**
   Unloads a loaded PE/COFF image from memory and releases its taken resource.
   Releases any environment specific resources that were allocated when the image
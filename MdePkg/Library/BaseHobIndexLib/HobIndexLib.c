@@ -0,0 +1,324 @@
+/** @file
+  Build and search the HOB index.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+
+#include <Library/HobIndexLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+/**
+  Returns the slot of a GUID in the GUID slots of a HOB index.
+
+  @param  Index                  The HOB index.
+  @param  Guid                   The GUID.
+
+  @return The first slot to probe for the GUID.
+
+**/
+STATIC
+UINTN
+InternalHobIndexGuidSlot (
+  IN CONST EDKII_HOB_INDEX  *Index,
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  return CalculateGuidHash (Guid) & (Index->GuidSlotCount - 1);
+}
+
+/**
+  Returns the chain of the GUID extension HOBs of a GUID in a HOB index.
+
+  @param  Index                  The HOB index.
+  @param  Guid                   The GUID.
+
+  @return The chain of the GUID, or the empty slot where the chain of the
+          GUID would be added.
+
+**/
+STATIC
+EDKII_HOB_INDEX_CHAIN *
+InternalHobIndexGuidChain (
+  IN CONST EDKII_HOB_INDEX  *Index,
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  UINTN  Slot;
+
+  for (Slot = InternalHobIndexGuidSlot (Index, Guid);
+       Index->GuidSlots[Slot].First != EDKII_HOB_INDEX_END;
+       Slot = (Slot + 1) & (Index->GuidSlotCount - 1)) {
+    if (CompareGuid (Guid, &((EFI_HOB_GUID_TYPE *) Index->Entries[Index->GuidSlots[Slot].First].Hob)->Name)) {
+      break;
+    }
+  }
+
+  return &Index->GuidSlots[Slot];
+}
+
+/**
+  Checks whether an entry of a HOB index is in the chain of a HOB type, or in
+  the chain of a GUID.
+
+  @param  Entry                  The entry.
+  @param  Type                   The HOB type.
+  @param  Guid                   The GUID when Type is
+                                 EFI_HOB_TYPE_GUID_EXTENSION.
+
+  @retval TRUE                   The entry is in the chain.
+  @retval FALSE                  The entry is not in the chain.
+
+**/
+STATIC
+BOOLEAN
+InternalHobIndexEntryInChain (
+  IN CONST EDKII_HOB_INDEX_ENTRY  *Entry,
+  IN UINT16                       Type,
+  IN CONST EFI_GUID               *Guid
+  )
+{
+  if (Entry->HobType != Type) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (Guid == NULL || CompareGuid (Guid, &((EFI_HOB_GUID_TYPE *) Entry->Hob)->Name));
+}
+
+/**
+  Returns the size of a HOB index with its GUID slots and its entries.
+
+  @param  EntryCapacity          The number of entries of the index.
+  @param  GuidSlotCount          The number of GUID slots of the index.
+
+  @return The size of the HOB index.
+
+**/
+UINTN
+EFIAPI
+GetHobIndexSize (
+  IN UINT32  EntryCapacity,
+  IN UINT32  GuidSlotCount
+  )
+{
+  return sizeof (EDKII_HOB_INDEX) +
+         GuidSlotCount * sizeof (EDKII_HOB_INDEX_CHAIN) +
+         EntryCapacity * sizeof (EDKII_HOB_INDEX_ENTRY);
+}
+
+/**
+  Initializes an empty HOB index in a buffer, with its GUID slots and its
+  entries following the header.
+
+  If GuidSlotCount is not a power of two, then ASSERT().
+
+  @param  Index                  The buffer of the HOB index, of the size
+                                 returned by GetHobIndexSize().
+  @param  HobList                The HOB list to index.
+  @param  TypeMask               The HOB types to index.
+  @param  EntryCapacity          The number of entries of the index.
+  @param  GuidSlotCount          The number of GUID slots, a power of two
+                                 larger than the number of GUIDs to index.
+
+**/
+VOID
+EFIAPI
+InitializeHobIndex (
+  OUT EDKII_HOB_INDEX  *Index,
+  IN  VOID             *HobList,
+  IN  UINT32           TypeMask,
+  IN  UINT32           EntryCapacity,
+  IN  UINT32           GuidSlotCount
+  )
+{
+  ASSERT (GuidSlotCount != 0 && (GuidSlotCount & (GuidSlotCount - 1)) == 0);
+
+  Index->Signature     = EDKII_HOB_INDEX_SIGNATURE;
+  Index->Revision      = EDKII_HOB_INDEX_REVISION;
+  Index->HobList       = HobList;
+  Index->IndexedEnd    = HobList;
+  Index->TypeMask      = TypeMask;
+  Index->EntryCount    = 0;
+  Index->EntryCapacity = EntryCapacity;
+  Index->GuidSlotCount = GuidSlotCount;
+  Index->GuidSlots     = (EDKII_HOB_INDEX_CHAIN *) (Index + 1);
+  Index->Entries       = (EDKII_HOB_INDEX_ENTRY *) (Index->GuidSlots + GuidSlotCount);
+
+  //
+  // Empty every chain.
+  //
+  SetMem (Index->Types, sizeof (Index->Types), 0xFF);
+  SetMem (Index->GuidSlots, GuidSlotCount * sizeof (EDKII_HOB_INDEX_CHAIN), 0xFF);
+}
+
+/**
+  Appends a HOB to a HOB index, and to the chain of its type, or of its GUID
+  for a GUID extension HOB. The HOB must follow all the HOBs of the index.
+
+  If the index is full, then ASSERT().
+  If the HOB type is not below EDKII_HOB_INDEX_TYPE_COUNT, then ASSERT().
+
+  @param  Index                  The HOB index.
+  @param  Hob                    The HOB to append.
+
+**/
+VOID
+EFIAPI
+AppendHobToIndex (
+  IN OUT EDKII_HOB_INDEX  *Index,
+  IN     VOID             *Hob
+  )
+{
+  EFI_PEI_HOB_POINTERS   HobPtr;
+  EDKII_HOB_INDEX_CHAIN  *Chain;
+  UINT32                 Entry;
+
+  ASSERT (Index->EntryCount < Index->EntryCapacity);
+
+  HobPtr.Raw = Hob;
+  ASSERT (HobPtr.Header->HobType < EDKII_HOB_INDEX_TYPE_COUNT);
+  if (HobPtr.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+    Chain = InternalHobIndexGuidChain (Index, &HobPtr.Guid->Name);
+  } else {
+    Chain = &Index->Types[HobPtr.Header->HobType];
+  }
+
+  Entry = Index->EntryCount++;
+  Index->Entries[Entry].Hob      = HobPtr.Raw;
+  Index->Entries[Entry].Next     = EDKII_HOB_INDEX_END;
+  Index->Entries[Entry].HobType  = HobPtr.Header->HobType;
+  Index->Entries[Entry].Reserved = 0;
+
+  if (Chain->First == EDKII_HOB_INDEX_END) {
+    Chain->First = Entry;
+  } else {
+    Index->Entries[Chain->Last].Next = Entry;
+  }
+  Chain->Last = Entry;
+}
+
+/**
+  Checks that a HOB index has the signature and the revision of this library,
+  and that it indexes a HOB list.
+
+  @param  Index                  The HOB index, or NULL.
+  @param  HobList                The HOB list.
+
+  @retval TRUE                   The HOB index can be searched for the HOBs
+                                 of the HOB list.
+  @retval FALSE                  The HOB index is NULL or can't be used.
+
+**/
+BOOLEAN
+EFIAPI
+IsHobIndexValid (
+  IN CONST EDKII_HOB_INDEX  *Index,   OPTIONAL
+  IN CONST VOID             *HobList
+  )
+{
+  return (BOOLEAN) (Index != NULL &&
+                    Index->Signature == EDKII_HOB_INDEX_SIGNATURE &&
+                    Index->Revision == EDKII_HOB_INDEX_REVISION &&
+                    Index->HobList == HobList);
+}
+
+/**
+  Looks up the next HOB of a type, or the next GUID extension HOB of a GUID,
+  in a HOB index.
+
+  The index is searched from the first entry of the chain that is not before
+  HobStart. When HobStart follows an entry of the chain, as it does when the
+  HOB list is walked with GET_NEXT_HOB(), that entry is found by a binary
+  search and its next entry is used. The HOBs whose type changed since they
+  were indexed are skipped.
+
+  @param  Index                  The HOB index, or NULL if there is none.
+  @param  Type                   The HOB type to return.
+  @param  Guid                   The GUID to match when Type is
+                                 EFI_HOB_TYPE_GUID_EXTENSION.
+  @param  HobStart               The starting HOB pointer to search from.
+  @param  Found                  Returns TRUE if a matching HOB was found in
+                                 the index.
+
+  @return The matching HOB if Found is TRUE. Otherwise, the HOB from which the
+          HOB list must still be searched.
+
+**/
+VOID *
+EFIAPI
+LookupHobIndex (
+  IN  CONST EDKII_HOB_INDEX  *Index,     OPTIONAL
+  IN  UINT16                 Type,
+  IN  CONST EFI_GUID         *Guid,      OPTIONAL
+  IN  CONST VOID             *HobStart,
+  OUT BOOLEAN                *Found
+  )
+{
+  CONST EDKII_HOB_INDEX_ENTRY  *Entries;
+  UINT32                       Entry;
+  UINTN                        Low;
+  UINTN                        High;
+  UINTN                        Middle;
+  EFI_PEI_HOB_POINTERS         Hob;
+
+  *Found = FALSE;
+
+  if (Index == NULL ||
+      Type >= EDKII_HOB_INDEX_TYPE_COUNT ||
+      (Index->TypeMask & (1U << Type)) == 0 ||
+      (Type == EFI_HOB_TYPE_GUID_EXTENSION && Guid == NULL) ||
+      (UINTN) HobStart < (UINTN) Index->HobList ||
+      (UINTN) HobStart > (UINTN) Index->IndexedEnd) {
+    return (VOID *) HobStart;
+  }
+
+  Entries = Index->Entries;
+  if (Type == EFI_HOB_TYPE_GUID_EXTENSION) {
+    Entry = InternalHobIndexGuidChain (Index, Guid)->First;
+  } else {
+    Guid  = NULL;
+    Entry = Index->Types[Type].First;
+  }
+
+  if (Entry != EDKII_HOB_INDEX_END && (UINTN) Entries[Entry].Hob < (UINTN) HobStart) {
+    //
+    // Find the last entry before HobStart.
+    //
+    Low  = 0;
+    High = Index->EntryCount;
+    while (Low < High) {
+      Middle = (Low + High) / 2;
+      if ((UINTN) Entries[Middle].Hob < (UINTN) HobStart) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    if (InternalHobIndexEntryInChain (&Entries[Low - 1], Type, Guid)) {
+      Entry = Entries[Low - 1].Next;
+    } else {
+      while (Entry != EDKII_HOB_INDEX_END && (UINTN) Entries[Entry].Hob < (UINTN) HobStart) {
+        Entry = Entries[Entry].Next;
+      }
+    }
+  }
+
+  //
+  // Skip the HOBs whose type changed since they were indexed.
+  //
+  for (; Entry != EDKII_HOB_INDEX_END; Entry = Entries[Entry].Next) {
+    Hob.Raw = Entries[Entry].Hob;
+    if (Hob.Header->HobType == Type) {
+      *Found = TRUE;
+      return Hob.Raw;
+    }
+  }
+
+  return Index->IndexedEnd;
+}
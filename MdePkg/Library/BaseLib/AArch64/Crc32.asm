@@ -0,0 +1,76 @@
+;------------------------------------------------------------------------------
+;
+; InternalCrc32Armv8() and InternalReadIdAa64Isar0() for AArch64
+;
+; Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+;
+; SPDX-License-Identifier: BSD-2-Clause-Patent
+;
+;------------------------------------------------------------------------------
+
+  EXPORT InternalReadIdAa64Isar0
+  EXPORT InternalCrc32Armv8
+  AREA BaseLib_LowLevel, CODE, READONLY
+
+;/**
+;  Reads the ID_AA64ISAR0_EL1 register.
+;
+;  @return The value of ID_AA64ISAR0_EL1.
+;
+;**/
+;UINT64
+;EFIAPI
+;InternalReadIdAa64Isar0 (
+;  VOID
+;  );
+;
+InternalReadIdAa64Isar0
+    mrs     x0, id_aa64isar0_el1
+    ret
+
+;/**
+;  Updates a 32-bit CRC with the bytes of a buffer, using the CRC32
+;  instructions.
+;
+;  @param[in]  Crc          The CRC of the preceding bytes, not inverted.
+;  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+;  @param[in]  Length       The number of bytes in the buffer.
+;
+;  @return The CRC of the preceding bytes and of the buffer, not inverted.
+;
+;**/
+;UINT32
+;EFIAPI
+;InternalCrc32Armv8 (
+;  IN      UINT32                    Crc,
+;  IN      CONST VOID                *Buffer,
+;  IN      UINTN                     Length
+;  );
+;
+InternalCrc32Armv8
+    cbz     x2, Crc32Done
+Crc32AlignLoop
+    tst     x1, #7                  // add bytes until the buffer is aligned
+    beq     Crc32Loop8
+    ldrb    w3, [x1], #1
+    crc32b  w0, w0, w3
+    subs    x2, x2, #1
+    bne     Crc32AlignLoop
+    ret
+Crc32Loop8
+    cmp     x2, #8                  // add 8 bytes per step
+    blo     Crc32Loop1
+    ldr     x3, [x1], #8
+    crc32x  w0, w0, x3
+    sub     x2, x2, #8
+    b       Crc32Loop8
+Crc32Loop1
+    cbz     x2, Crc32Done           // add the remaining bytes
+    ldrb    w3, [x1], #1
+    crc32b  w0, w0, w3
+    sub     x2, x2, #1
+    b       Crc32Loop1
+Crc32Done
+    ret
+
+  END
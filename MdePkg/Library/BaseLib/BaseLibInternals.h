@@ -866,4 +866,149 @@ InternalX86RdRand64  (
 
 #endif
 
+//
+// CalculateSum8/16/32/64() use the SSE registers for buffers of at least this
+// many bytes on X64, where SSE2 is architectural and is enabled for all code.
+//
+#define CHECKSUM_SSE2_MIN_LENGTH  256
+
+#if defined (MDE_CPU_X64)
+
+/**
+  Returns the sum of all 8-bit values in a buffer, adding 16 bytes per step
+  with SSE2. The carry bits are dropped.
+
+  @param  Buffer      The pointer to the buffer to carry out the sum operation.
+  @param  Length      The size, in bytes, of Buffer. It must be a non-zero
+                      multiple of 16.
+
+  @return The sum of Buffer with carry bits dropped during additions.
+
+**/
+UINT8
+EFIAPI
+InternalSum8Sse2 (
+  IN      CONST VOID                *Buffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Returns the sum of all 16-bit values in a buffer, adding 16 bytes per step
+  with SSE2. The carry bits are dropped.
+
+  @param  Buffer      The pointer to the buffer to carry out the sum operation.
+  @param  Length      The size, in bytes, of Buffer. It must be a non-zero
+                      multiple of 16.
+
+  @return The sum of Buffer with carry bits dropped during additions.
+
+**/
+UINT16
+EFIAPI
+InternalSum16Sse2 (
+  IN      CONST VOID                *Buffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Returns the sum of all 32-bit values in a buffer, adding 16 bytes per step
+  with SSE2. The carry bits are dropped.
+
+  @param  Buffer      The pointer to the buffer to carry out the sum operation.
+  @param  Length      The size, in bytes, of Buffer. It must be a non-zero
+                      multiple of 16.
+
+  @return The sum of Buffer with carry bits dropped during additions.
+
+**/
+UINT32
+EFIAPI
+InternalSum32Sse2 (
+  IN      CONST VOID                *Buffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Returns the sum of all 64-bit values in a buffer, adding 16 bytes per step
+  with SSE2. The carry bits are dropped.
+
+  @param  Buffer      The pointer to the buffer to carry out the sum operation.
+  @param  Length      The size, in bytes, of Buffer. It must be a non-zero
+                      multiple of 16.
+
+  @return The sum of Buffer with carry bits dropped during additions.
+
+**/
+UINT64
+EFIAPI
+InternalSum64Sse2 (
+  IN      CONST VOID                *Buffer,
+  IN      UINTN                     Length
+  );
+
+#endif
+
+//
+// CalculateCrc32() checks for and uses the CRC instructions of the processor
+// for buffers of at least this many bytes.
+//
+#define CRC32_ACCELERATED_MIN_LENGTH  SIZE_4KB
+
+#if defined (MDE_CPU_X64)
+
+/**
+  Updates a 32-bit CRC with the bytes of a buffer, folding 64 bytes per step
+  with PCLMULQDQ.
+
+  @param[in]  Crc          The CRC of the preceding bytes, not inverted.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in the buffer. It must be a
+                           multiple of 16, and at least 64.
+
+  @return The CRC of the preceding bytes and of the buffer, not inverted.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Clmul (
+  IN      UINT32                    Crc,
+  IN      CONST VOID                *Buffer,
+  IN      UINTN                     Length
+  );
+
+#elif defined (MDE_CPU_AARCH64)
+
+/**
+  Reads the ID_AA64ISAR0_EL1 register.
+
+  @return The value of ID_AA64ISAR0_EL1.
+
+**/
+UINT64
+EFIAPI
+InternalReadIdAa64Isar0 (
+  VOID
+  );
+
+/**
+  Updates a 32-bit CRC with the bytes of a buffer, using the CRC32
+  instructions.
+
+  @param[in]  Crc          The CRC of the preceding bytes, not inverted.
+  @param[in]  Buffer       A pointer to the bytes to add to the CRC.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC of the preceding bytes and of the buffer, not inverted.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Armv8 (
+  IN      UINT32                    Crc,
+  IN      CONST VOID                *Buffer,
+  IN      UINTN                     Length
+  );
+
+#endif
+
 #endif
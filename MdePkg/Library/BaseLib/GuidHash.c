@@ -0,0 +1,46 @@
+/** @file
+  GUID hash function, for hash tables keyed by GUID.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+/**
+  Computes and returns a 32-bit hash of a GUID, to index hash tables keyed
+  by GUID.
+
+  The four 32-bit words of the GUID are folded together, and the high bits of
+  the result are folded into its low bits, so that the low bits of the hash
+  can be used as the index of a table whose size is a power of two. This is
+  not a cryptographic hash: it is only suited to GUIDs that are not chosen to
+  collide.
+
+  If Guid is NULL, then ASSERT().
+
+  @param[in]  Guid         A pointer to the GUID, which may be unaligned.
+
+  @return The 32-bit hash of the GUID.
+
+**/
+UINT32
+EFIAPI
+CalculateGuidHash (
+  IN  CONST GUID                   *Guid
+  )
+{
+  UINT32  Hash;
+
+  ASSERT (Guid != NULL);
+
+  Hash  = ReadUnaligned32 ((CONST UINT32 *) Guid);
+  Hash ^= ReadUnaligned32 ((CONST UINT32 *) Guid + 1);
+  Hash ^= ReadUnaligned32 ((CONST UINT32 *) Guid + 2);
+  Hash ^= ReadUnaligned32 ((CONST UINT32 *) Guid + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return Hash;
+}
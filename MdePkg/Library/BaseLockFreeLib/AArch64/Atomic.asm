@@ -0,0 +1,180 @@
+;  Implementation of BaseLockFreeLib processor specific functions for ARM
+;  architecture (AArch64)
+;
+;  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+;
+;  SPDX-License-Identifier: BSD-2-Clause-Patent
+;
+;
+
+  EXPORT InternalAtomicFetchAdd32
+  EXPORT InternalAtomicFetchAdd64
+  EXPORT InternalAtomicFetchAnd32
+  EXPORT InternalAtomicFetchAnd64
+  EXPORT InternalAtomicFetchOr32
+  EXPORT InternalAtomicFetchOr64
+  AREA BaseLockFreeLib_LowLevel, CODE, READONLY
+
+;/**
+;  Atomically adds a value to a 32-bit unsigned integer and returns its original
+;  value. The operation is a full memory barrier.
+;
+;  @param  Value     A pointer to the 32-bit value.
+;  @param  Addend    The value to add.
+;
+;  @return The original *Value.
+;
+;**/
+;UINT32
+;EFIAPI
+;InternalAtomicFetchAdd32 (
+;  IN OUT  volatile UINT32  *Value,
+;  IN      UINT32           Addend
+;  )
+InternalAtomicFetchAdd32
+  dmb     sy
+TryInternalAtomicFetchAdd32
+  ldxr    w2, [x0]
+  add     w3, w2, w1
+  stxr    w4, w3, [x0]
+  cbnz    w4, TryInternalAtomicFetchAdd32
+  dmb     sy
+  mov     w0, w2
+  ret
+
+;/**
+;  Atomically adds a value to a 64-bit unsigned integer and returns its original
+;  value. The operation is a full memory barrier.
+;
+;  @param  Value     A pointer to the 64-bit value.
+;  @param  Addend    The value to add.
+;
+;  @return The original *Value.
+;
+;**/
+;UINT64
+;EFIAPI
+;InternalAtomicFetchAdd64 (
+;  IN OUT  volatile UINT64  *Value,
+;  IN      UINT64           Addend
+;  )
+InternalAtomicFetchAdd64
+  dmb     sy
+TryInternalAtomicFetchAdd64
+  ldxr    x2, [x0]
+  add     x3, x2, x1
+  stxr    w4, x3, [x0]
+  cbnz    w4, TryInternalAtomicFetchAdd64
+  dmb     sy
+  mov     x0, x2
+  ret
+
+;/**
+;  Atomically performs a bitwise AND of a 32-bit unsigned integer and
+;  returns its original value. The operation is a full memory barrier.
+;
+;  @param  Value     A pointer to the 32-bit value.
+;  @param  AndData   The value to AND with.
+;
+;  @return The original *Value.
+;
+;**/
+;UINT32
+;EFIAPI
+;InternalAtomicFetchAnd32 (
+;  IN OUT  volatile UINT32  *Value,
+;  IN      UINT32           AndData
+;  )
+InternalAtomicFetchAnd32
+  dmb     sy
+TryInternalAtomicFetchAnd32
+  ldxr    w2, [x0]
+  and     w3, w2, w1
+  stxr    w4, w3, [x0]
+  cbnz    w4, TryInternalAtomicFetchAnd32
+  dmb     sy
+  mov     w0, w2
+  ret
+
+;/**
+;  Atomically performs a bitwise AND of a 64-bit unsigned integer and
+;  returns its original value. The operation is a full memory barrier.
+;
+;  @param  Value     A pointer to the 64-bit value.
+;  @param  AndData   The value to AND with.
+;
+;  @return The original *Value.
+;
+;**/
+;UINT64
+;EFIAPI
+;InternalAtomicFetchAnd64 (
+;  IN OUT  volatile UINT64  *Value,
+;  IN      UINT64           AndData
+;  )
+InternalAtomicFetchAnd64
+  dmb     sy
+TryInternalAtomicFetchAnd64
+  ldxr    x2, [x0]
+  and     x3, x2, x1
+  stxr    w4, x3, [x0]
+  cbnz    w4, TryInternalAtomicFetchAnd64
+  dmb     sy
+  mov     x0, x2
+  ret
+
+;/**
+;  Atomically performs a bitwise OR of a 32-bit unsigned integer and
+;  returns its original value. The operation is a full memory barrier.
+;
+;  @param  Value     A pointer to the 32-bit value.
+;  @param  OrData    The value to OR with.
+;
+;  @return The original *Value.
+;
+;**/
+;UINT32
+;EFIAPI
+;InternalAtomicFetchOr32 (
+;  IN OUT  volatile UINT32  *Value,
+;  IN      UINT32           OrData
+;  )
+InternalAtomicFetchOr32
+  dmb     sy
+TryInternalAtomicFetchOr32
+  ldxr    w2, [x0]
+  orr     w3, w2, w1
+  stxr    w4, w3, [x0]
+  cbnz    w4, TryInternalAtomicFetchOr32
+  dmb     sy
+  mov     w0, w2
+  ret
+
+;/**
+;  Atomically performs a bitwise OR of a 64-bit unsigned integer and
+;  returns its original value. The operation is a full memory barrier.
+;
+;  @param  Value     A pointer to the 64-bit value.
+;  @param  OrData    The value to OR with.
+;
+;  @return The original *Value.
+;
+;**/
+;UINT64
+;EFIAPI
+;InternalAtomicFetchOr64 (
+;  IN OUT  volatile UINT64  *Value,
+;  IN      UINT64           OrData
+;  )
+InternalAtomicFetchOr64
+  dmb     sy
+TryInternalAtomicFetchOr64
+  ldxr    x2, [x0]
+  orr     x3, x2, x1
+  stxr    w4, x3, [x0]
+  cbnz    w4, TryInternalAtomicFetchOr64
+  dmb     sy
+  mov     x0, x2
+  ret
+
+  END
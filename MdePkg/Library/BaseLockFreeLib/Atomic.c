@@ -0,0 +1,165 @@
+/** @file
+  Atomic fetch-and-operate functions.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Atomically adds a value to a 32-bit unsigned integer and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 32-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 32-bit value to add to.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+AtomicFetchAdd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           Addend
+  )
+{
+  ASSERT (Value != NULL);
+  ASSERT (((UINTN) Value & (sizeof (*Value) - 1)) == 0);
+
+  return InternalAtomicFetchAdd32 (Value, Addend);
+}
+
+/**
+  Atomically adds a value to a 64-bit unsigned integer and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 64-bit value to add to.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+AtomicFetchAdd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           Addend
+  )
+{
+  ASSERT (Value != NULL);
+  ASSERT (((UINTN) Value & (sizeof (*Value) - 1)) == 0);
+
+  return InternalAtomicFetchAdd64 (Value, Addend);
+}
+
+/**
+  Atomically performs a bitwise AND of a 32-bit unsigned integer with a value and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 32-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 32-bit value to AND.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+AtomicFetchAnd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           AndData
+  )
+{
+  ASSERT (Value != NULL);
+  ASSERT (((UINTN) Value & (sizeof (*Value) - 1)) == 0);
+
+  return InternalAtomicFetchAnd32 (Value, AndData);
+}
+
+/**
+  Atomically performs a bitwise AND of a 64-bit unsigned integer with a value and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 64-bit value to AND.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+AtomicFetchAnd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           AndData
+  )
+{
+  ASSERT (Value != NULL);
+  ASSERT (((UINTN) Value & (sizeof (*Value) - 1)) == 0);
+
+  return InternalAtomicFetchAnd64 (Value, AndData);
+}
+
+/**
+  Atomically performs a bitwise OR of a 32-bit unsigned integer with a value and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 32-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 32-bit value to OR.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+AtomicFetchOr32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           OrData
+  )
+{
+  ASSERT (Value != NULL);
+  ASSERT (((UINTN) Value & (sizeof (*Value) - 1)) == 0);
+
+  return InternalAtomicFetchOr32 (Value, OrData);
+}
+
+/**
+  Atomically performs a bitwise OR of a 64-bit unsigned integer with a value and returns its
+  original value.
+
+  If Value is NULL, then ASSERT().
+  If Value is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Value     A pointer to the 64-bit value to OR.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+AtomicFetchOr64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           OrData
+  )
+{
+  ASSERT (Value != NULL);
+  ASSERT (((UINTN) Value & (sizeof (*Value) - 1)) == 0);
+
+  return InternalAtomicFetchOr64 (Value, OrData);
+}
@@ -0,0 +1,127 @@
+/** @file
+  Atomic AND and OR functions built on compare exchange. No processor that
+  BaseLockFreeLib supports returns the original value of an atomic AND or OR
+  other than through a compare exchange loop.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Atomically performs a bitwise AND of a 32-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchAnd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           AndData
+  )
+{
+  UINT32  Original;
+  UINT32  Observed;
+
+  Observed = *Value;
+  do {
+    Original = Observed;
+    Observed = InterlockedCompareExchange32 (Value, Original, Original & AndData);
+  } while (Observed != Original);
+
+  return Original;
+}
+
+/**
+  Atomically performs a bitwise AND of a 64-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchAnd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           AndData
+  )
+{
+  UINT64  Original;
+  UINT64  Observed;
+
+  Observed = *Value;
+  do {
+    Original = Observed;
+    Observed = InterlockedCompareExchange64 (Value, Original, Original & AndData);
+  } while (Observed != Original);
+
+  return Original;
+}
+
+/**
+  Atomically performs a bitwise OR of a 32-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchOr32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           OrData
+  )
+{
+  UINT32  Original;
+  UINT32  Observed;
+
+  Observed = *Value;
+  do {
+    Original = Observed;
+    Observed = InterlockedCompareExchange32 (Value, Original, Original | OrData);
+  } while (Observed != Original);
+
+  return Original;
+}
+
+/**
+  Atomically performs a bitwise OR of a 64-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchOr64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           OrData
+  )
+{
+  UINT64  Original;
+  UINT64  Observed;
+
+  Observed = *Value;
+  do {
+    Original = Observed;
+    Observed = InterlockedCompareExchange64 (Value, Original, Original | OrData);
+  } while (Observed != Original);
+
+  return Original;
+}
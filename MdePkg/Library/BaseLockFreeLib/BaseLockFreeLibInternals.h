@@ -0,0 +1,121 @@
+/** @file
+  Declaration of internal functions in BaseLockFreeLib.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __BASE_LOCK_FREE_LIB_INTERNALS__
+#define __BASE_LOCK_FREE_LIB_INTERNALS__
+
+#include <Base.h>
+#include <Library/LockFreeLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SynchronizationLib.h>
+
+/**
+  Atomically adds a value to a 32-bit unsigned integer and returns its original
+  value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchAdd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           Addend
+  );
+
+/**
+  Atomically adds a value to a 64-bit unsigned integer and returns its original
+  value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchAdd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           Addend
+  );
+
+/**
+  Atomically performs a bitwise AND of a 32-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchAnd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           AndData
+  );
+
+/**
+  Atomically performs a bitwise AND of a 64-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  AndData   The value to AND with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchAnd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           AndData
+  );
+
+/**
+  Atomically performs a bitwise OR of a 32-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchOr32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           OrData
+  );
+
+/**
+  Atomically performs a bitwise OR of a 64-bit unsigned integer and
+  returns its original value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  OrData    The value to OR with.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchOr64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           OrData
+  );
+
+#endif
@@ -0,0 +1,70 @@
+/** @file
+  GCC inline implementation of BaseLockFreeLib processor specific functions.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Atomically adds a value to a 32-bit unsigned integer and returns its original
+  value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchAdd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           Addend
+  )
+{
+  __asm__ __volatile__ (
+    "lock               \n\t"
+    "xaddl   %0, %1     \n\t"
+    : "+r" (Addend),          // %0
+      "+m" (*Value)           // %1
+    :                         // no inputs that aren't also outputs
+    : "memory",
+      "cc"
+    );
+
+  return Addend;
+}
+
+/**
+  Atomically adds a value to a 64-bit unsigned integer and returns its original
+  value. The operation is a full memory barrier.
+
+  IA32 has no 64-bit add instruction, so the value is updated with CMPXCHG8B.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchAdd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           Addend
+  )
+{
+  UINT64  Original;
+  UINT64  Observed;
+
+  Observed = *Value;
+  do {
+    Original = Observed;
+    Observed = InterlockedCompareExchange64 (Value, Original, Original + Addend);
+  } while (Observed != Original);
+
+  return Original;
+}
@@ -0,0 +1,213 @@
+/** @file
+  Bounded multi-producer multi-consumer ring buffer.
+
+  Each cell has a sequence number that tells which pass over the ring buffer
+  it is ready for. A cell at position Position is ready to be written when
+  its sequence is Position, and ready to be read when it is Position + 1.
+  The reader sets it to Position + Capacity for the writer of the next pass.
+
+  A producer or a consumer claims a position with a compare exchange on the
+  enqueue or the dequeue position, then copies its element while no other
+  processor uses the cell, and publishes the cell by updating its sequence.
+  Producers only write the enqueue position and consumers the dequeue
+  position, and both are on cache lines of their own.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Returns the sequence of a cell of a ring buffer.
+
+  @param  Ring      A pointer to the ring buffer.
+  @param  Position  The position of the cell.
+
+  @return A pointer to the sequence of the cell. The element follows it.
+
+**/
+STATIC
+volatile UINT32 *
+LockFreeRingCell (
+  IN LOCK_FREE_RING  *Ring,
+  IN UINT32          Position
+  )
+{
+  return (volatile UINT32 *) (Ring->Cells + (UINTN) (Position & Ring->Mask) * Ring->CellSize);
+}
+
+/**
+  Initializes an empty ring buffer of Capacity elements of ElementSize bytes.
+
+  If Ring is NULL, then ASSERT().
+  If Buffer is NULL, then ASSERT().
+  If Buffer is not aligned on a 64-bit boundary, then ASSERT().
+
+  @param  Ring          A pointer to the ring buffer to initialize.
+  @param  Buffer        The buffer of the cells of the ring buffer, of
+                        LOCK_FREE_RING_BUFFER_SIZE (ElementSize, Capacity)
+                        bytes.
+  @param  ElementSize   The size, in bytes, of the elements.
+  @param  Capacity      The number of elements the ring buffer holds. It must
+                        be a power of two, from 2 to SIZE_2GB.
+
+  @retval RETURN_SUCCESS            The ring buffer was initialized.
+  @retval RETURN_INVALID_PARAMETER  ElementSize is 0, or Capacity is not a
+                                    power of two from 2 to SIZE_2GB.
+
+**/
+RETURN_STATUS
+EFIAPI
+LockFreeRingInitialize (
+  OUT LOCK_FREE_RING  *Ring,
+  IN  VOID            *Buffer,
+  IN  UINTN           ElementSize,
+  IN  UINTN           Capacity
+  )
+{
+  UINT32  Position;
+
+  ASSERT (Ring != NULL);
+  ASSERT (Buffer != NULL);
+  ASSERT (((UINTN) Buffer & (sizeof (UINT64) - 1)) == 0);
+
+  if ((ElementSize == 0) || (ElementSize > MAX_UINT32 - 2 * sizeof (UINT64)) ||
+      (Capacity < 2) || (Capacity > SIZE_2GB) || ((Capacity & (Capacity - 1)) != 0)) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Ring, sizeof (*Ring));
+  Ring->Cells       = (UINT8 *) Buffer;
+  Ring->Mask        = (UINT32) (Capacity - 1);
+  Ring->CellSize    = (UINT32) LOCK_FREE_RING_CELL_SIZE (ElementSize);
+  Ring->ElementSize = (UINT32) ElementSize;
+
+  Position = 0;
+  do {
+    *LockFreeRingCell (Ring, Position) = Position;
+    Position++;
+  } while (Position <= Ring->Mask);
+
+  MemoryFence ();
+  return RETURN_SUCCESS;
+}
+
+/**
+  Copies an element to the tail of a ring buffer.
+
+  Any number of processors may enqueue and dequeue elements of the same ring
+  buffer at the same time.
+
+  If Ring is NULL, then ASSERT().
+  If Element is NULL, then ASSERT().
+
+  @param  Ring      A pointer to the ring buffer.
+  @param  Element   The element to copy.
+
+  @retval TRUE   The element was enqueued.
+  @retval FALSE  The ring buffer is full.
+
+**/
+BOOLEAN
+EFIAPI
+LockFreeRingEnqueue (
+  IN OUT LOCK_FREE_RING  *Ring,
+  IN     CONST VOID      *Element
+  )
+{
+  volatile UINT32  *Cell;
+  UINT32           Position;
+  UINT32           Observed;
+  INT32            Difference;
+
+  ASSERT (Ring != NULL);
+  ASSERT (Element != NULL);
+
+  Position = Ring->EnqueuePosition;
+  while (TRUE) {
+    Cell       = LockFreeRingCell (Ring, Position);
+    Difference = (INT32) (*Cell - Position);
+    MemoryFence ();
+    if (Difference == 0) {
+      Observed = InterlockedCompareExchange32 (&Ring->EnqueuePosition, Position, Position + 1);
+      if (Observed == Position) {
+        break;
+      }
+
+      Position = Observed;
+    } else if (Difference < 0) {
+      //
+      // The cell still holds the element of the previous pass.
+      //
+      return FALSE;
+    } else {
+      Position = Ring->EnqueuePosition;
+    }
+  }
+
+  CopyMem ((VOID *) (Cell + 2), Element, Ring->ElementSize);
+  MemoryFence ();
+  *Cell = Position + 1;
+  return TRUE;
+}
+
+/**
+  Removes the element at the head of a ring buffer and copies it.
+
+  Any number of processors may enqueue and dequeue elements of the same ring
+  buffer at the same time.
+
+  If Ring is NULL, then ASSERT().
+  If Element is NULL, then ASSERT().
+
+  @param  Ring      A pointer to the ring buffer.
+  @param  Element   The buffer to copy the element to.
+
+  @retval TRUE   An element was dequeued.
+  @retval FALSE  The ring buffer is empty.
+
+**/
+BOOLEAN
+EFIAPI
+LockFreeRingDequeue (
+  IN OUT LOCK_FREE_RING  *Ring,
+  OUT    VOID            *Element
+  )
+{
+  volatile UINT32  *Cell;
+  UINT32           Position;
+  UINT32           Observed;
+  INT32            Difference;
+
+  ASSERT (Ring != NULL);
+  ASSERT (Element != NULL);
+
+  Position = Ring->DequeuePosition;
+  while (TRUE) {
+    Cell       = LockFreeRingCell (Ring, Position);
+    Difference = (INT32) (*Cell - (Position + 1));
+    MemoryFence ();
+    if (Difference == 0) {
+      Observed = InterlockedCompareExchange32 (&Ring->DequeuePosition, Position, Position + 1);
+      if (Observed == Position) {
+        break;
+      }
+
+      Position = Observed;
+    } else if (Difference < 0) {
+      //
+      // The cell has not been written in this pass yet.
+      //
+      return FALSE;
+    } else {
+      Position = Ring->DequeuePosition;
+    }
+  }
+
+  CopyMem (Element, (VOID *) (Cell + 2), Ring->ElementSize);
+  MemoryFence ();
+  *Cell = Position + Ring->Mask + 1;
+  return TRUE;
+}
@@ -0,0 +1,163 @@
+/** @file
+  Sequence lock functions.
+
+  The sequence is odd while a writer holds the lock. Readers do not write the
+  lock: they read the sequence before and after they read the data it
+  protects, and read the data again if a writer held the lock in between.
+  Writers take the lock by incrementing an even sequence with a compare
+  exchange, so they do not need a lock of their own.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Initializes a sequence lock to the released state and returns the sequence
+  lock.
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock to initialize.
+
+  @return SeqLock in released state.
+
+**/
+SEQ_LOCK *
+EFIAPI
+InitializeSeqLock (
+  OUT SEQ_LOCK  *SeqLock
+  )
+{
+  ASSERT (SeqLock != NULL);
+
+  SeqLock->Sequence = 0;
+  MemoryFence ();
+  return SeqLock;
+}
+
+/**
+  Waits until the sequence lock is released by the other writers, then takes
+  it to write the data it protects.
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+
+**/
+VOID
+EFIAPI
+SeqLockWriteBegin (
+  IN OUT SEQ_LOCK  *SeqLock
+  )
+{
+  UINT32  Sequence;
+
+  ASSERT (SeqLock != NULL);
+
+  while (TRUE) {
+    Sequence = SeqLock->Sequence;
+    if (((Sequence & 1) == 0) &&
+        (InterlockedCompareExchange32 (&SeqLock->Sequence, Sequence, Sequence + 1) == Sequence)) {
+      break;
+    }
+
+    CpuPause ();
+  }
+
+  MemoryFence ();
+}
+
+/**
+  Releases a sequence lock taken by SeqLockWriteBegin(), after the data it
+  protects is written.
+
+  If SeqLock is NULL, then ASSERT().
+  If SeqLock is not taken, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+
+**/
+VOID
+EFIAPI
+SeqLockWriteEnd (
+  IN OUT SEQ_LOCK  *SeqLock
+  )
+{
+  UINT32  Sequence;
+
+  ASSERT (SeqLock != NULL);
+
+  Sequence = SeqLock->Sequence;
+  ASSERT ((Sequence & 1) != 0);
+
+  MemoryFence ();
+  SeqLock->Sequence = Sequence + 1;
+  MemoryFence ();
+}
+
+/**
+  Waits until no writer holds a sequence lock and returns its sequence, before
+  the data it protects is read.
+
+  The data may be updated while it is read, so it must be read into a copy
+  that is only used after SeqLockReadRetry() returns FALSE.
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+
+  @return The sequence to pass to SeqLockReadRetry().
+
+**/
+UINT32
+EFIAPI
+SeqLockReadBegin (
+  IN SEQ_LOCK  *SeqLock
+  )
+{
+  UINT32  Sequence;
+
+  ASSERT (SeqLock != NULL);
+
+  while (TRUE) {
+    Sequence = SeqLock->Sequence;
+    if ((Sequence & 1) == 0) {
+      break;
+    }
+
+    CpuPause ();
+  }
+
+  MemoryFence ();
+  return Sequence;
+}
+
+/**
+  Checks, after the data protected by a sequence lock is read, whether a
+  writer took the lock since SeqLockReadBegin().
+
+  If SeqLock is NULL, then ASSERT().
+
+  @param  SeqLock   A pointer to the sequence lock.
+  @param  Sequence  The sequence returned by SeqLockReadBegin().
+
+  @retval TRUE   The data may have been updated while it was read, and must
+                 be read again.
+  @retval FALSE  The data that was read is consistent.
+
+**/
+BOOLEAN
+EFIAPI
+SeqLockReadRetry (
+  IN SEQ_LOCK  *SeqLock,
+  IN UINT32    Sequence
+  )
+{
+  ASSERT (SeqLock != NULL);
+
+  MemoryFence ();
+  return (BOOLEAN) (SeqLock->Sequence != Sequence);
+}
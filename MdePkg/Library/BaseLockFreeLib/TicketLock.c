@@ -0,0 +1,131 @@
+/** @file
+  Ticket lock functions.
+
+  A processor takes the next ticket with an atomic add, and owns the lock when
+  the ticket is served. Unlike a spin lock, the processors own the lock in
+  the order they asked for it, and a processor that waits for the lock only
+  reads it.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Initializes a ticket lock to the released state and returns the ticket lock.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to initialize.
+
+  @return TicketLock in released state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+InitializeTicketLock (
+  OUT TICKET_LOCK  *TicketLock
+  )
+{
+  ASSERT (TicketLock != NULL);
+
+  TicketLock->NextTicket = 0;
+  TicketLock->NowServing = 0;
+  MemoryFence ();
+  return TicketLock;
+}
+
+/**
+  Waits until the ticket lock is released by the processors that asked for it
+  before, then acquires it.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @return TicketLock in acquired state.
+
+**/
+TICKET_LOCK *
+EFIAPI
+AcquireTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  )
+{
+  UINT32  Ticket;
+
+  ASSERT (TicketLock != NULL);
+
+  Ticket = InternalAtomicFetchAdd32 (&TicketLock->NextTicket, 1);
+  while (TicketLock->NowServing != Ticket) {
+    CpuPause ();
+  }
+
+  MemoryFence ();
+  return TicketLock;
+}
+
+/**
+  Acquires the ticket lock if it is released and no processor waits for it.
+
+  If TicketLock is NULL, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to acquire.
+
+  @retval TRUE   TicketLock was acquired.
+  @retval FALSE  TicketLock was not acquired.
+
+**/
+BOOLEAN
+EFIAPI
+AcquireTicketLockOrFail (
+  IN OUT TICKET_LOCK  *TicketLock
+  )
+{
+  UINT32  Ticket;
+
+  ASSERT (TicketLock != NULL);
+
+  Ticket = TicketLock->NowServing;
+  if (TicketLock->NextTicket != Ticket) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (InterlockedCompareExchange32 (&TicketLock->NextTicket, Ticket, Ticket + 1) == Ticket);
+}
+
+/**
+  Releases a ticket lock to the next processor that asked for it.
+
+  If TicketLock is NULL, then ASSERT().
+  If TicketLock is not acquired, then ASSERT().
+
+  @param  TicketLock  A pointer to the ticket lock to release.
+
+  @return TicketLock in released state, or acquired by the next processor.
+
+**/
+TICKET_LOCK *
+EFIAPI
+ReleaseTicketLock (
+  IN OUT TICKET_LOCK  *TicketLock
+  )
+{
+  UINT32  Ticket;
+
+  ASSERT (TicketLock != NULL);
+
+  Ticket = TicketLock->NowServing;
+  ASSERT (TicketLock->NextTicket != Ticket);
+
+  //
+  // Only the owner writes NowServing, so it needs no atomic operation, but
+  // its writes to the data the lock protects must be visible first.
+  //
+  MemoryFence ();
+  TicketLock->NowServing = Ticket + 1;
+  MemoryFence ();
+  return TicketLock;
+}
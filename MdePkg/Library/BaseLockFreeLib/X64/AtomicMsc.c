@@ -0,0 +1,67 @@
+/** @file
+  Microsoft Visual Studio intrinsic implementation of BaseLockFreeLib
+  processor specific functions.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLockFreeLibInternals.h"
+
+/**
+  Microsoft Visual Studio 7.1 Function Prototypes for I/O Intrinsics.
+**/
+
+long _InterlockedExchangeAdd(
+   long volatile * Addend,
+   long Value
+);
+
+__int64 _InterlockedExchangeAdd64(
+   __int64 volatile * Addend,
+   __int64 Value
+);
+
+#pragma intrinsic(_InterlockedExchangeAdd)
+#pragma intrinsic(_InterlockedExchangeAdd64)
+
+/**
+  Atomically adds a value to a 32-bit unsigned integer and returns its original
+  value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 32-bit value.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT32
+EFIAPI
+InternalAtomicFetchAdd32 (
+  IN OUT  volatile UINT32  *Value,
+  IN      UINT32           Addend
+  )
+{
+  return (UINT32) _InterlockedExchangeAdd ((long volatile *) Value, (long) Addend);
+}
+
+/**
+  Atomically adds a value to a 64-bit unsigned integer and returns its original
+  value. The operation is a full memory barrier.
+
+  @param  Value     A pointer to the 64-bit value.
+  @param  Addend    The value to add.
+
+  @return The original *Value.
+
+**/
+UINT64
+EFIAPI
+InternalAtomicFetchAdd64 (
+  IN OUT  volatile UINT64  *Value,
+  IN      UINT64           Addend
+  )
+{
+  return (UINT64) _InterlockedExchangeAdd64 ((__int64 volatile *) Value, (__int64) Addend);
+}
@@ -0,0 +1,290 @@
+/** @file
+  Selection of the copy and fill kernels of the Base Memory Library.
+
+  Processors that report Enhanced REP MOVSB/STOSB (ERMS) copy and fill memory
+  faster with a single "rep movsb" or "rep stosb" than with SSE2 loops, and
+  processors that also report Fast Short REP MOV (FSRM) do so for short
+  buffers as well. The features are read with CPUID once, and kept in a data
+  variable rather than in function pointers so that the library can be linked
+  into runtime drivers, whose function pointers are not converted to virtual
+  addresses.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MemLibInternals.h"
+
+#define MEM_LIB_FEATURE_DETECTED  BIT0
+#define MEM_LIB_FEATURE_ERMS      BIT1
+#define MEM_LIB_FEATURE_FSRM      BIT2
+
+//
+// CPUID.(EAX=07H, ECX=0H):EBX[9] and CPUID.(EAX=07H, ECX=0H):EDX[4]
+//
+#define CPUID_EBX_ERMS            BIT9
+#define CPUID_EDX_FSRM            BIT4
+
+//
+// Without FSRM, "rep movsb" and "rep stosb" are only used for buffers of at
+// least this many bytes.
+//
+#define MEM_LIB_REP_THRESHOLD     128
+
+UINT32  mMemLibFeatures = 0;
+
+/**
+  Reads CPUID leaf 7 sub-leaf 0.
+
+  @return EBX in bits 0..31 and EDX in bits 32..63, or 0 if leaf 7 is not
+          supported.
+
+**/
+UINT64
+EFIAPI
+InternalMemReadCpuFeatures (
+  VOID
+  );
+
+/**
+  Copy Length bytes from Source to Destination with SSE2 instructions.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemSse2 (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Copy Length bytes from Source to Destination with "rep movsb". Destination
+  must not overlap the part of Source that follows it.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemRep (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Set Buffer to Value for Size bytes with SSE2 instructions.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemSse2 (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value
+  );
+
+/**
+  Set Buffer to Value for Size bytes with "rep stosb".
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemRep (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value
+  );
+
+/**
+  Fills a target buffer with zeros with SSE2 instructions.
+
+  @param  Buffer      The pointer to the target buffer to fill with zeros.
+  @param  Length      The number of bytes in Buffer to fill with zeros.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemZeroMemSse2 (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Returns the processor features used to select the kernels, reading them
+  first if needed.
+
+  @return A combination of MEM_LIB_FEATURE_* bits.
+
+**/
+STATIC
+UINT32
+InternalMemGetFeatures (
+  VOID
+  )
+{
+  UINT64  CpuFeatures;
+  UINT32  Features;
+
+  if (mMemLibFeatures != 0) {
+    return mMemLibFeatures;
+  }
+
+  CpuFeatures = InternalMemReadCpuFeatures ();
+  Features    = MEM_LIB_FEATURE_DETECTED;
+  if (((UINT32) CpuFeatures & CPUID_EBX_ERMS) != 0) {
+    Features |= MEM_LIB_FEATURE_ERMS;
+    if (((UINT32) RShiftU64 (CpuFeatures, 32) & CPUID_EDX_FSRM) != 0) {
+      Features |= MEM_LIB_FEATURE_FSRM;
+    }
+  }
+
+  mMemLibFeatures = Features;
+  return Features;
+}
+
+/**
+  Checks whether a buffer is better handled by "rep movsb" or "rep stosb".
+
+  @param  Length      The number of bytes in the buffer.
+
+  @retval TRUE        The "rep" kernels are used.
+  @retval FALSE       The SSE2 kernels are used.
+
+**/
+STATIC
+BOOLEAN
+InternalMemUseRep (
+  IN      UINTN                     Length
+  )
+{
+  UINT32  Features;
+
+  Features = InternalMemGetFeatures ();
+  if ((Features & MEM_LIB_FEATURE_FSRM) != 0) {
+    return TRUE;
+  }
+
+  return (BOOLEAN) ((Features & MEM_LIB_FEATURE_ERMS) != 0 && Length >= MEM_LIB_REP_THRESHOLD);
+}
+
+/**
+  Copy Length bytes from Source to Destination.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMem (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length
+  )
+{
+  //
+  // "rep movsb" is only fast when copying forward, so a destination that
+  // overlaps the end of the source is left to the SSE2 kernel.
+  //
+  if (InternalMemUseRep (Length) &&
+      ((UINTN) DestinationBuffer - (UINTN) SourceBuffer >= Length)) {
+    return InternalMemCopyMemRep (DestinationBuffer, SourceBuffer, Length);
+  }
+
+  return InternalMemCopyMemSse2 (DestinationBuffer, SourceBuffer, Length);
+}
+
+/**
+  Set Buffer to Value for Size bytes.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMem (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value
+  )
+{
+  if (InternalMemUseRep (Length)) {
+    return InternalMemSetMemRep (Buffer, Length, Value);
+  }
+
+  return InternalMemSetMemSse2 (Buffer, Length, Value);
+}
+
+/**
+  Fills a target buffer with zeros.
+
+  @param  Buffer      The pointer to the target buffer to fill with zeros.
+  @param  Length      The number of bytes in Buffer to fill with zeros.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemZeroMem (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length
+  )
+{
+  if (InternalMemUseRep (Length)) {
+    return InternalMemSetMemRep (Buffer, Length, 0);
+  }
+
+  return InternalMemZeroMemSse2 (Buffer, Length);
+}
+
+/**
+  The constructor reads the processor features once, so that the first copy
+  does not have to.
+
+  @retval RETURN_SUCCESS   The constructor always returns RETURN_SUCCESS.
+
+**/
+RETURN_STATUS
+EFIAPI
+BaseMemoryLibSimdConstructor (
+  VOID
+  )
+{
+  InternalMemGetFeatures ();
+  return RETURN_SUCCESS;
+}
@@ -15,7 +15,7 @@
   PeCoffLoaderGetPeHeader() routine will do basic check for PE/COFF header.
   PeCoffLoaderGetImageInfo() routine will do basic check for whole PE/COFF image.
 
-  Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
   Portions copyright (c) 2008 - 2009, Apple Inc. All rights reserved.<BR>
   Portions Copyright (c) 2020, Hewlett Packard Enterprise Development LP. All rights reserved.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
@@ -858,6 +858,93 @@ PeCoffLoaderImageAddress (
   return (CHAR8 *)((UINTN) ImageContext->ImageAddress + Address - TeStrippedOffset);
 }
 
+/**
+  Applies the HIGHLOW and DIR64 fixups at the start of a relocation block, and
+  skips the ABSOLUTE ones, up to the first relocation of another type.
+
+  The fixups of a relocation block are all in the 4 KB page at the
+  VirtualAddress of the block, so the caller checks once that the page is in
+  the image instead of checking each fixup. Each run of fixups of one type is
+  applied by a loop of its own.
+
+  @param  Reloc       The pointer to the first relocation record of the block.
+  @param  RelocEnd    The pointer to the end of the block.
+  @param  FixupBase   The pointer to the page of the block.
+  @param  FixupData   The pointer to the pointer to the buffer to log the
+                      fixups, or to NULL if the fixups are not logged.
+  @param  Adjust      The offset to adjust the fixups.
+
+  @return The pointer to the first relocation record that was not applied, or
+          RelocEnd if all of them were.
+
+**/
+UINT16 *
+PeCoffLoaderRelocateBlock (
+  IN     UINT16   *Reloc,
+  IN     UINT16   *RelocEnd,
+  IN     CHAR8    *FixupBase,
+  IN OUT CHAR8    **FixupData,
+  IN     UINT64   Adjust
+  )
+{
+  UINT32                                *Fixup32;
+  UINT64                                *Fixup64;
+  CHAR8                                 *Data;
+
+  while ((UINTN) Reloc < (UINTN) RelocEnd) {
+    switch ((*Reloc) >> 12) {
+    case EFI_IMAGE_REL_BASED_ABSOLUTE:
+      Reloc += 1;
+      break;
+
+    case EFI_IMAGE_REL_BASED_HIGHLOW:
+      if (*FixupData == NULL) {
+        do {
+          Fixup32  = (UINT32 *) (FixupBase + (*Reloc & 0xFFF));
+          *Fixup32 = *Fixup32 + (UINT32) Adjust;
+          Reloc   += 1;
+        } while (((UINTN) Reloc < (UINTN) RelocEnd) && (((*Reloc) >> 12) == EFI_IMAGE_REL_BASED_HIGHLOW));
+      } else {
+        Data = ALIGN_POINTER (*FixupData, sizeof (UINT32));
+        do {
+          Fixup32  = (UINT32 *) (FixupBase + (*Reloc & 0xFFF));
+          *Fixup32 = *Fixup32 + (UINT32) Adjust;
+          *(UINT32 *) Data = *Fixup32;
+          Data    += sizeof (UINT32);
+          Reloc   += 1;
+        } while (((UINTN) Reloc < (UINTN) RelocEnd) && (((*Reloc) >> 12) == EFI_IMAGE_REL_BASED_HIGHLOW));
+        *FixupData = Data;
+      }
+      break;
+
+    case EFI_IMAGE_REL_BASED_DIR64:
+      if (*FixupData == NULL) {
+        do {
+          Fixup64  = (UINT64 *) (FixupBase + (*Reloc & 0xFFF));
+          *Fixup64 = *Fixup64 + Adjust;
+          Reloc   += 1;
+        } while (((UINTN) Reloc < (UINTN) RelocEnd) && (((*Reloc) >> 12) == EFI_IMAGE_REL_BASED_DIR64));
+      } else {
+        Data = ALIGN_POINTER (*FixupData, sizeof (UINT64));
+        do {
+          Fixup64  = (UINT64 *) (FixupBase + (*Reloc & 0xFFF));
+          *Fixup64 = *Fixup64 + Adjust;
+          *(UINT64 *) Data = *Fixup64;
+          Data    += sizeof (UINT64);
+          Reloc   += 1;
+        } while (((UINTN) Reloc < (UINTN) RelocEnd) && (((*Reloc) >> 12) == EFI_IMAGE_REL_BASED_DIR64));
+        *FixupData = Data;
+      }
+      break;
+
+    default:
+      return Reloc;
+    }
+  }
+
+  return Reloc;
+}
+
 /**
   Applies relocation fixups to a PE/COFF image that was loaded with PeCoffLoaderLoadImage().
 
@@ -1043,6 +1130,14 @@ PeCoffLoaderRelocateImage (
         return RETURN_LOAD_ERROR;
       }
 
+      //
+      // If the whole page of this relocation block is in the image, apply the
+      // common fixups without checking them one by one.
+      //
+      if ((UINT64) RelocBase->VirtualAddress + SIZE_4KB <= ImageContext->ImageSize + TeStrippedOffset) {
+        Reloc = PeCoffLoaderRelocateBlock (Reloc, RelocEnd, FixupBase, &FixupData, Adjust);
+      }
+
       //
       // Run this relocation record
       //
@@ -1625,6 +1720,359 @@ PeCoffLoaderLoadImage (
 }
 
 
+/**
+  Walks the relocations of a relocated PE32 or PE32+ image to count the entries
+  and the values of its runtime relocation table, and to store them.
+
+  @param  ImageContext  The context of the relocated image.
+  @param  Table         The table. Its counts are set to those of the image.
+  @param  Store         TRUE to store the entries and the values in Table, whose
+                        counts must already be those of the image.
+
+  @retval RETURN_SUCCESS      The relocations of the image were walked.
+  @retval RETURN_UNSUPPORTED  The image has a relocation that the table cannot
+                              describe.
+  @retval RETURN_LOAD_ERROR   The relocation data of the image is not valid.
+
+**/
+RETURN_STATUS
+PeCoffLoaderWalkRuntimeFixups (
+  IN     PE_COFF_LOADER_IMAGE_CONTEXT      *ImageContext,
+  IN OUT PE_COFF_RUNTIME_RELOCATION_TABLE  *Table,
+  IN     BOOLEAN                           Store
+  )
+{
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION   Hdr;
+  EFI_IMAGE_DATA_DIRECTORY              *RelocDir;
+  UINT32                                NumberOfRvaAndSizes;
+  EFI_IMAGE_BASE_RELOCATION             *RelocBase;
+  EFI_IMAGE_BASE_RELOCATION             *RelocBaseEnd;
+  UINT16                                *Reloc;
+  UINT16                                *RelocEnd;
+  CHAR8                                 *Image;
+  UINT64                                *WideValues;
+  UINT32                                *Values;
+  UINT16                                *Entries;
+  UINT32                                EntryCount;
+  UINT32                                ValueCount;
+  UINT32                                WideValueCount;
+  UINT32                                Rva;
+  UINT64                                FixupRva;
+  UINT32                                Distance;
+  UINT32                                Pages;
+  UINT64                                Content;
+  UINTN                                 FixupSize;
+  UINT16                                Type;
+
+  Image    = (CHAR8 *) (UINTN) ImageContext->ImageAddress;
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *) (Image + ImageContext->PeCoffHeaderOffset);
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    NumberOfRvaAndSizes = Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+    RelocDir            = &Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  } else {
+    NumberOfRvaAndSizes = Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+    RelocDir            = &Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  }
+
+  RelocBase    = NULL;
+  RelocBaseEnd = NULL;
+  if ((NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC) && (RelocDir->Size > 0)) {
+    RelocBase    = (EFI_IMAGE_BASE_RELOCATION *) PeCoffLoaderImageAddress (ImageContext, RelocDir->VirtualAddress, 0);
+    RelocBaseEnd = (EFI_IMAGE_BASE_RELOCATION *) PeCoffLoaderImageAddress (
+                                                   ImageContext,
+                                                   RelocDir->VirtualAddress + RelocDir->Size - 1,
+                                                   0
+                                                   );
+    if (RelocBase == NULL || RelocBaseEnd == NULL || (UINTN) RelocBaseEnd < (UINTN) RelocBase) {
+      return RETURN_LOAD_ERROR;
+    }
+  }
+
+  WideValues = (UINT64 *) (Table + 1);
+  Values     = (UINT32 *) (WideValues + Table->WideValueCount);
+  Entries    = (UINT16 *) (Values + Table->ValueCount);
+
+  EntryCount     = 0;
+  ValueCount     = 0;
+  WideValueCount = 0;
+  Rva            = 0;
+  while ((UINTN) RelocBase < (UINTN) RelocBaseEnd) {
+    if ((RelocBase->SizeOfBlock < sizeof (EFI_IMAGE_BASE_RELOCATION)) ||
+        (RelocBase->SizeOfBlock > (UINTN) RelocBaseEnd - (UINTN) RelocBase + 1)) {
+      return RETURN_LOAD_ERROR;
+    }
+
+    Reloc    = (UINT16 *) ((CHAR8 *) RelocBase + sizeof (EFI_IMAGE_BASE_RELOCATION));
+    RelocEnd = (UINT16 *) ((CHAR8 *) RelocBase + RelocBase->SizeOfBlock);
+    for (; (UINTN) Reloc < (UINTN) RelocEnd; Reloc++) {
+      Type = (UINT16) ((*Reloc) >> 12);
+      switch (Type) {
+      case EFI_IMAGE_REL_BASED_ABSOLUTE:
+        continue;
+
+      case EFI_IMAGE_REL_BASED_HIGH:
+      case EFI_IMAGE_REL_BASED_LOW:
+        FixupSize = sizeof (UINT16);
+        break;
+
+      case EFI_IMAGE_REL_BASED_HIGHLOW:
+        FixupSize = sizeof (UINT32);
+        break;
+
+      case EFI_IMAGE_REL_BASED_DIR64:
+        FixupSize = sizeof (UINT64);
+        break;
+
+      default:
+        return RETURN_UNSUPPORTED;
+      }
+
+      //
+      // The entries describe fixups in ascending order only.
+      //
+      FixupRva = (UINT64) RelocBase->VirtualAddress + (*Reloc & 0xFFF);
+      if ((FixupRva < Rva) || (FixupRva + FixupSize > ImageContext->ImageSize)) {
+        return RETURN_UNSUPPORTED;
+      }
+
+      Distance = (UINT32) (FixupRva - Rva);
+      while (Distance >= SIZE_4KB) {
+        Pages = Distance / SIZE_4KB;
+        if (Pages > 0xFFF) {
+          Pages = 0xFFF;
+        }
+        if (Store) {
+          Entries[EntryCount] = (UINT16) ((PE_COFF_RUNTIME_FIXUP_SKIP << 12) | (UINT16) Pages);
+        }
+        EntryCount++;
+        Distance -= Pages * SIZE_4KB;
+      }
+
+      switch (Type) {
+      case EFI_IMAGE_REL_BASED_HIGH:
+      case EFI_IMAGE_REL_BASED_LOW:
+        Content = *(UINT16 *) (Image + (UINTN) FixupRva);
+        break;
+
+      case EFI_IMAGE_REL_BASED_HIGHLOW:
+        Content = *(UINT32 *) (Image + (UINTN) FixupRva);
+        break;
+
+      default:
+        Content = *(UINT64 *) (Image + (UINTN) FixupRva) - (UINTN) Image;
+        if (Content > MAX_UINT32) {
+          Type = PE_COFF_RUNTIME_FIXUP_DIR64_WIDE;
+          if (Store) {
+            WideValues[WideValueCount] = *(UINT64 *) (Image + (UINTN) FixupRva);
+          }
+          WideValueCount++;
+        }
+        break;
+      }
+
+      if (Type != PE_COFF_RUNTIME_FIXUP_DIR64_WIDE) {
+        if (Store) {
+          Values[ValueCount] = (UINT32) Content;
+        }
+        ValueCount++;
+      }
+
+      if (Store) {
+        Entries[EntryCount] = (UINT16) ((Type << 12) | (UINT16) Distance);
+      }
+      EntryCount++;
+      Rva = (UINT32) FixupRva;
+    }
+
+    RelocBase = (EFI_IMAGE_BASE_RELOCATION *) RelocEnd;
+  }
+
+  ASSERT (!Store || (EntryCount == Table->EntryCount && ValueCount == Table->ValueCount && WideValueCount == Table->WideValueCount));
+  Table->EntryCount     = EntryCount;
+  Table->ValueCount     = ValueCount;
+  Table->WideValueCount = WideValueCount;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Builds the runtime relocation table of a PE32 or PE32+ image that was
+  relocated with PeCoffLoaderRelocateImage().
+
+  The table lists the fixups of the image that PeCoffLoaderRelocateImageForRuntime()
+  reapplies, with their content once relocated, and is passed to it in place
+  of the FixupData buffer. It leaves out the ABSOLUTE relocations, and the
+  relocations are checked against the image once, when the table is built.
+  The table of an image is usually smaller than its FixupData buffer.
+
+  The table must be built before the image runs, so that the content of each
+  fixup is the one the image was relocated with.
+
+  If ImageContext is NULL, then ASSERT().
+  If TableSize is NULL, then ASSERT().
+
+  @param  ImageContext        The pointer to the image context structure that describes the
+                              PE/COFF image that was relocated.
+  @param  Table               The buffer, 8-byte aligned, to build the table in, or NULL to get
+                              the size of the table.
+  @param  TableSize           On input, the size in bytes of Table. On output, the size in
+                              bytes of the table.
+
+  @retval RETURN_SUCCESS            The table was built.
+  @retval RETURN_BUFFER_TOO_SMALL   Table is NULL or smaller than the table. TableSize is set
+                                    to the size of the table.
+  @retval RETURN_UNSUPPORTED        The image has relocations that the table cannot describe,
+                                    so the FixupData buffer must be used instead.
+  @retval RETURN_LOAD_ERROR         The relocation data of the image is not valid.
+
+**/
+RETURN_STATUS
+EFIAPI
+PeCoffLoaderBuildRuntimeRelocationTable (
+  IN     PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  OUT    VOID                          *Table,  OPTIONAL
+  IN OUT UINTN                         *TableSize
+  )
+{
+  RETURN_STATUS                     Status;
+  PE_COFF_RUNTIME_RELOCATION_TABLE  Counts;
+  PE_COFF_RUNTIME_RELOCATION_TABLE  *Header;
+  UINTN                             Size;
+
+  ASSERT (ImageContext != NULL);
+  ASSERT (TableSize != NULL);
+
+  if (ImageContext->IsTeImage || ImageContext->RelocationsStripped) {
+    return RETURN_UNSUPPORTED;
+  }
+
+  ZeroMem (&Counts, sizeof (Counts));
+  Status = PeCoffLoaderWalkRuntimeFixups (ImageContext, &Counts, FALSE);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Size = sizeof (PE_COFF_RUNTIME_RELOCATION_TABLE) +
+         Counts.WideValueCount * sizeof (UINT64) +
+         Counts.ValueCount * sizeof (UINT32) +
+         Counts.EntryCount * sizeof (UINT16);
+  if ((Table == NULL) || (*TableSize < Size)) {
+    *TableSize = Size;
+    return RETURN_BUFFER_TOO_SMALL;
+  }
+
+  ASSERT (((UINTN) Table & (sizeof (UINT64) - 1)) == 0);
+
+  Header = (PE_COFF_RUNTIME_RELOCATION_TABLE *) Table;
+  CopyMem (Header, &Counts, sizeof (Counts));
+  Header->Signature = PE_COFF_RUNTIME_RELOCATION_SIGNATURE;
+  Header->ImageBase = ImageContext->ImageAddress;
+  Header->ImageSize = ImageContext->ImageSize;
+  Status = PeCoffLoaderWalkRuntimeFixups (ImageContext, Header, TRUE);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  *TableSize = Size;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Reapplies the fixups of a runtime relocation table to its image, for the
+  image to run at VirtImageBase.
+
+  A fixup whose content is no longer the one it was relocated with was
+  updated by the image, and is left as it is.
+
+  @param  Table          The runtime relocation table of the image.
+  @param  VirtImageBase  The virtual address of the image.
+
+**/
+VOID
+PeCoffLoaderRelocateTableForRuntime (
+  IN  PE_COFF_RUNTIME_RELOCATION_TABLE  *Table,
+  IN  PHYSICAL_ADDRESS                  VirtImageBase
+  )
+{
+  CHAR8                                 *Image;
+  UINT64                                Adjust;
+  UINT64                                *WideValues;
+  UINT32                                *Values;
+  UINT16                                *Entry;
+  UINT16                                *EntryEnd;
+  UINT32                                Rva;
+  UINT16                                *Fixup16;
+  UINT32                                *Fixup32;
+  UINT64                                *Fixup64;
+
+  Image  = (CHAR8 *) (UINTN) Table->ImageBase;
+  Adjust = VirtImageBase - Table->ImageBase;
+  if (Adjust == 0) {
+    return;
+  }
+
+  WideValues = (UINT64 *) (Table + 1);
+  Values     = (UINT32 *) (WideValues + Table->WideValueCount);
+  Entry      = (UINT16 *) (Values + Table->ValueCount);
+  EntryEnd   = Entry + Table->EntryCount;
+  Rva        = 0;
+  for (; Entry < EntryEnd; Entry++) {
+    if (((*Entry) >> 12) == PE_COFF_RUNTIME_FIXUP_SKIP) {
+      Rva += (UINT32) (*Entry & 0xFFF) * SIZE_4KB;
+      continue;
+    }
+
+    Rva += *Entry & 0xFFF;
+    if (Rva >= Table->ImageSize) {
+      return;
+    }
+
+    switch ((*Entry) >> 12) {
+    case EFI_IMAGE_REL_BASED_DIR64:
+      Fixup64 = (UINT64 *) (Image + Rva);
+      if (*Fixup64 == Table->ImageBase + *Values) {
+        *Fixup64 = *Fixup64 + Adjust;
+      }
+      Values++;
+      break;
+
+    case PE_COFF_RUNTIME_FIXUP_DIR64_WIDE:
+      Fixup64 = (UINT64 *) (Image + Rva);
+      if (*Fixup64 == *WideValues) {
+        *Fixup64 = *Fixup64 + Adjust;
+      }
+      WideValues++;
+      break;
+
+    case EFI_IMAGE_REL_BASED_HIGHLOW:
+      Fixup32 = (UINT32 *) (Image + Rva);
+      if (*Fixup32 == *Values) {
+        *Fixup32 = *Fixup32 + (UINT32) Adjust;
+      }
+      Values++;
+      break;
+
+    case EFI_IMAGE_REL_BASED_HIGH:
+      Fixup16 = (UINT16 *) (Image + Rva);
+      if (*Fixup16 == *Values) {
+        *Fixup16 = (UINT16) (*Fixup16 + ((UINT16) ((UINT32) Adjust >> 16)));
+      }
+      Values++;
+      break;
+
+    case EFI_IMAGE_REL_BASED_LOW:
+      Fixup16 = (UINT16 *) (Image + Rva);
+      if (*Fixup16 == *Values) {
+        *Fixup16 = (UINT16) (*Fixup16 + ((UINT16) Adjust & 0xffff));
+      }
+      Values++;
+      break;
+
+    default:
+      return;
+    }
+  }
+}
+
 /**
   Reapply fixups on a fixed up PE32/PE32+ image to allow virutal calling at EFI
   runtime.
@@ -1633,7 +2081,8 @@ PeCoffLoaderLoadImage (
   and ImageSize so the image will execute correctly when the PE/COFF image is mapped
   to the address specified by VirtualImageBase.  RelocationData must be identical
   to the FiuxupData buffer from the PE_COFF_LOADER_IMAGE_CONTEXT structure
-  after this PE/COFF image was relocated with PeCoffLoaderRelocateImage().
+  after this PE/COFF image was relocated with PeCoffLoaderRelocateImage(), or
+  be the table built from this image by PeCoffLoaderBuildRuntimeRelocationTable().
 
   Note that if the platform does not maintain coherency between the instruction cache(s) and the data
   cache(s) in hardware, then the caller is responsible for performing cache maintenance operations
@@ -1645,7 +2094,8 @@ PeCoffLoaderLoadImage (
                              be fixed up for.
   @param  ImageSize          The size, in bytes, of the PE/COFF image.
   @param  RelocationData     A pointer to the relocation data that was collected when the PE/COFF
-                             image was relocated using PeCoffLoaderRelocateImage().
+                             image was relocated using PeCoffLoaderRelocateImage(), or to the
+                             table built by PeCoffLoaderBuildRuntimeRelocationTable().
 
 **/
 VOID
@@ -1678,11 +2128,23 @@ PeCoffLoaderRelocateImageForRuntime (
   UINTN                               Adjust;
   RETURN_STATUS                       Status;
   PE_COFF_LOADER_IMAGE_CONTEXT        ImageContext;
+  PE_COFF_RUNTIME_RELOCATION_TABLE    *Table;
 
   if (RelocationData == NULL || ImageBase == 0x0 || VirtImageBase == 0x0) {
     return;
   }
 
+  //
+  // RelocationData is either the FixupData buffer of the relocation of the
+  // image, or the runtime relocation table of the image.
+  //
+  Table = (PE_COFF_RUNTIME_RELOCATION_TABLE *) RelocationData;
+  if ((Table->Signature == PE_COFF_RUNTIME_RELOCATION_SIGNATURE) &&
+      (Table->ImageBase == ImageBase) && (Table->ImageSize == ImageSize)) {
+    PeCoffLoaderRelocateTableForRuntime (Table, VirtImageBase);
+    return;
+  }
+
   OldBase = (CHAR8 *)((UINTN)ImageBase);
   NewBase = (CHAR8 *)((UINTN)VirtImageBase);
   Adjust = (UINTN) NewBase - (UINTN) OldBase;
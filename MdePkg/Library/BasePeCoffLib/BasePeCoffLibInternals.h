@@ -1,7 +1,7 @@
 /** @file
   Declaration of internal functions in PE/COFF Lib.
 
-  Copyright (c) 2006 - 2010, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
   Portions Copyright (c) 2020, Hewlett Packard Enterprise Development LP. All rights reserved.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -26,6 +26,46 @@
 #define RISCV_CONST_HIGH_PART(VALUE) \
   (((VALUE) + (RISCV_IMM_REACH/2)) & ~(RISCV_IMM_REACH-1))
 
+//
+// Runtime relocation table built by PeCoffLoaderBuildRuntimeRelocationTable().
+//
+// The header is followed by the 64-bit values, the 32-bit values and the
+// entries. Each entry is a UINT16 whose high 4 bits are a relocation type and
+// whose low 12 bits are the distance in bytes from the previous fixup, or
+// from the start of the image for the first one. Each fixup has a value, the
+// content of the fixup when the table was built:
+// - HIGH, LOW and HIGHLOW fixups have a 32-bit value.
+// - DIR64 fixups have a 32-bit value, which is the offset of the content from
+//   ImageBase.
+// - PE_COFF_RUNTIME_FIXUP_DIR64_WIDE fixups have a 64-bit value.
+// The values are in the order of the fixups.
+//
+#define PE_COFF_RUNTIME_RELOCATION_SIGNATURE  SIGNATURE_64 ('P', 'E', 'R', 'T', 'R', 'E', 'L', 'O')
+
+///
+/// Entry that adds its low 12 bits times 4 KB to the address of the next
+/// fixup, for fixups that are 4 KB or more apart.
+///
+#define PE_COFF_RUNTIME_FIXUP_SKIP        0x0
+
+///
+/// DIR64 fixup whose content is not within 4 GB above ImageBase.
+///
+#define PE_COFF_RUNTIME_FIXUP_DIR64_WIDE  0xF
+
+typedef struct {
+  UINT64  Signature;
+  ///
+  /// The address of the image when the table was built.
+  ///
+  UINT64  ImageBase;
+  UINT64  ImageSize;
+  UINT32  EntryCount;
+  UINT32  ValueCount;
+  UINT32  WideValueCount;
+  UINT32  Reserved;
+} PE_COFF_RUNTIME_RELOCATION_TABLE;
+
 
 /**
   Performs an Itanium-based specific relocation fixup and is a no-op on other
@@ -133,4 +173,64 @@ PeCoffLoaderImageAddress (
   IN     UINTN                                 TeStrippedOffset
   );
 
+/**
+  Applies the HIGHLOW and DIR64 fixups at the start of a relocation block, and
+  skips the ABSOLUTE ones, up to the first relocation of another type.
+
+  @param  Reloc       The pointer to the first relocation record of the block.
+  @param  RelocEnd    The pointer to the end of the block.
+  @param  FixupBase   The pointer to the page of the block.
+  @param  FixupData   The pointer to the pointer to the buffer to log the
+                      fixups, or to NULL if the fixups are not logged.
+  @param  Adjust      The offset to adjust the fixups.
+
+  @return The pointer to the first relocation record that was not applied, or
+          RelocEnd if all of them were.
+
+**/
+UINT16 *
+PeCoffLoaderRelocateBlock (
+  IN     UINT16   *Reloc,
+  IN     UINT16   *RelocEnd,
+  IN     CHAR8    *FixupBase,
+  IN OUT CHAR8    **FixupData,
+  IN     UINT64   Adjust
+  );
+
+/**
+  Walks the relocations of a relocated PE32 or PE32+ image to count the entries
+  and the values of its runtime relocation table, and to store them.
+
+  @param  ImageContext  The context of the relocated image.
+  @param  Table         The table. Its counts are set to those of the image.
+  @param  Store         TRUE to store the entries and the values in Table, whose
+                        counts must already be those of the image.
+
+  @retval RETURN_SUCCESS      The relocations of the image were walked.
+  @retval RETURN_UNSUPPORTED  The image has a relocation that the table cannot
+                              describe.
+  @retval RETURN_LOAD_ERROR   The relocation data of the image is not valid.
+
+**/
+RETURN_STATUS
+PeCoffLoaderWalkRuntimeFixups (
+  IN     PE_COFF_LOADER_IMAGE_CONTEXT      *ImageContext,
+  IN OUT PE_COFF_RUNTIME_RELOCATION_TABLE  *Table,
+  IN     BOOLEAN                           Store
+  );
+
+/**
+  Reapplies the fixups of a runtime relocation table to its image, for the
+  image to run at VirtImageBase.
+
+  @param  Table          The runtime relocation table of the image.
+  @param  VirtImageBase  The virtual address of the image.
+
+**/
+VOID
+PeCoffLoaderRelocateTableForRuntime (
+  IN  PE_COFF_RUNTIME_RELOCATION_TABLE  *Table,
+  IN  PHYSICAL_ADDRESS                  VirtImageBase
+  );
+
 #endif
@@ -1,7 +1,7 @@
 /** @file
   HOB Library implementation for Dxe Phase.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -9,13 +9,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <PiDxe.h>
 
 #include <Guid/HobList.h>
+#include <Guid/HobIndex.h>
 
 #include <Library/HobLib.h>
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/HobIndexLib.h>
 
-VOID  *mHobList = NULL;
+VOID                    *mHobList  = NULL;
+STATIC EDKII_HOB_INDEX  *mHobIndex = NULL;
 
 /**
   Returns the pointer to the HOB list.
@@ -47,6 +50,15 @@ GetHobList (
     Status = EfiGetSystemConfigurationTable (&gEfiHobListGuid, &mHobList);
     ASSERT_EFI_ERROR (Status);
     ASSERT (mHobList != NULL);
+
+    //
+    // The HOB index built by the DXE Core is optional. Without it, the HOB
+    // list is walked.
+    //
+    Status = EfiGetSystemConfigurationTable (&gEdkiiHobIndexGuid, (VOID **) &mHobIndex);
+    if (EFI_ERROR (Status) || !IsHobIndexValid (mHobIndex, mHobList)) {
+      mHobIndex = NULL;
+    }
   }
   return mHobList;
 }
@@ -98,10 +110,15 @@ GetNextHob (
   )
 {
   EFI_PEI_HOB_POINTERS  Hob;
+  BOOLEAN               Found;
 
   ASSERT (HobStart != NULL);
 
-  Hob.Raw = (UINT8 *) HobStart;
+  Hob.Raw = LookupHobIndex (mHobIndex, Type, NULL, HobStart, &Found);
+  if (Found) {
+    return Hob.Raw;
+  }
+
   //
   // Parse the HOB list until end of list or matching type is found.
   //
@@ -169,8 +186,13 @@ GetNextGuidHob (
   )
 {
   EFI_PEI_HOB_POINTERS  GuidHob;
+  BOOLEAN               Found;
+
+  GuidHob.Raw = LookupHobIndex (mHobIndex, EFI_HOB_TYPE_GUID_EXTENSION, Guid, HobStart, &Found);
+  if (Found) {
+    return GuidHob.Raw;
+  }
 
-  GuidHob.Raw = (UINT8 *) HobStart;
   while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
     if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
       break;
@@ -1,7 +1,7 @@
 /** @file
   Provide Hob Library functions for Pei phase.
 
-Copyright (c) 2007 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2021, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -9,11 +9,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <PiPei.h>
 
 #include <Guid/MemoryAllocationHob.h>
+#include <Guid/HobIndex.h>
 
 #include <Library/HobLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PeiServicesLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/HobIndexLib.h>
 
 /**
   Returns the pointer to the HOB list.
@@ -47,6 +49,39 @@ GetHobList (
   return HobList;
 }
 
+/**
+  Returns the HOB index published by the PEI Core in the second HOB of the
+  HOB list.
+
+  @param  HobList       The HOB list.
+
+  @return The HOB index, or NULL if there is none.
+
+**/
+STATIC
+EDKII_HOB_INDEX *
+InternalGetHobIndex (
+  IN CONST VOID             *HobList
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  EDKII_HOB_INDEX       *Index;
+
+  Hob.Raw = (UINT8 *) HobList;
+  Hob.Raw = GET_NEXT_HOB (Hob);
+  if (Hob.Header->HobType != EFI_HOB_TYPE_GUID_EXTENSION ||
+      !CompareGuid (&Hob.Guid->Name, &gEdkiiHobIndexGuid)) {
+    return NULL;
+  }
+
+  Index = (EDKII_HOB_INDEX *) (UINTN) ReadUnaligned64 (GET_GUID_HOB_DATA (Hob));
+  if (!IsHobIndexValid (Index, HobList)) {
+    return NULL;
+  }
+
+  return Index;
+}
+
 /**
   Returns the next instance of a HOB type from the starting HOB.
 
@@ -113,6 +148,46 @@ GetFirstHob (
   return GetNextHob (Type, HobList);
 }
 
+/**
+  Returns the next instance of the matched GUID HOB from the starting HOB in a
+  HOB list, through the HOB index of the HOB list when there is one.
+
+  @param  HobList       The HOB list.
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      The starting HOB pointer to search from.
+
+  @return The next instance of the matched GUID HOB from the starting HOB.
+
+**/
+STATIC
+VOID *
+InternalGetNextGuidHob (
+  IN CONST VOID             *HobList,
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  GuidHob;
+  BOOLEAN               Found;
+
+  //
+  // The PEI Core only indexes the GUID extension HOBs, because the types of
+  // the memory HOBs change while they are reused.
+  //
+  GuidHob.Raw = LookupHobIndex (InternalGetHobIndex (HobList), EFI_HOB_TYPE_GUID_EXTENSION, Guid, HobStart, &Found);
+  if (Found) {
+    return GuidHob.Raw;
+  }
+
+  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
+    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      break;
+    }
+    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
+  }
+  return GuidHob.Raw;
+}
+
 /**
   Returns the next instance of the matched GUID HOB from the starting HOB.
 
@@ -142,16 +217,7 @@ GetNextGuidHob (
   IN CONST VOID             *HobStart
   )
 {
-  EFI_PEI_HOB_POINTERS  GuidHob;
-
-  GuidHob.Raw = (UINT8 *) HobStart;
-  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
-    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
-      break;
-    }
-    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
-  }
-  return GuidHob.Raw;
+  return InternalGetNextGuidHob (GetHobList (), Guid, HobStart);
 }
 
 /**
@@ -181,7 +247,7 @@ GetFirstGuidHob (
   VOID      *HobList;
 
   HobList = GetHobList ();
-  return GetNextGuidHob (Guid, HobList);
+  return InternalGetNextGuidHob (HobList, Guid, HobList);
 }
 
 /**
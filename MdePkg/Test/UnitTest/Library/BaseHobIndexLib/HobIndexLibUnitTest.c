@@ -0,0 +1,637 @@
+/** @file
+  Host based unit tests of BaseHobIndexLib.
+
+  The tests build a HOB list with memory allocation, resource descriptor and
+  GUID extension HOBs of many GUIDs, and index it. Every lookup is checked
+  against a walk of the HOB list: a HOB found in the index must be the HOB the
+  walk finds, and a HOB not found in the index must be found by walking the
+  HOB list from the HOB the lookup returns.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+
+#include <PiPei.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobIndexLib.h>
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "BaseHobIndexLib Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_HOB_COUNT         1000
+#define TEST_GUID_COUNT        40
+#define TEST_GUID_SLOT_COUNT   256
+#define TEST_HOB_LIST_SIZE     (TEST_HOB_COUNT * 64 + SIZE_4KB)
+
+VOID             *mHobList;
+VOID             *mHobListMiddle;
+EFI_GUID         *mGuids;
+EDKII_HOB_INDEX  *mIndex;
+
+/**
+  Appends a HOB to the HOB list of the test.
+
+  @param  HobEnd                 The end of the HOB list, updated to the end
+                                 of the new HOB.
+  @param  HobType                The type of the HOB.
+  @param  HobLength              The length of the HOB.
+
+  @return The new HOB.
+
+**/
+VOID *
+AppendHob (
+  IN OUT UINT8   **HobEnd,
+  IN     UINT16  HobType,
+  IN     UINT16  HobLength
+  )
+{
+  EFI_HOB_GENERIC_HEADER  *Hob;
+
+  Hob            = (EFI_HOB_GENERIC_HEADER *) *HobEnd;
+  Hob->HobType   = HobType;
+  Hob->HobLength = HobLength;
+  Hob->Reserved  = 0;
+  *HobEnd       += HobLength;
+  return Hob;
+}
+
+/**
+  Returns the next HOB of a type, or the next GUID extension HOB of a GUID,
+  by walking the HOB list.
+
+  @param  Type                   The HOB type.
+  @param  Guid                   The GUID when Type is
+                                 EFI_HOB_TYPE_GUID_EXTENSION, or NULL.
+  @param  HobStart               The HOB to walk the HOB list from.
+
+  @return The matching HOB, or NULL if there is none.
+
+**/
+VOID *
+WalkHobList (
+  IN UINT16          Type,
+  IN CONST EFI_GUID  *Guid,     OPTIONAL
+  IN CONST VOID      *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+
+  for (Hob.Raw = (UINT8 *) HobStart; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == Type &&
+        (Guid == NULL || CompareGuid (&Hob.Guid->Name, Guid))) {
+      return Hob.Raw;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Checks that a lookup in the HOB index of the test gives the HOB that a walk
+  of the HOB list gives.
+
+  @param  Type                   The HOB type.
+  @param  Guid                   The GUID when Type is
+                                 EFI_HOB_TYPE_GUID_EXTENSION, or NULL.
+  @param  HobStart               The HOB to search from.
+  @param  Found                  Returns whether the HOB was found in the
+                                 index.
+
+  @retval UNIT_TEST_PASSED       The lookup and the walk give the same HOB.
+
+**/
+UNIT_TEST_STATUS
+CheckLookup (
+  IN  UINT16          Type,
+  IN  CONST EFI_GUID  *Guid,     OPTIONAL
+  IN  CONST VOID      *HobStart,
+  OUT BOOLEAN         *Found
+  )
+{
+  VOID  *Hob;
+  VOID  *Expected;
+
+  Hob      = LookupHobIndex (mIndex, Type, Guid, HobStart, Found);
+  Expected = WalkHobList (Type, Guid, HobStart);
+  if (*Found) {
+    UT_ASSERT_EQUAL ((UINTN) Hob, (UINTN) Expected);
+  } else {
+    UT_ASSERT_NOT_NULL (Hob);
+    UT_ASSERT_TRUE ((UINTN) Hob >= (UINTN) HobStart);
+    UT_ASSERT_EQUAL ((UINTN) WalkHobList (Type, Guid, Hob), (UINTN) Expected);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Builds the HOB index of the test for the HOBs of the HOB list before a HOB.
+
+  @param  TypeMask               The HOB types to index.
+  @param  IndexedEnd             The HOB that ends the indexed HOBs.
+
+  @retval UNIT_TEST_PASSED       The HOB index is built.
+
+**/
+UNIT_TEST_STATUS
+BuildIndex (
+  IN UINT32  TypeMask,
+  IN VOID    *IndexedEnd
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  UINT32                EntryCount;
+
+  EntryCount = 0;
+  for (Hob.Raw = mHobList; Hob.Raw != IndexedEnd; Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType < EDKII_HOB_INDEX_TYPE_COUNT &&
+        (TypeMask & (1U << Hob.Header->HobType)) != 0) {
+      EntryCount++;
+    }
+  }
+
+  mIndex = AllocatePool (GetHobIndexSize (EntryCount, TEST_GUID_SLOT_COUNT));
+  UT_ASSERT_NOT_NULL (mIndex);
+
+  InitializeHobIndex (mIndex, mHobList, TypeMask, EntryCount, TEST_GUID_SLOT_COUNT);
+  UT_ASSERT_TRUE (IsHobIndexValid (mIndex, mHobList));
+
+  for (Hob.Raw = mHobList; Hob.Raw != IndexedEnd; Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType < EDKII_HOB_INDEX_TYPE_COUNT &&
+        (TypeMask & (1U << Hob.Header->HobType)) != 0) {
+      AppendHobToIndex (mIndex, Hob.Raw);
+    }
+  }
+
+  mIndex->IndexedEnd = IndexedEnd;
+  UT_ASSERT_EQUAL (mIndex->EntryCount, EntryCount);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Builds a HOB list with HOBs of random types, and GUID extension HOBs of
+  random GUIDs of the test. The GUID extension HOBs of the last GUID are all
+  in the second half of the HOB list.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB list is built.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                       *HobEnd;
+  EFI_HOB_HANDOFF_INFO_TABLE  *Handoff;
+  EFI_HOB_GUID_TYPE           *GuidHob;
+  UINTN                       Index;
+  UINTN                       Word;
+
+  //
+  // Seed the C library generator, so that the HOB list is the same on every run.
+  //
+  srand (0x4321);
+
+  mIndex   = NULL;
+  mHobList = AllocateZeroPool (TEST_HOB_LIST_SIZE);
+  mGuids   = AllocatePool (TEST_GUID_COUNT * sizeof (EFI_GUID));
+  UT_ASSERT_NOT_NULL (mHobList);
+  UT_ASSERT_NOT_NULL (mGuids);
+
+  //
+  // Make GUIDs that differ in one word only, as the GUIDs of a platform often do.
+  //
+  for (Index = 0; Index < TEST_GUID_COUNT; Index++) {
+    for (Word = 0; Word < 4; Word++) {
+      ((UINT32 *) &mGuids[Index])[Word] = 0x5A5A0000 + (UINT32) Word;
+    }
+    mGuids[Index].Data1 += (UINT32) Index;
+  }
+
+  HobEnd  = mHobList;
+  Handoff = AppendHob (&HobEnd, EFI_HOB_TYPE_HANDOFF, sizeof (EFI_HOB_HANDOFF_INFO_TABLE));
+  Handoff->Version = EFI_HOB_HANDOFF_TABLE_VERSION;
+
+  for (Index = 0; Index < TEST_HOB_COUNT; Index++) {
+    if (Index == TEST_HOB_COUNT / 2) {
+      mHobListMiddle = HobEnd;
+    }
+    switch (rand () % 4) {
+      case 0:
+        AppendHob (&HobEnd, EFI_HOB_TYPE_MEMORY_ALLOCATION, sizeof (EFI_HOB_MEMORY_ALLOCATION));
+        break;
+      case 1:
+        AppendHob (&HobEnd, EFI_HOB_TYPE_RESOURCE_DESCRIPTOR, sizeof (EFI_HOB_RESOURCE_DESCRIPTOR));
+        break;
+      default:
+        GuidHob = AppendHob (&HobEnd, EFI_HOB_TYPE_GUID_EXTENSION, sizeof (EFI_HOB_GUID_TYPE) + 8 * (rand () % 4));
+        if (Index < TEST_HOB_COUNT / 2) {
+          CopyGuid (&GuidHob->Name, &mGuids[rand () % (TEST_GUID_COUNT - 1)]);
+        } else {
+          CopyGuid (&GuidHob->Name, &mGuids[rand () % TEST_GUID_COUNT]);
+        }
+        break;
+    }
+  }
+
+  AppendHob (&HobEnd, EFI_HOB_TYPE_END_OF_HOB_LIST, sizeof (EFI_HOB_GENERIC_HEADER));
+  Handoff->EfiEndOfHobList = (EFI_PHYSICAL_ADDRESS) (UINTN) (HobEnd - sizeof (EFI_HOB_GENERIC_HEADER));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Builds a HOB list, and indexes every HOB type that fits in the index, as
+  the DXE Core does.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOB list is built and indexed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CreateIndexedHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+
+  UT_ASSERT_EQUAL (CreateHobList (Context), UNIT_TEST_PASSED);
+
+  Hob.Raw = mHobList;
+  while (!END_OF_HOB_LIST (Hob)) {
+    Hob.Raw = GET_NEXT_HOB (Hob);
+  }
+
+  return BuildIndex (BIT16 - 1, Hob.Raw);
+}
+
+/**
+  Frees the HOB list and the HOB index of the test.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeHobList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mIndex != NULL) {
+    FreePool (mIndex);
+  }
+  FreePool (mHobList);
+  FreePool (mGuids);
+}
+
+/**
+  Checks that a lookup from any HOB of the HOB list gives the HOB that a walk
+  of the HOB list gives. Most of the lookups start after a HOB that is not in
+  the searched chain, so that the binary search is followed by a walk of the
+  chain.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every lookup matches the walk.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LookupMatchesWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  BOOLEAN               Found;
+  UINTN                 FoundCount;
+  UINTN                 Guid;
+
+  FoundCount = 0;
+  for (Hob.Raw = mHobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_MEMORY_ALLOCATION, NULL, Hob.Raw, &Found), UNIT_TEST_PASSED);
+    FoundCount += Found;
+    UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_RESOURCE_DESCRIPTOR, NULL, Hob.Raw, &Found), UNIT_TEST_PASSED);
+    FoundCount += Found;
+    UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_FV, NULL, Hob.Raw, &Found), UNIT_TEST_PASSED);
+    UT_ASSERT_FALSE (Found);
+
+    for (Guid = 0; Guid < TEST_GUID_COUNT; Guid += 7) {
+      UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[Guid], Hob.Raw, &Found), UNIT_TEST_PASSED);
+      FoundCount += Found;
+    }
+  }
+
+  UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_GUID_EXTENSION, &gEfiCallerIdGuid, mHobList, &Found), UNIT_TEST_PASSED);
+  UT_ASSERT_FALSE (Found);
+
+  //
+  // The walks that end at the end of the HOB list are not found.
+  //
+  UT_ASSERT_TRUE (FoundCount > TEST_HOB_COUNT);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that walking the HOBs of a type, or of a GUID, by looking up from
+  the HOB after the previous result, as GetNextGuidHob() is used, finds every
+  matching HOB in order.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every walk finds every matching HOB.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LookupResumesFromPreviousHob (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  VOID                  *Expected;
+  BOOLEAN               Found;
+  UINTN                 Guid;
+  UINTN                 Count;
+  UINTN                 Total;
+
+  Total = 0;
+  for (Guid = 0; Guid <= TEST_GUID_COUNT; Guid++) {
+    Count    = 0;
+    Expected = mHobList;
+    Hob.Raw  = mHobList;
+    while (TRUE) {
+      if (Guid < TEST_GUID_COUNT) {
+        Expected = WalkHobList (EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[Guid], Expected);
+        Hob.Raw  = LookupHobIndex (mIndex, EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[Guid], Hob.Raw, &Found);
+      } else {
+        Expected = WalkHobList (EFI_HOB_TYPE_MEMORY_ALLOCATION, NULL, Expected);
+        Hob.Raw  = LookupHobIndex (mIndex, EFI_HOB_TYPE_MEMORY_ALLOCATION, NULL, Hob.Raw, &Found);
+      }
+
+      if (Expected == NULL) {
+        UT_ASSERT_FALSE (Found);
+        UT_ASSERT_EQUAL ((UINTN) Hob.Raw, (UINTN) mIndex->IndexedEnd);
+        break;
+      }
+
+      UT_ASSERT_TRUE (Found);
+      UT_ASSERT_EQUAL ((UINTN) Hob.Raw, (UINTN) Expected);
+      Count++;
+
+      Hob.Raw  = GET_NEXT_HOB (Hob);
+      Expected = Hob.Raw;
+    }
+
+    Total += Count;
+  }
+
+  UT_ASSERT_TRUE (Total > TEST_HOB_COUNT / 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOBs whose type changed to EFI_HOB_TYPE_UNUSED after they
+  were indexed are skipped, including when they end a chain.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The changed HOBs are skipped.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnusedHobsAreSkipped (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  EFI_PEI_HOB_POINTERS  Last;
+  BOOLEAN               Found;
+  UINTN                 Count;
+  UINTN                 Guid;
+
+  Count    = 0;
+  Last.Raw = NULL;
+  for (Hob.Raw = mHobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_MEMORY_ALLOCATION ||
+        Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      Last.Raw = Hob.Raw;
+      if (Count++ % 3 == 0) {
+        Hob.Header->HobType = EFI_HOB_TYPE_UNUSED;
+      }
+    }
+  }
+
+  UT_ASSERT_NOT_NULL (Last.Raw);
+  Last.Header->HobType = EFI_HOB_TYPE_UNUSED;
+
+  for (Hob.Raw = mHobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_MEMORY_ALLOCATION, NULL, Hob.Raw, &Found), UNIT_TEST_PASSED);
+    for (Guid = 0; Guid < TEST_GUID_COUNT; Guid += 3) {
+      UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[Guid], Hob.Raw, &Found), UNIT_TEST_PASSED);
+    }
+  }
+
+  //
+  // The unused HOBs are not in the index of their new type.
+  //
+  UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_UNUSED, NULL, mHobList, &Found), UNIT_TEST_PASSED);
+  UT_ASSERT_FALSE (Found);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the lookups that start outside of the indexed HOBs, and the
+  GUID extension HOBs that follow the indexed HOBs, are left to a walk of the
+  HOB list.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOBs that are not indexed are walked.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+HobsAfterTheIndexAreWalked (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  CONST EFI_GUID        *LastGuid;
+  BOOLEAN               Found;
+  VOID                  *Result;
+
+  UT_ASSERT_EQUAL (BuildIndex (BIT16 - 1, mHobListMiddle), UNIT_TEST_PASSED);
+
+  //
+  // The GUID extension HOBs of the last GUID all follow the indexed HOBs.
+  //
+  LastGuid = &mGuids[TEST_GUID_COUNT - 1];
+  UT_ASSERT_NOT_NULL (WalkHobList (EFI_HOB_TYPE_GUID_EXTENSION, LastGuid, mHobListMiddle));
+  Result = LookupHobIndex (mIndex, EFI_HOB_TYPE_GUID_EXTENSION, LastGuid, mHobList, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) mHobListMiddle);
+
+  for (Hob.Raw = mHobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[0], Hob.Raw, &Found), UNIT_TEST_PASSED);
+    UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_GUID_EXTENSION, LastGuid, Hob.Raw, &Found), UNIT_TEST_PASSED);
+    UT_ASSERT_FALSE (Found);
+    if ((UINTN) Hob.Raw > (UINTN) mHobListMiddle) {
+      Result = LookupHobIndex (mIndex, EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[0], Hob.Raw, &Found);
+      UT_ASSERT_FALSE (Found);
+      UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) Hob.Raw);
+    }
+  }
+
+  //
+  // A lookup from before the HOB list is not searched in the index.
+  //
+  Result = LookupHobIndex (mIndex, EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[0], (UINT8 *) mHobList - 8, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) mHobList - 8);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the HOB types that are not indexed, and the invalid lookups,
+  are left to a walk of the HOB list, and that a HOB index is only valid for
+  its HOB list.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The HOBs that are not indexed are walked.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TypesNotIndexedAreWalked (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  BOOLEAN               Found;
+  VOID                  *Result;
+
+  Hob.Raw = mHobList;
+  while (!END_OF_HOB_LIST (Hob)) {
+    Hob.Raw = GET_NEXT_HOB (Hob);
+  }
+
+  //
+  // Index the GUID extension HOBs only, as the PEI Core does.
+  //
+  UT_ASSERT_EQUAL (BuildIndex (BIT0 << EFI_HOB_TYPE_GUID_EXTENSION, Hob.Raw), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mIndex->Types[EFI_HOB_TYPE_MEMORY_ALLOCATION].First, EDKII_HOB_INDEX_END);
+
+  Hob.Raw = mHobList;
+  Hob.Raw = GET_NEXT_HOB (Hob);
+  Result  = LookupHobIndex (mIndex, EFI_HOB_TYPE_MEMORY_ALLOCATION, NULL, Hob.Raw, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) Hob.Raw);
+
+  Result = LookupHobIndex (mIndex, EFI_HOB_TYPE_UNUSED, NULL, Hob.Raw, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) Hob.Raw);
+
+  Result = LookupHobIndex (mIndex, EFI_HOB_TYPE_GUID_EXTENSION, NULL, Hob.Raw, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) Hob.Raw);
+
+  Result = LookupHobIndex (NULL, EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[0], Hob.Raw, &Found);
+  UT_ASSERT_FALSE (Found);
+  UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) Hob.Raw);
+
+  UT_ASSERT_EQUAL (CheckLookup (EFI_HOB_TYPE_GUID_EXTENSION, &mGuids[1], Hob.Raw, &Found), UNIT_TEST_PASSED);
+  UT_ASSERT_TRUE (Found);
+
+  UT_ASSERT_TRUE (IsHobIndexValid (mIndex, mHobList));
+  UT_ASSERT_FALSE (IsHobIndexValid (mIndex, Hob.Raw));
+  UT_ASSERT_FALSE (IsHobIndexValid (NULL, mHobList));
+  mIndex->Signature = SIGNATURE_32 ('H', 'O', 'B', 'X');
+  UT_ASSERT_FALSE (IsHobIndexValid (mIndex, mHobList));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for
+  BaseHobIndexLib and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      LookupTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&LookupTests, Framework, "HOB index lookups", "MdePkg.BaseHobIndexLib.Lookup", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for LookupTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite--------Description-------------------------------------------Class Name----------------------Function----------------------Pre-------------------Post---------Context
+  AddTestCase (LookupTests, "A lookup finds the HOB a walk finds", "LookupMatchesWalk", LookupMatchesWalk, CreateIndexedHobList, FreeHobList, NULL);
+  AddTestCase (LookupTests, "A lookup resumes from the previous HOB", "LookupResumesFromPreviousHob", LookupResumesFromPreviousHob, CreateIndexedHobList, FreeHobList, NULL);
+  AddTestCase (LookupTests, "HOBs changed to unused are skipped", "UnusedHobsAreSkipped", UnusedHobsAreSkipped, CreateIndexedHobList, FreeHobList, NULL);
+  AddTestCase (LookupTests, "HOBs after the index are walked", "HobsAfterTheIndexAreWalked", HobsAfterTheIndexAreWalked, CreateHobList, FreeHobList, NULL);
+  AddTestCase (LookupTests, "HOB types not indexed are walked", "TypesNotIndexedAreWalked", TypesNotIndexedAreWalked, CreateHobList, FreeHobList, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
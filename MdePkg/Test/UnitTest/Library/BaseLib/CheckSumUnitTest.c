@@ -0,0 +1,488 @@
+/** @file
+  Host based unit test and throughput benchmark of the CalculateSum*() and
+  CalculateCheckSum*() functions in BaseLib.
+
+  The sums are computed a UINTN per step, or with SSE2 for buffers of at
+  least 256 bytes on X64. They are checked against sums computed one element
+  per step, for every length up to 300 bytes at every alignment, so that both
+  paths and the switch between them are covered, for large buffers, and for
+  buffers whose elements all carry. The throughput of each function and of
+  the reference loops is then reported on 4 KB, 64 KB and 4 MB buffers.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "BaseLib CheckSum Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_MAX_LENGTH        300
+#define TEST_MAX_ALIGNMENT     16
+#define TEST_BUFFER_SIZE       SIZE_4MB
+
+#define BENCHMARK_TOTAL        SIZE_256MB
+
+UINT8  *mBuffer;
+
+STATIC CONST UINTN  mBenchmarkLengths[] = { SIZE_4KB, SIZE_64KB, SIZE_4MB };
+
+/**
+  Returns the sum of the 8-bit values of a buffer, one per step.
+
+  @param  Buffer                 The buffer.
+  @param  Length                 The number of bytes in the buffer.
+
+  @return The sum of the buffer.
+
+**/
+UINT8
+ReferenceSum8 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT8  Sum;
+
+  for (Sum = 0; Length > 0; Length--) {
+    Sum = (UINT8) (Sum + *Buffer++);
+  }
+
+  return Sum;
+}
+
+/**
+  Returns the sum of the 16-bit values of a buffer, one per step.
+
+  @param  Buffer                 The buffer.
+  @param  Length                 The number of bytes in the buffer.
+
+  @return The sum of the buffer.
+
+**/
+UINT16
+ReferenceSum16 (
+  IN CONST UINT16  *Buffer,
+  IN UINTN         Length
+  )
+{
+  UINT16  Sum;
+
+  for (Sum = 0; Length > 0; Length -= sizeof (*Buffer)) {
+    Sum = (UINT16) (Sum + *Buffer++);
+  }
+
+  return Sum;
+}
+
+/**
+  Returns the sum of the 32-bit values of a buffer, one per step.
+
+  @param  Buffer                 The buffer.
+  @param  Length                 The number of bytes in the buffer.
+
+  @return The sum of the buffer.
+
+**/
+UINT32
+ReferenceSum32 (
+  IN CONST UINT32  *Buffer,
+  IN UINTN         Length
+  )
+{
+  UINT32  Sum;
+
+  for (Sum = 0; Length > 0; Length -= sizeof (*Buffer)) {
+    Sum = (UINT32) (Sum + *Buffer++);
+  }
+
+  return Sum;
+}
+
+/**
+  Returns the sum of the 64-bit values of a buffer, one per step.
+
+  @param  Buffer                 The buffer.
+  @param  Length                 The number of bytes in the buffer.
+
+  @return The sum of the buffer.
+
+**/
+UINT64
+ReferenceSum64 (
+  IN CONST UINT64  *Buffer,
+  IN UINTN         Length
+  )
+{
+  UINT64  Sum;
+
+  for (Sum = 0; Length > 0; Length -= sizeof (*Buffer)) {
+    Sum = Sum + *Buffer++;
+  }
+
+  return Sum;
+}
+
+/**
+  Checks all the sums and checksums of a buffer against the reference sums.
+  The 16, 32 and 64-bit sums are only checked when the buffer is aligned on
+  their element size.
+
+  @param  Buffer                 The buffer.
+  @param  Length                 The number of bytes in the buffer.
+
+  @retval UNIT_TEST_PASSED       The expected sums were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong sum was returned.
+
+**/
+UNIT_TEST_STATUS
+CheckBuffer (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UT_ASSERT_EQUAL (CalculateSum8 (Buffer, Length), ReferenceSum8 (Buffer, Length));
+  UT_ASSERT_EQUAL ((UINT8) (CalculateCheckSum8 (Buffer, Length) + ReferenceSum8 (Buffer, Length)), 0);
+
+  if ((((UINTN) Buffer | Length) & 0x1) == 0) {
+    UT_ASSERT_EQUAL (CalculateSum16 ((CONST UINT16 *) Buffer, Length), ReferenceSum16 ((CONST UINT16 *) Buffer, Length));
+    UT_ASSERT_EQUAL ((UINT16) (CalculateCheckSum16 ((CONST UINT16 *) Buffer, Length) + ReferenceSum16 ((CONST UINT16 *) Buffer, Length)), 0);
+  }
+
+  if ((((UINTN) Buffer | Length) & 0x3) == 0) {
+    UT_ASSERT_EQUAL (CalculateSum32 ((CONST UINT32 *) Buffer, Length), ReferenceSum32 ((CONST UINT32 *) Buffer, Length));
+    UT_ASSERT_EQUAL ((UINT32) (CalculateCheckSum32 ((CONST UINT32 *) Buffer, Length) + ReferenceSum32 ((CONST UINT32 *) Buffer, Length)), 0);
+  }
+
+  if ((((UINTN) Buffer | Length) & 0x7) == 0) {
+    UT_ASSERT_EQUAL (CalculateSum64 ((CONST UINT64 *) Buffer, Length), ReferenceSum64 ((CONST UINT64 *) Buffer, Length));
+    UT_ASSERT_EQUAL (CalculateCheckSum64 ((CONST UINT64 *) Buffer, Length) + ReferenceSum64 ((CONST UINT64 *) Buffer, Length), 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates and fills the test buffer.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The buffer was allocated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Setup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Index;
+  UINT32  Seed;
+
+  mBuffer = AllocatePool (TEST_BUFFER_SIZE + TEST_MAX_ALIGNMENT);
+  if (mBuffer == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Seed = 0x12345678;
+  for (Index = 0; Index < TEST_BUFFER_SIZE + TEST_MAX_ALIGNMENT; Index++) {
+    Seed           = Seed * 1103515245 + 12345;
+    mBuffer[Index] = (UINT8) (Seed >> 16);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the test buffer.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+Cleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePool (mBuffer);
+}
+
+/**
+  Checks the sums for every length up to TEST_MAX_LENGTH at every alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected sums were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong sum was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SmallBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN             Offset;
+  UINTN             Length;
+  UNIT_TEST_STATUS  Status;
+
+  for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset++) {
+    for (Length = 0; Length <= TEST_MAX_LENGTH; Length++) {
+      Status = CheckBuffer (mBuffer + Offset, Length);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks the sums of buffers of 4 KB to 4 MB, with lengths that are not
+  multiples of the block size of the SSE2 path, at every alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected sums were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong sum was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LargeBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN             Offset;
+  UINTN             Length;
+  UNIT_TEST_STATUS  Status;
+
+  for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset++) {
+    for (Length = SIZE_4KB - 40; Length <= SIZE_4KB + 40; Length++) {
+      Status = CheckBuffer (mBuffer + Offset, Length);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+
+    for (Length = SIZE_8KB + 8; Length <= TEST_BUFFER_SIZE; Length = Length * 2 + 8) {
+      Status = CheckBuffer (mBuffer + Offset, Length);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks the sums of buffers whose bits are all set, so that every addition
+  carries out of every element.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected sums were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong sum was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Carries (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN             Length;
+  UNIT_TEST_STATUS  Status;
+
+  SetMem (mBuffer, TEST_BUFFER_SIZE, 0xFF);
+
+  for (Length = 8; Length <= TEST_BUFFER_SIZE; Length *= 2) {
+    Status = CheckBuffer (mBuffer, Length - 8);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+
+    Status = CheckBuffer (mBuffer, Length);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+  }
+
+  //
+  // The sum of N elements with all bits set is -N.
+  //
+  UT_ASSERT_EQUAL (CalculateSum8 (mBuffer, SIZE_4KB + 1), (UINT8) (0 - (SIZE_4KB + 1)));
+  UT_ASSERT_EQUAL (CalculateSum16 ((CONST UINT16 *) mBuffer, SIZE_4KB + 2), (UINT16) (0 - (SIZE_4KB / 2 + 1)));
+  UT_ASSERT_EQUAL (CalculateSum32 ((CONST UINT32 *) mBuffer, SIZE_4KB + 4), (UINT32) (0 - (SIZE_4KB / 4 + 1)));
+  UT_ASSERT_EQUAL (CalculateSum64 ((CONST UINT64 *) mBuffer, SIZE_4KB + 8), (UINT64) (0 - (SIZE_4KB / 8 + 1)));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reports the throughput of a function.
+
+  @param  Name                   The name of the function.
+  @param  Length                 The length of the buffer.
+  @param  Start                  The clock at the start of the run.
+  @param  End                    The clock at the end of the run.
+
+**/
+VOID
+ReportThroughput (
+  IN CONST CHAR8  *Name,
+  IN UINTN        Length,
+  IN clock_t      Start,
+  IN clock_t      End
+  )
+{
+  UINT64  Microseconds;
+
+  Microseconds = (UINT64) (End - Start) * 1000000 / CLOCKS_PER_SEC;
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: %a %8d bytes: %6d MB/s\n",
+    gEfiCallerBaseName,
+    Name,
+    (UINT32) Length,
+    (UINT32) DivU64x64Remainder (BENCHMARK_TOTAL, MAX (Microseconds, 1), NULL)
+    ));
+}
+
+/**
+  Reports the throughput of the sums and of the reference loops.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The sums returned the expected results.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A sum returned a wrong result.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Throughput (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN    LengthIndex;
+  UINTN    Length;
+  UINTN    Count;
+  UINTN    Index;
+  UINT64   Sum;
+  UINT64   Reference;
+  clock_t  Start;
+
+  for (LengthIndex = 0; LengthIndex < ARRAY_SIZE (mBenchmarkLengths); LengthIndex++) {
+    Length = mBenchmarkLengths[LengthIndex];
+    Count  = BENCHMARK_TOTAL / Length;
+
+    Start = clock ();
+    for (Index = 0, Reference = 0; Index < Count; Index++) {
+      Reference += ReferenceSum8 (mBuffer, Length);
+    }
+    ReportThroughput ("ReferenceSum8 ", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0, Sum = 0; Index < Count; Index++) {
+      Sum += CalculateSum8 (mBuffer, Length);
+    }
+    ReportThroughput ("CalculateSum8 ", Length, Start, clock ());
+    UT_ASSERT_EQUAL (Sum, Reference);
+
+    Start = clock ();
+    for (Index = 0, Sum = 0; Index < Count; Index++) {
+      Sum += CalculateSum16 ((CONST UINT16 *) mBuffer, Length);
+    }
+    ReportThroughput ("CalculateSum16", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0, Sum = 0; Index < Count; Index++) {
+      Sum += CalculateSum32 ((CONST UINT32 *) mBuffer, Length);
+    }
+    ReportThroughput ("CalculateSum32", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0, Sum = 0; Index < Count; Index++) {
+      Sum += CalculateSum64 ((CONST UINT64 *) mBuffer, Length);
+    }
+    ReportThroughput ("CalculateSum64", Length, Start, clock ());
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the sums
+  and checksums, and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SumTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SumTests, Framework, "Sums and checksums", "BaseLib.CheckSum", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SumTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description------Class Name------Function------Pre---------Post-----Context
+  AddTestCase (SumTests, "Small buffers", "SmallBuffers", SmallBuffers, Setup, Cleanup, NULL);
+  AddTestCase (SumTests, "Large buffers", "LargeBuffers", LargeBuffers, Setup, Cleanup, NULL);
+  AddTestCase (SumTests, "Carries", "Carries", Carries, Setup, Cleanup, NULL);
+  AddTestCase (SumTests, "Throughput", "Throughput", Throughput, Setup, Cleanup, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,381 @@
+/** @file
+  Host based unit tests of CalculateCrc32() in BaseLib.
+
+  CalculateCrc32() processes 8 bytes per step, or uses the CRC instructions
+  of the processor for large buffers. Each path is checked bit for bit
+  against a CRC computed one byte per step with the CRC32 table, for every
+  small length and alignment and for large buffers. On X64, the CPUID service
+  of the host BaseLib is hooked to select the path.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#if defined (_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestHostBaseLib.h>
+
+#define UNIT_TEST_APP_NAME     "BaseLib CRC32 Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_MAX_LENGTH        300
+#define TEST_MAX_ALIGNMENT     8
+#define TEST_BUFFER_SIZE       (SIZE_64KB + 64)
+
+UINT8   *mBuffer;
+UINT32  mReferenceTable[256];
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+UNIT_TEST_HOST_BASE_LIB_ASM_CPUID  mOriginalAsmCpuid;
+#endif
+
+/**
+  Computes the CRC32 of a buffer one byte per step.
+
+  @param  Buffer                 The buffer.
+  @param  Length                 The number of bytes in the buffer.
+
+  @return The CRC32 of the buffer.
+
+**/
+UINT32
+ReferenceCrc32 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT32  Crc;
+
+  Crc = 0xFFFFFFFF;
+  while (Length-- > 0) {
+    Crc = (Crc >> 8) ^ mReferenceTable[(UINT8) Crc ^ *Buffer++];
+  }
+
+  return Crc ^ 0xFFFFFFFF;
+}
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+
+/**
+  Executes CPUID on the host processor.
+
+  @param  Index                  The CPUID leaf.
+  @param  Eax, Ebx, Ecx, Edx     The registers returned by CPUID. Optional.
+
+  @return Index.
+
+**/
+UINT32
+EFIAPI
+HostAsmCpuid (
+  IN      UINT32  Index,
+  OUT     UINT32  *Eax,  OPTIONAL
+  OUT     UINT32  *Ebx,  OPTIONAL
+  OUT     UINT32  *Ecx,  OPTIONAL
+  OUT     UINT32  *Edx   OPTIONAL
+  )
+{
+  UINT32  Registers[4];
+
+#if defined (_MSC_VER)
+  __cpuid ((int *) Registers, (int) Index);
+#else
+  __cpuid (Index, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+
+  if (Eax != NULL) {
+    *Eax = Registers[0];
+  }
+  if (Ebx != NULL) {
+    *Ebx = Registers[1];
+  }
+  if (Ecx != NULL) {
+    *Ecx = Registers[2];
+  }
+  if (Edx != NULL) {
+    *Edx = Registers[3];
+  }
+  return Index;
+}
+
+#endif
+
+/**
+  Allocates and fills the test buffer, and lets CalculateCrc32() process
+  every buffer 8 bytes per step.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The buffer was allocated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetupSliceBy8 (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Index;
+  UINT32  Seed;
+
+  mBuffer = AllocatePool (TEST_BUFFER_SIZE);
+  if (mBuffer == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Seed = 0x12345678;
+  for (Index = 0; Index < TEST_BUFFER_SIZE; Index++) {
+    Seed           = Seed * 1103515245 + 12345;
+    mBuffer[Index] = (UINT8) (Seed >> 16);
+  }
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  //
+  // The host BaseLib reports no CPUID feature, so PCLMULQDQ is not used.
+  //
+  mOriginalAsmCpuid = gUnitTestHostBaseLib.X86->AsmCpuid;
+#endif
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates and fills the test buffer, and lets CalculateCrc32() use the CRC
+  instructions of the host processor for large buffers.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The buffer was allocated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory, or the host
+                                                processor lacks PCLMULQDQ.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetupAccelerated (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+#if defined (MDE_CPU_X64)
+  UINT32            RegEcx;
+#endif
+
+  Status = SetupSliceBy8 (Context);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+#if defined (MDE_CPU_X64)
+  HostAsmCpuid (1, NULL, NULL, &RegEcx, NULL);
+  if ((RegEcx & BIT1) == 0) {
+    UT_LOG_WARNING ("The host processor does not implement PCLMULQDQ\n");
+    FreePool (mBuffer);
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  gUnitTestHostBaseLib.X86->AsmCpuid = HostAsmCpuid;
+#endif
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the test buffer and restores the host BaseLib services.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+Cleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  gUnitTestHostBaseLib.X86->AsmCpuid = mOriginalAsmCpuid;
+#endif
+
+  FreePool (mBuffer);
+}
+
+/**
+  Checks the CRC32 of the ITU-T V.42 check string.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected CRC was returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong CRC was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CheckValue (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_EQUAL (CalculateCrc32 ("123456789", 9), 0xCBF43926);
+  UT_ASSERT_EQUAL (CalculateCrc32 (mBuffer, 0), 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks CalculateCrc32() against the byte-wise CRC, for every length up to
+  TEST_MAX_LENGTH at every alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected CRCs were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong CRC was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SmallBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Offset;
+  UINTN  Length;
+
+  for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset++) {
+    for (Length = 0; Length <= TEST_MAX_LENGTH; Length++) {
+      UT_ASSERT_EQUAL (CalculateCrc32 (mBuffer + Offset, Length), ReferenceCrc32 (mBuffer + Offset, Length));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks CalculateCrc32() against the byte-wise CRC for buffers of 4 KB to
+  64 KB, with lengths that are not multiples of the block sizes of the
+  processor paths, at every alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected CRCs were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong CRC was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LargeBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Offset;
+  UINTN  Length;
+
+  for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset++) {
+    for (Length = SIZE_4KB - 17; Length <= SIZE_4KB + 80; Length++) {
+      UT_ASSERT_EQUAL (CalculateCrc32 (mBuffer + Offset, Length), ReferenceCrc32 (mBuffer + Offset, Length));
+    }
+
+    for (Length = SIZE_8KB + 3; Length <= SIZE_64KB; Length += 4093) {
+      UT_ASSERT_EQUAL (CalculateCrc32 (mBuffer + Offset, Length), ReferenceCrc32 (mBuffer + Offset, Length));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for
+  CalculateCrc32() and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SliceBy8Tests;
+  UNIT_TEST_SUITE_HANDLE      AcceleratedTests;
+  UINT32                      Index;
+  UINT32                      Bit;
+  UINT32                      Crc;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Build the CRC32 table from the bit reflected polynomial.
+  //
+  for (Index = 0; Index < 256; Index++) {
+    Crc = Index;
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = ((Crc & 1) != 0) ? ((Crc >> 1) ^ 0xEDB88320) : (Crc >> 1);
+    }
+    mReferenceTable[Index] = Crc;
+  }
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SliceBy8Tests, Framework, "CRC32 8 bytes per step", "BaseLib.Crc32.SliceBy8", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SliceBy8Tests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-----------Description-------------------Class Name-----Function------Pre------------Post-----Context
+  AddTestCase (SliceBy8Tests, "Check value of ITU-T V.42", "CheckValue", CheckValue, SetupSliceBy8, Cleanup, NULL);
+  AddTestCase (SliceBy8Tests, "Small buffers", "SmallBuffers", SmallBuffers, SetupSliceBy8, Cleanup, NULL);
+  AddTestCase (SliceBy8Tests, "Large buffers", "LargeBuffers", LargeBuffers, SetupSliceBy8, Cleanup, NULL);
+
+  Status = CreateUnitTestSuite (&AcceleratedTests, Framework, "CRC32 with CRC instructions", "BaseLib.Crc32.Accelerated", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for AcceleratedTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (AcceleratedTests, "Check value of ITU-T V.42", "CheckValue", CheckValue, SetupAccelerated, Cleanup, NULL);
+  AddTestCase (AcceleratedTests, "Small buffers", "SmallBuffers", SmallBuffers, SetupAccelerated, Cleanup, NULL);
+  AddTestCase (AcceleratedTests, "Large buffers", "LargeBuffers", LargeBuffers, SetupAccelerated, Cleanup, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,762 @@
+/** @file
+  Host based unit and stress tests of BaseLockFreeLib.
+
+  The atomic operations, the ticket lock, the sequence lock and the ring
+  buffer are first checked on a single thread. They are then run by POSIX
+  threads at the same time, and each thread checks that it never observes a
+  lost update, two owners of a lock, a torn read or a lost, duplicated or
+  reordered element. The host may have fewer processors than threads, so the
+  threads yield the processor while they wait for each other, and run fewer
+  iterations: a ticket lock hands itself to waiters that are not running.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/LockFreeLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "BaseLockFreeLib Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_THREADS           8
+#define TEST_ITERATIONS        200000
+#define TEST_FEW_ITERATIONS    2000
+#define TEST_SEQ_WORDS         8
+#define TEST_RING_CAPACITY     256
+
+typedef struct {
+  pthread_t  Handle;
+  UINTN      Index;
+  UINTN      Errors;
+} TEST_THREAD;
+
+typedef struct {
+  UINT32  Producer;
+  UINT32  Reserved;
+  UINT64  Sequence;
+} TEST_ELEMENT;
+
+typedef VOID * (*TEST_THREAD_ROUTINE) (VOID *Context);
+
+UINTN             mIterations;
+volatile BOOLEAN  mTestStart;
+volatile UINT32   mCounter32;
+volatile UINT64   mCounter64;
+volatile UINT32   mBits32;
+volatile UINT64   mBits64;
+TICKET_LOCK       mTicketLock;
+volatile UINTN    mTicketLockOwner;
+volatile UINT64   mTicketLockCount;
+SEQ_LOCK          mSeqLock;
+volatile UINT64   mSeqWords[TEST_SEQ_WORDS];
+volatile UINT32   mSeqWritersDone;
+LOCK_FREE_RING    mRing;
+VOID              *mRingBuffer;
+volatile UINT64   mRingConsumed;
+volatile UINT64   mRingSums[TEST_THREADS];
+volatile UINT64   mRingCounts[TEST_THREADS];
+
+/**
+  Runs a routine on threads started at the same time, and waits for them.
+
+  @param  Routine   The routine the threads run. It is passed its TEST_THREAD.
+  @param  Threads   The threads.
+  @param  Count     The number of threads.
+
+  @return The number of errors reported by the threads, or MAX_UINTN if a
+          thread could not be created.
+
+**/
+UINTN
+TestRunThreads (
+  IN TEST_THREAD_ROUTINE  Routine,
+  IN TEST_THREAD          *Threads,
+  IN UINTN                Count
+  )
+{
+  UINTN  Index;
+  UINTN  Created;
+  UINTN  Errors;
+
+  mTestStart = FALSE;
+  for (Created = 0; Created < Count; Created++) {
+    Threads[Created].Index  = Created;
+    Threads[Created].Errors = 0;
+    if (pthread_create (&Threads[Created].Handle, NULL, Routine, &Threads[Created]) != 0) {
+      break;
+    }
+  }
+
+  MemoryFence ();
+  mTestStart = TRUE;
+
+  Errors = (Created == Count) ? 0 : MAX_UINTN;
+  for (Index = 0; Index < Created; Index++) {
+    pthread_join (Threads[Index].Handle, NULL);
+    if (Errors != MAX_UINTN) {
+      Errors += Threads[Index].Errors;
+    }
+  }
+
+  return Errors;
+}
+
+/**
+  Waits until TestRunThreads() has created all the threads.
+**/
+VOID
+TestWaitForStart (
+  VOID
+  )
+{
+  while (!mTestStart) {
+    sched_yield ();
+  }
+}
+
+/**
+  Returns the time of a monotonic clock.
+
+  @return The time, in microseconds.
+
+**/
+UINT64
+TestMicroseconds (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  clock_gettime (CLOCK_MONOTONIC, &Time);
+  return MultU64x32 ((UINT64) Time.tv_sec, 1000000) + (UINT64) Time.tv_nsec / 1000;
+}
+
+/**
+  Checks the values returned and stored by the atomic operations.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The operations returned and stored the
+                                 expected values.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An operation returned or stored a wrong
+                                       value.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AtomicOperations (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mCounter32 = 0xFFFFFFF0;
+  UT_ASSERT_EQUAL (AtomicFetchAdd32 (&mCounter32, 0x20), 0xFFFFFFF0);
+  UT_ASSERT_EQUAL (mCounter32, 0x10);
+  UT_ASSERT_EQUAL (AtomicFetchAdd32 (&mCounter32, (UINT32) -0x11), 0x10);
+  UT_ASSERT_EQUAL (mCounter32, 0xFFFFFFFF);
+
+  mCounter64 = 0xFFFFFFFFFFFFFFF0ULL;
+  UT_ASSERT_EQUAL (AtomicFetchAdd64 (&mCounter64, 0x100000020ULL), 0xFFFFFFFFFFFFFFF0ULL);
+  UT_ASSERT_EQUAL (mCounter64, 0x100000010ULL);
+
+  mBits32 = 0xF0F0F0F0;
+  UT_ASSERT_EQUAL (AtomicFetchAnd32 (&mBits32, 0x3C3C3C3C), 0xF0F0F0F0);
+  UT_ASSERT_EQUAL (mBits32, 0x30303030);
+  UT_ASSERT_EQUAL (AtomicFetchOr32 (&mBits32, 0x03030303), 0x30303030);
+  UT_ASSERT_EQUAL (mBits32, 0x33333333);
+
+  mBits64 = 0xF0F0F0F0F0F0F0F0ULL;
+  UT_ASSERT_EQUAL (AtomicFetchAnd64 (&mBits64, 0x3C3C3C3C00000000ULL), 0xF0F0F0F0F0F0F0F0ULL);
+  UT_ASSERT_EQUAL (mBits64, 0x3030303000000000ULL);
+  UT_ASSERT_EQUAL (AtomicFetchOr64 (&mBits64, 0x0303030300000001ULL), 0x3030303000000000ULL);
+  UT_ASSERT_EQUAL (mBits64, 0x3333333300000001ULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Adds to the shared counters, and checks that the values it gets back only
+  increase.
+
+  @param  Context   The TEST_THREAD of the thread.
+
+  @return NULL.
+
+**/
+VOID *
+TestFetchAddThread (
+  IN VOID  *Context
+  )
+{
+  TEST_THREAD  *Thread;
+  UINTN        Iteration;
+  UINT32       Value32;
+  UINT32       Previous32;
+  UINT64       Value64;
+  UINT64       Previous64;
+
+  Thread     = (TEST_THREAD *) Context;
+  Previous32 = 0;
+  Previous64 = 0;
+  TestWaitForStart ();
+  for (Iteration = 0; Iteration < mIterations; Iteration++) {
+    Value32 = AtomicFetchAdd32 (&mCounter32, 1);
+    Value64 = AtomicFetchAdd64 (&mCounter64, BIT32 + 1);
+    if (((Iteration > 0) && (Value32 <= Previous32)) ||
+        ((Iteration > 0) && (Value64 <= Previous64))) {
+      Thread->Errors++;
+    }
+
+    Previous32 = Value32;
+    Previous64 = Value64;
+  }
+
+  return NULL;
+}
+
+/**
+  Checks that concurrent atomic adds are not lost.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       No add was lost.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An add was lost.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FetchAddIsAtomic (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_THREAD  Threads[TEST_THREADS];
+
+  mCounter32 = 0;
+  mCounter64 = 0;
+  UT_ASSERT_EQUAL (TestRunThreads (TestFetchAddThread, Threads, TEST_THREADS), 0);
+  UT_ASSERT_EQUAL (mCounter32, TEST_THREADS * mIterations);
+  UT_ASSERT_EQUAL (mCounter64, MultU64x32 (BIT32 + 1, (UINT32) (TEST_THREADS * mIterations)));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Sets and clears the bits of the thread in the shared bit masks, and checks
+  that no other thread changed them in between.
+
+  @param  Context   The TEST_THREAD of the thread.
+
+  @return NULL.
+
+**/
+VOID *
+TestFetchAndOrThread (
+  IN VOID  *Context
+  )
+{
+  TEST_THREAD  *Thread;
+  UINTN        Iteration;
+  UINT32       Bit32;
+  UINT64       Bit64;
+
+  Thread = (TEST_THREAD *) Context;
+  Bit32  = BIT0 << Thread->Index;
+  Bit64  = LShiftU64 (BIT0, 32 + Thread->Index);
+  TestWaitForStart ();
+  for (Iteration = 0; Iteration < mIterations; Iteration++) {
+    if (((AtomicFetchOr32 (&mBits32, Bit32) & Bit32) != 0) ||
+        ((AtomicFetchAnd32 (&mBits32, ~Bit32) & Bit32) == 0) ||
+        ((AtomicFetchOr64 (&mBits64, Bit64) & Bit64) != 0) ||
+        ((AtomicFetchAnd64 (&mBits64, ~Bit64) & Bit64) == 0)) {
+      Thread->Errors++;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Checks that concurrent atomic ANDs and ORs of different bits are not lost.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       No AND or OR was lost.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An AND or an OR was lost.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FetchAndOrIsAtomic (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_THREAD  Threads[TEST_THREADS];
+
+  mBits32 = 0;
+  mBits64 = 0;
+  UT_ASSERT_EQUAL (TestRunThreads (TestFetchAndOrThread, Threads, TEST_THREADS), 0);
+  UT_ASSERT_EQUAL (mBits32, 0);
+  UT_ASSERT_EQUAL (mBits64, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Acquires the shared ticket lock and updates the data it protects, checking
+  that no other thread owns the lock at the same time.
+
+  @param  Context   The TEST_THREAD of the thread.
+
+  @return NULL.
+
+**/
+VOID *
+TestTicketLockThread (
+  IN VOID  *Context
+  )
+{
+  TEST_THREAD  *Thread;
+  UINTN        Iteration;
+  UINT64       Count;
+
+  Thread = (TEST_THREAD *) Context;
+  TestWaitForStart ();
+  for (Iteration = 0; Iteration < mIterations; Iteration++) {
+    AcquireTicketLock (&mTicketLock);
+    mTicketLockOwner = Thread->Index;
+    Count            = mTicketLockCount;
+    CpuPause ();
+    mTicketLockCount = Count + 1;
+    if (mTicketLockOwner != Thread->Index) {
+      Thread->Errors++;
+    }
+    ReleaseTicketLock (&mTicketLock);
+  }
+
+  return NULL;
+}
+
+/**
+  Checks that a ticket lock has a single owner.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The lock had a single owner.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The lock had two owners.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TicketLockExcludes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_THREAD  Threads[TEST_THREADS];
+
+  InitializeTicketLock (&mTicketLock);
+  UT_ASSERT_TRUE (AcquireTicketLockOrFail (&mTicketLock));
+  UT_ASSERT_FALSE (AcquireTicketLockOrFail (&mTicketLock));
+  ReleaseTicketLock (&mTicketLock);
+  UT_ASSERT_TRUE (AcquireTicketLockOrFail (&mTicketLock));
+  ReleaseTicketLock (&mTicketLock);
+
+  mTicketLockCount = 0;
+  UT_ASSERT_EQUAL (TestRunThreads (TestTicketLockThread, Threads, TEST_THREADS), 0);
+  UT_ASSERT_EQUAL (mTicketLockCount, TEST_THREADS * mIterations);
+  UT_ASSERT_TRUE (AcquireTicketLockOrFail (&mTicketLock));
+  ReleaseTicketLock (&mTicketLock);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Writes the words protected by the shared sequence lock as the first two
+  threads, and reads them as the others, checking that a read that is not
+  retried gets the words of a single write.
+
+  @param  Context   The TEST_THREAD of the thread.
+
+  @return NULL.
+
+**/
+VOID *
+TestSeqLockThread (
+  IN VOID  *Context
+  )
+{
+  TEST_THREAD  *Thread;
+  UINTN        Iteration;
+  UINTN        Index;
+  UINT64       Words[TEST_SEQ_WORDS];
+  UINT32       Sequence;
+
+  Thread = (TEST_THREAD *) Context;
+  TestWaitForStart ();
+  if (Thread->Index < 2) {
+    for (Iteration = 0; Iteration < mIterations; Iteration++) {
+      SeqLockWriteBegin (&mSeqLock);
+      for (Index = 0; Index < TEST_SEQ_WORDS; Index++) {
+        mSeqWords[Index] = mSeqWords[Index] + 1;
+      }
+      SeqLockWriteEnd (&mSeqLock);
+    }
+
+    AtomicFetchAdd32 (&mSeqWritersDone, 1);
+    return NULL;
+  }
+
+  while (mSeqWritersDone < 2) {
+    do {
+      Sequence = SeqLockReadBegin (&mSeqLock);
+      for (Index = 0; Index < TEST_SEQ_WORDS; Index++) {
+        Words[Index] = mSeqWords[Index];
+      }
+    } while (SeqLockReadRetry (&mSeqLock, Sequence));
+
+    for (Index = 1; Index < TEST_SEQ_WORDS; Index++) {
+      if (Words[Index] != Words[0]) {
+        Thread->Errors++;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Checks that the readers of a sequence lock get consistent data, and that
+  its writers exclude each other.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The data was consistent.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A read was torn, or a write was lost.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SeqLockReadsAreConsistent (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_THREAD  Threads[TEST_THREADS];
+  UINTN        Index;
+
+  InitializeSeqLock (&mSeqLock);
+  ZeroMem ((VOID *) mSeqWords, sizeof (mSeqWords));
+  mSeqWritersDone = 0;
+  UT_ASSERT_EQUAL (TestRunThreads (TestSeqLockThread, Threads, TEST_THREADS), 0);
+  for (Index = 0; Index < TEST_SEQ_WORDS; Index++) {
+    UT_ASSERT_EQUAL (mSeqWords[Index], 2 * mIterations);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates the buffer of the shared ring buffer and initializes it.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The ring buffer was initialized.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetupRing (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mRingBuffer = AllocatePool (LOCK_FREE_RING_BUFFER_SIZE (sizeof (TEST_ELEMENT), TEST_RING_CAPACITY));
+  if ((mRingBuffer == NULL) ||
+      RETURN_ERROR (LockFreeRingInitialize (&mRing, mRingBuffer, sizeof (TEST_ELEMENT), TEST_RING_CAPACITY))) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the buffer of the shared ring buffer.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+CleanupRing (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mRingBuffer != NULL) {
+    FreePool (mRingBuffer);
+    mRingBuffer = NULL;
+  }
+}
+
+/**
+  Checks that a ring buffer is a bounded FIFO on a single thread, over many
+  passes, and that it rejects invalid sizes.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The ring buffer behaved as a bounded FIFO.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The ring buffer lost, duplicated or
+                                       reordered an element.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingIsBoundedFifo (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  LOCK_FREE_RING  Ring;
+  TEST_ELEMENT    Element;
+  UINT64          Enqueued;
+  UINT64          Dequeued;
+  UINTN           Pass;
+  UINTN           Index;
+
+  UT_ASSERT_EQUAL (LockFreeRingInitialize (&Ring, mRingBuffer, 0, TEST_RING_CAPACITY), RETURN_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (LockFreeRingInitialize (&Ring, mRingBuffer, sizeof (TEST_ELEMENT), 1), RETURN_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (LockFreeRingInitialize (&Ring, mRingBuffer, sizeof (TEST_ELEMENT), 3), RETURN_INVALID_PARAMETER);
+
+  ZeroMem (&Element, sizeof (Element));
+  Enqueued = 0;
+  Dequeued = 0;
+  for (Pass = 0; Pass < 3 * TEST_RING_CAPACITY; Pass++) {
+    //
+    // Fill the ring buffer, then empty it but for Pass % Capacity elements,
+    // so the head and the tail wrap at every position.
+    //
+    while (TRUE) {
+      Element.Sequence = Enqueued;
+      if (!LockFreeRingEnqueue (&mRing, &Element)) {
+        break;
+      }
+      Enqueued++;
+    }
+    UT_ASSERT_EQUAL (Enqueued - Dequeued, TEST_RING_CAPACITY);
+
+    for (Index = 0; Index < TEST_RING_CAPACITY - Pass % TEST_RING_CAPACITY; Index++) {
+      UT_ASSERT_TRUE (LockFreeRingDequeue (&mRing, &Element));
+      UT_ASSERT_EQUAL (Element.Sequence, Dequeued);
+      Dequeued++;
+    }
+  }
+
+  while (LockFreeRingDequeue (&mRing, &Element)) {
+    UT_ASSERT_EQUAL (Element.Sequence, Dequeued);
+    Dequeued++;
+  }
+  UT_ASSERT_EQUAL (Enqueued, Dequeued);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Enqueues numbered elements as the first half of the threads, and dequeues
+  them as the other half, checking that the elements of each producer are
+  dequeued in order.
+
+  @param  Context   The TEST_THREAD of the thread.
+
+  @return NULL.
+
+**/
+VOID *
+TestRingThread (
+  IN VOID  *Context
+  )
+{
+  TEST_THREAD   *Thread;
+  TEST_ELEMENT  Element;
+  UINT64        Next[TEST_THREADS / 2];
+  UINT64        Total;
+
+  Thread = (TEST_THREAD *) Context;
+  ZeroMem (&Element, sizeof (Element));
+  ZeroMem (Next, sizeof (Next));
+  Total  = (UINT64) (TEST_THREADS / 2) * mIterations;
+  TestWaitForStart ();
+  if (Thread->Index < TEST_THREADS / 2) {
+    Element.Producer = (UINT32) Thread->Index;
+    for (Element.Sequence = 0; Element.Sequence < mIterations; Element.Sequence++) {
+      while (!LockFreeRingEnqueue (&mRing, &Element)) {
+        sched_yield ();
+      }
+    }
+
+    return NULL;
+  }
+
+  while (mRingConsumed < Total) {
+    if (!LockFreeRingDequeue (&mRing, &Element)) {
+      sched_yield ();
+      continue;
+    }
+
+    if ((Element.Producer >= TEST_THREADS / 2) || (Element.Sequence < Next[Element.Producer])) {
+      Thread->Errors++;
+    } else {
+      Next[Element.Producer] = Element.Sequence + 1;
+      AtomicFetchAdd64 (&mRingSums[Element.Producer], Element.Sequence);
+      AtomicFetchAdd64 (&mRingCounts[Element.Producer], 1);
+    }
+
+    AtomicFetchAdd64 (&mRingConsumed, 1);
+  }
+
+  return NULL;
+}
+
+/**
+  Checks that the elements enqueued by concurrent producers are dequeued once
+  each by concurrent consumers, and reports the throughput of the ring buffer.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       Every element was dequeued once.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An element was lost, duplicated or
+                                       reordered.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RingIsMpmc (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_THREAD   Threads[TEST_THREADS];
+  TEST_ELEMENT  Element;
+  UINTN         Index;
+  UINT64        Start;
+  UINT64        Time;
+
+  mRingConsumed = 0;
+  ZeroMem ((VOID *) mRingSums, sizeof (mRingSums));
+  ZeroMem ((VOID *) mRingCounts, sizeof (mRingCounts));
+
+  Start = TestMicroseconds ();
+  UT_ASSERT_EQUAL (TestRunThreads (TestRingThread, Threads, TEST_THREADS), 0);
+  Time = TestMicroseconds () - Start;
+
+  UT_ASSERT_FALSE (LockFreeRingDequeue (&mRing, &Element));
+  for (Index = 0; Index < TEST_THREADS / 2; Index++) {
+    UT_ASSERT_EQUAL (mRingCounts[Index], mIterations);
+    UT_ASSERT_EQUAL (mRingSums[Index], DivU64x32 (MultU64x32 (mIterations, (UINT32) (mIterations - 1)), 2));
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%d producers and %d consumers: %d elements in %d us\n",
+    TEST_THREADS / 2,
+    TEST_THREADS / 2,
+    (UINT32) mRingConsumed,
+    (UINT32) Time
+    ));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  BaseLockFreeLib and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      AtomicTests;
+  UNIT_TEST_SUITE_HANDLE      LockTests;
+  UNIT_TEST_SUITE_HANDLE      RingTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  mIterations = TEST_ITERATIONS;
+  if (sysconf (_SC_NPROCESSORS_ONLN) < TEST_THREADS) {
+    mIterations = TEST_FEW_ITERATIONS;
+  }
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&AtomicTests, Framework, "Atomic operations", "MdePkg.BaseLockFreeLib.Atomic", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for AtomicTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description------------------------------------Class Name------------Function-----------Pre--------Post---------Context
+  AddTestCase (AtomicTests, "Atomic operations return the original value", "AtomicOperations", AtomicOperations, NULL, NULL, NULL);
+  AddTestCase (AtomicTests, "Concurrent adds are not lost", "FetchAddIsAtomic", FetchAddIsAtomic, NULL, NULL, NULL);
+  AddTestCase (AtomicTests, "Concurrent ANDs and ORs are not lost", "FetchAndOrIsAtomic", FetchAndOrIsAtomic, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&LockTests, Framework, "Locks", "MdePkg.BaseLockFreeLib.Lock", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for LockTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (LockTests, "A ticket lock has a single owner", "TicketLockExcludes", TicketLockExcludes, NULL, NULL, NULL);
+  AddTestCase (LockTests, "Sequence lock readers get consistent data", "SeqLockReadsAreConsistent", SeqLockReadsAreConsistent, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&RingTests, Framework, "Ring buffer", "MdePkg.BaseLockFreeLib.Ring", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for RingTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (RingTests, "A ring buffer is a bounded FIFO", "RingIsBoundedFifo", RingIsBoundedFifo, SetupRing, CleanupRing, NULL);
+  AddTestCase (RingTests, "Concurrent producers and consumers", "RingIsMpmc", RingIsMpmc, SetupRing, CleanupRing, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
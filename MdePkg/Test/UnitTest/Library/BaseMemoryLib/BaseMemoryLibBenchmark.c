@@ -0,0 +1,526 @@
+/** @file
+  Host based unit test and throughput benchmark of the BaseMemoryLib
+  instances.
+
+  The same test is built once per instance. It checks the copy, fill, compare
+  and scan services against byte-wise reference loops for every small length
+  and alignment, then reports the throughput of each service on 4 KB, 64 KB
+  and 4 MB buffers.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "BaseMemoryLib Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_MAX_LENGTH        300
+#define TEST_MAX_ALIGNMENT     16
+#define TEST_GUARD_SIZE        64
+#define TEST_BUFFER_SIZE       (TEST_GUARD_SIZE + TEST_MAX_ALIGNMENT + TEST_MAX_LENGTH * sizeof (UINT64) + TEST_GUARD_SIZE)
+#define TEST_GUARD_VALUE       0xA5
+
+#define BENCHMARK_MAX_LENGTH   SIZE_4MB
+#define BENCHMARK_TOTAL        SIZE_256MB
+
+UINT8  *mBuffer1;
+UINT8  *mBuffer2;
+UINT8  *mReference;
+
+STATIC CONST UINTN  mBenchmarkLengths[] = { SIZE_4KB, SIZE_64KB, SIZE_4MB };
+
+/**
+  Fills a buffer with pseudo random bytes.
+
+  @param  Buffer                 The buffer to fill.
+  @param  Length                 The number of bytes to fill.
+
+**/
+VOID
+TestFillRandom (
+  OUT UINT8  *Buffer,
+  IN  UINTN  Length
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    Buffer[Index] = (UINT8) rand ();
+  }
+}
+
+/**
+  Compares two buffers byte by byte.
+
+  @param  Buffer1                The first buffer.
+  @param  Buffer2                The second buffer.
+  @param  Length                 The number of bytes to compare.
+
+  @retval TRUE                   The buffers are identical.
+  @retval FALSE                  The buffers differ.
+
+**/
+BOOLEAN
+TestIsEqual (
+  IN CONST UINT8  *Buffer1,
+  IN CONST UINT8  *Buffer2,
+  IN UINTN        Length
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    if (Buffer1[Index] != Buffer2[Index]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Allocates the buffers of the test.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The buffers were allocated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocateBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mBuffer1   = AllocatePool (BENCHMARK_MAX_LENGTH + TEST_BUFFER_SIZE);
+  mBuffer2   = AllocatePool (BENCHMARK_MAX_LENGTH + TEST_BUFFER_SIZE);
+  mReference = AllocatePool (BENCHMARK_MAX_LENGTH + TEST_BUFFER_SIZE);
+  if (mBuffer1 == NULL || mBuffer2 == NULL || mReference == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  srand (0x1234);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the buffers of the test.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeBuffers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FreePool (mBuffer1);
+  FreePool (mBuffer2);
+  FreePool (mReference);
+}
+
+/**
+  Checks CopyMem() against a byte-wise copy, for every small length, for
+  every alignment of the source and of the destination, and for overlapping
+  buffers in both directions.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       CopyMem() copied the expected bytes.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  CopyMem() copied wrong bytes.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CopyMemIsCorrect (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Length;
+  UINTN  SourceOffset;
+  UINTN  DestinationOffset;
+  UINTN  Index;
+  VOID   *Result;
+
+  for (Length = 0; Length <= TEST_MAX_LENGTH; Length++) {
+    for (SourceOffset = 0; SourceOffset < TEST_MAX_ALIGNMENT; SourceOffset++) {
+      for (DestinationOffset = 0; DestinationOffset < TEST_MAX_ALIGNMENT; DestinationOffset++) {
+        //
+        // Disjoint buffers
+        //
+        TestFillRandom (mBuffer1, TEST_BUFFER_SIZE);
+        SetMem (mBuffer2, TEST_BUFFER_SIZE, TEST_GUARD_VALUE);
+        CopyMem (mReference, mBuffer2, TEST_BUFFER_SIZE);
+        for (Index = 0; Index < Length; Index++) {
+          mReference[TEST_GUARD_SIZE + DestinationOffset + Index] = mBuffer1[TEST_GUARD_SIZE + SourceOffset + Index];
+        }
+
+        Result = CopyMem (mBuffer2 + TEST_GUARD_SIZE + DestinationOffset, mBuffer1 + TEST_GUARD_SIZE + SourceOffset, Length);
+        UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) (mBuffer2 + TEST_GUARD_SIZE + DestinationOffset));
+        UT_ASSERT_TRUE (TestIsEqual (mBuffer2, mReference, TEST_BUFFER_SIZE));
+
+        //
+        // Overlapping buffers, the destination following the source and the
+        // source following the destination
+        //
+        TestFillRandom (mBuffer2, TEST_BUFFER_SIZE);
+        CopyMem (mReference, mBuffer2, TEST_BUFFER_SIZE);
+        for (Index = 0; Index < Length; Index++) {
+          mReference[TEST_GUARD_SIZE + DestinationOffset + Index] = mBuffer2[TEST_GUARD_SIZE + SourceOffset + Index];
+        }
+
+        CopyMem (mBuffer2 + TEST_GUARD_SIZE + DestinationOffset, mBuffer2 + TEST_GUARD_SIZE + SourceOffset, Length);
+        UT_ASSERT_TRUE (TestIsEqual (mBuffer2, mReference, TEST_BUFFER_SIZE));
+
+        TestFillRandom (mBuffer2, TEST_BUFFER_SIZE);
+        CopyMem (mReference, mBuffer2, TEST_BUFFER_SIZE);
+        for (Index = 0; Index < Length; Index++) {
+          mReference[TEST_GUARD_SIZE + SourceOffset + Length / 2 + Index] = mBuffer2[TEST_GUARD_SIZE + DestinationOffset + Index];
+        }
+
+        CopyMem (mBuffer2 + TEST_GUARD_SIZE + SourceOffset + Length / 2, mBuffer2 + TEST_GUARD_SIZE + DestinationOffset, Length);
+        UT_ASSERT_TRUE (TestIsEqual (mBuffer2, mReference, TEST_BUFFER_SIZE));
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks SetMem() and ZeroMem() against a byte-wise fill, for every small
+  length and alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       SetMem() and ZeroMem() set the expected bytes.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  SetMem() or ZeroMem() set wrong bytes.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetMemIsCorrect (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Length;
+  UINTN  Offset;
+  UINTN  Index;
+  UINT8  Value;
+  VOID   *Result;
+
+  for (Length = 0; Length <= TEST_MAX_LENGTH; Length++) {
+    for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset++) {
+      Value = (UINT8) rand ();
+
+      TestFillRandom (mBuffer1, TEST_BUFFER_SIZE);
+      CopyMem (mReference, mBuffer1, TEST_BUFFER_SIZE);
+      for (Index = 0; Index < Length; Index++) {
+        mReference[TEST_GUARD_SIZE + Offset + Index] = Value;
+      }
+
+      Result = SetMem (mBuffer1 + TEST_GUARD_SIZE + Offset, Length, Value);
+      UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) (mBuffer1 + TEST_GUARD_SIZE + Offset));
+      UT_ASSERT_TRUE (TestIsEqual (mBuffer1, mReference, TEST_BUFFER_SIZE));
+
+      TestFillRandom (mBuffer1, TEST_BUFFER_SIZE);
+      CopyMem (mReference, mBuffer1, TEST_BUFFER_SIZE);
+      for (Index = 0; Index < Length; Index++) {
+        mReference[TEST_GUARD_SIZE + Offset + Index] = 0;
+      }
+
+      Result = ZeroMem (mBuffer1 + TEST_GUARD_SIZE + Offset, Length);
+      UT_ASSERT_EQUAL ((UINTN) Result, (UINTN) (mBuffer1 + TEST_GUARD_SIZE + Offset));
+      UT_ASSERT_TRUE (TestIsEqual (mBuffer1, mReference, TEST_BUFFER_SIZE));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks CompareMem() and IsZeroBuffer() with a single different byte at
+  every position of every small length and alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected differences were reported.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong difference was reported.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CompareMemIsCorrect (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Length;
+  UINTN  Offset;
+  UINTN  Index;
+  UINT8  *Buffer1;
+  UINT8  *Buffer2;
+  UINT8  Value;
+
+  for (Length = 1; Length <= TEST_MAX_LENGTH; Length++) {
+    for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset++) {
+      Buffer1 = mBuffer1 + TEST_GUARD_SIZE + Offset;
+      Buffer2 = mBuffer2 + TEST_GUARD_SIZE + TEST_MAX_ALIGNMENT - 1 - Offset;
+
+      //
+      // Bytes around the buffers differ, and must not be looked at
+      //
+      TestFillRandom (mBuffer1, TEST_BUFFER_SIZE);
+      SetMem (mBuffer2, TEST_BUFFER_SIZE, TEST_GUARD_VALUE);
+      CopyMem (Buffer2, Buffer1, Length);
+      UT_ASSERT_EQUAL (CompareMem (Buffer1, Buffer2, Length), 0);
+
+      for (Index = 0; Index < Length; Index++) {
+        Value          = Buffer2[Index];
+        Buffer2[Index] = (UINT8) (Value + 1 + rand () % 255);
+        UT_ASSERT_EQUAL (CompareMem (Buffer1, Buffer2, Length), (INTN) Buffer1[Index] - (INTN) Buffer2[Index]);
+        Buffer2[Index] = Value;
+      }
+
+      ZeroMem (Buffer1, Length);
+      UT_ASSERT_TRUE (IsZeroBuffer (Buffer1, Length));
+      for (Index = 0; Index < Length; Index++) {
+        Buffer1[Index] = (UINT8) (1 + rand () % 255);
+        UT_ASSERT_FALSE (IsZeroBuffer (Buffer1, Length));
+        Buffer1[Index] = 0;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks ScanMem8(), ScanMem16(), ScanMem32() and ScanMem64() with a single
+  match at every position of every small length and alignment.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The expected matches were returned.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A wrong match was returned.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ScanMemIsCorrect (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Length;
+  UINTN  Offset;
+  UINTN  Index;
+  UINT8  *Buffer;
+
+  for (Length = 1; Length <= TEST_MAX_LENGTH; Length++) {
+    for (Offset = 0; Offset < TEST_MAX_ALIGNMENT; Offset += 8) {
+      Buffer = mBuffer1 + TEST_GUARD_SIZE + Offset;
+
+      //
+      // The value is only found around the buffer, where it must not be
+      // looked for.
+      //
+      SetMem (mBuffer1, TEST_BUFFER_SIZE, TEST_GUARD_VALUE);
+      SetMem (Buffer, Length * sizeof (UINT64), 0);
+      UT_ASSERT_TRUE (ScanMem8 (Buffer, Length, TEST_GUARD_VALUE) == NULL);
+      UT_ASSERT_TRUE (ScanMem16 (Buffer, Length * sizeof (UINT16), 0xA5A5) == NULL);
+      UT_ASSERT_TRUE (ScanMem32 (Buffer, Length * sizeof (UINT32), 0xA5A5A5A5) == NULL);
+      UT_ASSERT_TRUE (ScanMem64 (Buffer, Length * sizeof (UINT64), 0xA5A5A5A5A5A5A5A5ULL) == NULL);
+
+      for (Index = 0; Index < Length; Index++) {
+        Buffer[Index] = TEST_GUARD_VALUE;
+        UT_ASSERT_EQUAL ((UINTN) ScanMem8 (Buffer, Length, TEST_GUARD_VALUE), (UINTN) &Buffer[Index]);
+        Buffer[Index] = 0;
+
+        ((UINT16 *) Buffer)[Index] = 0xA5A5;
+        UT_ASSERT_EQUAL ((UINTN) ScanMem16 (Buffer, Length * sizeof (UINT16), 0xA5A5), (UINTN) &((UINT16 *) Buffer)[Index]);
+        ((UINT16 *) Buffer)[Index] = 0;
+
+        ((UINT32 *) Buffer)[Index] = 0xA5A5A5A5;
+        UT_ASSERT_EQUAL ((UINTN) ScanMem32 (Buffer, Length * sizeof (UINT32), 0xA5A5A5A5), (UINTN) &((UINT32 *) Buffer)[Index]);
+        ((UINT32 *) Buffer)[Index] = 0;
+
+        ((UINT64 *) Buffer)[Index] = 0xA5A5A5A5A5A5A5A5ULL;
+        UT_ASSERT_EQUAL ((UINTN) ScanMem64 (Buffer, Length * sizeof (UINT64), 0xA5A5A5A5A5A5A5A5ULL), (UINTN) &((UINT64 *) Buffer)[Index]);
+        ((UINT64 *) Buffer)[Index] = 0;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reports the throughput of a service.
+
+  @param  Name                   The name of the service.
+  @param  Length                 The length of the buffers.
+  @param  Start                  The clock at the start of the run.
+  @param  End                    The clock at the end of the run.
+
+**/
+VOID
+ReportThroughput (
+  IN CONST CHAR8  *Name,
+  IN UINTN        Length,
+  IN clock_t      Start,
+  IN clock_t      End
+  )
+{
+  UINT64  Microseconds;
+
+  Microseconds = (UINT64) (End - Start) * 1000000 / CLOCKS_PER_SEC;
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: %a %8d bytes: %6d MB/s\n",
+    gEfiCallerBaseName,
+    Name,
+    (UINT32) Length,
+    (UINT32) DivU64x64Remainder (BENCHMARK_TOTAL, MAX (Microseconds, 1), NULL)
+    ));
+}
+
+/**
+  Reports the throughput of the copy, fill, compare and scan services.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The services returned the expected results.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A service returned a wrong result.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Throughput (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN    LengthIndex;
+  UINTN    Length;
+  UINTN    Count;
+  UINTN    Index;
+  clock_t  Start;
+
+  for (LengthIndex = 0; LengthIndex < ARRAY_SIZE (mBenchmarkLengths); LengthIndex++) {
+    Length = mBenchmarkLengths[LengthIndex];
+    Count  = BENCHMARK_TOTAL / Length;
+
+    Start = clock ();
+    for (Index = 0; Index < Count; Index++) {
+      ZeroMem (mBuffer1, Length);
+    }
+    ReportThroughput ("ZeroMem     ", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0; Index < Count; Index++) {
+      SetMem (mBuffer2, Length, 0);
+    }
+    ReportThroughput ("SetMem      ", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0; Index < Count; Index++) {
+      CopyMem (mBuffer2, mBuffer1, Length);
+    }
+    ReportThroughput ("CopyMem     ", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0; Index < Count; Index++) {
+      UT_ASSERT_EQUAL (CompareMem (mBuffer1, mBuffer2, Length), 0);
+    }
+    ReportThroughput ("CompareMem  ", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0; Index < Count; Index++) {
+      UT_ASSERT_TRUE (ScanMem8 (mBuffer1, Length, 1) == NULL);
+    }
+    ReportThroughput ("ScanMem8    ", Length, Start, clock ());
+
+    Start = clock ();
+    for (Index = 0; Index < Count; Index++) {
+      UT_ASSERT_TRUE (IsZeroBuffer (mBuffer1, Length));
+    }
+    ReportThroughput ("IsZeroBuffer", Length, Start, clock ());
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  BaseMemoryLib services and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      MemoryTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&MemoryTests, Framework, "BaseMemoryLib Services", "MdePkg.BaseMemoryLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MemoryTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description-----------------------Class Name-------------Function-------------Pre--------------Post---------Context
+  AddTestCase (MemoryTests, "CopyMem copies the expected bytes", "CopyMemIsCorrect", CopyMemIsCorrect, AllocateBuffers, FreeBuffers, NULL);
+  AddTestCase (MemoryTests, "SetMem and ZeroMem set the expected bytes", "SetMemIsCorrect", SetMemIsCorrect, AllocateBuffers, FreeBuffers, NULL);
+  AddTestCase (MemoryTests, "CompareMem and IsZeroBuffer find differences", "CompareMemIsCorrect", CompareMemIsCorrect, AllocateBuffers, FreeBuffers, NULL);
+  AddTestCase (MemoryTests, "ScanMem finds the first match", "ScanMemIsCorrect", ScanMemIsCorrect, AllocateBuffers, FreeBuffers, NULL);
+  AddTestCase (MemoryTests, "Throughput of the services", "Throughput", Throughput, AllocateBuffers, FreeBuffers, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,1142 @@
+/** @file
+  Host based unit test and benchmark of the loading and relocation of PE/COFF
+  images by BasePeCoffLib.
+
+  The test builds a PE32 and a PE32+ image with relocation blocks of every
+  type the library applies itself, including a block whose page is not
+  entirely in the image, loads and relocates them with and without a fixup
+  log, and checks the result against relocation records applied one at a
+  time. It checks that the runtime relocation table of each image is
+  reapplied as its FixupData buffer is. It then reports the time to load and
+  to relocate these images and the PE/COFF images whose paths are given on the
+  command line, and the size and the time to reapply their runtime
+  relocation tables, for example:
+
+    PeCoffLibBenchmarkHost Build/Shell/RELEASE_GCC5/X64/Shell.efi
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <Uefi.h>
+#include <IndustryStandard/PeImage.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PeCoffLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "BasePeCoffLib Host Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_PE_HEADER_OFFSET  0x80
+#define TEST_HEADERS_SIZE      0x400
+#define TEST_ALIGNMENT         SIZE_4KB
+#define TEST_IMAGE_BASE        0x10000000
+#define TEST_DATA_PAGES        512
+#define TEST_SLOTS_PER_PAGE    (SIZE_4KB / sizeof (UINT64))
+
+#define BENCHMARK_FIXUPS       (64 * 1024 * 1024)
+
+typedef struct {
+  CHAR8   *Name;
+  UINT8   *File;
+  UINTN   FileSize;
+} TEST_IMAGE;
+
+UINTN       mTestArgc;
+CHAR8       **mTestArgv;
+
+TEST_IMAGE  mPe32Image     = { "PE32 test image" };
+TEST_IMAGE  mPe32PlusImage = { "PE32+ test image" };
+
+/**
+  Appends a relocation block to the relocation data of a test image.
+
+  The block fixes up Count random 8-byte slots of the page at VirtualAddress,
+  in ascending order, each with a relocation of a random type. Most of them
+  are of the type the image is linked with, in runs of a random length, and
+  the others are ABSOLUTE, HIGH and LOW relocations.
+
+  @param  Block           The buffer of the block.
+  @param  VirtualAddress  The address of the page of the block.
+  @param  Slots           The number of 8-byte slots of the page that can be
+                          fixed up.
+  @param  Count           The number of relocations of the block.
+  @param  Type            The type of relocation the image is linked with.
+
+  @return The size of the block.
+
+**/
+UINT32
+TestAddRelocationBlock (
+  OUT UINT8   *Block,
+  IN  UINT32  VirtualAddress,
+  IN  UINT32  Slots,
+  IN  UINT32  Count,
+  IN  UINT16  Type
+  )
+{
+  EFI_IMAGE_BASE_RELOCATION  *RelocBase;
+  UINT16                     *Reloc;
+  UINT32                     Slot;
+  UINT32                     Index;
+  UINT16                     RunType;
+  UINT32                     RunLength;
+
+  RelocBase = (EFI_IMAGE_BASE_RELOCATION *) Block;
+  Reloc     = (UINT16 *) (RelocBase + 1);
+
+  RunType   = Type;
+  RunLength = 0;
+  Slot      = 0;
+  for (Index = 0; Index < Count; Index++) {
+    if (RunLength == 0) {
+      switch (rand () % 8) {
+      case 0:
+        RunType = EFI_IMAGE_REL_BASED_ABSOLUTE;
+        break;
+      case 1:
+        RunType = EFI_IMAGE_REL_BASED_HIGH;
+        break;
+      case 2:
+        RunType = EFI_IMAGE_REL_BASED_LOW;
+        break;
+      default:
+        RunType = Type;
+        break;
+      }
+      RunLength = 1 + rand () % 32;
+    }
+    RunLength--;
+
+    //
+    // Leave enough slots for the relocations that follow
+    //
+    Slot += rand () % ((Slots - Slot) / (Count - Index));
+    *Reloc++ = (UINT16) ((RunType << 12) | (Slot * sizeof (UINT64)));
+    Slot++;
+  }
+
+  //
+  // Blocks are 32-bit aligned, the ABSOLUTE relocation that pads them is
+  // ignored.
+  //
+  if ((Count & 1) != 0) {
+    *Reloc++ = EFI_IMAGE_REL_BASED_ABSOLUTE << 12;
+  }
+
+  RelocBase->VirtualAddress = VirtualAddress;
+  RelocBase->SizeOfBlock    = (UINT32) ((UINT8 *) Reloc - Block);
+  return RelocBase->SizeOfBlock;
+}
+
+/**
+  Builds a PE32 or PE32+ test image.
+
+  The image is made of the headers, a .reloc section and a .data section of
+  TEST_DATA_PAGES pages of random bytes. Each page of the .data section is
+  fixed up by a relocation block. The last block is at the middle of the last
+  page, so the page of that block is not entirely in the image.
+
+  @param  Image   The test image.
+  @param  Magic   EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC or
+                  EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC.
+
+  @retval TRUE    The image was built.
+  @retval FALSE   Out of memory.
+
+**/
+BOOLEAN
+TestBuildImage (
+  IN OUT TEST_IMAGE  *Image,
+  IN     UINT16      Magic
+  )
+{
+  EFI_IMAGE_DOS_HEADER                 *DosHdr;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+  EFI_IMAGE_SECTION_HEADER             *Section;
+  EFI_IMAGE_DATA_DIRECTORY             *RelocDir;
+  UINT8                                *Reloc;
+  UINT32                               RelocSize;
+  UINT32                               RelocSectionSize;
+  UINT32                               DataAddress;
+  UINT32                               ImageSize;
+  UINT16                               Type;
+  UINTN                                Page;
+  UINTN                                Index;
+
+  Type = (Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) ? EFI_IMAGE_REL_BASED_HIGHLOW : EFI_IMAGE_REL_BASED_DIR64;
+
+  //
+  // A block has at most TEST_SLOTS_PER_PAGE relocations and one for padding
+  //
+  RelocSectionSize = ALIGN_VALUE (
+                       TEST_DATA_PAGES * (sizeof (EFI_IMAGE_BASE_RELOCATION) + (TEST_SLOTS_PER_PAGE + 1) * sizeof (UINT16)),
+                       TEST_ALIGNMENT
+                       );
+  DataAddress = TEST_ALIGNMENT + RelocSectionSize;
+  ImageSize   = DataAddress + TEST_DATA_PAGES * SIZE_4KB;
+
+  Image->FileSize = ImageSize;
+  Image->File     = AllocateZeroPool (ImageSize);
+  if (Image->File == NULL) {
+    return FALSE;
+  }
+
+  for (Index = DataAddress; Index < ImageSize; Index++) {
+    Image->File[Index] = (UINT8) rand ();
+  }
+
+  Reloc     = Image->File + TEST_ALIGNMENT;
+  RelocSize = 0;
+  for (Page = 0; Page < TEST_DATA_PAGES - 1; Page++) {
+    RelocSize += TestAddRelocationBlock (
+                   Reloc + RelocSize,
+                   (UINT32) (DataAddress + Page * SIZE_4KB),
+                   TEST_SLOTS_PER_PAGE,
+                   1 + rand () % TEST_SLOTS_PER_PAGE,
+                   Type
+                   );
+  }
+  RelocSize += TestAddRelocationBlock (
+                 Reloc + RelocSize,
+                 ImageSize - SIZE_2KB,
+                 TEST_SLOTS_PER_PAGE / 2,
+                 TEST_SLOTS_PER_PAGE / 4,
+                 Type
+                 );
+
+  DosHdr           = (EFI_IMAGE_DOS_HEADER *) Image->File;
+  DosHdr->e_magic  = EFI_IMAGE_DOS_SIGNATURE;
+  DosHdr->e_lfanew = TEST_PE_HEADER_OFFSET;
+
+  Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *) (Image->File + TEST_PE_HEADER_OFFSET);
+  Hdr.Pe32->Signature                   = EFI_IMAGE_NT_SIGNATURE;
+  Hdr.Pe32->FileHeader.NumberOfSections = 2;
+  if (Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    Hdr.Pe32->FileHeader.Machine                  = IMAGE_FILE_MACHINE_I386;
+    Hdr.Pe32->FileHeader.SizeOfOptionalHeader     = sizeof (EFI_IMAGE_OPTIONAL_HEADER32);
+    Hdr.Pe32->OptionalHeader.Magic                = Magic;
+    Hdr.Pe32->OptionalHeader.AddressOfEntryPoint  = DataAddress;
+    Hdr.Pe32->OptionalHeader.ImageBase            = TEST_IMAGE_BASE;
+    Hdr.Pe32->OptionalHeader.SectionAlignment     = TEST_ALIGNMENT;
+    Hdr.Pe32->OptionalHeader.FileAlignment        = TEST_ALIGNMENT;
+    Hdr.Pe32->OptionalHeader.SizeOfImage          = ImageSize;
+    Hdr.Pe32->OptionalHeader.SizeOfHeaders        = TEST_HEADERS_SIZE;
+    Hdr.Pe32->OptionalHeader.Subsystem            = EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER;
+    Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes  = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+    RelocDir = &Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    Section  = (EFI_IMAGE_SECTION_HEADER *) (Hdr.Pe32 + 1);
+  } else {
+    Hdr.Pe32Plus->FileHeader.Machine                  = IMAGE_FILE_MACHINE_X64;
+    Hdr.Pe32Plus->FileHeader.SizeOfOptionalHeader     = sizeof (EFI_IMAGE_OPTIONAL_HEADER64);
+    Hdr.Pe32Plus->OptionalHeader.Magic                = Magic;
+    Hdr.Pe32Plus->OptionalHeader.AddressOfEntryPoint  = DataAddress;
+    Hdr.Pe32Plus->OptionalHeader.ImageBase            = TEST_IMAGE_BASE;
+    Hdr.Pe32Plus->OptionalHeader.SectionAlignment     = TEST_ALIGNMENT;
+    Hdr.Pe32Plus->OptionalHeader.FileAlignment        = TEST_ALIGNMENT;
+    Hdr.Pe32Plus->OptionalHeader.SizeOfImage          = ImageSize;
+    Hdr.Pe32Plus->OptionalHeader.SizeOfHeaders        = TEST_HEADERS_SIZE;
+    Hdr.Pe32Plus->OptionalHeader.Subsystem            = EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER;
+    Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes  = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+    RelocDir = &Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    Section  = (EFI_IMAGE_SECTION_HEADER *) (Hdr.Pe32Plus + 1);
+  }
+
+  RelocDir->VirtualAddress = TEST_ALIGNMENT;
+  RelocDir->Size           = RelocSize;
+
+  CopyMem (Section[0].Name, ".reloc", sizeof (".reloc"));
+  Section[0].Misc.VirtualSize  = RelocSize;
+  Section[0].VirtualAddress    = TEST_ALIGNMENT;
+  Section[0].SizeOfRawData     = RelocSectionSize;
+  Section[0].PointerToRawData  = TEST_ALIGNMENT;
+  Section[0].Characteristics   = EFI_IMAGE_SCN_CNT_INITIALIZED_DATA | EFI_IMAGE_SCN_MEM_READ;
+
+  CopyMem (Section[1].Name, ".data", sizeof (".data"));
+  Section[1].Misc.VirtualSize  = TEST_DATA_PAGES * SIZE_4KB;
+  Section[1].VirtualAddress    = DataAddress;
+  Section[1].SizeOfRawData     = TEST_DATA_PAGES * SIZE_4KB;
+  Section[1].PointerToRawData  = DataAddress;
+  Section[1].Characteristics   = EFI_IMAGE_SCN_CNT_INITIALIZED_DATA | EFI_IMAGE_SCN_MEM_READ | EFI_IMAGE_SCN_MEM_WRITE;
+
+  return TRUE;
+}
+
+/**
+  Reads a PE/COFF image from a file.
+
+  @param  Image   The image, whose Name is the path of the file.
+
+  @retval TRUE    The image was read.
+  @retval FALSE   The file could not be read.
+
+**/
+BOOLEAN
+TestReadImage (
+  IN OUT TEST_IMAGE  *Image
+  )
+{
+  FILE  *File;
+  long  Size;
+
+  File = fopen (Image->Name, "rb");
+  if (File == NULL) {
+    return FALSE;
+  }
+
+  Image->File = NULL;
+  Size        = -1;
+  if (fseek (File, 0, SEEK_END) == 0) {
+    Size = ftell (File);
+  }
+
+  if ((Size > 0) && (fseek (File, 0, SEEK_SET) == 0)) {
+    Image->FileSize = (UINTN) Size;
+    Image->File     = AllocatePool (Image->FileSize);
+    if ((Image->File != NULL) && (fread (Image->File, 1, Image->FileSize, File) != Image->FileSize)) {
+      FreePool (Image->File);
+      Image->File = NULL;
+    }
+  }
+
+  fclose (File);
+  return (BOOLEAN) (Image->File != NULL);
+}
+
+/**
+  Allocates the buffer of an image and loads the image into it.
+
+  @param  Image         The image to load.
+  @param  ImageContext  The context of the image.
+
+  @retval TRUE    The image was loaded.
+  @retval FALSE   The image could not be loaded.
+
+**/
+BOOLEAN
+TestLoadImage (
+  IN  TEST_IMAGE                    *Image,
+  OUT PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext
+  )
+{
+  RETURN_STATUS  Status;
+
+  ZeroMem (ImageContext, sizeof (*ImageContext));
+  ImageContext->Handle    = Image->File;
+  ImageContext->ImageRead = PeCoffLoaderImageReadFromMemory;
+  Status = PeCoffLoaderGetImageInfo (ImageContext);
+  if (RETURN_ERROR (Status) || ImageContext->IsTeImage) {
+    return FALSE;
+  }
+
+  ImageContext->ImageAddress = (PHYSICAL_ADDRESS) (UINTN) AllocateAlignedPages (
+                                                            EFI_SIZE_TO_PAGES ((UINTN) ImageContext->ImageSize),
+                                                            MAX ((UINTN) ImageContext->SectionAlignment, TEST_ALIGNMENT)
+                                                            );
+  if (ImageContext->ImageAddress == 0) {
+    return FALSE;
+  }
+
+  Status = PeCoffLoaderLoadImage (ImageContext);
+  if (RETURN_ERROR (Status)) {
+    FreeAlignedPages ((VOID *) (UINTN) ImageContext->ImageAddress, EFI_SIZE_TO_PAGES ((UINTN) ImageContext->ImageSize));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Frees the buffer of an image loaded by TestLoadImage().
+
+  @param  ImageContext  The context of the image.
+
+**/
+VOID
+TestUnloadImage (
+  IN PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext
+  )
+{
+  FreeAlignedPages ((VOID *) (UINTN) ImageContext->ImageAddress, EFI_SIZE_TO_PAGES ((UINTN) ImageContext->ImageSize));
+}
+
+/**
+  Returns the relocation data directory of a loaded PE32 or PE32+ image, and
+  points to its image base.
+
+  @param  ImageContext  The context of the loaded image.
+  @param  ImageBase32   Set to the image base of a PE32 image, or NULL.
+  @param  ImageBase64   Set to the image base of a PE32+ image, or NULL.
+
+  @return The relocation data directory, or NULL if the image has none.
+
+**/
+EFI_IMAGE_DATA_DIRECTORY *
+TestGetRelocDir (
+  IN  PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  OUT UINT32                        **ImageBase32,
+  OUT UINT64                        **ImageBase64
+  )
+{
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+
+  Hdr.Pe32     = (EFI_IMAGE_NT_HEADERS32 *) ((UINTN) ImageContext->ImageAddress + ImageContext->PeCoffHeaderOffset);
+  *ImageBase32 = NULL;
+  *ImageBase64 = NULL;
+  if (Hdr.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    *ImageBase32 = &Hdr.Pe32->OptionalHeader.ImageBase;
+    if (Hdr.Pe32->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC) {
+      return NULL;
+    }
+    return &Hdr.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  }
+
+  *ImageBase64 = &Hdr.Pe32Plus->OptionalHeader.ImageBase;
+  if (Hdr.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC) {
+    return NULL;
+  }
+  return &Hdr.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+}
+
+/**
+  Relocates a loaded image by applying its relocation records one at a time,
+  as the reference for PeCoffLoaderRelocateImage().
+
+  @param  ImageContext  The context of the loaded image.
+  @param  BaseAddress   The address to relocate the image to.
+  @param  FixupData     The buffer to log the fixups, or NULL.
+  @param  FixupCount    Set to the number of fixups applied.
+
+  @retval TRUE    The image was relocated.
+  @retval FALSE   The image has a relocation of an unexpected type.
+
+**/
+BOOLEAN
+TestRelocateImage (
+  IN  PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  IN  UINT64                        BaseAddress,
+  IN  CHAR8                         *FixupData,
+  OUT UINTN                         *FixupCount
+  )
+{
+  EFI_IMAGE_DATA_DIRECTORY   *RelocDir;
+  UINT32                     *ImageBase32;
+  UINT64                     *ImageBase64;
+  UINT64                     Adjust;
+  UINT8                      *Image;
+  EFI_IMAGE_BASE_RELOCATION  *RelocBase;
+  UINT8                      *RelocDirEnd;
+  UINT16                     *Reloc;
+  UINT16                     *RelocEnd;
+  CHAR8                      *Fixup;
+
+  *FixupCount = 0;
+  RelocDir    = TestGetRelocDir (ImageContext, &ImageBase32, &ImageBase64);
+  if (ImageBase32 != NULL) {
+    Adjust       = BaseAddress - *ImageBase32;
+    *ImageBase32 = (UINT32) BaseAddress;
+  } else {
+    Adjust       = BaseAddress - *ImageBase64;
+    *ImageBase64 = BaseAddress;
+  }
+
+  if ((RelocDir == NULL) || (RelocDir->Size == 0)) {
+    return TRUE;
+  }
+
+  Image       = (UINT8 *) (UINTN) ImageContext->ImageAddress;
+  RelocBase   = (EFI_IMAGE_BASE_RELOCATION *) (Image + RelocDir->VirtualAddress);
+  RelocDirEnd = Image + RelocDir->VirtualAddress + RelocDir->Size;
+  while ((UINT8 *) RelocBase < RelocDirEnd) {
+    Reloc    = (UINT16 *) (RelocBase + 1);
+    RelocEnd = (UINT16 *) ((UINT8 *) RelocBase + RelocBase->SizeOfBlock);
+    for (; Reloc < RelocEnd; Reloc++) {
+      Fixup = (CHAR8 *) Image + RelocBase->VirtualAddress + (*Reloc & 0xFFF);
+      switch (*Reloc >> 12) {
+      case EFI_IMAGE_REL_BASED_ABSOLUTE:
+        continue;
+
+      case EFI_IMAGE_REL_BASED_HIGH:
+        *(UINT16 *) Fixup = (UINT16) (*(UINT16 *) Fixup + (UINT16) ((UINT32) Adjust >> 16));
+        if (FixupData != NULL) {
+          *(UINT16 *) FixupData = *(UINT16 *) Fixup;
+          FixupData += sizeof (UINT16);
+        }
+        break;
+
+      case EFI_IMAGE_REL_BASED_LOW:
+        *(UINT16 *) Fixup = (UINT16) (*(UINT16 *) Fixup + (UINT16) Adjust);
+        if (FixupData != NULL) {
+          *(UINT16 *) FixupData = *(UINT16 *) Fixup;
+          FixupData += sizeof (UINT16);
+        }
+        break;
+
+      case EFI_IMAGE_REL_BASED_HIGHLOW:
+        *(UINT32 *) Fixup = *(UINT32 *) Fixup + (UINT32) Adjust;
+        if (FixupData != NULL) {
+          FixupData = ALIGN_POINTER (FixupData, sizeof (UINT32));
+          *(UINT32 *) FixupData = *(UINT32 *) Fixup;
+          FixupData += sizeof (UINT32);
+        }
+        break;
+
+      case EFI_IMAGE_REL_BASED_DIR64:
+        *(UINT64 *) Fixup = *(UINT64 *) Fixup + Adjust;
+        if (FixupData != NULL) {
+          FixupData = ALIGN_POINTER (FixupData, sizeof (UINT64));
+          *(UINT64 *) FixupData = *(UINT64 *) Fixup;
+          FixupData += sizeof (UINT64);
+        }
+        break;
+
+      default:
+        return FALSE;
+      }
+      (*FixupCount)++;
+    }
+    RelocBase = (EFI_IMAGE_BASE_RELOCATION *) RelocEnd;
+  }
+
+  return TRUE;
+}
+
+/**
+  Checks that PeCoffLoaderRelocateImage() relocates an image as its
+  relocation records applied one at a time do, with and without a fixup log.
+
+  @param  Image   The image to check.
+
+  @retval UNIT_TEST_PASSED       The image was relocated as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The image was relocated wrongly.
+
+**/
+UNIT_TEST_STATUS
+TestCheckImage (
+  IN TEST_IMAGE  *Image
+  )
+{
+  PE_COFF_LOADER_IMAGE_CONTEXT  ImageContext;
+  PE_COFF_LOADER_IMAGE_CONTEXT  Reference;
+  CHAR8                         *FixupData;
+  CHAR8                         *ReferenceFixupData;
+  UINTN                         FixupCount;
+  UINTN                         Pass;
+  BOOLEAN                       Result;
+
+  UT_ASSERT_TRUE (TestLoadImage (Image, &ImageContext));
+  UT_ASSERT_TRUE (TestLoadImage (Image, &Reference));
+  UT_ASSERT_FALSE (ImageContext.RelocationsStripped);
+
+  FixupData          = AllocateZeroPool (ImageContext.FixupDataSize);
+  ReferenceFixupData = AllocateZeroPool (ImageContext.FixupDataSize);
+  UT_ASSERT_NOT_NULL (FixupData);
+  UT_ASSERT_NOT_NULL (ReferenceFixupData);
+
+  //
+  // Relocate both copies to the address of the first, then twice more to
+  // other addresses, logging the fixups of the last relocation.
+  //
+  Result = TRUE;
+  for (Pass = 0; Pass < 3 && Result; Pass++) {
+    ImageContext.DestinationAddress = ImageContext.ImageAddress + Pass * 0x123456000ULL;
+    ImageContext.FixupData          = (Pass == 2) ? FixupData : NULL;
+    Result = (BOOLEAN) (PeCoffLoaderRelocateImage (&ImageContext) == RETURN_SUCCESS);
+    Result = (BOOLEAN) (Result && TestRelocateImage (
+                                    &Reference,
+                                    ImageContext.DestinationAddress,
+                                    (Pass == 2) ? ReferenceFixupData : NULL,
+                                    &FixupCount
+                                    ));
+    Result = (BOOLEAN) (Result && (FixupCount > 0));
+    Result = (BOOLEAN) (Result && (CompareMem (
+                                     (VOID *) (UINTN) ImageContext.ImageAddress,
+                                     (VOID *) (UINTN) Reference.ImageAddress,
+                                     (UINTN) ImageContext.ImageSize
+                                     ) == 0));
+  }
+  Result = (BOOLEAN) (Result && (CompareMem (FixupData, ReferenceFixupData, ImageContext.FixupDataSize) == 0));
+
+  FreePool (FixupData);
+  FreePool (ReferenceFixupData);
+  TestUnloadImage (&ImageContext);
+  TestUnloadImage (&Reference);
+
+  UT_ASSERT_TRUE (Result);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks the relocation of the PE32 test image.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The image was relocated as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The image was relocated wrongly.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Pe32IsRelocated (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  return TestCheckImage (&mPe32Image);
+}
+
+/**
+  Checks the relocation of the PE32+ test image.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The image was relocated as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The image was relocated wrongly.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Pe32PlusIsRelocated (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  return TestCheckImage (&mPe32PlusImage);
+}
+
+/**
+  Checks the relocation of the images given on the command line.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The images were relocated as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An image was relocated wrongly.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ImagesAreRelocated (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_IMAGE        Image;
+  UINTN             Index;
+  UNIT_TEST_STATUS  Status;
+
+  for (Index = 1; Index < mTestArgc; Index++) {
+    Image.Name = mTestArgv[Index];
+    UT_ASSERT_TRUE (TestReadImage (&Image));
+    Status = TestCheckImage (&Image);
+    FreePool (Image.File);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Loads and relocates an image with a FixupData buffer, and builds its runtime
+  relocation table.
+
+  @param  Image         The image to load.
+  @param  ImageContext  The context of the image. Its FixupData is set to the
+                        FixupData buffer.
+  @param  Table         Set to the runtime relocation table of the image.
+  @param  TableSize     Set to the size of the table.
+
+  @retval TRUE    The image was loaded, and its table built.
+  @retval FALSE   The image could not be loaded or its table built.
+
+**/
+BOOLEAN
+TestLoadRuntimeImage (
+  IN  TEST_IMAGE                    *Image,
+  OUT PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  OUT VOID                          **Table,
+  OUT UINTN                         *TableSize
+  )
+{
+  if (!TestLoadImage (Image, ImageContext)) {
+    return FALSE;
+  }
+
+  ImageContext->FixupData = AllocateZeroPool (ImageContext->FixupDataSize);
+  *Table                  = NULL;
+  *TableSize              = 0;
+  if ((ImageContext->FixupData != NULL) &&
+      (PeCoffLoaderRelocateImage (ImageContext) == RETURN_SUCCESS) &&
+      (PeCoffLoaderBuildRuntimeRelocationTable (ImageContext, NULL, TableSize) == RETURN_BUFFER_TOO_SMALL)) {
+    *Table = AllocatePool (*TableSize);
+    if ((*Table != NULL) &&
+        (PeCoffLoaderBuildRuntimeRelocationTable (ImageContext, *Table, TableSize) == RETURN_SUCCESS)) {
+      return TRUE;
+    }
+  }
+
+  if (*Table != NULL) {
+    FreePool (*Table);
+  }
+  if (ImageContext->FixupData != NULL) {
+    FreePool (ImageContext->FixupData);
+  }
+  TestUnloadImage (ImageContext);
+  return FALSE;
+}
+
+/**
+  Frees an image loaded by TestLoadRuntimeImage().
+
+  @param  ImageContext  The context of the image.
+  @param  Table         The runtime relocation table of the image.
+
+**/
+VOID
+TestUnloadRuntimeImage (
+  IN PE_COFF_LOADER_IMAGE_CONTEXT  *ImageContext,
+  IN VOID                          *Table
+  )
+{
+  FreePool (Table);
+  FreePool (ImageContext->FixupData);
+  TestUnloadImage (ImageContext);
+}
+
+/**
+  Checks that the runtime relocation table of an image is reapplied as its
+  FixupData buffer is, after the image updated some of its data.
+
+  @param  Image   The image to check.
+
+  @retval UNIT_TEST_PASSED       The table was reapplied as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The table was reapplied wrongly.
+
+**/
+UNIT_TEST_STATUS
+TestCheckRuntimeTable (
+  IN TEST_IMAGE  *Image
+  )
+{
+  PE_COFF_LOADER_IMAGE_CONTEXT  ImageContext;
+  EFI_IMAGE_DATA_DIRECTORY      *RelocDir;
+  UINT32                        *ImageBase32;
+  UINT64                        *ImageBase64;
+  VOID                          *Table;
+  UINTN                         TableSize;
+  UINT8                         *Relocated;
+  UINT8                         *Updated;
+  UINT8                         *Expected;
+  UINTN                         ImageSize;
+  UINTN                         Offset;
+  UINTN                         Index;
+  PHYSICAL_ADDRESS              VirtImageBase;
+  BOOLEAN                       Result;
+
+  UT_ASSERT_TRUE (TestLoadRuntimeImage (Image, &ImageContext, &Table, &TableSize));
+  UT_ASSERT_TRUE (TableSize <= ImageContext.FixupDataSize);
+
+  //
+  // Update some data of the image, out of its headers and relocation data,
+  // at offsets spread over the image with an odd stride, as the offsets can
+  // be larger than RAND_MAX.
+  //
+  ImageSize = (UINTN) ImageContext.ImageSize;
+  Relocated = (UINT8 *) (UINTN) ImageContext.ImageAddress;
+  RelocDir  = TestGetRelocDir (&ImageContext, &ImageBase32, &ImageBase64);
+  UT_ASSERT_NOT_NULL (RelocDir);
+  for (Index = 0; Index < ImageSize / 64; Index++) {
+    Offset = ((Index * 4099) % (ImageSize / sizeof (UINT64))) * sizeof (UINT64);
+    if ((Offset >= ImageContext.SizeOfHeaders) &&
+        ((Offset + sizeof (UINT64) <= RelocDir->VirtualAddress) || (Offset >= RelocDir->VirtualAddress + RelocDir->Size))) {
+      *(UINT64 *) (Relocated + Offset) = rand ();
+    }
+  }
+
+  Updated = AllocateCopyPool (ImageSize, Relocated);
+  UT_ASSERT_NOT_NULL (Updated);
+
+  VirtImageBase = ImageContext.ImageAddress + 0x7FF000000000ULL;
+  PeCoffLoaderRelocateImageForRuntime (ImageContext.ImageAddress, VirtImageBase, ImageSize, ImageContext.FixupData);
+  Expected = AllocateCopyPool (ImageSize, Relocated);
+  UT_ASSERT_NOT_NULL (Expected);
+
+  CopyMem (Relocated, Updated, ImageSize);
+  PeCoffLoaderRelocateImageForRuntime (ImageContext.ImageAddress, VirtImageBase, ImageSize, Table);
+  Result = (BOOLEAN) (CompareMem (Expected, Relocated, ImageSize) == 0);
+
+  TestUnloadRuntimeImage (&ImageContext, Table);
+  FreePool (Updated);
+  FreePool (Expected);
+  UT_ASSERT_TRUE (Result);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the runtime relocation tables of the test images and of the
+  images given on the command line are reapplied as their FixupData buffers
+  are.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The tables were reapplied as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A table was reapplied wrongly.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RuntimeTablesAreApplied (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_IMAGE        Image;
+  UINTN             Index;
+  UNIT_TEST_STATUS  Status;
+
+  Status = TestCheckRuntimeTable (&mPe32Image);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  Status = TestCheckRuntimeTable (&mPe32PlusImage);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  for (Index = 1; Index < mTestArgc; Index++) {
+    Image.Name = mTestArgv[Index];
+    UT_ASSERT_TRUE (TestReadImage (&Image));
+    Status = TestCheckRuntimeTable (&Image);
+    FreePool (Image.File);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Returns the number of microseconds between two clocks.
+
+  @param  Start   The clock at the start of the run.
+  @param  End     The clock at the end of the run.
+
+  @return The number of microseconds, at least 1.
+
+**/
+UINT64
+TestMicroseconds (
+  IN clock_t  Start,
+  IN clock_t  End
+  )
+{
+  return MAX (DivU64x32 (MultU64x32 ((UINT64) (End - Start), 1000000), CLOCKS_PER_SEC), 1);
+}
+
+/**
+  Reports the size of the runtime relocation table of an image and the time to
+  reapply it, against those of the FixupData buffer of the image.
+
+  @param  Image       The image to benchmark.
+  @param  Iterations  The number of times to reapply the relocations.
+
+  @retval UNIT_TEST_PASSED       The size and the time were reported.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The table could not be built.
+
+**/
+UNIT_TEST_STATUS
+TestBenchmarkRuntimeTable (
+  IN TEST_IMAGE  *Image,
+  IN UINTN       Iterations
+  )
+{
+  PE_COFF_LOADER_IMAGE_CONTEXT  ImageContext;
+  VOID                          *Table;
+  UINTN                         TableSize;
+  VOID                          *Relocated;
+  UINTN                         ImageSize;
+  UINTN                         Index;
+  clock_t                       Start;
+  UINT64                        CopyTime;
+  UINT64                        TableTime;
+  UINT64                        FixupDataTime;
+
+  UT_ASSERT_TRUE (TestLoadRuntimeImage (Image, &ImageContext, &Table, &TableSize));
+  ImageSize = (UINTN) ImageContext.ImageSize;
+  Relocated = AllocateCopyPool (ImageSize, (VOID *) (UINTN) ImageContext.ImageAddress);
+  if (Relocated == NULL) {
+    TestUnloadRuntimeImage (&ImageContext, Table);
+    UT_ASSERT_NOT_NULL (Relocated);
+  }
+
+  //
+  // Each iteration restores the image as relocated at load time, so the time
+  // to restore it is measured first and subtracted.
+  //
+  Start = clock ();
+  for (Index = 0; Index < Iterations; Index++) {
+    CopyMem ((VOID *) (UINTN) ImageContext.ImageAddress, Relocated, ImageSize);
+  }
+  CopyTime = TestMicroseconds (Start, clock ());
+
+  Start = clock ();
+  for (Index = 0; Index < Iterations; Index++) {
+    CopyMem ((VOID *) (UINTN) ImageContext.ImageAddress, Relocated, ImageSize);
+    PeCoffLoaderRelocateImageForRuntime (ImageContext.ImageAddress, ImageContext.ImageAddress + SIZE_1GB, ImageSize, Table);
+  }
+  TableTime = TestMicroseconds (Start, clock ());
+
+  Start = clock ();
+  for (Index = 0; Index < Iterations; Index++) {
+    CopyMem ((VOID *) (UINTN) ImageContext.ImageAddress, Relocated, ImageSize);
+    PeCoffLoaderRelocateImageForRuntime (ImageContext.ImageAddress, ImageContext.ImageAddress + SIZE_1GB, ImageSize, ImageContext.FixupData);
+  }
+  FixupDataTime = TestMicroseconds (Start, clock ());
+
+  TableTime     = (TableTime > CopyTime) ? TableTime - CopyTime : 0;
+  FixupDataTime = (FixupDataTime > CopyTime) ? FixupDataTime - CopyTime : 0;
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: runtime table %d bytes, reapply %d us; FixupData %d bytes, reapply %d us\n",
+    Image->Name,
+    (UINT32) TableSize,
+    (UINT32) DivU64x64Remainder (TableTime, Iterations, NULL),
+    (UINT32) ImageContext.FixupDataSize,
+    (UINT32) DivU64x64Remainder (FixupDataTime, Iterations, NULL)
+    ));
+
+  FreePool (Relocated);
+  TestUnloadRuntimeImage (&ImageContext, Table);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reports the time to load and to relocate an image, and the size and the
+  time to reapply its runtime relocation table.
+
+  @param  Image   The image to benchmark.
+
+  @retval UNIT_TEST_PASSED       The time was reported.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The image could not be loaded or relocated.
+
+**/
+UNIT_TEST_STATUS
+TestBenchmarkImage (
+  IN TEST_IMAGE  *Image
+  )
+{
+  PE_COFF_LOADER_IMAGE_CONTEXT  ImageContext;
+  UINTN                         FixupCount;
+  UINTN                         Iterations;
+  UINTN                         Index;
+  clock_t                       Start;
+  UINT64                        LoadTime;
+  UINT64                        RelocateTime;
+  BOOLEAN                       Result;
+
+  UT_ASSERT_TRUE (TestLoadImage (Image, &ImageContext));
+
+  //
+  // Count the fixups by relocating the image to where it is
+  //
+  Result = TestRelocateImage (&ImageContext, ImageContext.ImageAddress, NULL, &FixupCount);
+  Iterations = BENCHMARK_FIXUPS / MAX (FixupCount, 1);
+  Iterations = MAX (Iterations, 1);
+
+  Start = clock ();
+  for (Index = 0; Index < Iterations && Result; Index++) {
+    Result = (BOOLEAN) (PeCoffLoaderLoadImage (&ImageContext) == RETURN_SUCCESS);
+  }
+  LoadTime = TestMicroseconds (Start, clock ());
+
+  Start = clock ();
+  for (Index = 0; Index < Iterations && Result; Index++) {
+    ImageContext.DestinationAddress = ImageContext.ImageAddress + (Index & 1) * SIZE_1GB;
+    Result = (BOOLEAN) (PeCoffLoaderRelocateImage (&ImageContext) == RETURN_SUCCESS);
+  }
+  RelocateTime = TestMicroseconds (Start, clock ());
+
+  TestUnloadImage (&ImageContext);
+  UT_ASSERT_TRUE (Result);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: %d KB, %d fixups, load %d us, relocate %d us, %d fixups/us\n",
+    Image->Name,
+    (UINT32) (Image->FileSize / SIZE_1KB),
+    (UINT32) FixupCount,
+    (UINT32) DivU64x64Remainder (LoadTime, Iterations, NULL),
+    (UINT32) DivU64x64Remainder (RelocateTime, Iterations, NULL),
+    (UINT32) DivU64x64Remainder (MultU64x64 (FixupCount, Iterations), RelocateTime, NULL)
+    ));
+
+  return TestBenchmarkRuntimeTable (Image, Iterations);
+}
+
+/**
+  Reports the time to load and to relocate the test images and the images
+  given on the command line, and the size and the time to reapply their
+  runtime relocation tables.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The times were reported.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  An image could not be loaded or relocated.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Benchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_IMAGE        Image;
+  UINTN             Index;
+  UNIT_TEST_STATUS  Status;
+
+  Status = TestBenchmarkImage (&mPe32Image);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  Status = TestBenchmarkImage (&mPe32PlusImage);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  for (Index = 1; Index < mTestArgc; Index++) {
+    Image.Name = mTestArgv[Index];
+    UT_ASSERT_TRUE (TestReadImage (&Image));
+    Status = TestBenchmarkImage (&Image);
+    FreePool (Image.File);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Builds the test images.
+
+  @param  Context                Unused.
+
+  @retval UNIT_TEST_PASSED       The images were built.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BuildImages (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  srand (0x1234);
+  if (!TestBuildImage (&mPe32Image, EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) ||
+      !TestBuildImage (&mPe32PlusImage, EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the test images.
+
+  @param  Context                Unused.
+
+**/
+VOID
+EFIAPI
+FreeImages (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mPe32Image.File != NULL) {
+    FreePool (mPe32Image.File);
+    mPe32Image.File = NULL;
+  }
+
+  if (mPe32PlusImage.File != NULL) {
+    FreePool (mPe32PlusImage.File);
+    mPe32PlusImage.File = NULL;
+  }
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  BasePeCoffLib and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PeCoffTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&PeCoffTests, Framework, "BasePeCoffLib Relocation", "MdePkg.BasePeCoffLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PeCoffTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description---------------------------------------Class Name-------------Function-------------Pre----------Post--------Context
+  AddTestCase (PeCoffTests, "A PE32 image is relocated as its records say", "Pe32IsRelocated", Pe32IsRelocated, BuildImages, FreeImages, NULL);
+  AddTestCase (PeCoffTests, "A PE32+ image is relocated as its records say", "Pe32PlusIsRelocated", Pe32PlusIsRelocated, BuildImages, FreeImages, NULL);
+  AddTestCase (PeCoffTests, "The given images are relocated as their records say", "ImagesAreRelocated", ImagesAreRelocated, NULL, NULL, NULL);
+  AddTestCase (PeCoffTests, "Runtime relocation tables are reapplied as FixupData is", "RuntimeTablesAreApplied", RuntimeTablesAreApplied, BuildImages, FreeImages, NULL);
+  AddTestCase (PeCoffTests, "Time to load and relocate images", "Benchmark", Benchmark, BuildImages, FreeImages, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  The arguments are the paths of PE/COFF images to check and benchmark in
+  addition to the test images.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  mTestArgc = (UINTN) argc;
+  mTestArgv = argv;
+  return UnitTestingEntry ();
+}
@@ -825,8 +825,7 @@ AddImageExeInfo (
 
   @param[in]  Certificate       Pointer to X.509 Certificate that is searched for.
   @param[in]  CertSize          Size of X.509 Certificate.
-  @param[in]  SignatureList     Pointer to the Signature List in forbidden database.
-  @param[in]  SignatureListSize Size of Signature List.
+  @param[in]  Dbx               The forbidden database, which must exist.
   @param[out] RevocationTime    Return the time that the certificate was revoked.
   @param[out] IsFound           Search result. Only valid if EFI_SUCCESS returned.
 
@@ -838,34 +837,20 @@ EFI_STATUS
 IsCertHashFoundInDbx (
   IN  UINT8               *Certificate,
   IN  UINTN               CertSize,
-  IN  EFI_SIGNATURE_LIST  *SignatureList,
-  IN  UINTN               SignatureListSize,
+  IN  SIGNATURE_DATABASE  *Dbx,
   OUT EFI_TIME            *RevocationTime,
   OUT BOOLEAN             *IsFound
   )
 {
   EFI_STATUS          Status;
-  EFI_SIGNATURE_LIST  *DbxList;
-  UINTN               DbxSize;
   EFI_SIGNATURE_DATA  *CertHash;
-  UINTN               CertHashCount;
-  UINTN               Index;
-  UINT32              HashAlg;
-  VOID                *HashCtx;
-  UINT8               CertDigest[MAX_DIGEST_SIZE];
-  UINT8               *DbxCertHash;
-  UINTN               SiglistHeaderSize;
+  UINTN               DigestSize;
   UINT8               *TBSCert;
   UINTN               TBSCertSize;
 
-  Status   = EFI_ABORTED;
   *IsFound = FALSE;
-  DbxList  = SignatureList;
-  DbxSize  = SignatureListSize;
-  HashCtx  = NULL;
-  HashAlg  = HASHALG_MAX;
 
-  if ((RevocationTime == NULL) || (DbxList == NULL)) {
+  if ((RevocationTime == NULL) || (Dbx == NULL) || EFI_ERROR (Dbx->Status)) {
     return EFI_INVALID_PARAMETER;
   }
 
@@ -873,91 +858,33 @@ IsCertHashFoundInDbx (
   // Retrieve the TBSCertificate from the X.509 Certificate.
   //
   if (!X509GetTBSCert (Certificate, CertSize, &TBSCert, &TBSCertSize)) {
+    return EFI_ABORTED;
+  }
+
+  Status = FindCertHashInDatabase (Dbx, TBSCert, TBSCertSize, &CertHash, &DigestSize);
+  if (EFI_ERROR (Status)) {
     return Status;
   }
 
-  while ((DbxSize > 0) && (SignatureListSize >= DbxList->SignatureListSize)) {
+  if (CertHash != NULL) {
     //
-    // Determine Hash Algorithm of Certificate in the forbidden database.
+    // Hash of Certificate is found in forbidden database.
     //
-    if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha256Guid)) {
-      HashAlg = HASHALG_SHA256;
-    } else if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha384Guid)) {
-      HashAlg = HASHALG_SHA384;
-    } else if (CompareGuid (&DbxList->SignatureType, &gEfiCertX509Sha512Guid)) {
-      HashAlg = HASHALG_SHA512;
-    } else {
-      DbxSize -= DbxList->SignatureListSize;
-      DbxList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) DbxList + DbxList->SignatureListSize);
-      continue;
-    }
+    *IsFound = TRUE;
 
     //
-    // Calculate the hash value of current TBSCertificate for comparision.
+    // Return the revocation time.
     //
-    if (mHash[HashAlg].GetContextSize == NULL) {
-      goto Done;
-    }
-    ZeroMem (CertDigest, MAX_DIGEST_SIZE);
-    HashCtx = AllocatePool (mHash[HashAlg].GetContextSize ());
-    if (HashCtx == NULL) {
-      goto Done;
-    }
-    if (!mHash[HashAlg].HashInit (HashCtx)) {
-      goto Done;
-    }
-    if (!mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize)) {
-      goto Done;
-    }
-    if (!mHash[HashAlg].HashFinal (HashCtx, CertDigest)) {
-      goto Done;
-    }
-
-    FreePool (HashCtx);
-    HashCtx = NULL;
-
-    SiglistHeaderSize = sizeof (EFI_SIGNATURE_LIST) + DbxList->SignatureHeaderSize;
-    CertHash          = (EFI_SIGNATURE_DATA *) ((UINT8 *) DbxList + SiglistHeaderSize);
-    CertHashCount     = (DbxList->SignatureListSize - SiglistHeaderSize) / DbxList->SignatureSize;
-    for (Index = 0; Index < CertHashCount; Index++) {
-      //
-      // Iterate each Signature Data Node within this CertList for verify.
-      //
-      DbxCertHash = CertHash->SignatureData;
-      if (CompareMem (DbxCertHash, CertDigest, mHash[HashAlg].DigestLength) == 0) {
-        //
-        // Hash of Certificate is found in forbidden database.
-        //
-        Status   = EFI_SUCCESS;
-        *IsFound = TRUE;
-
-        //
-        // Return the revocation time.
-        //
-        CopyMem (RevocationTime, (EFI_TIME *)(DbxCertHash + mHash[HashAlg].DigestLength), sizeof (EFI_TIME));
-        goto Done;
-      }
-      CertHash = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertHash + DbxList->SignatureSize);
-    }
-
-    DbxSize -= DbxList->SignatureListSize;
-    DbxList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) DbxList + DbxList->SignatureListSize);
-  }
-
-  Status = EFI_SUCCESS;
-
-Done:
-  if (HashCtx != NULL) {
-    FreePool (HashCtx);
+    CopyMem (RevocationTime, (EFI_TIME *)(CertHash->SignatureData + DigestSize), sizeof (EFI_TIME));
   }
 
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
   Check whether signature is in specified database.
 
-  @param[in]  VariableName        Name of database variable that is searched in.
+  @param[in]  Database            The database that is searched in.
   @param[in]  Signature           Pointer to signature that is searched for.
   @param[in]  CertType            Pointer to hash algorithm.
   @param[in]  SignatureSize       Size of Signature.
@@ -969,89 +896,46 @@ Done:
 **/
 EFI_STATUS
 IsSignatureFoundInDatabase (
-  IN  CHAR16            *VariableName,
-  IN  UINT8             *Signature,
-  IN  EFI_GUID          *CertType,
-  IN  UINTN             SignatureSize,
-  OUT BOOLEAN           *IsFound
+  IN  SIGNATURE_DATABASE  *Database,
+  IN  UINT8               *Signature,
+  IN  EFI_GUID            *CertType,
+  IN  UINTN               SignatureSize,
+  OUT BOOLEAN             *IsFound
   )
 {
-  EFI_STATUS          Status;
   EFI_SIGNATURE_LIST  *CertList;
   EFI_SIGNATURE_DATA  *Cert;
-  UINTN               DataSize;
-  UINT8               *Data;
-  UINTN               Index;
-  UINTN               CertCount;
 
-  //
-  // Read signature database variable.
-  //
-  *IsFound  = FALSE;
-  Data      = NULL;
-  DataSize  = 0;
-  Status    = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    if (Status == EFI_NOT_FOUND) {
+  *IsFound = FALSE;
+  if (EFI_ERROR (Database->Status)) {
+    if (Database->Status == EFI_NOT_FOUND) {
       //
       // No database, no need to search.
       //
-      Status = EFI_SUCCESS;
+      return EFI_SUCCESS;
     }
 
-    return Status;
-  }
-
-  Data = (UINT8 *) AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+    return Database->Status;
   }
 
-  Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
   //
-  // Enumerate all signature data in SigDB to check if signature exists for executable.
+  // Look the signature up in the index of the database.
   //
-  CertList = (EFI_SIGNATURE_LIST *) Data;
-  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
-    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
-    Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-    if ((CertList->SignatureSize == sizeof(EFI_SIGNATURE_DATA) - 1 + SignatureSize) && (CompareGuid(&CertList->SignatureType, CertType))) {
-      for (Index = 0; Index < CertCount; Index++) {
-        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
-          //
-          // Find the signature in database.
-          //
-          *IsFound = TRUE;
-          //
-          // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
-          //
-          if (StrCmp(VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
-            SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
-          }
-          break;
-        }
-
-        Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
-      }
-
-      if (*IsFound) {
-        break;
-      }
+  Cert = FindSignatureInDatabase (Database, CertType, Signature, SignatureSize, &CertList);
+  if (Cert != NULL) {
+    //
+    // Find the signature in database.
+    //
+    *IsFound = TRUE;
+    //
+    // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
+    //
+    if (Database == &mDb) {
+      SecureBootHook (Database->VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
     }
-
-    DataSize -= CertList->SignatureListSize;
-    CertList = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
   }
 
-Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -1269,11 +1153,8 @@ IsForbiddenByDbx (
   //
   // The image will not be forbidden if dbx can't be got.
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    if (Status == EFI_NOT_FOUND) {
+  if (EFI_ERROR (mDbx.Status)) {
+    if (mDbx.Status == EFI_NOT_FOUND) {
       //
       // Evidently not in dbx if the database doesn't exist.
       //
@@ -1281,15 +1162,8 @@ IsForbiddenByDbx (
     }
     return IsForbidden;
   }
-  Data = (UINT8 *) AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return IsForbidden;
-  }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *) Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
+  Data     = mDbx.Data;
+  DataSize = mDbx.DataSize;
 
   //
   // Verify image signature with RAW X509 certificates in DBX database.
@@ -1368,7 +1242,7 @@ IsForbiddenByDbx (
     //
     CertPtr = CertPtr + sizeof (UINT32) + CertSize;
 
-    Status = IsCertHashFoundInDbx (Cert, CertSize, (EFI_SIGNATURE_LIST *)Data, DataSize, &RevocationTime, &IsFound);
+    Status = IsCertHashFoundInDbx (Cert, CertSize, &mDbx, &RevocationTime, &IsFound);
     if (EFI_ERROR (Status)) {
       //
       // Error in searching dbx. Consider it as 'found'. RevocationTime might
@@ -1398,10 +1272,6 @@ IsForbiddenByDbx (
   IsForbidden = FALSE;
 
 Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
   Pkcs7FreeSigners (CertBuffer);
   Pkcs7FreeSigners (TrustedCert);
 
@@ -1436,67 +1306,32 @@ IsAllowedByDb (
   UINTN                     RootCertSize;
   UINTN                     Index;
   UINTN                     CertCount;
-  UINTN                     DbxDataSize;
-  UINT8                     *DbxData;
   EFI_TIME                  RevocationTime;
 
   Data              = NULL;
   CertList          = NULL;
   CertData          = NULL;
   RootCert          = NULL;
-  DbxData           = NULL;
   RootCertSize      = 0;
   VerifyStatus      = FALSE;
 
   //
-  // Fetch 'db' content. If 'db' doesn't exist or encounters problem to get the
+  // Use 'db' content. If 'db' doesn't exist or encounters problem to get the
   // data, return not-allowed-by-db (FALSE).
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    return VerifyStatus;
-  }
-
-  Data = (UINT8 *) AllocateZeroPool (DataSize);
-  if (Data == NULL) {
+  if (EFI_ERROR (mDb.Status)) {
     return VerifyStatus;
   }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *) Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
+  Data     = mDb.Data;
+  DataSize = mDb.DataSize;
 
   //
-  // Fetch 'dbx' content. If 'dbx' doesn't exist, continue to check 'db'.
+  // Use 'dbx' content. If 'dbx' doesn't exist, continue to check 'db'.
   // If any other errors occurred, no need to check 'db' but just return
   // not-allowed-by-db (FALSE) to avoid bypass.
   //
-  DbxDataSize = 0;
-  Status      = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    if (Status != EFI_NOT_FOUND) {
-      goto Done;
-    }
-    //
-    // 'dbx' does not exist. Continue to check 'db'.
-    //
-  } else {
-    //
-    // 'dbx' exists. Get its content.
-    //
-    DbxData = (UINT8 *) AllocateZeroPool (DbxDataSize);
-    if (DbxData == NULL) {
-      goto Done;
-    }
-
-    Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, (VOID *) DbxData);
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
+  if (EFI_ERROR (mDbx.Status) && (mDbx.Status != EFI_NOT_FOUND)) {
+    return VerifyStatus;
   }
 
   //
@@ -1530,11 +1365,11 @@ IsAllowedByDb (
           //
           // The image is signed and its signature is found in 'db'.
           //
-          if (DbxData != NULL) {
+          if (!EFI_ERROR (mDbx.Status)) {
             //
             // Here We still need to check if this RootCert's Hash is revoked
             //
-            Status = IsCertHashFoundInDbx (RootCert, RootCertSize, (EFI_SIGNATURE_LIST *)DbxData, DbxDataSize, &RevocationTime, &IsFound);
+            Status = IsCertHashFoundInDbx (RootCert, RootCertSize, &mDbx, &RevocationTime, &IsFound);
             if (EFI_ERROR (Status)) {
               //
               // Error in searching dbx. Consider it as 'found'. RevocationTime might
@@ -1575,13 +1410,6 @@ Done:
     SecureBootHook (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, CertData);
   }
 
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-  if (DbxData != NULL) {
-    FreePool (DbxData);
-  }
-
   return VerifyStatus;
 }
 
@@ -1803,6 +1631,13 @@ DxeImageVerificationHandler (
     }
   }
 
+  //
+  // Read db and dbx once for all the checks of this image. They are parsed
+  // again only if they were updated since the last image was verified.
+  //
+  RefreshSignatureDatabase (&mDb);
+  RefreshSignatureDatabase (&mDbx);
+
   //
   // Start Image Validation.
   //
@@ -1817,7 +1652,7 @@ DxeImageVerificationHandler (
     }
 
     DbStatus = IsSignatureFoundInDatabase (
-                 EFI_IMAGE_SECURITY_DATABASE1,
+                 &mDbx,
                  mImageDigest,
                  &mCertType,
                  mImageDigestSize,
@@ -1832,7 +1667,7 @@ DxeImageVerificationHandler (
     }
 
     DbStatus = IsSignatureFoundInDatabase (
-                 EFI_IMAGE_SECURITY_DATABASE,
+                 &mDb,
                  mImageDigest,
                  &mCertType,
                  mImageDigestSize,
@@ -1933,7 +1768,7 @@ DxeImageVerificationHandler (
     // Check the image's hash value.
     //
     DbStatus = IsSignatureFoundInDatabase (
-                 EFI_IMAGE_SECURITY_DATABASE1,
+                 &mDbx,
                  mImageDigest,
                  &mCertType,
                  mImageDigestSize,
@@ -1948,7 +1783,7 @@ DxeImageVerificationHandler (
 
     if (!IsVerified) {
       DbStatus = IsSignatureFoundInDatabase (
-                   EFI_IMAGE_SECURITY_DATABASE,
+                   &mDb,
                    mImageDigest,
                    &mCertType,
                    mImageDigestSize,
@@ -198,4 +198,141 @@ typedef struct {
   HASH_FINAL               HashFinal;
 } HASH_TABLE;
 
+extern HASH_TABLE          mHash[];
+
+//
+// A signature in the hash index of a signature database.
+//
+typedef struct {
+  EFI_SIGNATURE_LIST       *SignatureList;
+  EFI_SIGNATURE_DATA       *Signature;
+} SIGNATURE_DATABASE_ENTRY;
+
+//
+// Signature database (db or dbx) read once for each image verification,
+// and parsed again only when its content changed. The hash and the
+// X.509 certificate hash signatures are indexed by their value.
+//
+typedef struct {
+  //
+  // Name of the signature database variable.
+  //
+  CHAR16                   *VariableName;
+  //
+  // Status of the last read of the variable. EFI_NOT_FOUND if the
+  // database doesn't exist.
+  //
+  EFI_STATUS               Status;
+  //
+  // Content of the variable, valid if Status is EFI_SUCCESS.
+  //
+  UINT8                    *Data;
+  UINTN                    DataSize;
+  UINTN                    DataBufferSize;
+  //
+  // Buffer the variable is read into, to be compared with Data.
+  //
+  UINT8                    *Buffer;
+  UINTN                    BufferSize;
+  //
+  // Hash index of the signatures, with linear probing.
+  //
+  SIGNATURE_DATABASE_ENTRY *Entries;
+  UINTN                    EntryCount;
+  //
+  // Bit mask of the HASHALG_* of the X.509 certificate hash signature
+  // lists in the database.
+  //
+  UINT32                   CertHashAlgs;
+} SIGNATURE_DATABASE;
+
+extern SIGNATURE_DATABASE  mDb;
+extern SIGNATURE_DATABASE  mDbx;
+
+/**
+  Read a signature database variable, and parse it again if its content
+  changed since it was last read.
+
+  The status of the read is also kept in Database->Status.
+
+  @param[in, out]  Database      The signature database.
+
+  @retval EFI_SUCCESS            The signature database is up to date.
+  @retval EFI_NOT_FOUND          The signature database variable doesn't exist.
+  @retval EFI_OUT_OF_RESOURCES   No enough memory to read or index the database.
+  @retval Others                 The variable can't be read.
+
+**/
+EFI_STATUS
+RefreshSignatureDatabase (
+  IN OUT SIGNATURE_DATABASE  *Database
+  );
+
+/**
+  Find a signature in a signature database by its value.
+
+  For the X.509 certificate hash signature types, the value is the hash of
+  the certificate, and the revocation time follows it in the signature.
+
+  @param[in]  Database          The signature database.
+  @param[in]  SignatureType     The type of the signature list.
+  @param[in]  Value             The value of the signature.
+  @param[in]  ValueSize         The size of the value.
+  @param[out] SignatureList     The signature list the signature was found in.
+
+  @return The first signature of the database with this type and value, or
+          NULL if there is none.
+
+**/
+EFI_SIGNATURE_DATA *
+FindSignatureInDatabase (
+  IN  SIGNATURE_DATABASE    *Database,
+  IN  EFI_GUID              *SignatureType,
+  IN  UINT8                 *Value,
+  IN  UINTN                 ValueSize,
+  OUT EFI_SIGNATURE_LIST    **SignatureList
+  );
+
+/**
+  Find the hash of an X.509 certificate in a signature database.
+
+  The TBSCertificate is hashed with each hash algorithm of the X.509
+  certificate hash signature lists in the database.
+
+  @param[in]  Database          The signature database.
+  @param[in]  TBSCert           The TBSCertificate of the X.509 certificate.
+  @param[in]  TBSCertSize       The size of the TBSCertificate.
+  @param[out] CertHash          The first certificate hash signature of the
+                                database matching the certificate, or NULL if
+                                there is none. The revocation time follows the
+                                hash in the signature.
+  @param[out] DigestSize        The size of the hash in CertHash.
+
+  @retval EFI_SUCCESS           The database was searched.
+  @retval EFI_ABORTED           The certificate can't be hashed.
+
+**/
+EFI_STATUS
+FindCertHashInDatabase (
+  IN  SIGNATURE_DATABASE    *Database,
+  IN  UINT8                 *TBSCert,
+  IN  UINTN                 TBSCertSize,
+  OUT EFI_SIGNATURE_DATA    **CertHash,
+  OUT UINTN                 *DigestSize
+  );
+
+/**
+  Get the hash algorithm of an X.509 certificate hash signature type.
+
+  @param[in]  SignatureType     The type of the signature list.
+
+  @return The HASHALG_* of the signature type, or HASHALG_MAX if it isn't
+          an X.509 certificate hash signature type.
+
+**/
+UINT32
+GetCertHashAlg (
+  IN EFI_GUID               *SignatureType
+  );
+
 #endif
@@ -0,0 +1,469 @@
+/** @file
+  Keep the signature databases db and dbx parsed and indexed between image
+  verifications.
+
+  Caution: This file requires additional review when modified.
+  The signature databases are read from variables, and each of their signature
+  lists is validated against the size of the database before use.
+
+Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeImageVerificationLib.h"
+
+SIGNATURE_DATABASE  mDb  = { EFI_IMAGE_SECURITY_DATABASE,  EFI_NOT_FOUND };
+SIGNATURE_DATABASE  mDbx = { EFI_IMAGE_SECURITY_DATABASE1, EFI_NOT_FOUND };
+
+//
+// Types of the X.509 certificate hash signatures.
+//
+STATIC EFI_GUID *mCertHashType[] = {
+  &gEfiCertX509Sha256Guid,
+  &gEfiCertX509Sha384Guid,
+  &gEfiCertX509Sha512Guid
+};
+
+/**
+  Get the hash algorithm of an X.509 certificate hash signature type.
+
+  @param[in]  SignatureType     The type of the signature list.
+
+  @return The HASHALG_* of the signature type, or HASHALG_MAX if it isn't
+          an X.509 certificate hash signature type.
+
+**/
+UINT32
+GetCertHashAlg (
+  IN EFI_GUID               *SignatureType
+  )
+{
+  if (CompareGuid (SignatureType, &gEfiCertX509Sha256Guid)) {
+    return HASHALG_SHA256;
+  } else if (CompareGuid (SignatureType, &gEfiCertX509Sha384Guid)) {
+    return HASHALG_SHA384;
+  } else if (CompareGuid (SignatureType, &gEfiCertX509Sha512Guid)) {
+    return HASHALG_SHA512;
+  }
+
+  return HASHALG_MAX;
+}
+
+/**
+  Get the size of the value the signatures of a signature list are indexed by.
+
+  @param[in]  SignatureList     The signature list.
+
+  @return The size of the value of the signatures, or 0 if the signatures
+          of the list are not indexed.
+
+**/
+STATIC
+UINTN
+GetSignatureValueSize (
+  IN EFI_SIGNATURE_LIST     *SignatureList
+  )
+{
+  UINT32                    HashAlg;
+  UINTN                     ValueSize;
+
+  if (SignatureList->SignatureSize <= sizeof (EFI_GUID) ||
+      CompareGuid (&SignatureList->SignatureType, &gEfiCertX509Guid)) {
+    //
+    // The X.509 certificates are verified one by one.
+    //
+    return 0;
+  }
+
+  HashAlg = GetCertHashAlg (&SignatureList->SignatureType);
+  if (HashAlg == HASHALG_MAX) {
+    return SignatureList->SignatureSize - sizeof (EFI_GUID);
+  }
+
+  //
+  // The hash of the certificate is followed by its revocation time.
+  //
+  ValueSize = mHash[HashAlg].DigestLength;
+  if (SignatureList->SignatureSize < sizeof (EFI_GUID) + ValueSize + sizeof (EFI_TIME)) {
+    return 0;
+  }
+
+  return ValueSize;
+}
+
+/**
+  Compute the hash of the value of a signature.
+
+  @param[in]  Value             The value of the signature.
+  @param[in]  ValueSize         The size of the value.
+
+  @return The hash of the value.
+
+**/
+STATIC
+UINT32
+HashSignatureValue (
+  IN UINT8                  *Value,
+  IN UINTN                  ValueSize
+  )
+{
+  UINT32                    Hash;
+  UINTN                     Index;
+
+  //
+  // FNV-1a
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < ValueSize; Index++) {
+    Hash = (Hash ^ Value[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+  Count or index the signatures of the well formed signature lists of a
+  signature database.
+
+  The lists are walked in the order they are in the database, until one of
+  them doesn't fit in the rest of the database.
+
+  @param[in]       Database     The signature database.
+  @param[in, out]  Count        If Count is not NULL, the number of signatures
+                                to be indexed is added to it.
+  @param[in]       Index        If TRUE, the signatures of the lists are added
+                                to the hash index of the database.
+
+**/
+STATIC
+VOID
+WalkSignatureDatabase (
+  IN     SIGNATURE_DATABASE  *Database,
+  IN OUT UINTN               *Count,    OPTIONAL
+  IN     BOOLEAN             Index
+  )
+{
+  EFI_SIGNATURE_LIST        *CertList;
+  EFI_SIGNATURE_DATA        *Cert;
+  UINTN                     DataSize;
+  UINTN                     HeaderSize;
+  UINTN                     CertCount;
+  UINTN                     CertIndex;
+  UINTN                     ValueSize;
+  UINT32                    HashAlg;
+  UINTN                     Slot;
+
+  CertList = (EFI_SIGNATURE_LIST *) Database->Data;
+  DataSize = Database->DataSize;
+  while ((DataSize >= sizeof (EFI_SIGNATURE_LIST)) && (DataSize >= CertList->SignatureListSize)) {
+    HeaderSize = sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize;
+    if ((CertList->SignatureListSize < HeaderSize) || (CertList->SignatureHeaderSize > CertList->SignatureListSize) ||
+        (CertList->SignatureSize == 0)) {
+      break;
+    }
+
+    ValueSize = GetSignatureValueSize (CertList);
+    if (ValueSize != 0) {
+      CertCount = (CertList->SignatureListSize - HeaderSize) / CertList->SignatureSize;
+      if (Count != NULL) {
+        *Count += CertCount;
+      }
+
+      HashAlg = GetCertHashAlg (&CertList->SignatureType);
+      if (Index && (HashAlg != HASHALG_MAX)) {
+        Database->CertHashAlgs |= (1 << HashAlg);
+      }
+
+      Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + HeaderSize);
+      for (CertIndex = 0; Index && (CertIndex < CertCount); CertIndex++) {
+        Slot = HashSignatureValue (Cert->SignatureData, ValueSize) & (Database->EntryCount - 1);
+        while (Database->Entries[Slot].SignatureList != NULL) {
+          Slot = (Slot + 1) & (Database->EntryCount - 1);
+        }
+
+        Database->Entries[Slot].SignatureList = CertList;
+        Database->Entries[Slot].Signature     = Cert;
+        Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+      }
+    }
+
+    DataSize -= CertList->SignatureListSize;
+    CertList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+  }
+}
+
+/**
+  Index the signatures of a signature database by their value.
+
+  @param[in, out]  Database      The signature database.
+
+  @retval EFI_SUCCESS            The signatures were indexed.
+  @retval EFI_OUT_OF_RESOURCES   No enough memory to index the signatures.
+
+**/
+STATIC
+EFI_STATUS
+IndexSignatureDatabase (
+  IN OUT SIGNATURE_DATABASE  *Database
+  )
+{
+  UINTN                     Count;
+  UINTN                     EntryCount;
+
+  Database->CertHashAlgs = 0;
+
+  Count = 0;
+  WalkSignatureDatabase (Database, &Count, FALSE);
+
+  //
+  // Keep more than half of the entries free to keep the probes short.
+  //
+  EntryCount = 0;
+  if (Count != 0) {
+    EntryCount = (UINTN) GetPowerOfTwo64 (Count) * 4;
+  }
+
+  if (EntryCount > Database->EntryCount) {
+    if (Database->Entries != NULL) {
+      FreePool (Database->Entries);
+    }
+    Database->EntryCount = 0;
+    Database->Entries    = AllocatePool (EntryCount * sizeof (SIGNATURE_DATABASE_ENTRY));
+    if (Database->Entries == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Database->EntryCount = EntryCount;
+  if (EntryCount != 0) {
+    ZeroMem (Database->Entries, EntryCount * sizeof (SIGNATURE_DATABASE_ENTRY));
+    WalkSignatureDatabase (Database, NULL, TRUE);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Read a signature database variable, and parse it again if its content
+  changed since it was last read.
+
+  The status of the read is also kept in Database->Status.
+
+  @param[in, out]  Database      The signature database.
+
+  @retval EFI_SUCCESS            The signature database is up to date.
+  @retval EFI_NOT_FOUND          The signature database variable doesn't exist.
+  @retval EFI_OUT_OF_RESOURCES   No enough memory to read or index the database.
+  @retval Others                 The variable can't be read.
+
+**/
+EFI_STATUS
+RefreshSignatureDatabase (
+  IN OUT SIGNATURE_DATABASE  *Database
+  )
+{
+  EFI_STATUS                Status;
+  UINTN                     Size;
+  UINT8                     *Buffer;
+  UINTN                     BufferSize;
+
+  Size   = Database->BufferSize;
+  Status = gRT->GetVariable (Database->VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &Size, Database->Buffer);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    if (Database->Buffer != NULL) {
+      FreePool (Database->Buffer);
+    }
+    Database->BufferSize = 0;
+    Database->Buffer     = AllocatePool (Size);
+    if (Database->Buffer == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Database->BufferSize = Size;
+      Status = gRT->GetVariable (Database->VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &Size, Database->Buffer);
+    }
+  }
+
+  if (!EFI_ERROR (Status) && !EFI_ERROR (Database->Status) &&
+      (Size == Database->DataSize) && (CompareMem (Database->Buffer, Database->Data, Size) == 0)) {
+    //
+    // The database didn't change, its index is still valid.
+    //
+    return EFI_SUCCESS;
+  }
+
+  Database->DataSize = 0;
+  if (!EFI_ERROR (Status)) {
+    //
+    // Keep the new content, and read the variable into the old one next time.
+    //
+    Buffer                   = Database->Data;
+    BufferSize               = Database->DataBufferSize;
+    Database->Data           = Database->Buffer;
+    Database->DataBufferSize = Database->BufferSize;
+    Database->DataSize       = Size;
+    Database->Buffer         = Buffer;
+    Database->BufferSize     = BufferSize;
+    Status = IndexSignatureDatabase (Database);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Database->DataSize = 0;
+  }
+  Database->Status = Status;
+
+  return Status;
+}
+
+/**
+  Find a signature in a signature database by its value.
+
+  For the X.509 certificate hash signature types, the value is the hash of
+  the certificate, and the revocation time follows it in the signature.
+
+  @param[in]  Database          The signature database.
+  @param[in]  SignatureType     The type of the signature list.
+  @param[in]  Value             The value of the signature.
+  @param[in]  ValueSize         The size of the value.
+  @param[out] SignatureList     The signature list the signature was found in.
+
+  @return The first signature of the database with this type and value, or
+          NULL if there is none.
+
+**/
+EFI_SIGNATURE_DATA *
+FindSignatureInDatabase (
+  IN  SIGNATURE_DATABASE    *Database,
+  IN  EFI_GUID              *SignatureType,
+  IN  UINT8                 *Value,
+  IN  UINTN                 ValueSize,
+  OUT EFI_SIGNATURE_LIST    **SignatureList
+  )
+{
+  SIGNATURE_DATABASE_ENTRY  *Entry;
+  UINTN                     Slot;
+
+  if (EFI_ERROR (Database->Status) || (Database->EntryCount == 0) || (ValueSize == 0)) {
+    return NULL;
+  }
+
+  //
+  // The signatures with the same value are in the order of the database
+  // along their probe sequence, so the first one found is the first one in
+  // the database.
+  //
+  Slot = HashSignatureValue (Value, ValueSize) & (Database->EntryCount - 1);
+  for (Entry = &Database->Entries[Slot]; Entry->SignatureList != NULL; Entry = &Database->Entries[Slot]) {
+    if ((GetSignatureValueSize (Entry->SignatureList) == ValueSize) &&
+        CompareGuid (&Entry->SignatureList->SignatureType, SignatureType) &&
+        (CompareMem (Entry->Signature->SignatureData, Value, ValueSize) == 0)) {
+      *SignatureList = Entry->SignatureList;
+      return Entry->Signature;
+    }
+
+    Slot = (Slot + 1) & (Database->EntryCount - 1);
+  }
+
+  return NULL;
+}
+
+/**
+  Find the hash of an X.509 certificate in a signature database.
+
+  The TBSCertificate is hashed with each hash algorithm of the X.509
+  certificate hash signature lists in the database.
+
+  @param[in]  Database          The signature database.
+  @param[in]  TBSCert           The TBSCertificate of the X.509 certificate.
+  @param[in]  TBSCertSize       The size of the TBSCertificate.
+  @param[out] CertHash          The first certificate hash signature of the
+                                database matching the certificate, or NULL if
+                                there is none. The revocation time follows the
+                                hash in the signature.
+  @param[out] DigestSize        The size of the hash in CertHash.
+
+  @retval EFI_SUCCESS           The database was searched.
+  @retval EFI_ABORTED           The certificate can't be hashed.
+
+**/
+EFI_STATUS
+FindCertHashInDatabase (
+  IN  SIGNATURE_DATABASE    *Database,
+  IN  UINT8                 *TBSCert,
+  IN  UINTN                 TBSCertSize,
+  OUT EFI_SIGNATURE_DATA    **CertHash,
+  OUT UINTN                 *DigestSize
+  )
+{
+  EFI_STATUS                Status;
+  EFI_SIGNATURE_LIST        *SignatureList;
+  EFI_SIGNATURE_DATA        *Signature;
+  UINTN                     Index;
+  UINT32                    HashAlg;
+  VOID                      *HashCtx;
+  UINT8                     CertDigest[MAX_DIGEST_SIZE];
+
+  Status      = EFI_ABORTED;
+  HashCtx     = NULL;
+  *CertHash   = NULL;
+  *DigestSize = 0;
+
+  for (Index = 0; Index < ARRAY_SIZE (mCertHashType); Index++) {
+    HashAlg = GetCertHashAlg (mCertHashType[Index]);
+    if ((Database->CertHashAlgs & (1 << HashAlg)) == 0) {
+      continue;
+    }
+
+    //
+    // Calculate the hash value of the TBSCertificate for comparision.
+    //
+    if (mHash[HashAlg].GetContextSize == NULL) {
+      goto Done;
+    }
+    ZeroMem (CertDigest, MAX_DIGEST_SIZE);
+    HashCtx = AllocatePool (mHash[HashAlg].GetContextSize ());
+    if (HashCtx == NULL) {
+      goto Done;
+    }
+    if (!mHash[HashAlg].HashInit (HashCtx)) {
+      goto Done;
+    }
+    if (!mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize)) {
+      goto Done;
+    }
+    if (!mHash[HashAlg].HashFinal (HashCtx, CertDigest)) {
+      goto Done;
+    }
+
+    FreePool (HashCtx);
+    HashCtx = NULL;
+
+    Signature = FindSignatureInDatabase (
+                  Database,
+                  mCertHashType[Index],
+                  CertDigest,
+                  mHash[HashAlg].DigestLength,
+                  &SignatureList
+                  );
+    //
+    // Keep the hash that comes first in the database.
+    //
+    if ((Signature != NULL) && ((*CertHash == NULL) || ((UINTN) Signature < (UINTN) *CertHash))) {
+      *CertHash   = Signature;
+      *DigestSize = mHash[HashAlg].DigestLength;
+    }
+  }
+
+  Status = EFI_SUCCESS;
+
+Done:
+  if (HashCtx != NULL) {
+    FreePool (HashCtx);
+  }
+  if (EFI_ERROR (Status)) {
+    *CertHash   = NULL;
+    *DigestSize = 0;
+  }
+
+  return Status;
+}
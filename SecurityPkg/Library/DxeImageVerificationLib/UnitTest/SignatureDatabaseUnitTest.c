@@ -0,0 +1,946 @@
+/** @file
+  Host based unit test of the hash index of the signature databases of
+  DxeImageVerificationLib.
+
+  The test reads the dbx from a variable in memory, and checks that the
+  signatures are found in the order of the database, that the malformed
+  signature lists are skipped, that the index follows the variable when it
+  changes, and that a database that can't be indexed matches nothing and
+  keeps its error status, so that the image verification fails closed.
+
+  The hash functions of the test only need to be deterministic, the digests
+  of the X.509 certificate hash signatures are computed with them.
+
+  Copyright (c) 2021, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeImageVerificationLib.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "Signature Database Unit Test"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_VARIABLE_SIZE        SIZE_16KB
+#define TEST_HASH_SIZE            SHA256_DIGEST_SIZE
+#define TEST_HASH_SIGNATURE_SIZE  (sizeof (EFI_GUID) + TEST_HASH_SIZE)
+
+//
+// Context of the hash functions of the test.
+//
+typedef struct {
+  UINTN  DigestLength;
+  UINT8  Digest[MAX_DIGEST_SIZE];
+} TEST_HASH_CONTEXT;
+
+UINTN
+EFIAPI
+TestHashGetContextSize (
+  VOID
+  );
+
+BOOLEAN
+EFIAPI
+TestSha256Init (
+  IN OUT VOID  *HashContext
+  );
+
+BOOLEAN
+EFIAPI
+TestSha384Init (
+  IN OUT VOID  *HashContext
+  );
+
+BOOLEAN
+EFIAPI
+TestSha512Init (
+  IN OUT VOID  *HashContext
+  );
+
+BOOLEAN
+EFIAPI
+TestHashUpdate (
+  IN OUT VOID        *HashContext,
+  IN     CONST VOID  *Data,
+  IN     UINTN       DataLength
+  );
+
+BOOLEAN
+EFIAPI
+TestHashFinal (
+  IN OUT VOID   *HashContext,
+  OUT    UINT8  *HashValue
+  );
+
+HASH_TABLE mHash[] = {
+  { L"SHA1",   SHA1_DIGEST_SIZE,   NULL, 0, NULL,                   NULL,           NULL,           NULL          },
+  { L"SHA224", 28,                 NULL, 0, NULL,                   NULL,           NULL,           NULL          },
+  { L"SHA256", SHA256_DIGEST_SIZE, NULL, 0, TestHashGetContextSize, TestSha256Init, TestHashUpdate, TestHashFinal },
+  { L"SHA384", SHA384_DIGEST_SIZE, NULL, 0, TestHashGetContextSize, TestSha384Init, TestHashUpdate, TestHashFinal },
+  { L"SHA512", SHA512_DIGEST_SIZE, NULL, 0, TestHashGetContextSize, TestSha512Init, TestHashUpdate, TestHashFinal }
+};
+
+EFI_STATUS
+EFIAPI
+TestGetVariable (
+  IN     CHAR16    *VariableName,
+  IN     EFI_GUID  *VendorGuid,
+  OUT    UINT32    *Attributes,    OPTIONAL
+  IN OUT UINTN     *DataSize,
+  OUT    VOID      *Data           OPTIONAL
+  );
+
+EFI_RUNTIME_SERVICES   mRuntimeServices;
+EFI_RUNTIME_SERVICES   *gRT = &mRuntimeServices;
+
+//
+// The dbx variable of the test.
+//
+UINT8                  mVariable[TEST_VARIABLE_SIZE];
+UINTN                  mVariableSize;
+BOOLEAN                mVariableExists;
+
+//
+// The number of allocations that succeed before the next one fails.
+//
+UINTN                  mAllocationsBeforeFailure = MAX_UINTN;
+
+//
+// The TBSCertificate the X.509 certificate hash signatures are made of.
+//
+UINT8                  mTestTbsCert[] = {
+  0x30, 0x82, 0x01, 0x0A, 0xA0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x09, 0x00,
+  0xB4, 0x1C, 0x6E, 0x35, 0xD9, 0x02, 0x7A, 0x58, 0x30, 0x0D, 0x06, 0x09
+};
+
+/**
+  Allocates a buffer of type EfiBootServicesData for the signature database,
+  unless the allocation is set to fail.
+
+  The allocations of SignatureDatabase.c are made through this function by
+  the build options of the test.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+TestAllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  if (mAllocationsBeforeFailure == 0) {
+    return NULL;
+  }
+
+  mAllocationsBeforeFailure--;
+  return AllocateZeroPool (AllocationSize);
+}
+
+/**
+  Returns the dbx variable of the test.
+
+  @param  VariableName          The name of the variable.
+  @param  VendorGuid            The vendor GUID of the variable.
+  @param  Attributes            Unused.
+  @param  DataSize              The size of Data, and the size of the variable
+                                on return.
+  @param  Data                  The buffer the variable is returned in.
+
+  @retval EFI_SUCCESS           The variable is returned.
+  @retval EFI_NOT_FOUND         The variable doesn't exist.
+  @retval EFI_BUFFER_TOO_SMALL  Data is too small for the variable.
+
+**/
+EFI_STATUS
+EFIAPI
+TestGetVariable (
+  IN     CHAR16    *VariableName,
+  IN     EFI_GUID  *VendorGuid,
+  OUT    UINT32    *Attributes,    OPTIONAL
+  IN OUT UINTN     *DataSize,
+  OUT    VOID      *Data           OPTIONAL
+  )
+{
+  if (!mVariableExists || (StrCmp (VariableName, EFI_IMAGE_SECURITY_DATABASE1) != 0) ||
+      !CompareGuid (VendorGuid, &gEfiImageSecurityDatabaseGuid)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (*DataSize < mVariableSize) {
+    *DataSize = mVariableSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  CopyMem (Data, mVariable, mVariableSize);
+  *DataSize = mVariableSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the size of the context of the hash functions of the test.
+
+  @return The size of TEST_HASH_CONTEXT.
+
+**/
+UINTN
+EFIAPI
+TestHashGetContextSize (
+  VOID
+  )
+{
+  return sizeof (TEST_HASH_CONTEXT);
+}
+
+/**
+  Initializes the context of a hash of the test.
+
+  @param  HashContext           The context to initialize.
+  @param  DigestLength          The size of the digest.
+
+  @retval TRUE                  The context is initialized.
+
+**/
+BOOLEAN
+TestHashInit (
+  IN OUT VOID   *HashContext,
+  IN     UINTN  DigestLength
+  )
+{
+  TEST_HASH_CONTEXT  *Context;
+
+  Context = (TEST_HASH_CONTEXT *) HashContext;
+  Context->DigestLength = DigestLength;
+  SetMem (Context->Digest, sizeof (Context->Digest), (UINT8) DigestLength);
+  return TRUE;
+}
+
+/**
+  Initializes the context of the SHA-256 hash of the test.
+
+  @param  HashContext           The context to initialize.
+
+  @retval TRUE                  The context is initialized.
+
+**/
+BOOLEAN
+EFIAPI
+TestSha256Init (
+  IN OUT VOID  *HashContext
+  )
+{
+  return TestHashInit (HashContext, SHA256_DIGEST_SIZE);
+}
+
+/**
+  Initializes the context of the SHA-384 hash of the test.
+
+  @param  HashContext           The context to initialize.
+
+  @retval TRUE                  The context is initialized.
+
+**/
+BOOLEAN
+EFIAPI
+TestSha384Init (
+  IN OUT VOID  *HashContext
+  )
+{
+  return TestHashInit (HashContext, SHA384_DIGEST_SIZE);
+}
+
+/**
+  Initializes the context of the SHA-512 hash of the test.
+
+  @param  HashContext           The context to initialize.
+
+  @retval TRUE                  The context is initialized.
+
+**/
+BOOLEAN
+EFIAPI
+TestSha512Init (
+  IN OUT VOID  *HashContext
+  )
+{
+  return TestHashInit (HashContext, SHA512_DIGEST_SIZE);
+}
+
+/**
+  Adds data to a hash of the test.
+
+  @param  HashContext           The context of the hash.
+  @param  Data                  The data to hash.
+  @param  DataLength            The size of Data.
+
+  @retval TRUE                  The data is added to the hash.
+
+**/
+BOOLEAN
+EFIAPI
+TestHashUpdate (
+  IN OUT VOID        *HashContext,
+  IN     CONST VOID  *Data,
+  IN     UINTN       DataLength
+  )
+{
+  TEST_HASH_CONTEXT  *Context;
+  UINTN              Index;
+
+  Context = (TEST_HASH_CONTEXT *) HashContext;
+  for (Index = 0; Index < DataLength; Index++) {
+    Context->Digest[Index % Context->DigestLength] = (UINT8) (Context->Digest[Index % Context->DigestLength] * 31 + ((CONST UINT8 *) Data)[Index]);
+  }
+
+  return TRUE;
+}
+
+/**
+  Completes a hash of the test.
+
+  @param  HashContext           The context of the hash.
+  @param  HashValue             The buffer the digest is returned in.
+
+  @retval TRUE                  The digest is returned.
+
+**/
+BOOLEAN
+EFIAPI
+TestHashFinal (
+  IN OUT VOID   *HashContext,
+  OUT    UINT8  *HashValue
+  )
+{
+  TEST_HASH_CONTEXT  *Context;
+
+  Context = (TEST_HASH_CONTEXT *) HashContext;
+  CopyMem (HashValue, Context->Digest, Context->DigestLength);
+  return TRUE;
+}
+
+/**
+  Appends a signature list to the dbx variable of the test.
+
+  The value of each signature is made of Seed and of the index of the
+  signature in the list.
+
+  @param  SignatureType         The type of the signature list.
+  @param  SignatureSize         The size of each signature of the list.
+  @param  SignatureCount        The number of signatures of the list.
+  @param  Seed                  The seed of the values of the signatures.
+
+  @return The signature list.
+
+**/
+EFI_SIGNATURE_LIST *
+AppendSignatureList (
+  IN EFI_GUID  *SignatureType,
+  IN UINT32    SignatureSize,
+  IN UINTN     SignatureCount,
+  IN UINT8     Seed
+  )
+{
+  EFI_SIGNATURE_LIST  *SignatureList;
+  EFI_SIGNATURE_DATA  *Signature;
+  UINTN               Index;
+  UINTN               ValueIndex;
+
+  SignatureList = (EFI_SIGNATURE_LIST *) (mVariable + mVariableSize);
+  ZeroMem (SignatureList, sizeof (EFI_SIGNATURE_LIST) + SignatureSize * SignatureCount);
+  CopyGuid (&SignatureList->SignatureType, SignatureType);
+  SignatureList->SignatureListSize = (UINT32) (sizeof (EFI_SIGNATURE_LIST) + SignatureSize * SignatureCount);
+  SignatureList->SignatureSize     = SignatureSize;
+
+  Signature = (EFI_SIGNATURE_DATA *) (SignatureList + 1);
+  for (Index = 0; Index < SignatureCount; Index++) {
+    for (ValueIndex = 0; ValueIndex + sizeof (EFI_GUID) < SignatureSize; ValueIndex++) {
+      Signature->SignatureData[ValueIndex] = (UINT8) (Seed * 31 + ValueIndex);
+    }
+    if (SignatureSize > sizeof (EFI_GUID) + 2) {
+      Signature->SignatureData[0] = (UINT8) Index;
+      Signature->SignatureData[1] = (UINT8) (Index >> 8);
+    }
+    Signature = (EFI_SIGNATURE_DATA *) ((UINT8 *) Signature + SignatureSize);
+  }
+
+  mVariableSize  += SignatureList->SignatureListSize;
+  mVariableExists = TRUE;
+  return SignatureList;
+}
+
+/**
+  Computes the hash of the TBSCertificate of the test.
+
+  @param  HashAlg               The hash algorithm.
+  @param  Digest                The buffer the digest is returned in.
+
+**/
+VOID
+ComputeCertHash (
+  IN  UINT32  HashAlg,
+  OUT UINT8   *Digest
+  )
+{
+  TEST_HASH_CONTEXT  Context;
+
+  mHash[HashAlg].HashInit (&Context);
+  mHash[HashAlg].HashUpdate (&Context, mTestTbsCert, sizeof (mTestTbsCert));
+  mHash[HashAlg].HashFinal (&Context, Digest);
+}
+
+/**
+  Appends an X.509 certificate hash signature list, with the hash of the
+  TBSCertificate of the test, to the dbx variable of the test.
+
+  @param  HashAlg               The hash algorithm of the signature list.
+  @param  Year                  The year of the revocation time.
+
+  @return The signature of the list.
+
+**/
+EFI_SIGNATURE_DATA *
+AppendCertHashList (
+  IN UINT32  HashAlg,
+  IN UINT16  Year
+  )
+{
+  EFI_GUID            *SignatureTypes[] = { NULL, NULL, &gEfiCertX509Sha256Guid, &gEfiCertX509Sha384Guid, &gEfiCertX509Sha512Guid };
+  EFI_SIGNATURE_LIST  *SignatureList;
+  EFI_SIGNATURE_DATA  *Signature;
+  EFI_TIME            *RevocationTime;
+
+  SignatureList = AppendSignatureList (
+                    SignatureTypes[HashAlg],
+                    (UINT32) (sizeof (EFI_GUID) + mHash[HashAlg].DigestLength + sizeof (EFI_TIME)),
+                    1,
+                    0
+                    );
+  Signature = (EFI_SIGNATURE_DATA *) (SignatureList + 1);
+
+  ComputeCertHash (HashAlg, Signature->SignatureData);
+
+  RevocationTime = (EFI_TIME *) (Signature->SignatureData + mHash[HashAlg].DigestLength);
+  ZeroMem (RevocationTime, sizeof (EFI_TIME));
+  RevocationTime->Year = Year;
+  return Signature;
+}
+
+/**
+  Returns the signature of a signature list in the dbx read by the database.
+
+  @param  SignatureList         The signature list in the dbx variable of the
+                                test.
+  @param  Index                 The index of the signature in the list.
+
+  @return The signature in Database->Data.
+
+**/
+EFI_SIGNATURE_DATA *
+GetDatabaseSignature (
+  IN EFI_SIGNATURE_LIST  *SignatureList,
+  IN UINTN               Index
+  )
+{
+  return (EFI_SIGNATURE_DATA *) (mDbx.Data + ((UINT8 *) SignatureList - mVariable) +
+                                 sizeof (EFI_SIGNATURE_LIST) + SignatureList->SignatureHeaderSize +
+                                 Index * SignatureList->SignatureSize);
+}
+
+/**
+  Looks a signature of the dbx variable of the test up in the database.
+
+  @param  SignatureList         The signature list in the dbx variable of the
+                                test.
+  @param  Index                 The index of the signature in the list.
+  @param  ValueSize             The size of the value of the signature.
+
+  @return The signature found, or NULL.
+
+**/
+EFI_SIGNATURE_DATA *
+FindTestSignature (
+  IN EFI_SIGNATURE_LIST  *SignatureList,
+  IN UINTN               Index,
+  IN UINTN               ValueSize
+  )
+{
+  EFI_SIGNATURE_DATA  *Signature;
+  EFI_SIGNATURE_LIST  *FoundList;
+
+  Signature = (EFI_SIGNATURE_DATA *) ((UINT8 *) (SignatureList + 1) + SignatureList->SignatureHeaderSize +
+                                      Index * SignatureList->SignatureSize);
+  return FindSignatureInDatabase (&mDbx, &SignatureList->SignatureType, Signature->SignatureData, ValueSize, &FoundList);
+}
+
+/**
+  Checks that a signature of the dbx variable of the test is found in the
+  database, at its own place.
+
+  @param  SignatureList         The signature list in the dbx variable of the
+                                test.
+  @param  Index                 The index of the signature in the list.
+
+  @retval UNIT_TEST_PASSED      The signature is found.
+
+**/
+UNIT_TEST_STATUS
+CheckSignatureFound (
+  IN EFI_SIGNATURE_LIST  *SignatureList,
+  IN UINTN               Index
+  )
+{
+  UT_ASSERT_EQUAL (
+    (UINTN) FindTestSignature (SignatureList, Index, SignatureList->SignatureSize - sizeof (EFI_GUID)),
+    (UINTN) GetDatabaseSignature (SignatureList, Index)
+    );
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Empties the dbx variable of the test and the dbx database.
+
+  @param  Context               Unused.
+
+  @retval UNIT_TEST_PASSED      The dbx is empty.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetDbx (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ZeroMem (mVariable, sizeof (mVariable));
+  mVariableSize             = 0;
+  mVariableExists           = FALSE;
+  mAllocationsBeforeFailure = MAX_UINTN;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the dbx database.
+
+  @param  Context               Unused.
+
+**/
+VOID
+EFIAPI
+FreeDbx (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mDbx.Data != NULL) {
+    FreePool (mDbx.Data);
+  }
+  if (mDbx.Buffer != NULL) {
+    FreePool (mDbx.Buffer);
+  }
+  if (mDbx.Entries != NULL) {
+    FreePool (mDbx.Entries);
+  }
+
+  ZeroMem (&mDbx, sizeof (mDbx));
+  mDbx.VariableName = EFI_IMAGE_SECURITY_DATABASE1;
+  mDbx.Status       = EFI_NOT_FOUND;
+}
+
+/**
+  Checks that each signature of the hash signature lists is found, and that
+  a value present in several lists is found in the first one.
+
+  @param  Context               Unused.
+
+  @retval UNIT_TEST_PASSED      The signatures are found in the order of the
+                                database.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FirstDuplicateIsFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_SIGNATURE_LIST  *First;
+  EFI_SIGNATURE_LIST  *Other;
+  EFI_SIGNATURE_LIST  *Duplicate;
+  EFI_SIGNATURE_LIST  *FoundList;
+  UINTN               Index;
+  UINT8               Value[TEST_HASH_SIZE];
+
+  First     = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 200, 1);
+  Other     = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 10, 2);
+  Duplicate = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 3, 1);
+
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (mDbx.CertHashAlgs, 0);
+
+  for (Index = 0; Index < 200; Index++) {
+    UT_ASSERT_EQUAL (CheckSignatureFound (First, Index), UNIT_TEST_PASSED);
+  }
+  for (Index = 0; Index < 10; Index++) {
+    UT_ASSERT_EQUAL (CheckSignatureFound (Other, Index), UNIT_TEST_PASSED);
+  }
+
+  //
+  // The duplicates of the last list are found in the first one.
+  //
+  for (Index = 0; Index < 3; Index++) {
+    UT_ASSERT_EQUAL ((UINTN) FindTestSignature (Duplicate, Index, TEST_HASH_SIZE), (UINTN) GetDatabaseSignature (First, Index));
+  }
+
+  //
+  // A value is only found with the type and the size of its list.
+  //
+  UT_ASSERT_EQUAL ((UINTN) FindSignatureInDatabase (&mDbx, &gEfiCertSha384Guid, GetDatabaseSignature (First, 0)->SignatureData, TEST_HASH_SIZE, &FoundList), 0);
+  UT_ASSERT_EQUAL ((UINTN) FindSignatureInDatabase (&mDbx, &gEfiCertSha256Guid, GetDatabaseSignature (First, 0)->SignatureData, TEST_HASH_SIZE - 1, &FoundList), 0);
+
+  ZeroMem (Value, sizeof (Value));
+  UT_ASSERT_EQUAL ((UINTN) FindSignatureInDatabase (&mDbx, &gEfiCertSha256Guid, Value, sizeof (Value), &FoundList), 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the hash of a certificate is found in the SHA-256, SHA-384 and
+  SHA-512 X.509 certificate hash signature lists, and that the one that comes
+  first in the database gives the revocation time.
+
+  @param  Context               Unused.
+
+  @retval UNIT_TEST_PASSED      The earliest certificate hash is found.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+EarliestCertHashIsFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT32              HashAlg;
+  EFI_SIGNATURE_DATA  *CertHash;
+  UINTN               DigestSize;
+
+  //
+  // The certificate hash of each algorithm is found alone.
+  //
+  for (HashAlg = HASHALG_SHA256; HashAlg <= HASHALG_SHA512; HashAlg++) {
+    FreeDbx (NULL);
+    ResetDbx (NULL);
+    AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 4, 1);
+    AppendCertHashList (HashAlg, (UINT16) (2000 + HashAlg));
+
+    UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+    UT_ASSERT_EQUAL (mDbx.CertHashAlgs, (UINT32) (1 << HashAlg));
+    UT_ASSERT_NOT_EFI_ERROR (FindCertHashInDatabase (&mDbx, mTestTbsCert, sizeof (mTestTbsCert), &CertHash, &DigestSize));
+    UT_ASSERT_NOT_NULL (CertHash);
+    UT_ASSERT_EQUAL (DigestSize, mHash[HashAlg].DigestLength);
+    UT_ASSERT_EQUAL (((EFI_TIME *) (CertHash->SignatureData + DigestSize))->Year, 2000 + HashAlg);
+  }
+
+  //
+  // The SHA-512 hash comes first, then a SHA-256 hash revoked at another
+  // time, then the SHA-384 hash.
+  //
+  FreeDbx (NULL);
+  ResetDbx (NULL);
+  AppendCertHashList (HASHALG_SHA512, 2012);
+  AppendCertHashList (HASHALG_SHA256, 2010);
+  AppendCertHashList (HASHALG_SHA384, 2011);
+  AppendCertHashList (HASHALG_SHA256, 2020);
+
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_NOT_EFI_ERROR (FindCertHashInDatabase (&mDbx, mTestTbsCert, sizeof (mTestTbsCert), &CertHash, &DigestSize));
+  UT_ASSERT_EQUAL ((UINTN) CertHash, (UINTN) (mDbx.Data + sizeof (EFI_SIGNATURE_LIST)));
+  UT_ASSERT_EQUAL (DigestSize, SHA512_DIGEST_SIZE);
+  UT_ASSERT_EQUAL (((EFI_TIME *) (CertHash->SignatureData + DigestSize))->Year, 2012);
+
+  //
+  // Another certificate isn't found.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (FindCertHashInDatabase (&mDbx, mTestTbsCert, sizeof (mTestTbsCert) - 1, &CertHash, &DigestSize));
+  UT_ASSERT_EQUAL ((UINTN) CertHash, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that a signature list with a SignatureSize of 0, or with a header
+  bigger than the list, ends the signature lists, and that an X.509
+  certificate hash signature list too short for the revocation time is
+  skipped.
+
+  @param  Context               Unused.
+
+  @retval UNIT_TEST_PASSED      The malformed lists are not indexed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MalformedListsAreSkipped (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_SIGNATURE_LIST  *Before;
+  EFI_SIGNATURE_LIST  *ShortCertHash;
+  EFI_SIGNATURE_LIST  *After;
+  EFI_SIGNATURE_LIST  *Malformed;
+  EFI_SIGNATURE_LIST  *Ignored;
+  EFI_SIGNATURE_DATA  *CertHash;
+  UINTN               DigestSize;
+
+  //
+  // A certificate hash list without room for the revocation time is skipped.
+  //
+  Before        = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 2, 1);
+  ShortCertHash = AppendSignatureList (&gEfiCertX509Sha256Guid, sizeof (EFI_GUID) + SHA256_DIGEST_SIZE, 1, 0);
+  ComputeCertHash (HASHALG_SHA256, ((EFI_SIGNATURE_DATA *) (ShortCertHash + 1))->SignatureData);
+  After = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 2, 2);
+
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (mDbx.CertHashAlgs, 0);
+  UT_ASSERT_NOT_EFI_ERROR (FindCertHashInDatabase (&mDbx, mTestTbsCert, sizeof (mTestTbsCert), &CertHash, &DigestSize));
+  UT_ASSERT_EQUAL ((UINTN) CertHash, 0);
+  UT_ASSERT_EQUAL (CheckSignatureFound (Before, 1), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckSignatureFound (After, 1), UNIT_TEST_PASSED);
+
+  //
+  // A list with a SignatureSize of 0 ends the lists.
+  //
+  Malformed = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 1, 3);
+  Malformed->SignatureSize = 0;
+  Ignored = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 2, 4);
+
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (After, 1), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (Ignored, 1, TEST_HASH_SIZE), 0);
+
+  //
+  // So does a list with a header bigger than the list.
+  //
+  Malformed->SignatureSize       = TEST_HASH_SIGNATURE_SIZE;
+  Malformed->SignatureHeaderSize = Malformed->SignatureListSize + 1;
+
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (After, 1), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (Ignored, 1, TEST_HASH_SIZE), 0);
+
+  //
+  // The lists are found again once the list is fixed.
+  //
+  Malformed->SignatureHeaderSize = 0;
+
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (Malformed, 0), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckSignatureFound (Ignored, 1), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that the index follows the dbx variable when it grows, shrinks, is
+  deleted and is created again between two refreshes.
+
+  @param  Context               Unused.
+
+  @retval UNIT_TEST_PASSED      The index matches the variable.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ChangedVariableIsIndexed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_SIGNATURE_LIST  *First;
+  EFI_SIGNATURE_LIST  *Added;
+  UINT8               *Data;
+
+  First = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 4, 1);
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (First, 3), UNIT_TEST_PASSED);
+
+  //
+  // The database isn't parsed again if the variable didn't change.
+  //
+  Data = mDbx.Data;
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL ((UINTN) mDbx.Data, (UINTN) Data);
+
+  //
+  // The variable grows.
+  //
+  Added = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 150, 2);
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (mDbx.DataSize, mVariableSize);
+  UT_ASSERT_EQUAL (CheckSignatureFound (First, 3), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (CheckSignatureFound (Added, 149), UNIT_TEST_PASSED);
+
+  //
+  // A value of the variable changes.
+  //
+  ((EFI_SIGNATURE_DATA *) (First + 1))->SignatureData[TEST_HASH_SIZE - 1] ^= 0xFF;
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (First, 0), UNIT_TEST_PASSED);
+
+  //
+  // The variable shrinks.
+  //
+  mVariableSize -= Added->SignatureListSize;
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (mDbx.DataSize, mVariableSize);
+  UT_ASSERT_EQUAL (CheckSignatureFound (First, 3), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (Added, 149, TEST_HASH_SIZE), 0);
+
+  //
+  // The variable is deleted.
+  //
+  mVariableExists = FALSE;
+  UT_ASSERT_STATUS_EQUAL (RefreshSignatureDatabase (&mDbx), EFI_NOT_FOUND);
+  UT_ASSERT_STATUS_EQUAL (mDbx.Status, EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (First, 3, TEST_HASH_SIZE), 0);
+
+  //
+  // The variable is created again with the same content.
+  //
+  mVariableExists = TRUE;
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (First, 3), UNIT_TEST_PASSED);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that a dbx that can't be read or indexed for lack of memory keeps
+  its error status and matches nothing, until it is refreshed successfully.
+
+  @param  Context               Unused.
+
+  @retval UNIT_TEST_PASSED      The database fails closed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocationFailureFailsClosed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_SIGNATURE_LIST  *First;
+  EFI_SIGNATURE_LIST  *Added;
+  EFI_SIGNATURE_DATA  *CertHash;
+  UINTN               DigestSize;
+
+  First = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 4, 1);
+  AppendCertHashList (HASHALG_SHA256, 2000);
+
+  //
+  // The variable is read, but the index can't be allocated.
+  //
+  mAllocationsBeforeFailure = 1;
+  UT_ASSERT_STATUS_EQUAL (RefreshSignatureDatabase (&mDbx), EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_STATUS_EQUAL (mDbx.Status, EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL (mDbx.DataSize, 0);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (First, 0, TEST_HASH_SIZE), 0);
+
+  //
+  // The same content is indexed once the memory is back.
+  //
+  mAllocationsBeforeFailure = MAX_UINTN;
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (First, 0), UNIT_TEST_PASSED);
+  UT_ASSERT_NOT_EFI_ERROR (FindCertHashInDatabase (&mDbx, mTestTbsCert, sizeof (mTestTbsCert), &CertHash, &DigestSize));
+  UT_ASSERT_NOT_NULL (CertHash);
+
+  //
+  // The variable grows, and can't be read.
+  //
+  Added = AppendSignatureList (&gEfiCertSha256Guid, TEST_HASH_SIGNATURE_SIZE, 150, 2);
+  mAllocationsBeforeFailure = 0;
+  UT_ASSERT_STATUS_EQUAL (RefreshSignatureDatabase (&mDbx), EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_STATUS_EQUAL (mDbx.Status, EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (First, 0, TEST_HASH_SIZE), 0);
+
+  //
+  // The grown variable is read, but its bigger index can't be allocated.
+  //
+  mAllocationsBeforeFailure = 1;
+  UT_ASSERT_STATUS_EQUAL (RefreshSignatureDatabase (&mDbx), EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_STATUS_EQUAL (mDbx.Status, EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (First, 0, TEST_HASH_SIZE), 0);
+  UT_ASSERT_EQUAL ((UINTN) FindTestSignature (Added, 0, TEST_HASH_SIZE), 0);
+
+  //
+  // The hash context of a certificate can't be allocated.
+  //
+  mAllocationsBeforeFailure = MAX_UINTN;
+  UT_ASSERT_NOT_EFI_ERROR (RefreshSignatureDatabase (&mDbx));
+  UT_ASSERT_EQUAL (CheckSignatureFound (Added, 149), UNIT_TEST_PASSED);
+  mAllocationsBeforeFailure = 0;
+  UT_ASSERT_STATUS_EQUAL (FindCertHashInDatabase (&mDbx, mTestTbsCert, sizeof (mTestTbsCert), &CertHash, &DigestSize), EFI_ABORTED);
+  UT_ASSERT_EQUAL ((UINTN) CertHash, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the hash
+  index of the signature databases and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SignatureDatabaseTests;
+
+  Framework = NULL;
+
+  mRuntimeServices.GetVariable = TestGetVariable;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SignatureDatabaseTests, Framework, "Signature Database Index", "ImageVerification.SignatureDatabase", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SignatureDatabaseTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-----------------Description-----------------------------------------Class Name--------------------------Function----------------------Pre-------Post-----Context
+  AddTestCase (SignatureDatabaseTests, "The first duplicate signature is found",             "FirstDuplicateIsFound",         FirstDuplicateIsFound,         ResetDbx, FreeDbx, NULL);
+  AddTestCase (SignatureDatabaseTests, "The earliest certificate hash is found",             "EarliestCertHashIsFound",       EarliestCertHashIsFound,       ResetDbx, FreeDbx, NULL);
+  AddTestCase (SignatureDatabaseTests, "Malformed signature lists are skipped",              "MalformedListsAreSkipped",      MalformedListsAreSkipped,      ResetDbx, FreeDbx, NULL);
+  AddTestCase (SignatureDatabaseTests, "A changed variable is indexed again",                "ChangedVariableIsIndexed",      ChangedVariableIsIndexed,      ResetDbx, FreeDbx, NULL);
+  AddTestCase (SignatureDatabaseTests, "An allocation failure fails closed",                 "AllocationFailureFailsClosed",  AllocationFailureFailsClosed,  ResetDbx, FreeDbx, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}